@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Counters of the global operator new, defined in main.cpp
+extern std::atomic<uint64_t> g_allocCount;
+extern std::atomic<uint64_t> g_allocBytes;
+
+// Results are written here so the compiler cannot remove the benchmarked code
+extern volatile uint64_t g_sink;
+
+//--------------------------------------------------------------------------------------------------
+// Minimal benchmark runner
+// - Each benchmark is run in `nbSamples` batches; the batch size is chosen so that a batch lasts
+//   about `minTime / nbSamples` seconds. A sample is the average time of one operation in a batch.
+// - Allocations are counted over all batches, and reported per operation
+// - `itemsPerOp` (triangles, pixels, instances, ...) gives the throughput in items per second
+//
+class BenchmarkRunner
+{
+public:
+  struct Result
+  {
+    std::string         name;
+    std::string         unit;  // What an item is
+    uint64_t            itemsPerOp{1};
+    uint64_t            iterations{0};
+    std::vector<double> samplesNs;  // Time of one operation, one entry per batch
+    double              medianNs{0};
+    double              allocsPerOp{0};
+    double              bytesPerOp{0};
+  };
+
+  void setFilter(const std::string& filter) { m_filter = filter; }
+  void setSamples(uint32_t nbSamples) { m_nbSamples = std::max(nbSamples, 1u); }
+  void setMinTime(double seconds) { m_minTime = seconds; }
+
+  bool isEnabled(const std::string& name) const
+  {
+    return m_filter.empty() || name.find(m_filter) != std::string::npos;
+  }
+
+  template <typename Op>
+  void run(const std::string& name, const char* unit, uint64_t itemsPerOp, Op&& op)
+  {
+    using Clock = std::chrono::steady_clock;
+    if(!isEnabled(name))
+      return;
+
+    // Warm up, and estimation of the batch size
+    auto start = Clock::now();
+    op();
+    double   opTime    = std::chrono::duration<double>(Clock::now() - start).count();
+    double   batchTime = m_minTime / m_nbSamples;
+    uint64_t batchSize = static_cast<uint64_t>(batchTime / std::max(opTime, 1e-9));
+    batchSize          = std::max<uint64_t>(batchSize, 1);
+
+    Result result;
+    result.name       = name;
+    result.unit       = unit;
+    result.itemsPerOp = itemsPerOp;
+
+    uint64_t allocCount = g_allocCount;
+    uint64_t allocBytes = g_allocBytes;
+    for(uint32_t s = 0; s < m_nbSamples; s++)
+    {
+      start = Clock::now();
+      for(uint64_t i = 0; i < batchSize; i++)
+        op();
+      double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+      result.samplesNs.push_back(elapsed / batchSize);
+    }
+    result.iterations  = batchSize * m_nbSamples;
+    result.allocsPerOp = static_cast<double>(g_allocCount - allocCount) / result.iterations;
+    result.bytesPerOp  = static_cast<double>(g_allocBytes - allocBytes) / result.iterations;
+
+    std::vector<double> sorted = result.samplesNs;
+    std::sort(sorted.begin(), sorted.end());
+    size_t mid      = sorted.size() / 2;
+    result.medianNs = sorted.size() % 2 ? sorted[mid] : 0.5 * (sorted[mid - 1] + sorted[mid]);
+
+    printf("%-36s %12.3f us %14.3e %s/s %10.1f allocs %12.0f B\n", name.c_str(),
+           result.medianNs / 1000.0, itemsPerSecond(result), unit, result.allocsPerOp,
+           result.bytesPerOp);
+    fflush(stdout);
+    m_results.push_back(std::move(result));
+  }
+
+  static double itemsPerSecond(const Result& r)
+  {
+    return r.medianNs > 0 ? r.itemsPerOp * 1e9 / r.medianNs : 0;
+  }
+
+  //------------------------------------------------------------------------------------------------
+  // {"benchmarks":[{"name":"...","unit":"triangles","items_per_op":N,"iterations":N,"median_ns":X,
+  //   "items_per_second":X,"allocs_per_op":X,"bytes_per_op":X,"samples_ns":[...]},...]}
+  //
+  bool writeJson(const std::string& filename) const
+  {
+    FILE* file = fopen(filename.c_str(), "w");
+    if(file == nullptr)
+      return false;
+    fprintf(file, "{\"benchmarks\":[");
+    for(size_t i = 0; i < m_results.size(); i++)
+    {
+      const Result& r = m_results[i];
+      fprintf(file, "%s\n{\"name\":\"%s\",\"unit\":\"%s\",", i ? "," : "", r.name.c_str(),
+              r.unit.c_str());
+      fprintf(file, "\"items_per_op\":%llu,\"iterations\":%llu,",
+              static_cast<unsigned long long>(r.itemsPerOp),
+              static_cast<unsigned long long>(r.iterations));
+      fprintf(file, "\"median_ns\":%.1f,\"items_per_second\":%.6e,", r.medianNs, itemsPerSecond(r));
+      fprintf(file, "\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f,\"samples_ns\":[", r.allocsPerOp,
+              r.bytesPerOp);
+      for(size_t s = 0; s < r.samplesNs.size(); s++)
+        fprintf(file, "%s%.1f", s ? "," : "", r.samplesNs[s]);
+      fprintf(file, "]}");
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+  }
+
+private:
+  std::string         m_filter;
+  uint32_t            m_nbSamples{15};
+  double              m_minTime{0.5};
+  std::vector<Result> m_results;
+};
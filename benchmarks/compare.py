@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+# SPDX-License-Identifier: Apache-2.0
+
+"""Compares performance results of a baseline and a candidate.
+
+Reads any of the files written by the samples and the benchmarks:
+  - vk_benchmarks_KHR --json          {"benchmarks":[{"name", "samples_ns", "allocs_per_op"...}]}
+  - GPU profiler capture, JSON        {"frames":[{"frame", "passes":[{"name", "gpu_ms"}]}]}
+  - GPU profiler capture, CSV         frame,pass,depth,gpu_ms
+  - Startup trace (load_trace.json)   {"traceEvents":[{"name", "ph":"X", "dur"}]}
+
+Several files can be given for each side (repeated runs). The samples of all files are
+pooled, and the median of each run is kept to show the run-to-run spread.
+
+For each metric, the change is the ratio of the candidate median over the baseline median,
+with a bootstrap confidence interval. A metric regresses when the whole interval is above
+1 + threshold, it improves when the whole interval is below 1 - threshold; anything else is
+considered noise. All metrics are "lower is better" (times, allocations).
+
+Usage:
+  compare.py -b base_run1.json base_run2.json -c cand_run1.json cand_run2.json
+  compare.py -b gpu_timings_base.csv -c gpu_timings.csv --threshold 3 --metric "Ray trace=1"
+Exit code is 1 when a metric regresses, so it can be used in scripts.
+"""
+
+import argparse
+import csv
+import json
+import random
+import statistics
+import sys
+
+
+def load_samples(filename):
+    """Returns {metric: [samples]} for one result file. Times are in milliseconds."""
+    metrics = {}
+
+    def add(name, value):
+        metrics.setdefault(name, []).append(float(value))
+
+    if filename.lower().endswith(".csv"):
+        with open(filename, newline="") as f:
+            for row in csv.DictReader(f):
+                add("gpu/" + row["pass"], row["gpu_ms"])
+        return metrics
+
+    with open(filename) as f:
+        data = json.load(f)
+
+    if "benchmarks" in data:
+        for bench in data["benchmarks"]:
+            for sample in bench.get("samples_ns", [bench.get("median_ns", 0)]):
+                add("cpu/" + bench["name"], sample / 1e6)
+            # Allocations are deterministic: one value per run
+            add("alloc/" + bench["name"], bench.get("allocs_per_op", 0))
+    elif "frames" in data:
+        for frame in data["frames"]:
+            for section in frame["passes"]:
+                add("gpu/" + section["name"], section["gpu_ms"])
+    elif "traceEvents" in data:
+        for event in data["traceEvents"]:
+            if event.get("ph") == "X":
+                add("trace/" + event["name"], event["dur"] / 1000.0)
+    else:
+        raise ValueError("%s: unknown result format" % filename)
+    return metrics
+
+
+def load_runs(filenames):
+    """Pools the samples of several runs, keeps the median of each run."""
+    pooled, run_medians = {}, {}
+    for filename in filenames:
+        for name, samples in load_samples(filename).items():
+            pooled.setdefault(name, []).extend(samples)
+            run_medians.setdefault(name, []).append(statistics.median(samples))
+    return pooled, run_medians
+
+
+def mad(samples):
+    """Median absolute deviation, scaled to be comparable to a standard deviation."""
+    med = statistics.median(samples)
+    return 1.4826 * statistics.median([abs(s - med) for s in samples])
+
+
+def bootstrap_ratio_ci(base, cand, confidence, iterations, rng):
+    """Confidence interval of median(cand) / median(base), percentile bootstrap."""
+    ratios = []
+    for _ in range(iterations):
+        b = statistics.median(rng.choices(base, k=len(base)))
+        c = statistics.median(rng.choices(cand, k=len(cand)))
+        ratios.append(c / b if b > 0 else float("inf") if c > 0 else 1.0)
+    ratios.sort()
+    alpha = (1.0 - confidence) / 2.0
+    low = ratios[int(alpha * (iterations - 1))]
+    high = ratios[int((1.0 - alpha) * (iterations - 1))]
+    return low, high
+
+
+def parse_metric_thresholds(values):
+    thresholds = {}
+    for value in values or []:
+        name, _, percent = value.rpartition("=")
+        if not name:
+            raise ValueError("--metric expects NAME=PERCENT, got '%s'" % value)
+        thresholds[name] = float(percent) / 100.0
+    return thresholds
+
+
+def threshold_for(name, default, overrides):
+    # Overrides match the full metric name or the part after the category ("Ray trace")
+    short = name.split("/", 1)[-1]
+    return overrides.get(name, overrides.get(short, default))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-b", "--baseline", nargs="+", required=True,
+                        help="baseline result files")
+    parser.add_argument("-c", "--candidate", nargs="+", required=True,
+                        help="candidate result files")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="default threshold in percent (5)")
+    parser.add_argument("--metric", action="append", help="per-metric threshold, NAME=PERCENT")
+    parser.add_argument("--confidence", type=float, default=0.95, help="confidence level (0.95)")
+    parser.add_argument("--bootstrap", type=int, default=2000, help="bootstrap iterations (2000)")
+    parser.add_argument("--min-samples", type=int, default=3,
+                        help="skip metrics with fewer samples")
+    parser.add_argument("--filter", default="", help="only metrics containing this string")
+    parser.add_argument("--json", help="write the comparison to this file")
+    args = parser.parse_args()
+
+    overrides = parse_metric_thresholds(args.metric)
+    base, base_runs = load_runs(args.baseline)
+    cand, cand_runs = load_runs(args.candidate)
+    rng = random.Random(0)  # Same intervals for the same inputs
+
+    header = "%-40s %11s %9s %11s %9s %8s %17s  %s" % (
+        "Metric", "base med", "base MAD", "cand med", "cand MAD", "change", "CI", "verdict")
+    print(header)
+    print("-" * len(header))
+
+    report, regressions = [], 0
+    for name in sorted(set(base) | set(cand)):
+        if args.filter not in name:
+            continue
+        if name not in base or name not in cand:
+            print("%-40s %s" % (name, "only in " + ("baseline" if name in base else "candidate")))
+            continue
+
+        b, c = base[name], cand[name]
+        b_med, c_med = statistics.median(b), statistics.median(c)
+        entry = {"metric": name, "baseline_median": b_med, "candidate_median": c_med,
+                 "baseline_mad": mad(b), "candidate_mad": mad(c),
+                 "baseline_runs": base_runs[name], "candidate_runs": cand_runs[name]}
+
+        threshold = threshold_for(name, args.threshold / 100.0, overrides)
+        if name.startswith("alloc/"):
+            # Not noisy: compare the values directly
+            ratio = c_med / b_med if b_med > 0 else (1.0 if c_med == 0 else float("inf"))
+            low = high = ratio
+        elif len(b) < args.min_samples or len(c) < args.min_samples:
+            print("%-40s %s" % (name, "not enough samples"))
+            continue
+        else:
+            ratio = c_med / b_med if b_med > 0 else float("inf")
+            low, high = bootstrap_ratio_ci(b, c, args.confidence, args.bootstrap, rng)
+
+        if low > 1.0 + threshold:
+            verdict = "REGRESSION"
+            regressions += 1
+        elif high < 1.0 - threshold:
+            verdict = "improvement"
+        else:
+            verdict = "-"
+
+        entry.update({"ratio": ratio, "ci_low": low, "ci_high": high, "threshold": threshold,
+                      "verdict": verdict})
+        report.append(entry)
+        print("%-40s %11.4f %9.4f %11.4f %9.4f %+7.1f%% [%+6.1f%%,%+6.1f%%]  %s" % (
+            name[:40], b_med, entry["baseline_mad"], c_med, entry["candidate_mad"],
+            (ratio - 1.0) * 100.0, (low - 1.0) * 100.0, (high - 1.0) * 100.0, verdict))
+
+    print("\n%d metric(s) compared, %d regression(s)" % (len(report), regressions))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"metrics": report, "regressions": regressions}, f, indent=1)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,566 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//--------------------------------------------------------------------------------------------------
+// CPU micro-benchmarks of the loading and preprocessing done by the samples before any Vulkan
+// call. No device is needed.
+//
+// Usage: vk_benchmarks_KHR [--json <file>] [--filter <substring>] [--samples <n>]
+//                          [--min-time <seconds>] [--quick]
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "alias_table.h"
+#include "benchmark.h"
+#include "nvh/fileoperations.hpp"
+#include "nvpsystem.hpp"
+#include "obj_loader.h"
+#include "sample_sequences.h"
+#include "sbt_layout.h"
+#include "scene_generator.h"
+#include "trace_events.h"
+
+std::atomic<uint64_t> g_allocCount{0};
+std::atomic<uint64_t> g_allocBytes{0};
+volatile uint64_t     g_sink = 0;
+
+// Counting all allocations going through the global operator new (std containers, strings, ...)
+void* operator new(size_t size)
+{
+  g_allocCount++;
+  g_allocBytes += size;
+  if(void* ptr = malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+std::vector<std::string> defaultSearchPaths;
+
+
+//--------------------------------------------------------------------------------------------------
+// OBJ parsing, on generated meshes of increasing size and on the meshes of the samples
+//
+static void benchObjLoad(BenchmarkRunner& runner, const std::vector<uint32_t>& sizes)
+{
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "vk_raytracing_bench";
+
+  for(uint32_t tris : sizes)
+  {
+    std::string name = "obj_load/generated_" + std::to_string(tris);
+    if(!runner.isEnabled(name))
+      continue;
+
+    std::filesystem::path sizeDir = dir / std::to_string(tris);
+    std::filesystem::create_directories(sizeDir);
+
+    SceneGenerator::Settings settings;
+    settings.nbMeshes         = 1;
+    settings.trianglesPerMesh = tris;
+    settings.materialsPerMesh = 4;
+
+    SceneGenerator::Scene scene = SceneGenerator::generate(settings);
+    SceneGenerator::writeObj(scene, sizeDir.string());
+
+    std::string filename = (sizeDir / "mesh_0.obj").string();
+    auto        nbTris   = static_cast<uint64_t>(scene.meshes[0].m_indices.size() / 3);
+    runner.run(name, "triangles", nbTris, [&]() {
+      ObjLoader loader;
+      loader.loadModel(filename);
+      g_sink += loader.m_vertices.size();
+    });
+  }
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+
+  for(const char* media : {"media/scenes/Medieval_building.obj", "media/scenes/wuson.obj"})
+  {
+    std::string filename = nvh::findFile(media, defaultSearchPaths, false);
+    if(filename.empty())
+      continue;
+    ObjLoader probe;
+    probe.loadModel(filename);
+    std::string name = std::string("obj_load/") + std::filesystem::path(media).stem().string();
+    runner.run(name, "triangles", probe.m_indices.size() / 3, [&]() {
+      ObjLoader loader;
+      loader.loadModel(filename);
+      g_sink += loader.m_vertices.size();
+    });
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Material colors from sRGB to linear, as done by the samples after loading an OBJ
+//
+static void benchSrgbToLinear(BenchmarkRunner& runner, uint32_t nbMaterials)
+{
+  std::vector<MaterialObj> source(nbMaterials);
+  for(uint32_t i = 0; i < nbMaterials; i++)
+    source[i].diffuse = nvmath::vec3f((i % 256) / 255.f, ((i / 7) % 256) / 255.f, 0.5f);
+
+  std::vector<MaterialObj> materials;
+  runner.run("srgb_to_linear/" + std::to_string(nbMaterials), "materials", nbMaterials, [&]() {
+    materials = source;
+    for(auto& m : materials)
+    {
+      m.ambient  = nvmath::pow(m.ambient, 2.2f);
+      m.diffuse  = nvmath::pow(m.diffuse, 2.2f);
+      m.specular = nvmath::pow(m.specular, 2.2f);
+    }
+    g_sink += static_cast<uint64_t>(materials.back().diffuse.x * 255.f);
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Normals of meshes without normals (ObjLoader::computeNormals)
+//
+static void benchNormals(BenchmarkRunner& runner, const std::vector<uint32_t>& sizes)
+{
+  for(uint32_t tris : sizes)
+  {
+    SceneGenerator::Settings settings;
+    settings.trianglesPerMesh = tris;
+    ObjLoader mesh            = SceneGenerator::generate(settings).meshes[0];
+
+    runner.run("compute_normals/" + std::to_string(tris), "triangles", mesh.m_indices.size() / 3,
+               [&]() {
+                 mesh.computeNormals();
+                 g_sink += static_cast<uint64_t>(mesh.m_vertices[0].nrm.y);
+               });
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Texture decoding from memory (no file access), with the textures of the media folder
+//
+static void benchTextureDecode(BenchmarkRunner& runner)
+{
+  for(const char* media : {"media/textures/WoodRough0106_2_S.jpg", "media/textures/compass.jpg",
+                           "media/textures/out_0_6E339CC8.png"})
+  {
+    std::string filename = nvh::findFile(media, defaultSearchPaths, false);
+    if(filename.empty())
+      continue;
+    std::string data = nvh::loadFile(filename, true);
+
+    // Skips the files stb cannot decode (unsupported variant of the format, truncated file)
+    int      w = 0, h = 0, comp = 0;
+    stbi_uc* probe = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data.data()),
+                                           static_cast<int>(data.size()), &w, &h, &comp,
+                                           STBI_rgb_alpha);
+    if(probe == nullptr)
+    {
+      fprintf(stderr, "texture_decode: cannot decode %s: %s\n", media, stbi_failure_reason());
+      continue;
+    }
+    stbi_image_free(probe);
+
+    std::string name = "texture_decode/" + std::filesystem::path(media).filename().string();
+    runner.run(name, "pixels", static_cast<uint64_t>(w) * h, [&]() {
+      int      width, height, channels;
+      stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data.data()),
+                                              static_cast<int>(data.size()), &width, &height,
+                                              &channels, STBI_rgb_alpha);
+      if(pixels == nullptr)
+        return;
+      g_sink += pixels[0];
+      stbi_image_free(pixels);
+    });
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Instance matrices and their inverse transpose, as stored in the scene description
+//
+static void benchInstanceTransforms(BenchmarkRunner& runner, uint32_t nbInstances)
+{
+  SceneGenerator::Settings settings;
+  settings.nbInstances      = nbInstances;
+  settings.nbMeshes         = 1;
+  settings.trianglesPerMesh = 6;
+
+  SceneGenerator::Scene scene = SceneGenerator::generate(settings);
+
+  std::vector<nvmath::mat4f> transformIT(nbInstances);
+  runner.run("instance_inverse/" + std::to_string(nbInstances), "instances", nbInstances, [&]() {
+    for(uint32_t i = 0; i < nbInstances; i++)
+      transformIT[i] = nvmath::transpose(nvmath::invert(scene.instances[i].transform));
+    g_sink += static_cast<uint64_t>(transformIT.back()(0, 0));
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bounding boxes of implicit spheres (ray_tracing_intersection)
+//
+static void benchAabbs(BenchmarkRunner& runner, uint32_t nbSpheres)
+{
+  struct Aabb
+  {
+    nvmath::vec3f minimum;
+    nvmath::vec3f maximum;
+  };
+
+  SceneGenerator::Settings settings;
+  settings.nbSpheres          = nbSpheres;
+  SceneGenerator::Scene scene = SceneGenerator::generate(settings);
+
+  runner.run("sphere_aabbs/" + std::to_string(nbSpheres), "spheres", nbSpheres, [&]() {
+    std::vector<Aabb> aabbs;
+    aabbs.reserve(nbSpheres);
+    for(const auto& s : scene.spheres)
+    {
+      Aabb aabb;
+      aabb.minimum = s.center - nvmath::vec3f(s.radius);
+      aabb.maximum = s.center + nvmath::vec3f(s.radius);
+      aabbs.emplace_back(aabb);
+    }
+    g_sink += static_cast<uint64_t>(aabbs.back().maximum.x);
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Shader binding table layout: strides, regions, and copy of the handles and record data, with the
+// typical properties of a device (32 bytes handles, 64 bytes base alignment) and fake handles.
+// The update benchmark changes the data of one hit record, as done when editing a material.
+//
+static void benchSbtLayout(BenchmarkRunner& runner, uint32_t nbHitGroups)
+{
+  const uint32_t groupCount = 2 + nbHitGroups;  // raygen, miss, hits
+  struct HitData
+  {
+    float color[4];
+  };
+
+  SbtLayout::Properties properties;
+  properties.handleSize      = 32;
+  properties.handleAlignment = 32;
+  properties.baseAlignment   = 64;
+
+  std::vector<uint8_t> handles(static_cast<size_t>(groupCount) * properties.handleSize, 0xAB);
+  std::vector<uint8_t> sbt;
+  SbtLayout            layout;
+  std::string          error;
+  auto                 build = [&]() {
+    layout.setup(properties);
+    layout.addRecord(SbtLayout::eRaygen, 0);
+    layout.addRecord(SbtLayout::eMiss, 1);
+    for(uint32_t g = 0; g < nbHitGroups; g++)
+      layout.addRecord(SbtLayout::eHit, 2 + g, HitData{{1.f, 1.f, 1.f, 1.f}});
+    if(!layout.finalize(&error))
+    {
+      fprintf(stderr, "sbt_layout: %s\n", error.c_str());
+      exit(EXIT_FAILURE);
+    }
+    sbt.resize(layout.getSize());
+    layout.write(sbt.data(), handles.data(), groupCount);
+  };
+
+  // Expected layout: raygen 64 bytes (32 aligned to the base), miss 32 bytes right after, hits
+  // 32 + 16 bytes rounded to 64, starting on the base alignment
+  auto check = [&](bool condition, const char* what) {
+    if(!condition)
+    {
+      fprintf(stderr, "sbt_layout: wrong %s\n", what);
+      exit(EXIT_FAILURE);
+    }
+  };
+  const uint64_t hitOffset = 128;
+  auto           hitData   = [&](uint32_t r) {
+    float value[4];
+    memcpy(value, sbt.data() + hitOffset + 64 * r + properties.handleSize, sizeof(value));
+    return value[3];
+  };
+  layout.setup(properties);
+  layout.addRecord(SbtLayout::eHit, 2, HitData{});
+  check(!layout.setRecordData(SbtLayout::eHit, 0, HitData{}), "update before finalize");
+  build();
+  check(layout.getStride(SbtLayout::eRaygen) == 64 && layout.getStride(SbtLayout::eMiss) == 32
+            && layout.getStride(SbtLayout::eHit) == 64
+            && layout.getStride(SbtLayout::eCallable) == 0,
+        "strides");
+  check(layout.getOffset(SbtLayout::eRaygen) == 0 && layout.getOffset(SbtLayout::eMiss) == 64
+            && layout.getOffset(SbtLayout::eHit) == hitOffset,
+        "offsets");
+  check(layout.getSize() == hitOffset + 64ULL * nbHitGroups, "size");
+  auto regions = layout.getRegions(0x10000);
+  check(regions[SbtLayout::eRaygen].deviceAddress == 0x10000
+            && regions[SbtLayout::eRaygen].size == 64
+            && regions[SbtLayout::eMiss].deviceAddress == 0x10040
+            && regions[SbtLayout::eMiss].size == 32
+            && regions[SbtLayout::eHit].deviceAddress == 0x10000 + hitOffset
+            && regions[SbtLayout::eHit].stride == 64
+            && regions[SbtLayout::eHit].size == 64ULL * nbHitGroups
+            && regions[SbtLayout::eCallable].size == 0,
+        "regions");
+  check(sbt[hitOffset] == 0xAB && hitData(nbHitGroups - 1) == 1.f, "records");
+
+  // One update: only the data of the record is dirty
+  uint32_t updated = nbHitGroups / 2;
+  check(layout.setRecordData(SbtLayout::eHit, updated, HitData{{0.5f, 0.5f, 0.5f, 2.f}}),
+        "update after finalize");
+  layout.writeDirty(sbt.data());
+  uint64_t dirtyOffset = 0, dirtySize = 0;
+  check(layout.getDirtyRange(dirtyOffset, dirtySize)
+            && dirtyOffset == hitOffset + 64 * updated + properties.handleSize
+            && dirtySize == sizeof(HitData),
+        "dirty range");
+  check(hitData(updated) == 2.f && sbt[hitOffset + 64 * updated] == 0xAB, "updated record");
+  layout.clearDirty();
+  check(!layout.getDirtyRange(dirtyOffset, dirtySize), "dirty range after clearDirty");
+
+  runner.run("sbt_layout/" + std::to_string(nbHitGroups), "groups", groupCount, [&]() {
+    build();
+    g_sink += layout.getRegions(0)[SbtLayout::eHit].size + sbt[layout.getOffset(SbtLayout::eHit)];
+  });
+
+  build();
+  uint32_t record = 0;
+  runner.run("sbt_update/" + std::to_string(nbHitGroups), "records", 1, [&]() {
+    HitData data{{0.5f, 0.5f, 0.5f, float(record)}};
+    layout.setRecordData(SbtLayout::eHit, record, data);
+    layout.writeDirty(sbt.data());
+    uint64_t offset = 0, size = 0;
+    layout.getDirtyRange(offset, size);
+    layout.clearDirty();
+    record = (record + 1) % nbHitGroups;
+    g_sink += offset + size;
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Light sampling table of the emissive triangles (ray_tracing_gltf), on one and on all threads.
+// The powers have a large dynamic range, as for a few bright lights among many dim triangles.
+//
+static void benchAliasTable(BenchmarkRunner& runner, const std::vector<uint32_t>& sizes)
+{
+  for(uint32_t count : sizes)
+  {
+    std::vector<float> powers(count);
+    uint32_t           state = 0x9E3779B9u;
+    for(auto& p : powers)
+    {
+      state = state * 1664525u + 1013904223u;
+      p     = std::exp2(float(state >> 8) / float(1 << 24) * 16.f - 8.f);
+    }
+
+    AliasTable table;
+    for(uint32_t nbThreads : {1u, 0u})
+    {
+      std::string name = "alias_table/" + std::to_string(count) + (nbThreads ? "/1" : "/mt");
+      runner.run(name, "emitters", count, [&]() {
+        table.build(powers, nbThreads);
+        g_sink += table.getEntries().back().alias;
+      });
+    }
+    if(table.getMaxError() > 1e-6)
+    {
+      fprintf(stderr, "alias_table: error %g\n", table.getMaxError());
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sample sequences of the shaders (common/sample_sequences.h): generation time, and convergence
+// on an integral of known value, estimated in 32x32 pixels with 1 to 256 samples each.
+// The integrand has an edge in the first pair of dimensions (a disk, as a pixel footprint) and
+// is smooth in the second one (as a diffuse bounce). Besides the RMSE of the pixels, the RMSE
+// of the image filtered by a 3x3 box tells how the error is distributed: blue noise moves it to
+// high frequencies, where the filter (or the eye) removes it.
+//
+static void benchSampleSequences(BenchmarkRunner& runner)
+{
+  using Seq = SampleSequence;
+  const Seq::BlueNoise noise = Seq::generateBlueNoise();
+
+  // 64x64 pixels, 16 samples of 2 pairs of dimensions
+  for(int t = 0; t < Seq::eTypeCount; t++)
+  {
+    Seq::Type   type = Seq::Type(t);
+    std::string name = std::string("sampler/") + Seq::getTypeName(type);
+    runner.run(name, "samples", 64 * 64 * 16 * 2, [&]() {
+      float sum = 0.f;
+      for(uint32_t y = 0; y < 64; y++)
+        for(uint32_t x = 0; x < 64; x++)
+          for(uint32_t i = 0; i < 16; i++)
+          {
+            Seq sampler(type, x, y, i, &noise);
+            sum += sampler.next2D().x + sampler.next2D().y;
+          }
+      g_sink += static_cast<uint64_t>(sum);
+    });
+  }
+
+  if(!runner.isEnabled("sample_convergence"))
+    return;
+
+  const uint32_t size       = 32;
+  const uint32_t maxSamples = 256;
+  const double   radius     = 0.75;
+  const double   exact      = 3.14159265358979323846 * radius * radius / 4.0;
+  auto           integrand  = [&](nvmath::vec2f a, nvmath::vec2f b) {
+    double disk = a.x * a.x + a.y * a.y < radius * radius ? 1.0 : 0.0;
+    return disk * (1.0 + 0.5 * std::cos(2.0 * 3.14159265358979323846 * b.x) * b.y);
+  };
+
+  // rmse[type][spp - 1], for the pixels and the filtered image
+  std::vector<std::vector<double>> rmse(Seq::eTypeCount), filteredRmse(Seq::eTypeCount);
+  for(int t = 0; t < Seq::eTypeCount; t++)
+  {
+    std::vector<double> sums(size * size, 0.0);
+    for(uint32_t n = 1; n <= maxSamples; n++)
+    {
+      for(uint32_t p = 0; p < size * size; p++)
+      {
+        Seq           sampler(Seq::Type(t), p % size, p / size, n - 1, &noise);
+        nvmath::vec2f a = sampler.next2D();
+        nvmath::vec2f b = sampler.next2D();
+        sums[p] += integrand(a, b);
+      }
+
+      double error = 0.0, filteredError = 0.0;
+      for(uint32_t y = 0; y < size; y++)
+      {
+        for(uint32_t x = 0; x < size; x++)
+        {
+          double value = sums[y * size + x] / n - exact;
+          double box   = 0.0;
+          for(uint32_t k = 0; k < 9; k++)
+            box += sums[((y + size + k / 3 - 1) % size) * size + (x + size + k % 3 - 1) % size];
+          error += value * value;
+          filteredError += (box / (9.0 * n) - exact) * (box / (9.0 * n) - exact);
+        }
+      }
+      rmse[t].push_back(std::sqrt(error / (size * size)));
+      filteredRmse[t].push_back(std::sqrt(filteredError / (size * size)));
+    }
+  }
+
+  printf("\nConvergence, RMSE / RMSE of the 3x3 filtered image, %ux%u pixels\n", size, size);
+  printf("%-6s", "spp");
+  for(int t = 0; t < Seq::eTypeCount; t++)
+    printf(" %21s", Seq::getTypeName(Seq::Type(t)));
+  printf("\n");
+  for(uint32_t n = 1; n <= maxSamples; n *= 2)
+  {
+    printf("%-6u", n);
+    for(int t = 0; t < Seq::eTypeCount; t++)
+      printf("   %.3e / %.3e", rmse[t][n - 1], filteredRmse[t][n - 1]);
+    printf("\n");
+  }
+
+  // Samples needed to reach the error of white noise at 256 spp, and from there on
+  printf("%-6s", "spp for");
+  const double target = rmse[Seq::eWhite][maxSamples - 1];
+  for(int t = 0; t < Seq::eTypeCount; t++)
+  {
+    uint32_t needed = maxSamples;
+    while(needed > 1 && rmse[t][needed - 2] <= target)
+      needed--;
+    if(rmse[t][maxSamples - 1] <= target)
+      printf(" %21u", needed);
+    else
+      printf(" %21s", "-");
+  }
+  printf("  (the RMSE of white noise at %u spp)\n\n", maxSamples);
+}
+
+
+int main(int argc, char** argv)
+{
+  std::string jsonFile;
+  bool        quick = false;
+
+  BenchmarkRunner runner;
+  for(int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if(strcmp(argv[i], "--json") == 0 && hasValue)
+      jsonFile = argv[++i];
+    else if(strcmp(argv[i], "--filter") == 0 && hasValue)
+      runner.setFilter(argv[++i]);
+    else if(strcmp(argv[i], "--samples") == 0 && hasValue)
+      runner.setSamples(static_cast<uint32_t>(atoi(argv[++i])));
+    else if(strcmp(argv[i], "--min-time") == 0 && hasValue)
+      runner.setMinTime(atof(argv[++i]));
+    else if(strcmp(argv[i], "--quick") == 0)
+      quick = true;
+    else
+    {
+      printf("Usage: %s [--json <file>] [--filter <substring>] [--samples <n>] "
+             "[--min-time <seconds>] [--quick]\n",
+             argv[0]);
+      return 1;
+    }
+  }
+
+  NVPSystem system(PROJECT_NAME);
+  defaultSearchPaths = {
+      NVPSystem::exePath() + PROJECT_RELDIRECTORY,
+      NVPSystem::exePath() + PROJECT_RELDIRECTORY "..",
+      std::string(PROJECT_NAME),
+  };
+
+  // Not measuring the trace recording of the loader
+  TraceRecorder::get().setEnabled(false);
+
+  std::vector<uint32_t> sizes = {1000, 10000, 100000};
+  if(!quick)
+    sizes.push_back(1000000);
+  uint32_t count = quick ? 10000 : 100000;
+
+  printf("%-36s %15s %20s %17s %14s\n", "Benchmark", "median", "throughput", "allocs/op",
+         "bytes/op");
+  benchObjLoad(runner, sizes);
+  benchSrgbToLinear(runner, count);
+  benchNormals(runner, sizes);
+  benchTextureDecode(runner);
+  benchInstanceTransforms(runner, count);
+  benchAabbs(runner, count * 10);
+  benchSbtLayout(runner, 16);
+  benchSbtLayout(runner, count / 10);
+  benchAliasTable(runner, sizes);
+  benchSampleSequences(runner);
+
+  if(!jsonFile.empty())
+  {
+    if(!runner.writeJson(jsonFile))
+    {
+      printf("Cannot write %s\n", jsonFile.c_str());
+      return 1;
+    }
+    printf("Results written to %s\n", jsonFile.c_str());
+  }
+  return 0;
+}
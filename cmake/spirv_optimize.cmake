@@ -0,0 +1,89 @@
+#*****************************************************************************
+# Copyright 2021 NVIDIA Corporation. All rights reserved.
+#*****************************************************************************
+
+#--------------------------------------------------------------------------------------------------
+# Offline optimization of the SPIR-V modules compiled by compile_glsl_directory
+#
+# - Each module of SPV is optimized by spirv-opt in DST (spv/opt), with the preset
+#   SPIRV_OPT_PRESET: "performance" (-O), "size" (-Os) or "none" (copy)
+# - SPIRV_OPT_STRIP_DEBUG removes the debug instructions (names, lines, sources) in Release
+# - A report of the size and instruction counts, unoptimized and optimized, is written in
+#   DST/spirv_report.txt (and .json) when Python is found
+#
+# Usage, after compile_glsl_directory:
+#   optimize_spirv(SPV ${SPV_OUTPUT} DST "${CMAKE_CURRENT_SOURCE_DIR}/spv/opt")
+#   target_sources(${PROJNAME} PUBLIC ${SPV_OPT_OUTPUT})
+#
+set(SPIRV_OPT_PRESET "performance" CACHE STRING "spirv-opt preset: performance, size or none")
+set_property(CACHE SPIRV_OPT_PRESET PROPERTY STRINGS "performance" "size" "none")
+option(SPIRV_OPT_STRIP_DEBUG "Strip the debug information of optimized SPIR-V in Release" ON)
+
+find_program(SPIRV_OPT_EXECUTABLE
+  NAMES spirv-opt
+  HINTS "$ENV{VULKAN_SDK}/bin" "$ENV{VULKAN_SDK}/Bin"
+  DOC "SPIR-V optimizer of SPIRV-Tools"
+  )
+find_package(Python3 COMPONENTS Interpreter QUIET)
+set(SPIRV_REPORT_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/spirv_report.py)
+
+function(optimize_spirv)
+  set(oneValueArgs DST)
+  set(multiValueArgs SPV)
+  cmake_parse_arguments(OPT "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+  if(SPIRV_OPT_PRESET STREQUAL "size")
+    set(_OPT_FLAGS -Os)
+  elseif(SPIRV_OPT_PRESET STREQUAL "none")
+    set(_OPT_FLAGS "")
+  else()
+    set(_OPT_FLAGS -O)
+  endif()
+  if(SPIRV_OPT_STRIP_DEBUG)
+    list(APPEND _OPT_FLAGS "$<$<CONFIG:Release>:--strip-debug>")
+  endif()
+
+  if(NOT SPIRV_OPT_EXECUTABLE)
+    message(STATUS "spirv-opt not found: the modules of ${OPT_DST} are not optimized")
+  endif()
+
+  set(_OUTPUTS "")
+  foreach(_SPV ${OPT_SPV})
+    get_filename_component(_NAME ${_SPV} NAME)
+    set(_OUT ${OPT_DST}/${_NAME})
+    if(SPIRV_OPT_EXECUTABLE AND NOT SPIRV_OPT_PRESET STREQUAL "none")
+      add_custom_command(
+        OUTPUT ${_OUT}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${OPT_DST}
+        COMMAND ${SPIRV_OPT_EXECUTABLE} ${_OPT_FLAGS} --target-env=vulkan1.2 ${_SPV} -o ${_OUT}
+        DEPENDS ${_SPV}
+        COMMENT "spirv-opt ${_NAME} (${SPIRV_OPT_PRESET})"
+        COMMAND_EXPAND_LISTS
+        VERBATIM
+        )
+    else()
+      add_custom_command(
+        OUTPUT ${_OUT}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${OPT_DST}
+        COMMAND ${CMAKE_COMMAND} -E copy ${_SPV} ${_OUT}
+        DEPENDS ${_SPV}
+        VERBATIM
+        )
+    endif()
+    list(APPEND _OUTPUTS ${_OUT})
+  endforeach()
+
+  if(Python3_Interpreter_FOUND AND _OUTPUTS)
+    add_custom_command(
+      OUTPUT ${OPT_DST}/spirv_report.txt
+      COMMAND ${Python3_EXECUTABLE} ${SPIRV_REPORT_SCRIPT} --base ${OPT_SPV} --opt ${_OUTPUTS}
+              --json ${OPT_DST}/spirv_report.json -o ${OPT_DST}/spirv_report.txt
+      DEPENDS ${_OUTPUTS} ${SPIRV_REPORT_SCRIPT}
+      COMMENT "SPIR-V report ${OPT_DST}/spirv_report.txt"
+      VERBATIM
+      )
+    list(APPEND _OUTPUTS ${OPT_DST}/spirv_report.txt)
+  endif()
+
+  set(SPV_OPT_OUTPUT ${_OUTPUTS} PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+# SPDX-License-Identifier: Apache-2.0
+
+
+"""Size and instruction counts of SPIR-V modules, before and after optimization.
+
+For each module (matched by file name between --base and --opt):
+  - size in bytes and number of instructions, without the debug instructions
+  - functions, basic blocks (OpLabel) and id bound
+  - register-pressure proxies: function-scope variables (OpVariable Function), OpPhi, and the
+    largest number of values defined in one basic block
+  - debug instructions (OpName, OpLine, OpSource...), removed by --strip-debug
+
+Usage:
+  spirv_report.py --base spv/a.spv spv/b.spv --opt spv/opt/a.spv spv/opt/b.spv [-o report.txt]
+                  [--json report.json]
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+SPIRV_MAGIC = 0x07230203
+
+OP_SOURCE_CONTINUED, OP_SOURCE, OP_SOURCE_EXTENSION = 2, 3, 4
+OP_NAME, OP_MEMBER_NAME, OP_STRING, OP_LINE = 5, 6, 7, 8
+OP_NO_LINE, OP_MODULE_PROCESSED = 317, 330
+OP_FUNCTION, OP_VARIABLE, OP_PHI, OP_LABEL = 54, 59, 245, 248
+OP_EXT_INST = 12
+DEBUG_OPS = {OP_SOURCE_CONTINUED, OP_SOURCE, OP_SOURCE_EXTENSION, OP_NAME, OP_MEMBER_NAME,
+             OP_STRING, OP_LINE, OP_NO_LINE, OP_MODULE_PROCESSED}
+STORAGE_FUNCTION = 7
+
+# Opcodes without result id, among the ones found in a function body (SPIR-V grammar, unified1).
+# OpLabel has one but starts a block, it is not a value.
+NO_RESULT_OPS = {
+    OP_LINE, OP_NO_LINE, OP_LABEL,
+    0,                        # OpNop
+    56,                       # OpFunctionEnd
+    62, 63, 64,               # OpStore, OpCopyMemory, OpCopyMemorySized
+    99,                       # OpImageWrite
+    218, 219, 220, 221,       # OpEmitVertex, OpEndPrimitive, OpEmitStreamVertex, OpEndStream...
+    224, 225, 228,            # OpControlBarrier, OpMemoryBarrier, OpAtomicStore
+    246, 247,                 # OpLoopMerge, OpSelectionMerge
+    249, 250, 251, 252,       # OpBranch, OpBranchConditional, OpSwitch, OpKill
+    253, 254, 255,            # OpReturn, OpReturnValue, OpUnreachable
+    256, 257,                 # OpLifetimeStart, OpLifetimeStop
+    329,                      # OpMemoryNamedBarrier
+    4416,                     # OpTerminateInvocation
+    4445, 4446, 4448, 4449,   # OpTraceRayKHR, OpExecuteCallableKHR, OpIgnoreIntersectionKHR,
+                              # OpTerminateRayKHR; 4447 (OpConvertUToAccelerationStructure) has one
+    4458,                     # OpCooperativeMatrixStoreKHR
+    4473, 4474, 4475, 4476,   # OpRayQueryInitialize, Terminate, GenerateIntersection and
+                              # ConfirmIntersectionKHR; not OpRayQueryProceedKHR nor the getters
+    5294, 5295, 5299,         # OpEmitMeshTasksEXT, OpSetMeshOutputsEXT, OpWritePacked...NV
+    5335, 5336, 5337,         # OpIgnoreIntersectionNV, OpTerminateRayNV, OpTraceNV
+    5338, 5339, 5344,         # OpTraceMotionNV, OpTraceRayMotionNV, OpExecuteCallableNV
+    5360,                     # OpCooperativeMatrixStoreNV
+    5364, 5365,               # OpBeginInvocationInterlockEXT, OpEndInvocationInterlockEXT
+    5380,                     # OpDemoteToHelperInvocation
+}
+
+
+def read_module(filename):
+    with open(filename, "rb") as f:
+        data = f.read()
+    if len(data) < 20 or len(data) % 4:
+        raise ValueError("%s: not a SPIR-V module" % filename)
+    endian = "<" if struct.unpack_from("<I", data)[0] == SPIRV_MAGIC else ">"
+    words = struct.unpack("%s%dI" % (endian, len(data) // 4), data)
+    if words[0] != SPIRV_MAGIC:
+        raise ValueError("%s: bad SPIR-V magic number" % filename)
+    return len(data), words
+
+
+def analyze(filename):
+    size, words = read_module(filename)
+    stats = {"bytes": size, "instructions": 0, "debug": 0, "functions": 0, "blocks": 0,
+             "id_bound": words[3], "function_vars": 0, "phis": 0, "max_block_values": 0,
+             "ext_inst": 0}
+    block_values = 0
+    i = 5
+    while i < len(words):
+        count, opcode = words[i] >> 16, words[i] & 0xFFFF
+        if count == 0:
+            raise ValueError("%s: invalid instruction at word %d" % (filename, i))
+        if opcode in DEBUG_OPS:
+            stats["debug"] += 1
+        else:
+            stats["instructions"] += 1
+        if opcode == OP_FUNCTION:
+            stats["functions"] += 1
+        elif opcode == OP_LABEL:
+            stats["blocks"] += 1
+            block_values = 0
+        elif opcode == OP_VARIABLE and words[i + 3] == STORAGE_FUNCTION:
+            stats["function_vars"] += 1
+        elif opcode == OP_PHI:
+            stats["phis"] += 1
+        elif opcode == OP_EXT_INST:
+            stats["ext_inst"] += 1
+        if stats["blocks"] and opcode not in NO_RESULT_OPS and opcode not in DEBUG_OPS:
+            block_values += 1
+            stats["max_block_values"] = max(stats["max_block_values"], block_values)
+        i += count
+    return stats
+
+
+COLUMNS = [("bytes", "bytes"), ("instructions", "instr"), ("blocks", "blocks"),
+           ("id_bound", "ids"), ("function_vars", "fvars"), ("phis", "phis"),
+           ("max_block_values", "blk vals"), ("debug", "debug")]
+
+
+def format_row(name, stats):
+    return "%-30s " % name[:30] + " ".join("%9d" % stats[key] for key, _ in COLUMNS)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--base", nargs="+", required=True, help="unoptimized modules")
+    parser.add_argument("--opt", nargs="+", required=True, help="optimized modules")
+    parser.add_argument("-o", "--output", help="text report (default: stdout)")
+    parser.add_argument("--json", help="write the report to this file")
+    args = parser.parse_args()
+
+    optimized = {os.path.basename(f): f for f in args.opt}
+    header = "%-30s " % "Module" + " ".join("%9s" % title for _, title in COLUMNS)
+    lines = [header, "-" * len(header)]
+    report = []
+    totals = {"base": dict.fromkeys([k for k, _ in COLUMNS], 0),
+              "opt": dict.fromkeys([k for k, _ in COLUMNS], 0)}
+    for base_file in args.base:
+        name = os.path.basename(base_file)
+        if name not in optimized:
+            continue
+        base, opt = analyze(base_file), analyze(optimized[name])
+        for key, _ in COLUMNS:
+            totals["base"][key] += base[key]
+            totals["opt"][key] += opt[key]
+        report.append({"module": name, "base": base, "opt": opt})
+        lines.append(format_row(name, base))
+        lines.append(format_row("  optimized", opt))
+
+    lines.append("-" * len(header))
+    lines.append(format_row("Total", totals["base"]))
+    lines.append(format_row("  optimized", totals["opt"]))
+    if totals["base"]["bytes"]:
+        lines.append("\nSize: %+.1f%%, instructions: %+.1f%%" % (
+            100.0 * (totals["opt"]["bytes"] / totals["base"]["bytes"] - 1.0),
+            100.0 * (totals["opt"]["instructions"] / max(totals["base"]["instructions"], 1) - 1.0)))
+
+    text = "\n".join(lines) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"modules": report, "totals": totals}, f, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "alias_table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// Below this size, starting threads costs more than it saves
+static const size_t s_minItemsPerThread = 16 * 1024;
+
+//--------------------------------------------------------------------------------------------------
+// Calls `func(chunk, begin, end)` on `nbChunks` contiguous ranges of [0, count), one per thread
+//
+template <typename Func>
+static void forEachChunk(size_t count, uint32_t nbChunks, Func&& func)
+{
+  if(nbChunks <= 1)
+  {
+    func(0u, size_t(0), count);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(nbChunks);
+  size_t chunkSize = (count + nbChunks - 1) / nbChunks;
+  for(uint32_t c = 0; c < nbChunks; c++)
+  {
+    size_t begin = std::min(count, c * chunkSize);
+    size_t end   = std::min(count, begin + chunkSize);
+    threads.emplace_back([&func, c, begin, end]() { func(c, begin, end); });
+  }
+  for(auto& t : threads)
+    t.join();
+}
+
+static float validWeight(float w)
+{
+  return std::isfinite(w) && w > 0.f ? w : 0.f;
+}
+
+void AliasTable::clear()
+{
+  m_entries.clear();
+  m_totalWeight = 0.0;
+}
+
+bool AliasTable::build(const std::vector<float>& weights, uint32_t nbThreads)
+{
+  clear();
+  const size_t count = weights.size();
+  if(count == 0)
+    return false;
+
+  if(nbThreads == 0)
+    nbThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  uint32_t nbChunks = static_cast<uint32_t>(
+      std::min<size_t>(nbThreads, (count + s_minItemsPerThread - 1) / s_minItemsPerThread));
+  nbChunks = std::max(nbChunks, 1u);
+
+  // Sum of the weights, the partial sums of the chunks are added in order
+  std::vector<double> partialSums(nbChunks, 0.0);
+  forEachChunk(count, nbChunks, [&](uint32_t chunk, size_t begin, size_t end) {
+    double sum = 0.0;
+    for(size_t i = begin; i < end; i++)
+      sum += validWeight(weights[i]);
+    partialSums[chunk] = sum;
+  });
+  double total = 0.0;
+  for(double s : partialSums)
+    total += s;
+  if(!(total > 0.0))
+    return false;
+
+  // Scaled weights (average 1) and the items below and above the average, per chunk
+  std::vector<double>                scaled(count);
+  std::vector<std::vector<uint32_t>> small(nbChunks), large(nbChunks);
+  m_entries.resize(count);
+  const double scale = static_cast<double>(count) / total;
+  forEachChunk(count, nbChunks, [&](uint32_t chunk, size_t begin, size_t end) {
+    for(size_t i = begin; i < end; i++)
+    {
+      float w             = validWeight(weights[i]);
+      scaled[i]           = w * scale;
+      m_entries[i].weight = w;
+      m_entries[i].pdf    = static_cast<float>(w / total);
+      (scaled[i] < 1.0 ? small[chunk] : large[chunk]).push_back(static_cast<uint32_t>(i));
+    }
+  });
+  std::vector<uint32_t> smallItems, largeItems;
+  smallItems.reserve(count);
+  largeItems.reserve(count);
+  for(uint32_t c = 0; c < nbChunks; c++)
+  {
+    smallItems.insert(smallItems.end(), small[c].begin(), small[c].end());
+    largeItems.insert(largeItems.end(), large[c].begin(), large[c].end());
+  }
+
+  // Vose: each small item is completed by a large one, which loses what it gave
+  while(!smallItems.empty() && !largeItems.empty())
+  {
+    uint32_t s = smallItems.back();
+    uint32_t l = largeItems.back();
+    smallItems.pop_back();
+
+    m_entries[s].prob  = static_cast<float>(scaled[s]);
+    m_entries[s].alias = l;
+    scaled[l]          = (scaled[l] + scaled[s]) - 1.0;
+    if(scaled[l] < 1.0)
+    {
+      largeItems.pop_back();
+      smallItems.push_back(l);
+    }
+  }
+  // What remains is 1 up to the rounding errors, except for the items of weight 0 left when the
+  // large items ran out first: they must never be sampled, their entries go to a heavy item
+  uint32_t heavy = 0;
+  for(uint32_t i = 1; i < count; i++)
+    heavy = m_entries[i].weight > m_entries[heavy].weight ? i : heavy;
+  for(uint32_t i : largeItems)
+    m_entries[i] = {1.f, i, m_entries[i].pdf, m_entries[i].weight};
+  for(uint32_t i : smallItems)
+  {
+    bool zero    = m_entries[i].weight == 0.f;
+    m_entries[i] = {zero ? 0.f : 1.f, zero ? heavy : i, m_entries[i].pdf, m_entries[i].weight};
+  }
+
+  m_totalWeight = total;
+  return true;
+}
+
+uint32_t AliasTable::sample(float u, float v) const
+{
+  const uint32_t count = static_cast<uint32_t>(m_entries.size());
+  uint32_t       i     = std::min(static_cast<uint32_t>(double(u) * count), count - 1);
+  return v < m_entries[i].prob ? i : m_entries[i].alias;
+}
+
+double AliasTable::getMaxError() const
+{
+  const size_t        count = m_entries.size();
+  std::vector<double> probabilities(count, 0.0);
+  for(size_t i = 0; i < count; i++)
+  {
+    probabilities[i] += m_entries[i].prob / double(count);
+    probabilities[m_entries[i].alias] += (1.0 - m_entries[i].prob) / double(count);
+  }
+
+  double maxError = 0.0;
+  for(size_t i = 0; i < count; i++)
+    maxError = std::max(maxError, std::abs(probabilities[i] - m_entries[i].weight / m_totalWeight));
+  return maxError;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Alias table (Walker, with the construction of Vose): samples N items proportionally to their
+// weights in constant time, with two random numbers
+//
+// - Each entry splits the range [i/N, (i+1)/N) in two: the item itself with probability `prob`,
+//   and the item `alias` otherwise. The sum of the parts of an item is its normalized weight.
+// - The entries are 16 bytes and std430 compatible: the table can be uploaded as is. `pdf` is the
+//   probability of the item of the entry, not of the sampled item: after sampling `j`, read
+//   `entries[j].pdf`.
+// - Negative, NaN and infinite weights are treated as 0. Items with a weight of 0 are never
+//   sampled, their entries always select their alias; a table where all the weights are 0 is
+//   empty.
+// - The normalization and the classification of the items are done on `nbThreads` threads, the
+//   pairing of the small and large items is sequential (linear). The items are classified in
+//   chunk order, so the table is the same for any number of threads, up to the rounding of
+//   the sum of the weights.
+// - Only CPU code: it can be built and checked without a device (see getMaxError())
+//
+// Usage:
+//   AliasTable table;
+//   table.build(powers);
+//   uint32_t light = table.sample(rnd(seed), rnd(seed));
+//   float    pdf   = table.getPdf(light);
+//   alloc.createBuffer(cmdBuf, table.getEntries(), vk::BufferUsageFlagBits::eStorageBuffer);
+//
+class AliasTable
+{
+public:
+  struct Entry
+  {
+    float    prob{1.f};    // Probability to keep the item of this entry, else `alias`
+    uint32_t alias{0};
+    float    pdf{0.f};     // Normalized weight of the item of this entry
+    float    weight{0.f};  // Weight as given to build()
+  };
+
+  // Returns false if there is nothing to sample (no item, or all weights are 0).
+  // `nbThreads` 0 uses std::thread::hardware_concurrency(); small tables are built on the
+  // calling thread.
+  bool build(const std::vector<float>& weights, uint32_t nbThreads = 0);
+  void clear();
+
+  bool   empty() const { return m_entries.empty(); }
+  size_t size() const { return m_entries.size(); }
+  // Sum of the valid weights, in double to keep the precision of large tables
+  double getTotalWeight() const { return m_totalWeight; }
+
+  // `u` and `v` in [0,1): `u` picks the entry, `v` its item or the alias. A separate number for
+  // the second choice keeps its precision: the fraction of u*N loses bits as N grows.
+  uint32_t sample(float u, float v) const;
+  float    getPdf(uint32_t item) const { return m_entries[item].pdf; }
+
+  const std::vector<Entry>& getEntries() const { return m_entries; }
+
+  // Largest difference between the probability of an item as encoded by the table and its
+  // normalized weight. Should be in the order of the float precision, 1e-6 * N.
+  double getMaxError() const;
+
+private:
+  std::vector<Entry> m_entries;
+  double             m_totalWeight{0.0};
+};
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "gpu_profiler.h"
+#include "imgui.h"
+#include "nvh/nvprint.hpp"
+
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------------------
+// Creating the query pool: two timestamps per section, `maxSections` per frame in flight
+//
+void GpuProfiler::setup(const vk::Device&         device,
+                        const vk::PhysicalDevice& physicalDevice,
+                        uint32_t                  queueFamily,
+                        uint32_t                  nbFrames,
+                        uint32_t                  maxSections)
+{
+  m_device      = device;
+  m_maxSections = maxSections;
+  m_slots.resize(nbFrames);
+
+  vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+  auto     queueFamilies = physicalDevice.getQueueFamilyProperties();
+  uint32_t validBits     = queueFamilies[queueFamily].timestampValidBits;
+  m_supported            = validBits > 0 && properties.limits.timestampPeriod > 0.f;
+  if(!m_supported)
+  {
+    LOGW("GpuProfiler: timestamps are not supported on queue family %d\n", queueFamily);
+    return;
+  }
+  m_timestampPeriod = properties.limits.timestampPeriod;
+  m_timestampMask   = validBits >= 64 ? ~0ULL : ((1ULL << validBits) - 1);
+
+  vk::QueryPoolCreateInfo createInfo;
+  createInfo.setQueryType(vk::QueryType::eTimestamp);
+  createInfo.setQueryCount(2 * m_maxSections * nbFrames);
+  m_queryPool = m_device.createQueryPool(createInfo);
+}
+
+void GpuProfiler::destroy()
+{
+  stopCapture();
+  if(m_device)
+    m_device.destroy(m_queryPool);
+  m_queryPool = vk::QueryPool();
+  m_slots.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Must be called outside of a render pass, before any section of the frame.
+// The results of the previous use of this frame slot are collected before resetting its queries.
+//
+void GpuProfiler::beginFrame(const vk::CommandBuffer& cmdBuf, uint32_t frameIndex)
+{
+  if(!m_supported)
+    return;
+
+  m_curSlot       = frameIndex % static_cast<uint32_t>(m_slots.size());
+  FrameSlot& slot = m_slots[m_curSlot];
+  if(slot.nbSections > 0)
+    readBack(slot, m_curSlot);
+
+  slot.frameNumber = m_frameNumber++;
+  slot.nbSections  = 0;
+  slot.names.clear();
+  slot.depths.clear();
+  m_openSections.clear();
+
+  cmdBuf.resetQueryPool(m_queryPool, 2 * m_maxSections * m_curSlot, 2 * m_maxSections);
+}
+
+void GpuProfiler::beginSection(const vk::CommandBuffer& cmdBuf, const char* name)
+{
+  if(!m_supported)
+    return;
+
+  FrameSlot& slot = m_slots[m_curSlot];
+  if(slot.nbSections >= m_maxSections)
+  {
+    m_openSections.push_back(~0u);  // Too many sections: ignored, but keep begin/end balanced
+    return;
+  }
+
+  uint32_t section = slot.nbSections++;
+  slot.names.emplace_back(name);
+  slot.depths.push_back(static_cast<uint32_t>(m_openSections.size()));
+  m_openSections.push_back(section);
+
+  uint32_t query = 2 * (m_maxSections * m_curSlot + section);
+  cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_queryPool, query);
+}
+
+void GpuProfiler::endSection(const vk::CommandBuffer& cmdBuf)
+{
+  if(!m_supported || m_openSections.empty())
+    return;
+
+  uint32_t section = m_openSections.back();
+  m_openSections.pop_back();
+  if(section == ~0u)
+    return;
+
+  uint32_t query = 2 * (m_maxSections * m_curSlot + section) + 1;
+  cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_queryPool, query);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Fetching the timestamps of a frame slot. The frame using the slot has completed (its fence
+// was waited in prepareFrame), so this does not wait. If the results are not there for some
+// reason, the frame is simply dropped.
+//
+void GpuProfiler::readBack(FrameSlot& slot, uint32_t slotIndex)
+{
+  std::vector<uint64_t> timestamps(2 * slot.nbSections);
+  vk::Result            result = m_device.getQueryPoolResults(
+      m_queryPool, 2 * m_maxSections * slotIndex, 2 * slot.nbSections,
+      timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+      vk::QueryResultFlagBits::e64);
+  if(result != vk::Result::eSuccess)
+    return;
+
+  m_lastFrame.clear();
+  m_lastFrameNumber = slot.frameNumber;
+  for(uint32_t i = 0; i < slot.nbSections; i++)
+  {
+    uint64_t begin = timestamps[2 * i + 0] & m_timestampMask;
+    uint64_t end   = timestamps[2 * i + 1] & m_timestampMask;
+    uint64_t ticks = (end - begin) & m_timestampMask;
+
+    Section section;
+    section.name  = slot.names[i];
+    section.depth = slot.depths[i];
+    section.gpuMs = static_cast<double>(ticks) * m_timestampPeriod / 1e6;
+    m_lastFrame.push_back(section);
+    accumulate(section);
+  }
+
+  if(isCapturing())
+    writeCapture(slot.frameNumber);
+}
+
+void GpuProfiler::accumulate(const Section& section)
+{
+  auto it = m_statsIndex.find(section.name);
+  if(it == m_statsIndex.end())
+  {
+    it = m_statsIndex.emplace(section.name, m_stats.size()).first;
+    Stats stats;
+    stats.name  = section.name;
+    stats.depth = section.depth;
+    stats.minMs = section.gpuMs;
+    stats.maxMs = section.gpuMs;
+    stats.avgMs = section.gpuMs;
+    m_stats.push_back(stats);
+  }
+
+  Stats& stats = m_stats[it->second];
+  stats.lastMs = section.gpuMs;
+  stats.avgMs  = stats.avgMs * 0.95 + section.gpuMs * 0.05;
+  stats.minMs  = std::min(stats.minMs, section.gpuMs);
+  stats.maxMs  = std::max(stats.maxMs, section.gpuMs);
+  stats.count++;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Capture
+// - CSV : one line per section: frame,pass,depth,gpu_ms
+// - JSON: {"frames":[{"frame":N,"passes":[{"name":"Ray trace","depth":0,"gpu_ms":1.23},...]},...]}
+//
+bool GpuProfiler::startCapture(const std::string& filename)
+{
+  stopCapture();
+
+  std::string ext = filename.substr(std::min(filename.find_last_of('.'), filename.size()));
+  m_captureJson   = (ext == ".json");
+  m_captureFile.open(filename);
+  if(!m_captureFile.is_open())
+  {
+    LOGE("GpuProfiler: cannot open %s\n", filename.c_str());
+    return false;
+  }
+
+  if(m_captureJson)
+    m_captureFile << "{\"frames\":[\n";
+  else
+    m_captureFile << "frame,pass,depth,gpu_ms\n";
+  m_captureFirstEntry = true;
+  LOGI("GpuProfiler: capturing to %s\n", filename.c_str());
+  return true;
+}
+
+void GpuProfiler::stopCapture()
+{
+  if(!isCapturing())
+    return;
+  if(m_captureJson)
+    m_captureFile << "\n]}\n";
+  m_captureFile.close();
+}
+
+void GpuProfiler::writeCapture(uint64_t frameNumber)
+{
+  if(!m_captureJson)
+  {
+    for(const auto& s : m_lastFrame)
+      m_captureFile << frameNumber << ",\"" << s.name << "\"," << s.depth << "," << s.gpuMs << "\n";
+    return;
+  }
+
+  m_captureFile << (m_captureFirstEntry ? "" : ",\n") << "{\"frame\":" << frameNumber
+                << ",\"passes\":[";
+  for(size_t i = 0; i < m_lastFrame.size(); i++)
+  {
+    const auto& s = m_lastFrame[i];
+    m_captureFile << (i == 0 ? "" : ",") << "{\"name\":\"" << s.name << "\",\"depth\":" << s.depth
+                  << ",\"gpu_ms\":" << s.gpuMs << "}";
+  }
+  m_captureFile << "]}";
+  m_captureFirstEntry = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Per-pass table and capture control
+//
+void GpuProfiler::renderUI()
+{
+  if(!m_supported)
+  {
+    ImGui::Text("GPU timestamps not supported");
+    return;
+  }
+
+  ImGui::Text("%-20s %8s %8s %8s", "Pass", "last", "avg", "max");
+  for(const auto& s : m_stats)
+  {
+    std::string name = std::string(2 * s.depth, ' ') + s.name;
+    ImGui::Text("%-20s %8.3f %8.3f %8.3f", name.c_str(), s.lastMs, s.avgMs, s.maxMs);
+  }
+
+  if(isCapturing())
+  {
+    if(ImGui::Button("Stop capture"))
+      stopCapture();
+  }
+  else
+  {
+    if(ImGui::Button("Capture CSV"))
+      startCapture("gpu_timings.csv");
+    ImGui::SameLine();
+    if(ImGui::Button("Capture JSON"))
+      startCapture("gpu_timings.json");
+  }
+  ImGui::SameLine();
+  if(ImGui::Button("Reset"))
+  {
+    m_stats.clear();
+    m_statsIndex.clear();
+  }
+}
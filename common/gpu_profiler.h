@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <vulkan/vulkan.hpp>
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// GPU timestamp profiler
+// - Each section (Ray trace, Rasterize, Post, ...) writes a timestamp at its beginning and end
+// - There is one set of queries per frame in flight: the results of a frame are read back when
+//   the same frame slot is used again, at which point the fence of that frame has been waited
+//   and the queries are available without stalling the GPU
+// - Timings can be shown in the UI and streamed to a CSV or JSON file
+//
+// Usage:
+//   profiler.beginFrame(cmdBuf, curFrame);   // right after cmdBuf.begin()
+//   profiler.beginSection(cmdBuf, "Ray trace");
+//   ...
+//   profiler.endSection(cmdBuf);
+//
+class GpuProfiler
+{
+public:
+  // Timing of one section, for one frame
+  struct Section
+  {
+    std::string name;
+    uint32_t    depth{0};  // Nesting level
+    double      gpuMs{0};
+  };
+
+  // Accumulated statistics of a section over the frames
+  struct Stats
+  {
+    std::string name;
+    uint32_t    depth{0};
+    double      lastMs{0};
+    double      avgMs{0};  // Exponential moving average
+    double      minMs{0};
+    double      maxMs{0};
+    uint64_t    count{0};
+  };
+
+  void setup(const vk::Device&         device,
+             const vk::PhysicalDevice& physicalDevice,
+             uint32_t                  queueFamily,
+             uint32_t                  nbFrames,
+             uint32_t                  maxSections = 32);
+  void destroy();
+
+  void beginFrame(const vk::CommandBuffer& cmdBuf, uint32_t frameIndex);
+  void beginSection(const vk::CommandBuffer& cmdBuf, const char* name);
+  void endSection(const vk::CommandBuffer& cmdBuf);
+
+  // Capturing to file; the format is deduced from the extension (.csv or .json)
+  bool startCapture(const std::string& filename);
+  void stopCapture();
+  bool isCapturing() const { return m_captureFile.is_open(); }
+
+  void renderUI();
+
+  const std::vector<Section>& getLastFrame() const { return m_lastFrame; }
+  const std::vector<Stats>&   getStats() const { return m_stats; }
+  bool                        isSupported() const { return m_supported; }
+
+  // Number of the frame started by the last beginFrame(), and of the frame in getLastFrame()
+  uint64_t getFrameNumber() const { return m_frameNumber - 1; }
+  uint64_t getLastFrameNumber() const { return m_lastFrameNumber; }
+
+private:
+  // Queries of a frame slot
+  struct FrameSlot
+  {
+    uint64_t                 frameNumber{0};
+    std::vector<std::string> names;
+    std::vector<uint32_t>    depths;
+    uint32_t                 nbSections{0};
+  };
+
+  void readBack(FrameSlot& slot, uint32_t slotIndex);
+  void accumulate(const Section& section);
+  void writeCapture(uint64_t frameNumber);
+
+  vk::Device             m_device;
+  vk::QueryPool          m_queryPool;
+  std::vector<FrameSlot> m_slots;
+  std::vector<uint32_t>  m_openSections;  // Stack of sections started in the current frame
+  uint32_t               m_curSlot{0};
+  uint32_t               m_maxSections{0};
+  uint64_t               m_frameNumber{0};
+  uint64_t               m_lastFrameNumber{0};
+  double                 m_timestampPeriod{1.0};  // Nanoseconds per tick
+  uint64_t               m_timestampMask{~0ULL};
+  bool                   m_supported{false};
+
+  std::vector<Section>                    m_lastFrame;  // Most recent frame read back
+  std::vector<Stats>                      m_stats;
+  std::unordered_map<std::string, size_t> m_statsIndex;
+
+  std::ofstream m_captureFile;
+  bool          m_captureJson{false};
+  bool          m_captureFirstEntry{true};
+};
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "image_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+static double toDisplay(float value)
+{
+  double v = std::pow(std::max(static_cast<double>(value), 0.0), 1.0 / 2.2);
+  return std::min(v, 1.0);
+}
+
+ImageError compareImages(const float* image, const float* reference, size_t nbPixels)
+{
+  ImageError error;
+  if(nbPixels == 0)
+    return error;
+
+  double sumSquared = 0.0;
+  double sumRel     = 0.0;
+  for(size_t i = 0; i < nbPixels; i++)
+  {
+    for(size_t c = 0; c < 3; c++)
+    {
+      float  value = image[4 * i + c];
+      float  ref   = reference[4 * i + c];
+      double diff  = toDisplay(value) - toDisplay(ref);
+      sumSquared += diff * diff;
+      error.maxError = std::max(error.maxError, std::abs(diff));
+
+      double linear = static_cast<double>(value) - ref;
+      sumRel += linear * linear / (static_cast<double>(ref) * ref + 0.01);
+    }
+  }
+
+  double mse   = sumSquared / (3.0 * nbPixels);
+  error.rmse   = std::sqrt(mse);
+  error.psnr   = mse > 0.0 ? -10.0 * std::log10(mse) : std::numeric_limits<double>::infinity();
+  error.relMse = sumRel / (3.0 * nbPixels);
+  return error;
+}
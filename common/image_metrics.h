@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <cstddef>
+
+//--------------------------------------------------------------------------------------------------
+// Error of an image against a reference, both RGBA32F as read back from the offscreen image
+// - rmse and psnr are computed on the displayed values: gamma 2.2 and clamped to [0,1], as done
+//   by post.frag, so they relate to what is seen on screen
+// - relMse is the relative MSE of the linear radiance, mean((x - ref)^2 / (ref^2 + 0.01)), the
+//   usual metric for the convergence of a path tracer, not dominated by the bright pixels
+// - The alpha channel is ignored
+//
+struct ImageError
+{
+  double rmse{0};
+  double psnr{0};  // In dB, infinite for identical images
+  double relMse{0};
+  double maxError{0};  // Largest difference of a displayed channel
+};
+
+ImageError compareImages(const float* image, const float* reference, size_t nbPixels);
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filename)
+{
+  close();
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(mapping == nullptr)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if(view == nullptr)
+  {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file    = file;
+  m_mapping = mapping;
+  m_data    = static_cast<const uint8_t*>(view);
+  m_size    = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::close()
+{
+  if(m_data)
+    UnmapViewOfFile(m_data);
+  if(m_mapping)
+    CloseHandle(m_mapping);
+  if(m_file)
+    CloseHandle(m_file);
+  m_data    = nullptr;
+  m_size    = 0;
+  m_file    = nullptr;
+  m_mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filename)
+{
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0)
+    return false;
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  // The mapping stays valid after closing the descriptor
+  void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(view == MAP_FAILED)
+    return false;
+
+  m_data = static_cast<const uint8_t*>(view);
+  m_size = static_cast<size_t>(st.st_size);
+  return true;
+}
+
+void MappedFile::close()
+{
+  if(m_data)
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
+
+#endif
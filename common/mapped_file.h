@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+// Read-only memory mapping of a whole file
+// - The pages are loaded by the OS on first access, nothing is read when opening the file
+// - The mapping is released when the object is destroyed, pointers into it become invalid
+//
+// Usage:
+//   MappedFile file;
+//   if(file.open("scene.glb"))
+//     parse(file.data(), file.size());
+//
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const std::string& filename);
+  void close();
+
+  const uint8_t* data() const { return m_data; }
+  size_t         size() const { return m_size; }
+  bool           isOpen() const { return m_data != nullptr; }
+
+private:
+  const uint8_t* m_data{nullptr};
+  size_t         m_size{0};
+#ifdef _WIN32
+  void* m_file{nullptr};
+  void* m_mapping{nullptr};
+#endif
+};
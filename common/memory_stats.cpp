@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "memory_stats.h"
+#include "imgui.h"
+#include "nvh/nvprint.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+double toMB(vk::DeviceSize bytes)
+{
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+}  // namespace
+
+
+const char* MemoryStats::categoryName(MemCategory category)
+{
+  static const char* names[] = {"Geometry", "Material", "Texture", "Render target", "BLAS",
+                                "TLAS",     "Scratch",  "SBT",     "Other"};
+  static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(MemCategory::eCount),
+                "Missing category name");
+  return names[static_cast<size_t>(category)];
+}
+
+//--------------------------------------------------------------------------------------------------
+// The budget is only available when the physical device exposes VK_EXT_memory_budget
+//
+void MemoryStats::setup(const vk::Device& device, const vk::PhysicalDevice& physicalDevice)
+{
+  m_device          = device;
+  m_physicalDevice  = physicalDevice;
+  m_budgetSupported = false;
+  for(const auto& ext : physicalDevice.enumerateDeviceExtensionProperties())
+  {
+    if(strcmp(ext.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+      m_budgetSupported = true;
+  }
+  updateBudget();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Tagging buffers and images. The size is the one required by the resource, which is what
+// the allocator reserves for it (without the alignment padding of the sub-allocation).
+//
+void MemoryStats::trackBuffer(const vk::Buffer& buffer, MemCategory category, int model)
+{
+  if(!buffer || m_buffers.count(buffer) != 0)
+    return;
+  Allocation alloc{m_device.getBufferMemoryRequirements(buffer).size, category, model};
+  m_buffers[buffer] = alloc;
+  add(alloc);
+}
+
+void MemoryStats::trackImage(const vk::Image& image, MemCategory category, int model)
+{
+  if(!image || m_images.count(image) != 0)
+    return;
+  Allocation alloc{m_device.getImageMemoryRequirements(image).size, category, model};
+  m_images[image] = alloc;
+  add(alloc);
+}
+
+void MemoryStats::untrackBuffer(const vk::Buffer& buffer)
+{
+  auto it = m_buffers.find(buffer);
+  if(it == m_buffers.end())
+    return;
+  remove(it->second);
+  m_buffers.erase(it);
+}
+
+void MemoryStats::untrackImage(const vk::Image& image)
+{
+  auto it = m_images.find(image);
+  if(it == m_images.end())
+    return;
+  remove(it->second);
+  m_images.erase(it);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Acceleration structures: the builder allocates the structures and the scratch buffer itself,
+// the sizes are queried with the same inputs. The scratch buffer only lives during the build,
+// it is counted in the high-water mark but not in the live memory.
+//
+void MemoryStats::trackBlas(const std::vector<nvvk::RaytracingBuilderKHR::BlasInput>& blas,
+                            vk::BuildAccelerationStructureFlagsKHR                    flags)
+{
+  vk::DeviceSize maxScratch = 0;
+  for(size_t i = 0; i < blas.size(); i++)
+  {
+    std::vector<uint32_t> maxPrimCount;
+    for(const auto& range : blas[i].asBuildOffsetInfo)
+      maxPrimCount.push_back(range.primitiveCount);
+
+    vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+    buildInfo.setType(vk::AccelerationStructureTypeKHR::eBottomLevel);
+    buildInfo.setMode(vk::BuildAccelerationStructureModeKHR::eBuild);
+    buildInfo.setFlags(flags);
+    buildInfo.setGeometries(blas[i].asGeometry);
+
+    auto sizes = m_device.getAccelerationStructureBuildSizesKHR(
+        vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, maxPrimCount);
+    maxScratch = std::max(maxScratch, sizes.buildScratchSize);
+
+    Allocation alloc{sizes.accelerationStructureSize, MemCategory::eBlas, static_cast<int>(i)};
+    add(alloc);
+    m_accels.push_back(alloc);
+  }
+
+  Allocation scratch{maxScratch, MemCategory::eScratch, -1};
+  add(scratch);
+  remove(scratch);
+}
+
+void MemoryStats::trackTlas(uint32_t nbInstances, vk::BuildAccelerationStructureFlagsKHR flags)
+{
+  vk::AccelerationStructureGeometryKHR topASGeometry{vk::GeometryTypeKHR::eInstances};
+  topASGeometry.geometry.setInstances(vk::AccelerationStructureGeometryInstancesDataKHR{});
+
+  vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+  buildInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+  buildInfo.setMode(vk::BuildAccelerationStructureModeKHR::eBuild);
+  buildInfo.setFlags(flags);
+  buildInfo.setGeometries(topASGeometry);
+
+  auto sizes = m_device.getAccelerationStructureBuildSizesKHR(
+      vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, nbInstances);
+
+  Allocation tlas{sizes.accelerationStructureSize, MemCategory::eTlas, -1};
+  Allocation instances{nbInstances * sizeof(VkAccelerationStructureInstanceKHR), MemCategory::eTlas,
+                       -1};
+  add(tlas);
+  add(instances);
+  m_accels.push_back(tlas);
+  m_accels.push_back(instances);
+
+  Allocation scratch{sizes.buildScratchSize, MemCategory::eScratch, -1};
+  add(scratch);
+  remove(scratch);
+}
+
+void MemoryStats::untrackAccelerationStructures()
+{
+  for(const auto& alloc : m_accels)
+    remove(alloc);
+  m_accels.clear();
+}
+
+void MemoryStats::add(const Allocation& alloc)
+{
+  CategoryStats& cat = m_categories[static_cast<size_t>(alloc.category)];
+  cat.live += alloc.size;
+  cat.peak = std::max(cat.peak, cat.live);
+  cat.count++;
+  if(alloc.model >= 0)
+    m_models[alloc.model] += alloc.size;
+  m_totalPeak = std::max(m_totalPeak, totalLive());
+}
+
+void MemoryStats::remove(const Allocation& alloc)
+{
+  CategoryStats& cat = m_categories[static_cast<size_t>(alloc.category)];
+  cat.live -= std::min(cat.live, alloc.size);
+  cat.count--;
+  if(alloc.model >= 0)
+  {
+    auto it = m_models.find(alloc.model);
+    if(it == m_models.end())
+      return;
+    it->second -= std::min(it->second, alloc.size);
+    if(it->second == 0)
+      m_models.erase(it);
+  }
+}
+
+vk::DeviceSize MemoryStats::totalLive() const
+{
+  vk::DeviceSize total = 0;
+  for(const auto& cat : m_categories)
+    total += cat.live;
+  return total;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Usage and budget of each heap, as seen by the driver for the whole process. The headroom is
+// what can still be allocated before the heap goes over budget.
+//
+void MemoryStats::updateBudget()
+{
+  m_heaps.clear();
+  if(!m_physicalDevice)
+    return;
+
+  if(!m_budgetSupported)
+  {
+    auto memProperties = m_physicalDevice.getMemoryProperties();
+    for(uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+    {
+      HeapBudget heap;
+      heap.size        = memProperties.memoryHeaps[i].size;
+      heap.deviceLocal =
+          bool(memProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+      m_heaps.push_back(heap);
+    }
+    return;
+  }
+
+  auto chain = m_physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+                                                     vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+  const auto& memProperties = chain.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+  const auto& budget        = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+  for(uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+  {
+    HeapBudget heap;
+    heap.size        = memProperties.memoryHeaps[i].size;
+    heap.budget      = budget.heapBudget[i];
+    heap.usage       = budget.heapUsage[i];
+    heap.deviceLocal =
+        bool(memProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+    m_heaps.push_back(heap);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Categories, heaviest models and heap budgets
+//
+void MemoryStats::renderUI()
+{
+  ImGui::Text("%-14s %10s %10s %6s", "Category", "live MB", "peak MB", "count");
+  for(size_t c = 0; c < m_categories.size(); c++)
+  {
+    const CategoryStats& cat = m_categories[c];
+    ImGui::Text("%-14s %10.2f %10.2f %6u", categoryName(static_cast<MemCategory>(c)),
+                toMB(cat.live), toMB(cat.peak), cat.count);
+  }
+  ImGui::Text("%-14s %10.2f %10.2f", "Total", toMB(totalLive()), toMB(m_totalPeak));
+
+  if(!m_models.empty())
+  {
+    std::vector<std::pair<int, vk::DeviceSize>> models(m_models.begin(), m_models.end());
+    std::sort(models.begin(), models.end(),
+              [](const auto& a, const auto& b) { return a.second > b.second; });
+    ImGui::Separator();
+    ImGui::Text("Heaviest models (%d)", static_cast<int>(models.size()));
+    for(size_t i = 0; i < std::min<size_t>(models.size(), 8); i++)
+      ImGui::Text("  model %-6d %10.2f MB", models[i].first, toMB(models[i].second));
+  }
+
+  ImGui::Separator();
+  if(ImGui::Button("Refresh budget"))
+    updateBudget();
+  for(size_t i = 0; i < m_heaps.size(); i++)
+  {
+    const HeapBudget& heap = m_heaps[i];
+    if(m_budgetSupported)
+      ImGui::Text("Heap %d%s: %.0f / %.0f MB, headroom %.0f MB", static_cast<int>(i),
+                  heap.deviceLocal ? " (device)" : "", toMB(heap.usage), toMB(heap.budget),
+                  toMB(heap.budget > heap.usage ? heap.budget - heap.usage : 0));
+    else
+      ImGui::Text("Heap %d%s: %.0f MB (no budget)", static_cast<int>(i),
+                  heap.deviceLocal ? " (device)" : "", toMB(heap.size));
+  }
+
+  if(ImGui::Button("Dump memory_stats.json"))
+    dump("memory_stats.json");
+}
+
+//--------------------------------------------------------------------------------------------------
+// Machine readable report, sizes in bytes
+// {"total":{"live":N,"peak":N},
+//  "categories":[{"name":"Geometry","live":N,"peak":N,"count":N},...],
+//  "models":[{"id":0,"live":N},...], "budgetSupported":true,
+//  "heaps":[{"size":N,"budget":N,"usage":N,"deviceLocal":true},...]}
+//
+bool MemoryStats::dump(const std::string& filename)
+{
+  FILE* file = fopen(filename.c_str(), "w");
+  if(file == nullptr)
+  {
+    LOGE("MemoryStats: cannot open %s\n", filename.c_str());
+    return false;
+  }
+
+  updateBudget();
+  auto u64 = [](vk::DeviceSize v) { return static_cast<unsigned long long>(v); };
+
+  fprintf(file, "{\"total\":{\"live\":%llu,\"peak\":%llu},\n", u64(totalLive()),
+          u64(m_totalPeak));
+  fprintf(file, "\"categories\":[");
+  for(size_t c = 0; c < m_categories.size(); c++)
+  {
+    const CategoryStats& cat = m_categories[c];
+    fprintf(file, "%s\n{\"name\":\"%s\",\"live\":%llu,\"peak\":%llu,\"count\":%u}",
+            c == 0 ? "" : ",", categoryName(static_cast<MemCategory>(c)), u64(cat.live),
+            u64(cat.peak), cat.count);
+  }
+  fprintf(file, "],\n\"models\":[");
+  bool first = true;
+  for(const auto& model : m_models)
+  {
+    fprintf(file, "%s\n{\"id\":%d,\"live\":%llu}", first ? "" : ",", model.first,
+            u64(model.second));
+    first = false;
+  }
+  fprintf(file, "],\n\"budgetSupported\":%s,\n\"heaps\":[", m_budgetSupported ? "true" : "false");
+  for(size_t i = 0; i < m_heaps.size(); i++)
+  {
+    const HeapBudget& heap = m_heaps[i];
+    fprintf(file, "%s\n{\"size\":%llu,\"budget\":%llu,\"usage\":%llu,\"deviceLocal\":%s}",
+            i == 0 ? "" : ",", u64(heap.size), u64(heap.budget), u64(heap.usage),
+            heap.deviceLocal ? "true" : "false");
+  }
+  fprintf(file, "]}\n");
+  fclose(file);
+  LOGI("MemoryStats: written %s\n", filename.c_str());
+  return true;
+}
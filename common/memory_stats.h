@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "nvvk/raytraceKHR_vk.hpp"
+
+// What the memory is used for
+enum class MemCategory
+{
+  eGeometry,      // Vertices, indices
+  eMaterial,      // Materials, material indices
+  eTexture,       // Scene textures
+  eRenderTarget,  // Offscreen color, depth, G-buffers
+  eBlas,          // Bottom level acceleration structures
+  eTlas,          // Top level acceleration structure and its instances
+  eScratch,       // Acceleration structure build scratch (transient)
+  eSbt,           // Shader binding table
+  eOther,         // Uniforms, scene description, ...
+  eCount
+};
+
+//--------------------------------------------------------------------------------------------------
+// Accounting of the device memory used by the sample
+// - Buffers and images are tagged with a category, and optionally with the model they belong to,
+//   after being created by the allocator; they must be untracked before being destroyed
+// - Acceleration structures are allocated inside nvvk::RaytracingBuilderKHR, their sizes are
+//   the ones returned by vkGetAccelerationStructureBuildSizesKHR for the same build inputs
+// - The heap budget and usage are coming from VK_EXT_memory_budget, when supported
+//
+class MemoryStats
+{
+public:
+  struct CategoryStats
+  {
+    vk::DeviceSize live{0};
+    vk::DeviceSize peak{0};
+    uint32_t       count{0};
+  };
+
+  struct HeapBudget
+  {
+    vk::DeviceSize size{0};
+    vk::DeviceSize budget{0};
+    vk::DeviceSize usage{0};
+    bool           deviceLocal{false};
+  };
+
+  void setup(const vk::Device& device, const vk::PhysicalDevice& physicalDevice);
+
+  void trackBuffer(const vk::Buffer& buffer, MemCategory category, int model = -1);
+  void trackImage(const vk::Image& image, MemCategory category, int model = -1);
+  void untrackBuffer(const vk::Buffer& buffer);
+  void untrackImage(const vk::Image& image);
+
+  // The BLAS are in the order of the inputs, BLAS 'i' is accounted for model 'i'
+  void trackBlas(const std::vector<nvvk::RaytracingBuilderKHR::BlasInput>& blas,
+                 vk::BuildAccelerationStructureFlagsKHR                    flags);
+  void trackTlas(uint32_t nbInstances, vk::BuildAccelerationStructureFlagsKHR flags);
+  // Before nvvk::RaytracingBuilderKHR::destroy(): all the BLAS and TLAS tracked above
+  void untrackAccelerationStructures();
+
+  void updateBudget();
+  bool isBudgetSupported() const { return m_budgetSupported; }
+
+  vk::DeviceSize       totalLive() const;
+  vk::DeviceSize       totalPeak() const { return m_totalPeak; }
+  const CategoryStats& getCategory(MemCategory category) const
+  {
+    return m_categories[static_cast<size_t>(category)];
+  }
+  const std::vector<HeapBudget>& getHeaps() const { return m_heaps; }
+
+  void renderUI();
+  bool dump(const std::string& filename);
+
+  static const char* categoryName(MemCategory category);
+
+private:
+  struct Allocation
+  {
+    vk::DeviceSize size{0};
+    MemCategory    category{MemCategory::eOther};
+    int            model{-1};
+  };
+
+  void add(const Allocation& alloc);
+  void remove(const Allocation& alloc);
+
+  vk::Device         m_device;
+  vk::PhysicalDevice m_physicalDevice;
+  bool               m_budgetSupported{false};
+
+  std::map<vk::Buffer, Allocation> m_buffers;
+  std::map<vk::Image, Allocation>  m_images;
+  std::vector<Allocation>          m_accels;  // From trackBlas and trackTlas
+
+  std::array<CategoryStats, static_cast<size_t>(MemCategory::eCount)> m_categories;
+  std::map<int, vk::DeviceSize>                                        m_models;  // Live per model
+  vk::DeviceSize                                                       m_totalPeak{0};
+  std::vector<HeapBudget>                                              m_heaps;
+};
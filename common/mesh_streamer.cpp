@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mesh_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+void MeshStreamer::request(uint32_t id, float priority, LoadFunc load)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back({id, priority, std::move(load)});
+    m_requested++;
+  }
+  m_wakeUp.notify_one();
+}
+
+void MeshStreamer::start(uint32_t nbThreads)
+{
+  m_stop = false;
+  for(uint32_t i = 0; i < std::max(nbThreads, 1u); i++)
+    m_threads.emplace_back(&MeshStreamer::worker, this);
+}
+
+void MeshStreamer::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_pending.clear();
+  }
+  m_wakeUp.notify_all();
+  for(auto& thread : m_threads)
+    thread.join();
+  m_threads.clear();
+}
+
+void MeshStreamer::setPriorities(const std::function<float(uint32_t id)>& priorityOf)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for(auto& request : m_pending)
+    request.priority = priorityOf(request.id);
+}
+
+std::vector<MeshStreamer::Loaded> MeshStreamer::takeLoaded(size_t maxCount)
+{
+  std::vector<Loaded>         result;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t                      count = std::min(maxCount, m_loaded.size());
+  result.reserve(count);
+  std::move(m_loaded.begin(), m_loaded.begin() + count, std::back_inserter(result));
+  m_loaded.erase(m_loaded.begin(), m_loaded.begin() + count);
+  m_taken += static_cast<uint32_t>(count);
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Takes the pending request with the highest priority, loads it without holding the lock
+//
+void MeshStreamer::worker()
+{
+  while(true)
+  {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wakeUp.wait(lock, [&] { return m_stop || !m_pending.empty(); });
+      if(m_stop)
+        return;
+
+      auto best = std::max_element(m_pending.begin(), m_pending.end(),
+                                   [](const Request& a, const Request& b) {
+                                     return a.priority < b.priority;
+                                   });
+      request = std::move(*best);
+      *best   = std::move(m_pending.back());
+      m_pending.pop_back();
+    }
+
+    auto   start = std::chrono::steady_clock::now();
+    Loaded loaded;
+    loaded.id     = request.id;
+    loaded.mesh   = request.load();
+    loaded.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                              - start)
+                        .count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_loaded.emplace_back(std::move(loaded));
+  }
+}
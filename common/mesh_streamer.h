@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include "obj_loader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Loads meshes on background threads, the most important ones first
+//
+// - Each request has an id (model index, ...), a priority and a function producing the mesh
+//   (reading a file, generating, ...). The function is called on a worker thread.
+// - Workers always take the pending request with the highest priority. Priorities can be
+//   changed while loading, for example when the camera moves.
+// - Loaded meshes are collected by the render thread with `takeLoaded()`, which is where the
+//   device buffers and acceleration structures are created.
+// - The load functions run concurrently with the render thread, so they must not record trace
+//   events while TraceRecorder::dump() can be called.
+//
+// Usage:
+//   MeshStreamer streamer;
+//   streamer.request(0, 1.f, [] { ObjLoader l; l.loadModel("a.obj"); return l; });
+//   streamer.start(2);
+//   ... each frame
+//   for(auto& loaded : streamer.takeLoaded(16))
+//     upload(loaded.id, loaded.mesh);
+//
+class MeshStreamer
+{
+public:
+  using LoadFunc = std::function<ObjLoader()>;
+
+  struct Loaded
+  {
+    uint32_t  id{0};
+    ObjLoader mesh;
+    double    loadMs{0};  // Time spent in the load function
+  };
+
+  ~MeshStreamer() { stop(); }
+
+  void request(uint32_t id, float priority, LoadFunc load);
+  void start(uint32_t nbThreads);
+  void stop();  // Pending requests are dropped
+
+  // Recomputes the priority of all pending requests
+  void setPriorities(const std::function<float(uint32_t id)>& priorityOf);
+
+  // At most `maxCount` meshes, in the order they finished loading
+  std::vector<Loaded> takeLoaded(size_t maxCount);
+
+  uint32_t requestedCount() const { return m_requested; }
+  uint32_t takenCount() const { return m_taken; }
+  bool     isComplete() const { return m_taken == m_requested; }
+
+private:
+  struct Request
+  {
+    uint32_t id;
+    float    priority;
+    LoadFunc load;
+  };
+
+  void worker();
+
+  std::mutex               m_mutex;  // Protects the requests and the loaded meshes
+  std::condition_variable  m_wakeUp;
+  std::vector<Request>     m_pending;
+  std::vector<Loaded>      m_loaded;
+  std::vector<std::thread> m_threads;
+  bool                     m_stop{false};
+  std::atomic<uint32_t>    m_requested{0};
+  std::atomic<uint32_t>    m_taken{0};
+};
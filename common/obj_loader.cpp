@@ -21,12 +21,18 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "obj_loader.h"
 #include "nvh/nvprint.hpp"
+#include "trace_events.h"
 
 
 void ObjLoader::loadModel(const std::string& filename)
 {
+  TRACE_SCOPE("OBJ load", filename);
+
   tinyobj::ObjReader reader;
-  reader.ParseFromFile(filename);
+  {
+    TRACE_SCOPE("OBJ parse");
+    reader.ParseFromFile(filename);
+  }
   if(!reader.Valid())
   {
     LOGE(reader.Error().c_str());
@@ -63,6 +69,7 @@ void ObjLoader::loadModel(const std::string& filename)
 
   const tinyobj::attrib_t& attrib = reader.GetAttrib();
 
+  TraceScope vertices("OBJ vertices");
   for(const auto& shape : reader.GetShapes())
   {
     m_vertices.reserve(shape.mesh.indices.size() + m_vertices.size());
@@ -98,6 +105,7 @@ void ObjLoader::loadModel(const std::string& filename)
       m_indices.push_back(static_cast<int>(m_indices.size()));
     }
   }
+  vertices.end();
 
   // Fixing material indices
   for(auto& mi : m_matIndx)
@@ -109,17 +117,24 @@ void ObjLoader::loadModel(const std::string& filename)
 
   // Compute normal when no normal were provided.
   if(attrib.normals.empty())
+    computeNormals();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Flat normals: each vertex gets the normal of the last triangle using it
+//
+void ObjLoader::computeNormals()
+{
+  TRACE_SCOPE("OBJ normals");
+  for(size_t i = 0; i < m_indices.size(); i += 3)
   {
-    for(size_t i = 0; i < m_indices.size(); i += 3)
-    {
-      VertexObj& v0 = m_vertices[m_indices[i + 0]];
-      VertexObj& v1 = m_vertices[m_indices[i + 1]];
-      VertexObj& v2 = m_vertices[m_indices[i + 2]];
-
-      nvmath::vec3f n = nvmath::normalize(nvmath::cross((v1.pos - v0.pos), (v2.pos - v0.pos)));
-      v0.nrm          = n;
-      v1.nrm          = n;
-      v2.nrm          = n;
-    }
+    VertexObj& v0 = m_vertices[m_indices[i + 0]];
+    VertexObj& v1 = m_vertices[m_indices[i + 1]];
+    VertexObj& v2 = m_vertices[m_indices[i + 2]];
+
+    nvmath::vec3f n = nvmath::normalize(nvmath::cross((v1.pos - v0.pos), (v2.pos - v0.pos)));
+    v0.nrm          = n;
+    v1.nrm          = n;
+    v2.nrm          = n;
   }
 }
@@ -62,6 +62,7 @@ class ObjLoader
 {
 public:
   void loadModel(const std::string& filename);
+  void computeNormals();
 
   std::vector<VertexObj>   m_vertices;
   std::vector<uint32_t>    m_indices;
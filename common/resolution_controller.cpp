@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "resolution_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+void ResolutionController::setSettings(const Settings& settings)
+{
+  m_settings          = settings;
+  m_settings.minScale = std::max(m_settings.minScale, m_settings.step);
+  m_settings.maxScale = std::max(m_settings.maxScale, m_settings.minScale);
+  m_scale             = quantize(m_scale);
+}
+
+void ResolutionController::reset(float scale)
+{
+  m_stats = Stats();
+  m_scale = quantize(scale);
+}
+
+//--------------------------------------------------------------------------------------------------
+// The scaled part of the frame is proportional to the number of pixels: `fullResMs * scale^2`.
+// The scale giving the target is then `sqrt((targetMs - fixedMs) / fullResMs)`.
+//
+float ResolutionController::addFrame(float scale, double scaledMs, double fixedMs)
+{
+  if(scale <= 0.f || scaledMs <= 0.0)
+    return m_scale;
+
+  double fullResMs = scaledMs / (static_cast<double>(scale) * scale);
+  double alpha     = m_stats.frames == 0 ? 1.0 : m_settings.smoothing;
+  m_stats.fullResMs += alpha * (fullResMs - m_stats.fullResMs);
+  m_stats.fixedMs += alpha * (fixedMs - m_stats.fixedMs);
+  m_stats.lastFrameMs = scaledMs + fixedMs;
+  m_stats.frames++;
+
+  double budget = m_settings.targetMs - m_stats.fixedMs;
+  float  ideal  = budget > 0.0 ? static_cast<float>(std::sqrt(budget / m_stats.fullResMs)) : 0.f;
+  ideal         = std::min(std::max(ideal, m_settings.minScale), m_settings.maxScale);
+  m_stats.idealScale = ideal;
+
+  // Keeping the current scale while its predicted time is close enough to the target
+  double predicted = m_stats.fixedMs + m_stats.fullResMs * m_scale * m_scale;
+  double error     = (predicted - m_settings.targetMs) / m_settings.targetMs;
+  float  next      = m_scale;
+  if(error > m_settings.tolerance)
+    next = ideal;  // Over budget: going down right away
+  else if(error < -m_settings.tolerance)
+    next = m_scale + 0.5f * (ideal - m_scale);  // Under budget: going up progressively
+
+  // Rounding down, for the quantized scale to stay within the budget, but always moving by at
+  // least one step in the wanted direction
+  float quantized = std::floor(next / m_settings.step) * m_settings.step;
+  if(next > m_scale && quantized <= m_scale && ideal >= m_scale + m_settings.step)
+    quantized = m_scale + m_settings.step;
+  quantized = quantize(quantized);
+
+  if(quantized != m_scale)
+  {
+    m_scale = quantized;
+    m_stats.changes++;
+  }
+  return m_scale;
+}
+
+void ResolutionController::getRenderSize(uint32_t  width,
+                                         uint32_t  height,
+                                         uint32_t& renderWidth,
+                                         uint32_t& renderHeight) const
+{
+  renderWidth  = std::max(1u, static_cast<uint32_t>(std::lround(width * m_scale)));
+  renderHeight = std::max(1u, static_cast<uint32_t>(std::lround(height * m_scale)));
+  renderWidth  = std::min(renderWidth, width);
+  renderHeight = std::min(renderHeight, height);
+}
+
+float ResolutionController::quantize(float scale) const
+{
+  scale = std::round(scale / m_settings.step) * m_settings.step;
+  return std::min(std::max(scale, m_settings.minScale), m_settings.maxScale);
+}
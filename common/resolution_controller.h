@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+// Dynamic resolution: finds the render scale holding a target GPU frame time
+// - The frame is split in a part proportional to the number of rendered pixels (ray tracing),
+//   and a fixed part (post-process, UI, ...)
+// - Each measured frame gives the cost of the scaled part at full resolution,
+//   `scaledMs / scale^2`; its moving average predicts the scale reaching the target
+// - The scale goes down at once when the frame is over budget, and up by half of the way when
+//   under budget, so it does not oscillate around the target
+// - Scales are quantized to `step`, and kept while the prediction is within `tolerance` of the
+//   target: the resolution does not change at every frame
+// - Timings come back from the GPU a few frames late, so the scale used to render each frame
+//   must be passed along with its timings
+//
+class ResolutionController
+{
+public:
+  struct Settings
+  {
+    float targetMs{8.f};       // GPU frame time to hold
+    float minScale{0.25f};     // Limits of the scale, on each axis
+    float maxScale{1.f};       //
+    float step{1.f / 32.f};    // Quantization of the scale
+    float tolerance{0.05f};    // Relative to the target
+    float smoothing{0.25f};    // Weight of the last frame in the moving averages
+  };
+
+  struct Stats
+  {
+    double   fullResMs{0};  // Predicted time of the scaled part at full resolution
+    double   fixedMs{0};    // Average time of the fixed part
+    double   lastFrameMs{0};
+    float    idealScale{1};  // Scale reaching the target, before quantization
+    uint64_t frames{0};
+    uint64_t changes{0};  // Number of times the scale changed
+  };
+
+  void            setSettings(const Settings& settings);
+  const Settings& getSettings() const { return m_settings; }
+
+  // Forgets the measures, and restarts at `scale`
+  void reset(float scale = 1.f);
+
+  // Timings of a frame rendered at `scale`; returns the scale for the next frames
+  float addFrame(float scale, double scaledMs, double fixedMs);
+
+  float        getScale() const { return m_scale; }
+  const Stats& getStats() const { return m_stats; }
+
+  // Size of the render target for the current scale, at least one pixel
+  void getRenderSize(uint32_t width, uint32_t height, uint32_t& renderWidth,
+                     uint32_t& renderHeight) const;
+
+private:
+  float quantize(float scale) const;
+
+  Settings m_settings;
+  Stats    m_stats;
+  float    m_scale{1.f};
+};
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "sample_budget.h"
+
+#include <algorithm>
+
+
+void SampleBudget::setSettings(const Settings& settings)
+{
+  m_settings            = settings;
+  m_settings.minSamples = floorPowerOfTwo(m_settings.minSamples);
+  m_settings.maxSamples = std::max(floorPowerOfTwo(m_settings.maxSamples), m_settings.minSamples);
+  m_samples             = clamp(m_samples);
+}
+
+void SampleBudget::reset(uint32_t samples)
+{
+  m_stats   = Stats();
+  m_samples = clamp(floorPowerOfTwo(samples));
+}
+
+//--------------------------------------------------------------------------------------------------
+// The sampled part of the frame is proportional to the samples: `sampleMs * samples`. The samples
+// giving the target are then `(targetMs - fixedMs) / sampleMs`.
+//
+uint32_t SampleBudget::addFrame(uint32_t samples, double sampledMs, double fixedMs)
+{
+  if(samples == 0 || sampledMs <= 0.0)
+    return m_samples;
+
+  double sampleMs = sampledMs / samples;
+  double alpha    = m_stats.frames == 0 ? 1.0 : m_settings.smoothing;
+  m_stats.sampleMs += alpha * (sampleMs - m_stats.sampleMs);
+  m_stats.fixedMs += alpha * (fixedMs - m_stats.fixedMs);
+  m_stats.lastFrameMs = sampledMs + fixedMs;
+  m_stats.frames++;
+
+  double budget        = m_settings.targetMs - m_stats.fixedMs;
+  double ideal         = budget > 0.0 ? budget / m_stats.sampleMs : 0.0;
+  m_stats.idealSamples = static_cast<float>(ideal);
+
+  double   predicted = m_stats.fixedMs + m_stats.sampleMs * m_samples;
+  double   doubled   = m_stats.fixedMs + m_stats.sampleMs * m_samples * 2;
+  uint32_t next      = m_samples;
+  if(predicted > m_settings.targetMs * (1.0 + m_settings.tolerance))
+  {
+    // Over budget: going down right away, to the largest power of two within the budget
+    next = floorPowerOfTwo(static_cast<uint32_t>(std::min(ideal, double(m_samples))));
+  }
+  else if(doubled <= m_settings.targetMs)
+  {
+    // Under budget: going up one power of two at a time
+    next = m_samples * 2;
+  }
+  next = clamp(next);
+
+  if(next != m_samples)
+  {
+    m_samples = next;
+    m_stats.changes++;
+  }
+  return m_samples;
+}
+
+uint32_t SampleBudget::getVariant(uint32_t samples)
+{
+  uint32_t variant = 0;
+  while(samples > 1)
+  {
+    samples >>= 1;
+    variant++;
+  }
+  return variant;
+}
+
+uint32_t SampleBudget::floorPowerOfTwo(uint32_t value)
+{
+  uint32_t result = 1;
+  while(result <= value / 2)
+    result *= 2;
+  return result;
+}
+
+uint32_t SampleBudget::clamp(uint32_t samples) const
+{
+  return std::min(std::max(samples, m_settings.minSamples), m_settings.maxSamples);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+// Samples per launch of a progressive renderer, tuned to fill a GPU time budget per frame
+// - Each launch traces `samples` paths per pixel: fewer, larger launches amortize the cost of a
+//   launch (and of the frame around it), but the frame rate drops
+// - The frame is split in a part proportional to the number of samples (path tracing), and a
+//   fixed part (post-process, UI, ...). Each measured frame gives the cost of one sample per
+//   pixel, `sampledMs / samples`; its moving average predicts the samples filling the budget.
+// - Samples are powers of two, as each value is a specialization of the shaders: there are
+//   log2(maxSamples) + 1 variants, see getVariant()
+// - The samples halve, or more, at once when the frame is over budget, and double only when the
+//   doubled frame is predicted to fit: it does not oscillate between two values
+// - Timings come back from the GPU a few frames late, so the samples used to render each frame
+//   must be passed along with its timings
+//
+class SampleBudget
+{
+public:
+  struct Settings
+  {
+    float    targetMs{16.f};    // GPU frame time to fill
+    uint32_t minSamples{1};     // Limits of the samples per launch, powers of two
+    uint32_t maxSamples{64};    //
+    float    tolerance{0.1f};   // Relative to the target
+    float    smoothing{0.25f};  // Weight of the last frame in the moving averages
+  };
+
+  struct Stats
+  {
+    double   sampleMs{0};  // Predicted time of one sample per pixel
+    double   fixedMs{0};   // Average time of the fixed part
+    double   lastFrameMs{0};
+    float    idealSamples{1};  // Samples reaching the target, before rounding to a power of two
+    uint64_t frames{0};
+    uint64_t changes{0};  // Number of times the samples changed
+  };
+
+  void            setSettings(const Settings& settings);
+  const Settings& getSettings() const { return m_settings; }
+
+  // Forgets the measures, and restarts at `samples`
+  void reset(uint32_t samples = 1);
+
+  // Timings of a frame rendered with `samples` per pixel; returns the samples for the next frames
+  uint32_t addFrame(uint32_t samples, double sampledMs, double fixedMs);
+
+  uint32_t     getSamples() const { return m_samples; }
+  const Stats& getStats() const { return m_stats; }
+
+  // Index of the shader variant of `samples`: log2(samples)
+  static uint32_t getVariant(uint32_t samples);
+  // Largest power of two not above `value`, at least 1
+  static uint32_t floorPowerOfTwo(uint32_t value);
+
+private:
+  uint32_t clamp(uint32_t samples) const;
+
+  Settings m_settings;
+  Stats    m_stats;
+  uint32_t m_samples{1};
+};
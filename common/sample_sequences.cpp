@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "sample_sequences.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Generators of the rank-1 lattices, in 0.32 fixed point
+static const uint32_t s_r2X = 3242174889u;  // 1 / plastic number
+static const uint32_t s_r2Y = 2447445413u;  // 1 / plastic number^2
+
+SampleSequence::SampleSequence(Type             type,
+                               uint32_t         x,
+                               uint32_t         y,
+                               uint32_t         index,
+                               const BlueNoise* noise)
+    : m_type(type)
+    , m_x(x)
+    , m_y(y)
+    , m_index(index)
+    , m_noise(noise)
+{
+  if(m_type == eWhite)
+    m_seed = tea((y << 16) ^ x, index);
+  else
+    m_seed = hashCombine(hash(x), y);
+  if(m_type == eBlueNoise && (m_noise == nullptr || m_noise->ranks.empty()))
+    m_type = eR2;
+}
+
+nvmath::vec2f SampleSequence::next2D()
+{
+  const uint32_t dimension = m_dimension++;
+  switch(m_type)
+  {
+    case eWhite: {
+      // lcg() of random.glsl
+      m_seed     = 1664525u * m_seed + 1013904223u;
+      uint32_t x = m_seed & 0x00FFFFFF;
+      m_seed     = 1664525u * m_seed + 1013904223u;
+      uint32_t y = m_seed & 0x00FFFFFF;
+      return {float(x) / float(0x01000000), float(y) / float(0x01000000)};
+    }
+    case eSobol: {
+      uint32_t seed     = hashCombine(m_seed, dimension);
+      uint32_t shuffled = nestedUniformScramble(m_index, seed);
+      uint32_t x        = nestedUniformScramble(sobol(shuffled, 0), hashCombine(seed, 0));
+      uint32_t y        = nestedUniformScramble(sobol(shuffled, 1), hashCombine(seed, 1));
+      return {toFloat(x), toFloat(y)};
+    }
+    case eR2: {
+      // The index is shuffled per pair, otherwise the pairs would be shifted copies of each other
+      uint32_t seed  = hashCombine(m_seed, dimension);
+      uint32_t index = nestedUniformScramble(m_index, hashCombine(seed, 2));
+      uint32_t x     = index * s_r2X + hashCombine(seed, 0);
+      uint32_t y     = index * s_r2Y + hashCombine(seed, 1);
+      return {toFloat(x), toFloat(y)};
+    }
+    case eBlueNoise:
+    default: {
+      // Each pair of dimensions reads the tile at a different offset, for each axis. The shuffle
+      // of the index does not depend on the pixel: neighbor pixels use the same lattice point,
+      // so the rotations keep the spectrum of the blue noise.
+      const uint32_t size   = m_noise->size;
+      const uint64_t ranks  = uint64_t(size) * size;
+      uint32_t       shift0 = hash(2 * dimension + 0);
+      uint32_t       shift1 = hash(2 * dimension + 1);
+      uint32_t       r0     = m_noise->ranks[((m_y + (shift0 >> 16)) % size) * size
+                                   + (m_x + (shift0 & 0xFFFF)) % size];
+      uint32_t       r1     = m_noise->ranks[((m_y + (shift1 >> 16)) % size) * size
+                                   + (m_x + (shift1 & 0xFFFF)) % size];
+      uint32_t       index  = nestedUniformScramble(m_index, hash(dimension));
+      uint32_t       x      = index * s_r2X + static_cast<uint32_t>((uint64_t(r0) << 32) / ranks);
+      uint32_t       y      = index * s_r2Y + static_cast<uint32_t>((uint64_t(r1) << 32) / ranks);
+      return {toFloat(x), toFloat(y)};
+    }
+  }
+}
+
+const char* SampleSequence::getTypeName(Type type)
+{
+  switch(type)
+  {
+    case eWhite:
+      return "white";
+    case eSobol:
+      return "sobol";
+    case eR2:
+      return "r2";
+    case eBlueNoise:
+      return "blue_noise";
+    default:
+      return "unknown";
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Integer hash of Chris Wellons (lowbias32), and the combination of boost
+//
+uint32_t SampleSequence::hash(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+uint32_t SampleSequence::hashCombine(uint32_t seed, uint32_t v)
+{
+  return seed ^ (hash(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+uint32_t SampleSequence::reverseBits(uint32_t x)
+{
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+  x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Owen scrambling: the Laine-Karras permutation, with the constants of Burley, on the reversed
+// bits (each bit is flipped depending on the higher bits only)
+//
+uint32_t SampleSequence::nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+  x = reverseBits(x);
+  x ^= x * 0x3d20adeau;
+  x += seed;
+  x *= (seed >> 16) | 1u;
+  x ^= x * 0x05526c56u;
+  x ^= x * 0x53a22864u;
+  return reverseBits(x);
+}
+
+//--------------------------------------------------------------------------------------------------
+// First two dimensions of Sobol: the van der Corput sequence, and the one of the polynomial x+1,
+// whose direction numbers are the rows of the Pascal triangle modulo 2
+//
+uint32_t SampleSequence::sobol(uint32_t index, uint32_t dimension)
+{
+  if(dimension == 0)
+    return reverseBits(index);
+
+  uint32_t result    = 0;
+  uint32_t direction = 1u << 31;
+  for(; index != 0; index >>= 1)
+  {
+    if(index & 1)
+      result ^= direction;
+    direction ^= direction >> 1;
+  }
+  return result;
+}
+
+uint32_t SampleSequence::tea(uint32_t val0, uint32_t val1)
+{
+  uint32_t v0 = val0;
+  uint32_t v1 = val1;
+  uint32_t s0 = 0;
+  for(uint32_t n = 0; n < 16; n++)
+  {
+    s0 += 0x9e3779b9u;
+    v0 += ((v1 << 4) + 0xa341316cu) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4u);
+    v1 += ((v0 << 4) + 0xad90777du) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761eu);
+  }
+  return v0;
+}
+
+float SampleSequence::toFloat(uint32_t x)
+{
+  return float(x >> 8) / float(1 << 24);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Void-and-cluster: the energy of a pixel is the sum of a toroidal gaussian of the pixels which are
+// on. The tightest cluster is the 'on' pixel of highest energy, the largest void the 'off' pixel
+// of lowest energy.
+// 1. A random initial pattern (10% of the pixels) is relaxed by moving its tightest cluster to
+//    its largest void, until the move would undo itself
+// 2. Its pixels are ranked by removing the tightest clusters, the last removed gets rank 0
+// 3. The remaining pixels are ranked by filling the largest voids. Past the half, this is also
+//    the tightest cluster of the 'off' pixels, as the sum of the energies of both is constant.
+//
+SampleSequence::BlueNoise SampleSequence::generateBlueNoise(uint32_t size, uint32_t seed)
+{
+  const uint32_t count = size * size;
+  const float    sigma = 1.5f;
+
+  std::vector<float> kernel(count);
+  for(uint32_t dy = 0; dy < size; dy++)
+  {
+    for(uint32_t dx = 0; dx < size; dx++)
+    {
+      float x = float(std::min(dx, size - dx));
+      float y = float(std::min(dy, size - dy));
+      kernel[dy * size + dx] = std::exp(-(x * x + y * y) / (2.f * sigma * sigma));
+    }
+  }
+
+  // Switches the pixel `p` of `pattern`, and updates the energies `e`
+  auto toggle = [&](std::vector<uint8_t>& pattern, std::vector<float>& e, uint32_t p) {
+    float    sign = pattern[p] ? -1.f : 1.f;
+    uint32_t px   = p % size;
+    uint32_t py   = p / size;
+    pattern[p]    = pattern[p] ? 0 : 1;
+    for(uint32_t qy = 0; qy < size; qy++)
+    {
+      const float* row = &kernel[((qy + size - py) % size) * size];
+      for(uint32_t qx = 0; qx < size; qx++)
+        e[qy * size + qx] += sign * row[(qx + size - px) % size];
+    }
+  };
+  auto tightestCluster = [&](const std::vector<uint8_t>& pattern, const std::vector<float>& e) {
+    uint32_t best = 0;
+    float    max  = -1.f;
+    for(uint32_t p = 0; p < count; p++)
+    {
+      if(pattern[p] && e[p] > max)
+      {
+        max  = e[p];
+        best = p;
+      }
+    }
+    return best;
+  };
+  auto largestVoid = [&](const std::vector<uint8_t>& pattern, const std::vector<float>& e) {
+    uint32_t best = 0;
+    float    min  = 1e30f;
+    for(uint32_t p = 0; p < count; p++)
+    {
+      if(!pattern[p] && e[p] < min)
+      {
+        min  = e[p];
+        best = p;
+      }
+    }
+    return best;
+  };
+
+  // 1. Initial pattern
+  std::vector<uint8_t> on(count, 0);
+  std::vector<float>   energy(count, 0.f);
+  const uint32_t nbInitial = std::max(count / 10, 1u);
+  uint32_t       state     = hash(seed);
+  for(uint32_t placed = 0; placed < nbInitial;)
+  {
+    state      = hash(state + 1);
+    uint32_t p = state % count;
+    if(!on[p])
+    {
+      toggle(on, energy, p);
+      placed++;
+    }
+  }
+  for(uint32_t iteration = 0; iteration < count; iteration++)
+  {
+    uint32_t cluster = tightestCluster(on, energy);
+    toggle(on, energy, cluster);
+    uint32_t gap = largestVoid(on, energy);
+    toggle(on, energy, gap);
+    if(gap == cluster)
+      break;
+  }
+
+  BlueNoise noise;
+  noise.size = size;
+  noise.ranks.resize(count);
+
+  // 2. Ranks of the initial pattern
+  std::vector<uint8_t> pattern = on;
+  std::vector<float>   e       = energy;
+  for(uint32_t rank = nbInitial; rank-- > 0;)
+  {
+    uint32_t cluster     = tightestCluster(pattern, e);
+    noise.ranks[cluster] = rank;
+    toggle(pattern, e, cluster);
+  }
+
+  // 3. Filling
+  for(uint32_t rank = nbInitial; rank < count; rank++)
+  {
+    uint32_t gap     = largestVoid(on, energy);
+    noise.ranks[gap] = rank;
+    toggle(on, energy, gap);
+  }
+  return noise;
+}
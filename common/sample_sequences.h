@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include "nvmath/nvmath.h"
+
+#include <cstdint>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Sample sequences of the shaders (shaders/sampler.glsl of the samples), on the CPU: both must
+// give the same values, bit for bit, for the same pixel, sample index and dimension.
+//
+// - eWhite: tea() seeding and rnd(), the random numbers used before
+// - eSobol: Sobol (0,2)-sequence, with the hash-based Owen scrambling and shuffling of
+//   Burley, "Practical Hash-based Owen Scrambling" (JCGT 2020). Each pair of dimensions is an
+//   independently scrambled and shuffled 2D sequence, seeded by the pixel.
+// - eR2: rank-1 lattice of the plastic number (Roberts, "The Unreasonable Effectiveness of
+//   Quasirandom Sequences"), with a random rotation (Cranley-Patterson) per pixel and pair of
+//   dimensions
+// - eBlueNoise: R2, rotated by a tiled blue-noise texture instead of a hash. The error of
+//   neighbor pixels is anti-correlated, which looks less noisy at the same error.
+//
+// All sequences are computed in 32-bit fixed point, to be exact on the GPU. The sample index is
+// the index of the path (or camera sample) in the pixel, and the dimensions are consumed by pairs:
+// next1D() also uses a pair.
+//
+// Usage:
+//   SampleSequence::BlueNoise noise = SampleSequence::generateBlueNoise();  // Texture of the GPU
+//   SampleSequence sampler(SampleSequence::eSobol, x, y, frame, &noise);
+//   nvmath::vec2f  jitter = sampler.next2D();
+//   nvmath::vec2f  bounce = sampler.next2D();
+//
+class SampleSequence
+{
+public:
+  enum Type
+  {
+    eWhite,
+    eSobol,
+    eR2,
+    eBlueNoise,
+    eTypeCount
+  };
+
+  // Square tile of ranks in [0, size*size), void-and-cluster (Ulichney 1993)
+  static const uint32_t s_blueNoiseSize = 64;  // BLUE_NOISE_SIZE of sampler.glsl
+  struct BlueNoise
+  {
+    uint32_t              size{0};
+    std::vector<uint32_t> ranks;  // size * size, row major
+  };
+
+  // Sequence of the pixel (x, y), sample `index`. `noise` is only needed by eBlueNoise.
+  SampleSequence(Type             type,
+                 uint32_t         x,
+                 uint32_t         y,
+                 uint32_t         index,
+                 const BlueNoise* noise = nullptr);
+
+  nvmath::vec2f next2D();
+  float         next1D() { return next2D().x; }
+
+  static const char* getTypeName(Type type);
+
+  // Building blocks, also in sampler.glsl
+  static uint32_t hash(uint32_t x);
+  static uint32_t hashCombine(uint32_t seed, uint32_t v);
+  static uint32_t reverseBits(uint32_t x);
+  static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed);
+  static uint32_t sobol(uint32_t index, uint32_t dimension);  // Dimensions 0 and 1
+  static uint32_t tea(uint32_t val0, uint32_t val1);
+  static float    toFloat(uint32_t x);  // [0,1), keeps the 24 upper bits
+
+  // Deterministic for a given seed. About 0.2 s for 64x64, done once at load.
+  static BlueNoise generateBlueNoise(uint32_t size = s_blueNoiseSize, uint32_t seed = 0);
+
+private:
+  Type             m_type;
+  uint32_t         m_x;
+  uint32_t         m_y;
+  uint32_t         m_index;
+  uint32_t         m_dimension{0};  // Pairs of dimensions consumed
+  uint32_t         m_seed;          // Pixel hash, or state of the white noise
+  const BlueNoise* m_noise;
+};
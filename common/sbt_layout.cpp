@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "sbt_layout.h"
+
+#include <algorithm>
+#include <cstring>
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool isPowerOfTwo(uint32_t value)
+{
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void SbtLayout::setup(const Properties& properties)
+{
+  m_properties = properties;
+  clear();
+}
+
+void SbtLayout::setup(const vk::PhysicalDeviceRayTracingPipelinePropertiesKHR& rtProperties)
+{
+  Properties properties;
+  properties.handleSize      = rtProperties.shaderGroupHandleSize;
+  properties.handleAlignment = rtProperties.shaderGroupHandleAlignment;
+  properties.baseAlignment   = rtProperties.shaderGroupBaseAlignment;
+  properties.maxStride       = rtProperties.maxShaderGroupStride;
+  setup(properties);
+}
+
+void SbtLayout::clear()
+{
+  for(auto& records : m_records)
+    records.clear();
+  m_stride    = {};
+  m_offset    = {};
+  m_size      = 0;
+  m_finalized = false;
+  clearDirty();
+}
+
+const char* SbtLayout::getRegionName(Region region)
+{
+  static const char* names[] = {"raygen", "miss", "hit", "callable"};
+  return region < eRegionCount ? names[region] : "unknown";
+}
+
+//--------------------------------------------------------------------------------------------------
+// Adding a record invalidates the layout: finalize() must be called again
+//
+uint32_t SbtLayout::addRecord(Region      region,
+                              uint32_t    groupIndex,
+                              const void* data,
+                              uint32_t    dataSize)
+{
+  Record record;
+  record.group = groupIndex;
+  record.data.resize(dataSize);
+  if(data != nullptr && dataSize > 0)
+    memcpy(record.data.data(), data, dataSize);
+  m_records[region].push_back(std::move(record));
+  m_finalized = false;
+  return static_cast<uint32_t>(m_records[region].size() - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Regions follow each other in the order raygen, miss, hit, callable. Empty regions take no space.
+//
+bool SbtLayout::finalize(std::string* error)
+{
+  m_finalized = false;
+  auto fail   = [&](const std::string& message) {
+    if(error != nullptr)
+      *error = message;
+    return false;
+  };
+
+  const Properties& p = m_properties;
+  if(p.handleSize == 0)
+    return fail("shader group handle size is 0");
+  if(!isPowerOfTwo(p.handleAlignment) || !isPowerOfTwo(p.baseAlignment))
+    return fail("shaderGroupHandleAlignment and shaderGroupBaseAlignment must be powers of two");
+  if(m_records[eRaygen].empty())
+    return fail("the raygen region has no record");
+
+  uint64_t offset = 0;
+  for(uint32_t r = 0; r < eRegionCount; r++)
+  {
+    const auto& records = m_records[r];
+    uint64_t    largest = 0;
+    for(const auto& record : records)
+      largest = std::max<uint64_t>(largest, p.handleSize + record.data.size());
+
+    uint64_t stride = alignUp(largest, p.handleAlignment);
+    if(r == eRaygen)
+      stride = alignUp(stride, p.baseAlignment);  // Each raygen record starts a region
+    if(!records.empty() && stride > p.maxStride)
+      return fail(std::string(getRegionName(Region(r))) + " region: stride of "
+                  + std::to_string(stride) + " bytes is larger than maxShaderGroupStride ("
+                  + std::to_string(p.maxStride) + ")");
+
+    m_stride[r] = records.empty() ? 0 : static_cast<uint32_t>(stride);
+    m_offset[r] = offset;
+    offset      = alignUp(offset + stride * records.size(), p.baseAlignment);
+  }
+  m_size      = offset;
+  m_finalized = true;
+  return true;
+}
+
+uint32_t SbtLayout::getGroupCount() const
+{
+  uint32_t count = 0;
+  for(const auto& records : m_records)
+    for(const auto& record : records)
+      count = std::max(count, record.group + 1);
+  return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The bytes between the records (alignment) are left to zero
+//
+bool SbtLayout::write(uint8_t* dst, const uint8_t* handles, uint32_t groupCount) const
+{
+  if(!m_finalized || groupCount < getGroupCount())
+    return false;
+
+  memset(dst, 0, m_size);
+  for(uint32_t r = 0; r < eRegionCount; r++)
+  {
+    const auto& records = m_records[r];
+    for(uint32_t i = 0; i < static_cast<uint32_t>(records.size()); i++)
+    {
+      uint8_t* pRecord = dst + getRecordOffset(Region(r), i);
+      memcpy(pRecord, handles + static_cast<size_t>(records[i].group) * m_properties.handleSize,
+             m_properties.handleSize);
+      if(!records[i].data.empty())
+        memcpy(pRecord + m_properties.handleSize, records[i].data.data(), records[i].data.size());
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The raygen region is a single record: its size must be equal to its stride
+//
+std::array<vk::StridedDeviceAddressRegionKHR, 4> SbtLayout::getRegions(vk::DeviceAddress address,
+                                                                       uint32_t raygenRecord) const
+{
+  std::array<vk::StridedDeviceAddressRegionKHR, 4> regions{};
+  regions[eRaygen] = vk::StridedDeviceAddressRegionKHR{
+      address + getRecordOffset(eRaygen, raygenRecord), m_stride[eRaygen], m_stride[eRaygen]};
+  for(uint32_t r = eMiss; r < eRegionCount; r++)
+  {
+    if(m_records[r].empty())
+      continue;
+    uint64_t size = static_cast<uint64_t>(m_stride[r]) * m_records[r].size();
+    regions[r]    = vk::StridedDeviceAddressRegionKHR{address + m_offset[r], m_stride[r], size};
+  }
+  return regions;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Partial update of a record. The offsets of the records are only known after finalize().
+//
+bool SbtLayout::setRecordData(Region region, uint32_t record, const void* data, uint32_t dataSize)
+{
+  if(!m_finalized || record >= m_records[region].size())
+    return false;
+  Record& rec = m_records[region][record];
+  if(dataSize > rec.data.size())
+    return false;
+  memcpy(rec.data.data(), data, dataSize);
+  rec.dirty = true;
+
+  uint64_t begin = getRecordOffset(region, record) + m_properties.handleSize;
+  m_dirtyBegin   = std::min(m_dirtyBegin, begin);
+  m_dirtyEnd     = std::max(m_dirtyEnd, begin + dataSize);
+  return true;
+}
+
+bool SbtLayout::getDirtyRange(uint64_t& offset, uint64_t& size) const
+{
+  if(m_dirtyEnd <= m_dirtyBegin)
+    return false;
+  offset = m_dirtyBegin & ~3ULL;
+  size   = std::min(alignUp(m_dirtyEnd, 4), m_size) - offset;
+  return true;
+}
+
+void SbtLayout::writeDirty(uint8_t* table) const
+{
+  for(uint32_t r = 0; r < eRegionCount; r++)
+  {
+    const auto& records = m_records[r];
+    for(uint32_t i = 0; i < static_cast<uint32_t>(records.size()); i++)
+    {
+      if(records[i].dirty)
+        memcpy(table + getRecordOffset(Region(r), i) + m_properties.handleSize,
+               records[i].data.data(), records[i].data.size());
+    }
+  }
+}
+
+void SbtLayout::clearDirty()
+{
+  for(auto& records : m_records)
+    for(auto& record : records)
+      record.dirty = false;
+  m_dirtyBegin = ~0ULL;
+  m_dirtyEnd   = 0;
+}
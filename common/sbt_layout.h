@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+//--------------------------------------------------------------------------------------------------
+// Layout of a shader binding table (SBT)
+// - Records are added to the four regions (raygen, miss, hit, callable). Each one references a
+//   shader group of the pipeline and can carry inline data, read with `shaderRecordEXT`
+// - The stride of a region is its largest record (handle + data) aligned to
+//   shaderGroupHandleAlignment, and each region starts on shaderGroupBaseAlignment. A raygen
+//   record is a region by itself, so its stride is also aligned to shaderGroupBaseAlignment.
+// - Only bytes are handled: the layout can be computed and written with fake handles, without a
+//   device. The Vulkan parts are the handles given to write() and the regions for traceRaysKHR.
+// - The data of a record can be changed after the table was written: only the modified bytes
+//   need to be written again (getDirtyRange / writeDirty)
+//
+// Usage:
+//   layout.setup(rtProperties);
+//   layout.addRecord(SbtLayout::eRaygen, 0);
+//   layout.addRecord(SbtLayout::eMiss, 1);
+//   layout.addRecord(SbtLayout::eHit, 2, hitData);  // any trivially copyable type
+//   if(!layout.finalize(&error)) ...
+//   layout.write(table.data(), handles.data(), layout.getGroupCount());
+//   auto regions = layout.getRegions(sbtBufferAddress);
+//
+class SbtLayout
+{
+public:
+  enum Region
+  {
+    eRaygen,
+    eMiss,
+    eHit,
+    eCallable,
+    eRegionCount
+  };
+
+  // Device limits, from VkPhysicalDeviceRayTracingPipelinePropertiesKHR
+  struct Properties
+  {
+    uint32_t handleSize{32};
+    uint32_t handleAlignment{32};
+    uint32_t baseAlignment{64};
+    uint32_t maxStride{4096};
+  };
+
+  void setup(const Properties& properties);
+  void setup(const vk::PhysicalDeviceRayTracingPipelinePropertiesKHR& rtProperties);
+  void clear();
+
+  // Adds a record using the shader group `groupIndex`, returns its index in the region.
+  // `dataSize` is also the space reserved for later updates of the record data.
+  uint32_t addRecord(Region      region,
+                     uint32_t    groupIndex,
+                     const void* data     = nullptr,
+                     uint32_t    dataSize = 0);
+  template <typename T>
+  uint32_t addRecord(Region region, uint32_t groupIndex, const T& data)
+  {
+    return addRecord(region, groupIndex, &data, static_cast<uint32_t>(sizeof(T)));
+  }
+
+  // Computes the strides and offsets of the regions and validates them against the device limits.
+  // On failure, `error` tells which region or record is invalid.
+  bool finalize(std::string* error = nullptr);
+  bool isFinalized() const { return m_finalized; }
+
+  // Valid after finalize()
+  uint64_t getSize() const { return m_size; }
+  uint32_t getStride(Region region) const { return m_stride[region]; }
+  uint64_t getOffset(Region region) const { return m_offset[region]; }
+  uint32_t getRecordCount(Region region) const
+  {
+    return static_cast<uint32_t>(m_records[region].size());
+  }
+  uint64_t getRecordOffset(Region region, uint32_t record) const
+  {
+    return m_offset[region] + static_cast<uint64_t>(record) * m_stride[region];
+  }
+  // Number of shader group handles write() needs: the largest group index + 1
+  uint32_t getGroupCount() const;
+
+  // Writes the whole table (getSize() bytes) in `dst`. `handles` holds `groupCount` handles of
+  // `handleSize` bytes, as returned by getRayTracingShaderGroupHandlesKHR.
+  bool write(uint8_t* dst, const uint8_t* handles, uint32_t groupCount) const;
+
+  // Regions for traceRaysKHR, `address` being the device address of the table.
+  // Only one raygen record is used by a trace: `raygenRecord` selects it.
+  std::array<vk::StridedDeviceAddressRegionKHR, 4> getRegions(vk::DeviceAddress address,
+                                                              uint32_t raygenRecord = 0) const;
+
+  // Partial update: replaces the data of a record, without touching the rest of the table.
+  // `dataSize` cannot be larger than the size given to addRecord(). Fails before finalize().
+  bool setRecordData(Region region, uint32_t record, const void* data, uint32_t dataSize);
+  template <typename T>
+  bool setRecordData(Region region, uint32_t record, const T& data)
+  {
+    return setRecordData(region, record, &data, static_cast<uint32_t>(sizeof(T)));
+  }
+  // Byte range of the table modified since the last clearDirty(), rounded to 4 bytes
+  // (vkCmdUpdateBuffer / vkCmdCopyBuffer friendly). Returns false if nothing changed.
+  bool getDirtyRange(uint64_t& offset, uint64_t& size) const;
+  // Writes the data of the modified records in `table`, a copy of the whole table
+  void writeDirty(uint8_t* table) const;
+  void clearDirty();
+
+  static const char* getRegionName(Region region);
+
+private:
+  struct Record
+  {
+    uint32_t             group{0};
+    std::vector<uint8_t> data;  // Its size is the space reserved in the record
+    bool                 dirty{false};
+  };
+
+  Properties                                    m_properties;
+  std::array<std::vector<Record>, eRegionCount> m_records;
+  std::array<uint32_t, eRegionCount>            m_stride{};
+  std::array<uint64_t, eRegionCount>            m_offset{};
+  uint64_t                                      m_size{0};
+  bool                                          m_finalized{false};
+  uint64_t                                      m_dirtyBegin{~0ULL};  // Modified bytes
+  uint64_t                                      m_dirtyEnd{0};
+};
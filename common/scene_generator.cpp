@@ -0,0 +1,632 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "scene_generator.h"
+#include "nvh/nvprint.hpp"
+#include "trace_events.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+const float kPi = 3.14159265358979323846f;
+
+// Independent random streams
+enum RandomStream : uint64_t
+{
+  eStreamInstances = 1,
+  eStreamSpheres   = 2,
+  eStreamClusters  = 3,
+  eStreamTextures  = 0x1000,  // + texture index
+  eStreamMeshes    = 0x100000000ULL,  // + mesh index
+};
+
+//--------------------------------------------------------------------------------------------------
+// PCG32 (https://www.pcg-random.org): small state, good quality, and the same sequence
+// everywhere, which is not the case of the distributions of <random>
+//
+class Pcg32
+{
+public:
+  Pcg32(uint64_t seed, uint64_t stream)
+      : m_inc((stream << 1u) | 1u)
+  {
+    next();
+    m_state += seed;
+    next();
+  }
+
+  uint32_t next()
+  {
+    uint64_t old = m_state;
+    m_state      = old * 6364136223846793005ULL + m_inc;
+    auto xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+    auto rot        = static_cast<uint32_t>(old >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+  }
+
+  // [0, 1)
+  float uniform() { return static_cast<float>(next() >> 8) * (1.f / 16777216.f); }
+  float uniform(float a, float b) { return a + (b - a) * uniform(); }
+
+  // Standard normal distribution (Box-Muller)
+  float normal()
+  {
+    float u1 = std::max(uniform(), 1e-7f);
+    float u2 = uniform();
+    return sqrtf(-2.f * logf(u1)) * cosf(2.f * kPi * u2);
+  }
+
+private:
+  uint64_t m_state{0};
+  uint64_t m_inc;
+};
+
+std::string textureName(uint32_t index)
+{
+  return "texture_" + std::to_string(index) + ".png";
+}
+
+//--------------------------------------------------------------------------------------------------
+// Position following the distribution of the settings
+//
+nvmath::vec3f samplePosition(Pcg32&                            rng,
+                             const SceneGenerator::Settings&   settings,
+                             const std::vector<nvmath::vec3f>& clusters)
+{
+  const nvmath::vec3f& c = settings.center;
+  const nvmath::vec3f& s = settings.spread;
+  switch(settings.distribution)
+  {
+    case SceneGenerator::Distribution::eUniform:
+      return nvmath::vec3f(c.x + s.x * rng.uniform(-1.f, 1.f), c.y + s.y * rng.uniform(-1.f, 1.f),
+                           c.z + s.z * rng.uniform(-1.f, 1.f));
+    case SceneGenerator::Distribution::eClustered: {
+      const nvmath::vec3f& cluster = clusters[rng.next() % clusters.size()];
+      return nvmath::vec3f(cluster.x + 0.1f * s.x * rng.normal(),
+                           cluster.y + 0.1f * s.y * rng.normal(),
+                           cluster.z + 0.1f * s.z * rng.normal());
+    }
+    default:
+      return nvmath::vec3f(c.x + s.x * rng.normal(), c.y + s.y * rng.normal(),
+                           c.z + s.z * rng.normal());
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Ellipsoid made of `stacks` bands of `slices` quads, the bands at the poles are triangles:
+// 2 * slices * (stacks - 1) triangles. Materials take contiguous ranges of triangles.
+//
+ObjLoader ellipsoidMesh(const SceneGenerator::Settings& settings, uint32_t meshIndex)
+{
+  Pcg32 rng(settings.seed, eStreamMeshes + meshIndex);
+
+  uint32_t tris   = std::max(settings.trianglesPerMesh, 6u);
+  uint32_t stacks = std::max(2u, static_cast<uint32_t>(sqrtf(tris / 4.f) + 0.5f) + 1u);
+  uint32_t slices = std::max(3u, (tris + stacks - 1) / (2 * (stacks - 1)));
+
+  nvmath::vec3f radii(rng.uniform(0.5f, 1.f), rng.uniform(0.5f, 1.f), rng.uniform(0.5f, 1.f));
+
+  ObjLoader mesh;
+  mesh.m_vertices.reserve(static_cast<size_t>(stacks + 1) * (slices + 1));
+  for(uint32_t st = 0; st <= stacks; st++)
+  {
+    float theta = kPi * st / stacks;
+    for(uint32_t sl = 0; sl <= slices; sl++)
+    {
+      float         phi = 2.f * kPi * sl / slices;
+      nvmath::vec3f dir(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+
+      VertexObj v;
+      v.pos      = nvmath::vec3f(dir.x * radii.x, dir.y * radii.y, dir.z * radii.z);
+      v.nrm      = nvmath::normalize(
+          nvmath::vec3f(dir.x / radii.x, dir.y / radii.y, dir.z / radii.z));
+      v.color    = nvmath::vec3f(1.f);
+      v.texCoord = nvmath::vec2f(static_cast<float>(sl) / slices, static_cast<float>(st) / stacks);
+      mesh.m_vertices.push_back(v);
+    }
+  }
+
+  auto vtx = [&](uint32_t st, uint32_t sl) { return st * (slices + 1) + sl; };
+  for(uint32_t st = 0; st < stacks; st++)
+  {
+    for(uint32_t sl = 0; sl < slices; sl++)
+    {
+      if(st != 0)
+        mesh.m_indices.insert(mesh.m_indices.end(),
+                              {vtx(st, sl), vtx(st, sl + 1), vtx(st + 1, sl)});
+      if(st != stacks - 1)
+        mesh.m_indices.insert(mesh.m_indices.end(),
+                              {vtx(st, sl + 1), vtx(st + 1, sl + 1), vtx(st + 1, sl)});
+    }
+  }
+
+  if(settings.nbTextures > 0)
+    mesh.m_textures.push_back(textureName(meshIndex % settings.nbTextures));
+
+  uint32_t nbMaterials = std::max(settings.materialsPerMesh, 1u);
+  for(uint32_t m = 0; m < nbMaterials; m++)
+  {
+    MaterialObj mat;
+    mat.diffuse   = nvmath::vec3f(rng.uniform(0.1f, 0.9f), rng.uniform(0.1f, 0.9f),
+                                rng.uniform(0.1f, 0.9f));
+    mat.specular  = nvmath::vec3f(rng.uniform(0.f, 0.5f));
+    mat.shininess = rng.uniform(1.f, 64.f);
+    mat.illum     = 2;
+    mat.textureID = mesh.m_textures.empty() ? -1 : 0;
+    mesh.m_materials.push_back(mat);
+  }
+
+  auto nbTriangles = static_cast<uint32_t>(mesh.m_indices.size() / 3);
+  mesh.m_matIndx.resize(nbTriangles);
+  for(uint32_t t = 0; t < nbTriangles; t++)
+    mesh.m_matIndx[t] = static_cast<int32_t>(static_cast<uint64_t>(t) * nbMaterials / nbTriangles);
+
+  return mesh;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Checker of two random colors, with a random number of cells
+//
+SceneGenerator::Texture generateTexture(const SceneGenerator::Settings& settings, uint32_t index)
+{
+  Pcg32 rng(settings.seed, eStreamTextures + index);
+
+  SceneGenerator::Texture texture;
+  texture.name   = textureName(index);
+  texture.width  = std::max(settings.textureSize, 1u);
+  texture.height = texture.width;
+  texture.rgba.resize(static_cast<size_t>(texture.width) * texture.height * 4);
+
+  uint8_t colors[2][3];
+  for(auto& color : colors)
+    for(auto& c : color)
+      c = static_cast<uint8_t>(rng.next() & 0xFF);
+  uint32_t cells    = 2 + rng.next() % 15;
+  uint32_t cellSize = std::max(texture.width / cells, 1u);
+
+  for(uint32_t y = 0; y < texture.height; y++)
+  {
+    for(uint32_t x = 0; x < texture.width; x++)
+    {
+      const uint8_t* color = colors[((x / cellSize) + (y / cellSize)) & 1];
+      uint8_t*       texel = &texture.rgba[(static_cast<size_t>(y) * texture.width + x) * 4];
+      texel[0]             = color[0];
+      texel[1]             = color[1];
+      texel[2]             = color[2];
+      texel[3]             = 255;
+    }
+  }
+  return texture;
+}
+
+//--------------------------------------------------------------------------------------------------
+// PNG helpers: the image data is stored in uncompressed deflate blocks
+//
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+  // Initialized once, thread-safe: images can be written from several threads
+  static const std::array<uint32_t, 256> table = []() {
+    std::array<uint32_t, 256> t{};
+    for(uint32_t n = 0; n < 256; n++)
+    {
+      uint32_t c = n;
+      for(int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[n] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for(size_t i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+void writePngChunk(FILE* file, const char* type, const std::vector<uint8_t>& data)
+{
+  std::vector<uint8_t> chunk;
+  putBigEndian(chunk, static_cast<uint32_t>(data.size()));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  putBigEndian(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+  fwrite(chunk.data(), 1, chunk.size(), file);
+}
+}  // namespace
+
+
+//--------------------------------------------------------------------------------------------------
+// Generating all elements of the scene
+//
+SceneGenerator::Scene SceneGenerator::generate(const Settings& settings)
+{
+  TRACE_SCOPE("Scene generation");
+
+  Scene scene;
+
+  uint32_t nbMeshes = settings.nbMeshes;
+  if(settings.nbInstances > 0)
+    nbMeshes = std::max(nbMeshes, 1u);
+  if(settings.generateMeshes)
+  {
+    scene.meshes.reserve(nbMeshes);
+    for(uint32_t i = 0; i < nbMeshes; i++)
+      scene.meshes.emplace_back(ellipsoidMesh(settings, i));
+  }
+
+  for(uint32_t i = 0; i < settings.nbTextures; i++)
+    scene.textures.emplace_back(generateTexture(settings, i));
+
+  std::vector<nvmath::vec3f> clusters;
+  if(settings.distribution == Distribution::eClustered)
+  {
+    Pcg32    rng(settings.seed, eStreamClusters);
+    Settings uniform     = settings;
+    uniform.distribution = Distribution::eUniform;
+    for(uint32_t i = 0; i < std::max(settings.nbClusters, 1u); i++)
+      clusters.push_back(samplePosition(rng, uniform, clusters));
+  }
+
+  Pcg32 instRng(settings.seed, eStreamInstances);
+  scene.instances.reserve(settings.nbInstances);
+  for(uint32_t i = 0; i < settings.nbInstances; i++)
+  {
+    nvmath::vec3f pos   = samplePosition(instRng, settings, clusters);
+    float         rx    = instRng.uniform(0.f, 2.f * kPi);
+    float         ry    = instRng.uniform(0.f, 2.f * kPi);
+    float         rz    = instRng.uniform(0.f, 2.f * kPi);
+    float         scale = instRng.uniform(settings.minScale, settings.maxScale);
+
+    Instance inst;
+    inst.meshIndex = i % nbMeshes;
+    inst.transform = nvmath::translation_mat4(pos) * nvmath::rotation_mat4_x(rx)
+                     * nvmath::rotation_mat4_y(ry) * nvmath::rotation_mat4_z(rz)
+                     * nvmath::scale_mat4(nvmath::vec3f(scale));
+    scene.instances.push_back(inst);
+  }
+
+  Pcg32 sphereRng(settings.seed, eStreamSpheres);
+  scene.spheres.resize(settings.nbSpheres);
+  for(auto& sphere : scene.spheres)
+  {
+    sphere.center = samplePosition(sphereRng, settings, clusters);
+    sphere.radius = sphereRng.uniform(settings.minRadius, settings.maxRadius);
+  }
+
+  return scene;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Same mesh as the one of `generate`, can be called from any thread
+//
+ObjLoader SceneGenerator::generateMesh(const Settings& settings, uint32_t meshIndex)
+{
+  return ellipsoidMesh(settings, meshIndex);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Writing the scene as OBJ: OBJ has no instancing, the placement of the meshes is in a side file
+//
+bool SceneGenerator::writeObj(const Scene& scene, const std::string& directory)
+{
+  TRACE_SCOPE("Write OBJ", directory);
+
+  for(size_t m = 0; m < scene.meshes.size(); m++)
+  {
+    const ObjLoader& mesh = scene.meshes[m];
+    std::string      name = "mesh_" + std::to_string(m);
+
+    FILE* mtl = fopen((directory + "/" + name + ".mtl").c_str(), "w");
+    if(mtl == nullptr)
+    {
+      LOGE("SceneGenerator: cannot write in %s\n", directory.c_str());
+      return false;
+    }
+    for(size_t i = 0; i < mesh.m_materials.size(); i++)
+    {
+      const MaterialObj& mat = mesh.m_materials[i];
+      fprintf(mtl, "newmtl mat_%zu\n", i);
+      fprintf(mtl, "Ka %f %f %f\n", mat.ambient.x, mat.ambient.y, mat.ambient.z);
+      fprintf(mtl, "Kd %f %f %f\n", mat.diffuse.x, mat.diffuse.y, mat.diffuse.z);
+      fprintf(mtl, "Ks %f %f %f\n", mat.specular.x, mat.specular.y, mat.specular.z);
+      fprintf(mtl, "Ns %f\nillum %d\n", mat.shininess, mat.illum);
+      if(mat.textureID >= 0)
+        fprintf(mtl, "map_Kd %s\n", mesh.m_textures[mat.textureID].c_str());
+    }
+    fclose(mtl);
+
+    FILE* obj = fopen((directory + "/" + name + ".obj").c_str(), "w");
+    if(obj == nullptr)
+      return false;
+    fprintf(obj, "mtllib %s.mtl\n", name.c_str());
+    for(const auto& v : mesh.m_vertices)
+      fprintf(obj, "v %f %f %f\n", v.pos.x, v.pos.y, v.pos.z);
+    for(const auto& v : mesh.m_vertices)
+      fprintf(obj, "vn %f %f %f\n", v.nrm.x, v.nrm.y, v.nrm.z);
+    for(const auto& v : mesh.m_vertices)
+      fprintf(obj, "vt %f %f\n", v.texCoord.x, v.texCoord.y);
+    int curMat = -1;
+    for(size_t t = 0; t < mesh.m_matIndx.size(); t++)
+    {
+      if(mesh.m_matIndx[t] != curMat)
+      {
+        curMat = mesh.m_matIndx[t];
+        fprintf(obj, "usemtl mat_%d\n", curMat);
+      }
+      uint32_t a = mesh.m_indices[3 * t + 0] + 1;
+      uint32_t b = mesh.m_indices[3 * t + 1] + 1;
+      uint32_t c = mesh.m_indices[3 * t + 2] + 1;
+      fprintf(obj, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+    }
+    fclose(obj);
+  }
+
+  FILE* csv = fopen((directory + "/instances.csv").c_str(), "w");
+  if(csv == nullptr)
+    return false;
+  fprintf(csv, "mesh,m00,m10,m20,m30,m01,m11,m21,m31,m02,m12,m22,m32,m03,m13,m23,m33\n");
+  for(const auto& inst : scene.instances)
+  {
+    fprintf(csv, "%u", inst.meshIndex);
+    for(int col = 0; col < 4; col++)
+      for(int row = 0; row < 4; row++)
+        fprintf(csv, ",%f", inst.transform(row, col));
+    fprintf(csv, "\n");
+  }
+  fclose(csv);
+
+  for(const auto& texture : scene.textures)
+  {
+    std::string pngName = directory + "/" + texture.name;
+    if(!writePng(pngName, texture.width, texture.height, texture.rgba.data()))
+      return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Writing the scene as glTF 2.0. For each mesh, the .bin holds positions, normals, texcoords
+// and indices; the primitives of a mesh share the vertex attributes and each one references
+// the range of indices of its material.
+//
+bool SceneGenerator::writeGltf(const Scene& scene, const std::string& filename)
+{
+  TRACE_SCOPE("Write glTF", filename);
+
+  std::string base    = filename.substr(0, filename.find_last_of('.'));
+  std::string binName = base.substr(base.find_last_of("/\\") + 1) + ".bin";
+  std::string dir     = filename.substr(0, filename.find_last_of("/\\") + 1);
+
+  FILE* bin = fopen((base + ".bin").c_str(), "wb");
+  FILE* gltf = fopen(filename.c_str(), "w");
+  if(bin == nullptr || gltf == nullptr)
+  {
+    LOGE("SceneGenerator: cannot write %s\n", filename.c_str());
+    if(bin)
+      fclose(bin);
+    if(gltf)
+      fclose(gltf);
+    return false;
+  }
+
+  std::string bufferViews, accessors, meshes, materials;
+  size_t      offset = 0, nbViews = 0, nbAccessors = 0, nbMaterials = 0;
+
+  auto addView = [&](const void* data, size_t size, int target) {
+    fwrite(data, 1, size, bin);
+    char str[128];
+    snprintf(str, sizeof(str),
+             "%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":%d}",
+             nbViews ? "," : "", offset, size, target);
+    bufferViews += str;
+    offset += size;
+    return nbViews++;
+  };
+  auto addAccessor = [&](size_t view, size_t byteOffset, int componentType, size_t count,
+                         const char* type, const std::string& extra) {
+    char str[256];
+    snprintf(str, sizeof(str),
+             "%s{\"bufferView\":%zu,\"byteOffset\":%zu,\"componentType\":%d,\"count\":%zu,"
+             "\"type\":\"%s\"%s}",
+             nbAccessors ? "," : "", view, byteOffset, componentType, count, type, extra.c_str());
+    accessors += str;
+    return nbAccessors++;
+  };
+
+  for(size_t m = 0; m < scene.meshes.size(); m++)
+  {
+    const ObjLoader& mesh = scene.meshes[m];
+
+    std::vector<nvmath::vec3f> positions, normals;
+    std::vector<nvmath::vec2f> texcoords;
+    nvmath::vec3f              bmin(1e30f), bmax(-1e30f);
+    for(const auto& v : mesh.m_vertices)
+    {
+      positions.push_back(v.pos);
+      normals.push_back(v.nrm);
+      texcoords.push_back(v.texCoord);
+      for(int c = 0; c < 3; c++)
+      {
+        bmin[c] = std::min(bmin[c], v.pos[c]);
+        bmax[c] = std::max(bmax[c], v.pos[c]);
+      }
+    }
+
+    char minMax[160];
+    snprintf(minMax, sizeof(minMax), ",\"min\":[%f,%f,%f],\"max\":[%f,%f,%f]", bmin.x, bmin.y,
+             bmin.z, bmax.x, bmax.y, bmax.z);
+    size_t count  = positions.size();
+    // 34962: ARRAY_BUFFER, 34963: ELEMENT_ARRAY_BUFFER, 5126: FLOAT, 5125: UNSIGNED_INT
+    size_t posView = addView(positions.data(), count * sizeof(nvmath::vec3f), 34962);
+    size_t nrmView = addView(normals.data(), count * sizeof(nvmath::vec3f), 34962);
+    size_t uvView  = addView(texcoords.data(), count * sizeof(nvmath::vec2f), 34962);
+    size_t posAcc  = addAccessor(posView, 0, 5126, count, "VEC3", minMax);
+    size_t nrmAcc  = addAccessor(nrmView, 0, 5126, count, "VEC3", "");
+    size_t uvAcc   = addAccessor(uvView, 0, 5126, count, "VEC2", "");
+    size_t idxView =
+        addView(mesh.m_indices.data(), mesh.m_indices.size() * sizeof(uint32_t), 34963);
+
+    // One primitive per contiguous range of triangles with the same material
+    std::string primitives;
+    size_t      first = 0;
+    for(size_t t = 1; t <= mesh.m_matIndx.size(); t++)
+    {
+      if(t < mesh.m_matIndx.size() && mesh.m_matIndx[t] == mesh.m_matIndx[first])
+        continue;
+      size_t idxAcc = addAccessor(idxView, first * 3 * sizeof(uint32_t), 5125, (t - first) * 3,
+                                  "SCALAR", "");
+      char   str[256];
+      snprintf(str, sizeof(str),
+               "%s{\"attributes\":{\"POSITION\":%zu,\"NORMAL\":%zu,\"TEXCOORD_0\":%zu},"
+               "\"indices\":%zu,\"material\":%zu}",
+               primitives.empty() ? "" : ",", posAcc, nrmAcc, uvAcc, idxAcc,
+               nbMaterials + mesh.m_matIndx[first]);
+      primitives += str;
+      first = t;
+    }
+    meshes += std::string(m ? "," : "") + "{\"primitives\":[" + primitives + "]}";
+
+    for(const auto& mat : mesh.m_materials)
+    {
+      char str[256];
+      snprintf(str, sizeof(str),
+               "%s{\"pbrMetallicRoughness\":{\"baseColorFactor\":[%f,%f,%f,1],"
+               "\"metallicFactor\":0,\"roughnessFactor\":%f",
+               nbMaterials ? "," : "", mat.diffuse.x, mat.diffuse.y, mat.diffuse.z,
+               1.f - mat.shininess / 128.f);
+      materials += str;
+      if(mat.textureID >= 0 && !scene.textures.empty())
+      {
+        size_t texIndex = m % scene.textures.size();  // See ellipsoidMesh()
+        materials += ",\"baseColorTexture\":{\"index\":" + std::to_string(texIndex) + "}";
+      }
+      materials += "}}";
+      nbMaterials++;
+    }
+  }
+  fclose(bin);
+
+  fprintf(gltf, "{\"asset\":{\"version\":\"2.0\",\"generator\":\"SceneGenerator\"},\n");
+  fprintf(gltf, "\"buffers\":[{\"uri\":\"%s\",\"byteLength\":%zu}],\n", binName.c_str(), offset);
+  fprintf(gltf, "\"bufferViews\":[%s],\n", bufferViews.c_str());
+  fprintf(gltf, "\"accessors\":[%s],\n", accessors.c_str());
+  fprintf(gltf, "\"meshes\":[%s],\n", meshes.c_str());
+  fprintf(gltf, "\"materials\":[%s],\n", materials.c_str());
+  if(!scene.textures.empty())
+  {
+    fprintf(gltf, "\"samplers\":[{\"magFilter\":9729,\"minFilter\":9987}],\n\"images\":[");
+    for(size_t i = 0; i < scene.textures.size(); i++)
+      fprintf(gltf, "%s{\"uri\":\"%s\"}", i ? "," : "", scene.textures[i].name.c_str());
+    fprintf(gltf, "],\n\"textures\":[");
+    for(size_t i = 0; i < scene.textures.size(); i++)
+      fprintf(gltf, "%s{\"sampler\":0,\"source\":%zu}", i ? "," : "", i);
+    fprintf(gltf, "],\n");
+  }
+
+  fprintf(gltf, "\"nodes\":[");
+  for(size_t i = 0; i < scene.instances.size(); i++)
+  {
+    const Instance& inst = scene.instances[i];
+    fprintf(gltf, "%s\n{\"mesh\":%u,\"matrix\":[", i ? "," : "", inst.meshIndex);
+    for(int col = 0; col < 4; col++)
+      for(int row = 0; row < 4; row++)
+        fprintf(gltf, "%s%g", (col || row) ? "," : "", inst.transform(row, col));
+    fprintf(gltf, "]}");
+  }
+  fprintf(gltf, "],\n\"scenes\":[{\"nodes\":[");
+  for(size_t i = 0; i < scene.instances.size(); i++)
+    fprintf(gltf, "%s%zu", i ? "," : "", i);
+  fprintf(gltf, "]}],\n\"scene\":0}\n");
+  fclose(gltf);
+
+  for(const auto& texture : scene.textures)
+  {
+    if(!writePng(dir + texture.name, texture.width, texture.height, texture.rgba.data()))
+      return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Minimal PNG: IHDR, a single IDAT with stored (not compressed) deflate blocks, IEND
+//
+bool SceneGenerator::writePng(const std::string& filename,
+                              uint32_t           width,
+                              uint32_t           height,
+                              const uint8_t*     rgba)
+{
+  FILE* file = fopen(filename.c_str(), "wb");
+  if(file == nullptr)
+  {
+    LOGE("SceneGenerator: cannot write %s\n", filename.c_str());
+    return false;
+  }
+
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  fwrite(signature, 1, sizeof(signature), file);
+
+  std::vector<uint8_t> header;
+  putBigEndian(header, width);
+  putBigEndian(header, height);
+  header.insert(header.end(), {8, 6, 0, 0, 0});  // 8 bits, RGBA, deflate, no filter, no interlace
+  writePngChunk(file, "IHDR", header);
+
+  // Raw scanlines, each one starting with its filter type (none)
+  size_t               rowSize = static_cast<size_t>(width) * 4;
+  std::vector<uint8_t> raw;
+  raw.reserve((rowSize + 1) * height);
+  for(uint32_t y = 0; y < height; y++)
+  {
+    raw.push_back(0);
+    raw.insert(raw.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+  }
+
+  // zlib stream
+  std::vector<uint8_t> data = {0x78, 0x01};
+  for(size_t pos = 0; pos < raw.size() || pos == 0; pos += 65535)
+  {
+    auto size = static_cast<uint16_t>(std::min<size_t>(raw.size() - pos, 65535));
+    data.push_back(pos + size >= raw.size() ? 1 : 0);  // Last block
+    data.insert(data.end(), {static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+                             static_cast<uint8_t>(~size), static_cast<uint8_t>(~size >> 8)});
+    data.insert(data.end(), raw.begin() + pos, raw.begin() + pos + size);
+  }
+  uint32_t a = 1, b = 0;  // Adler-32
+  for(uint8_t c : raw)
+  {
+    a = (a + c) % 65521;
+    b = (b + a) % 65521;
+  }
+  putBigEndian(data, (b << 16) | a);
+  writePngChunk(file, "IDAT", data);
+  writePngChunk(file, "IEND", {});
+
+  fclose(file);
+  return true;
+}
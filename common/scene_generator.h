@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include "nvmath/nvmath.h"
+#include "obj_loader.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Deterministic synthetic scenes, for load, build and trace scaling measurements
+//
+// - The same settings always produce the same scene: the random numbers come from PCG32 and
+//   the distributions are implemented here, the ones of <random> differ between standard
+//   libraries
+// - Meshes, instances, textures and spheres use separate random streams, so changing the
+//   number of instances does not change the meshes, and so on
+// - Instance 'i' uses mesh 'i % nbMeshes', the first `nbMeshes` instances introduce the meshes
+//   in order
+// - The scene can be used directly in memory, or written as OBJ or glTF files
+//
+// Usage:
+//   SceneGenerator::Settings settings;
+//   settings.seed        = 42;
+//   settings.nbInstances = 10000;
+//   settings.nbMeshes    = 100;
+//   SceneGenerator::Scene scene = SceneGenerator::generate(settings);
+//   SceneGenerator::writeGltf(scene, "synthetic.gltf");
+//
+class SceneGenerator
+{
+public:
+  enum class Distribution
+  {
+    eUniform,    // In the box center +/- spread
+    eNormal,     // Gaussian around center, spread is the standard deviation
+    eClustered,  // `nbClusters` gaussian clusters, uniformly placed in the box
+  };
+
+  struct Settings
+  {
+    uint32_t seed{0};
+
+    // Triangle meshes
+    uint32_t nbInstances{0};
+    uint32_t nbMeshes{1};            // Unique meshes, shared by the instances
+    uint32_t trianglesPerMesh{128};  // Approximate, meshes are UV ellipsoids
+    uint32_t materialsPerMesh{1};    // Each takes a contiguous range of triangles
+    uint32_t nbTextures{0};          // Mesh 'i' uses texture 'i % nbTextures'
+    uint32_t textureSize{256};       // Width and height of the textures
+    float    minScale{0.05f};        // Uniform scale of the instances
+    float    maxScale{0.2f};
+    bool     generateMeshes{true};  // False: `Scene::meshes` is empty, see generateMesh()
+
+    // Procedural primitives (spheres in AABB)
+    uint32_t nbSpheres{0};
+    float    minRadius{0.05f};
+    float    maxRadius{0.2f};
+
+    // Placement of the instances and spheres
+    Distribution  distribution{Distribution::eNormal};
+    nvmath::vec3f center{0.f, 0.f, 0.f};
+    nvmath::vec3f spread{1.f, 1.f, 1.f};
+    uint32_t      nbClusters{8};
+  };
+
+  struct Instance
+  {
+    uint32_t      meshIndex{0};
+    nvmath::mat4f transform{1};
+  };
+
+  struct Texture
+  {
+    std::string          name;  // Name referenced by the materials of the meshes
+    uint32_t             width{0};
+    uint32_t             height{0};
+    std::vector<uint8_t> rgba;
+  };
+
+  struct Sphere
+  {
+    nvmath::vec3f center;
+    float         radius;
+  };
+
+  struct Scene
+  {
+    std::vector<ObjLoader> meshes;  // Same content as loaded OBJ files, colors are sRGB
+    std::vector<Instance>  instances;
+    std::vector<Texture>   textures;
+    std::vector<Sphere>    spheres;
+  };
+
+  static Scene generate(const Settings& settings);
+
+  // Mesh 'meshIndex' of the scene, for loading the meshes on demand (streaming). The mesh
+  // fits in a sphere of radius 1 around the origin.
+  static ObjLoader generateMesh(const Settings& settings, uint32_t meshIndex);
+
+  // One mesh_N.obj/.mtl per mesh, instances.csv with the mesh index and the column-major
+  // matrix of each instance, texture_N.png
+  static bool writeObj(const Scene& scene, const std::string& directory);
+
+  // Single .gltf with its .bin and the textures next to it; one node per instance, one
+  // primitive per material of the mesh. Spheres are not exported.
+  static bool writeGltf(const Scene& scene, const std::string& filename);
+
+  // Uncompressed RGBA8 PNG
+  static bool writePng(const std::string& filename,
+                       uint32_t           width,
+                       uint32_t           height,
+                       const uint8_t*     rgba);
+};
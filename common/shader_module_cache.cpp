@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "shader_module_cache.h"
+
+#include "nvh/fileoperations.hpp"
+#include "nvh/nvprint.hpp"
+#include "shader_variants.h"
+
+void ShaderModuleCache::setup(const vk::Device& device, const std::vector<std::string>& searchPaths)
+{
+  m_device      = device;
+  m_searchPaths = searchPaths;
+}
+
+void ShaderModuleCache::destroy()
+{
+  for(auto& m : m_modules)
+    m_device.destroy(m.second.module);
+  m_modules.clear();
+  m_files.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+// 64-bit FNV-1a
+//
+uint64_t ShaderModuleCache::hashCode(const void* data, size_t size)
+{
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  uint64_t    hash  = 14695981039346656037ULL;
+  for(size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// The size is mixed in the key, to make collisions between modules even less likely
+static uint64_t moduleKey(const std::string& code)
+{
+  return ShaderModuleCache::hashCode(code.data(), code.size())
+         ^ (static_cast<uint64_t>(code.size()) << 32);
+}
+
+// Key of a file in m_files: the same name has a module per SPIR-V variant
+static std::string fileKey(const std::string& name, SpirvVariant variant)
+{
+  return std::string(getSpirvVariantName(variant)) + "/" + name;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns the key of the module of the code, creating it if no other file had the same content.
+// The code is compared, not only the hash: on a collision, the next key is probed.
+//
+uint64_t ShaderModuleCache::acquire(const std::string& code, bool& created)
+{
+  uint64_t key = moduleKey(code);
+  auto     it  = m_modules.find(key);
+  while(it != m_modules.end() && it->second.code != code)
+    it = m_modules.find(++key);
+
+  Module& m = m_modules[key];
+  created   = !m.module;
+  if(created)
+  {
+    m.code   = code;
+    m.module = m_device.createShaderModule(
+        {{}, code.size(), reinterpret_cast<const uint32_t*>(code.data())});
+    m_stats.modulesCreated++;
+  }
+  m.references++;
+  return key;
+}
+
+void ShaderModuleCache::release(uint64_t key)
+{
+  auto it = m_modules.find(key);
+  if(it == m_modules.end())
+    return;
+  if(--it->second.references == 0)
+  {
+    m_device.destroy(it->second.module);
+    m_modules.erase(it);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Only the first get() of a file, for each variant, touches the file system
+//
+vk::ShaderModule ShaderModuleCache::get(const std::string& name)
+{
+  std::string key  = fileKey(name, getSpirvVariant());
+  auto        file = m_files.find(key);
+  if(file != m_files.end())
+  {
+    m_stats.hits++;
+    return m_modules[file->second].module;
+  }
+
+  std::string filename = spvFile(name, m_searchPaths);
+  std::string code     = nvh::loadFile(filename, true, m_searchPaths, true);
+  if(code.empty())
+  {
+    LOGE("Shader module cache: cannot load %s\n", filename.c_str());
+    return {};
+  }
+  m_stats.fileLoads++;
+
+  bool created = false;
+  m_files[key] = acquire(code, created);
+  if(!created)
+    m_stats.sharedModules++;
+  return m_modules[m_files[key]].module;
+}
+
+void ShaderModuleCache::invalidate(const std::string& name)
+{
+  for(SpirvVariant variant : {SpirvVariant::eOriginal, SpirvVariant::eOptimized})
+  {
+    auto file = m_files.find(fileKey(name, variant));
+    if(file == m_files.end())
+      continue;
+    release(file->second);
+    m_files.erase(file);
+  }
+}
+
+void ShaderModuleCache::setCode(const std::string& name, const std::string& code)
+{
+  invalidate(name);
+  for(SpirvVariant variant : {SpirvVariant::eOriginal, SpirvVariant::eOptimized})
+  {
+    bool created                    = false;
+    m_files[fileKey(name, variant)] = acquire(code, created);
+  }
+}
+
+const std::string& ShaderModuleCache::getCode(const std::string& name)
+{
+  static const std::string none;
+  if(!get(name))
+    return none;
+  return m_modules[m_files[fileKey(name, getSpirvVariant())]].code;
+}
+
+void ShaderModuleCache::invalidateAll()
+{
+  for(auto& file : m_files)
+    release(file.second);
+  m_files.clear();
+}
+
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Cache of shader modules, keyed by the hash of their SPIR-V code
+// - Modules are created once and kept across pipeline rebuilds (resize, shader variant, reload):
+//   a pipeline created again with the same files does no file I/O and no vkCreateShaderModule
+// - Files with the same content share the same module
+// - The modules are owned by the cache: pipelines must not destroy them. Destroying a module
+//   does not affect the pipelines created with it, so invalidate() can release it right away.
+//
+// Usage:
+//   m_shaderCache.setup(m_device, defaultSearchPaths);
+//   stages.push_back({{}, vk::ShaderStageFlagBits::eRaygenKHR,
+//                     m_shaderCache.get("raytrace.rgen.spv"), "main"});
+//   ...
+//   m_shaderCache.destroy();
+//
+class ShaderModuleCache
+{
+public:
+  struct Stats
+  {
+    uint32_t fileLoads{0};        // Files read from disk
+    uint32_t modulesCreated{0};   // vkCreateShaderModule calls
+    uint32_t hits{0};             // get() answered without I/O nor module creation
+    uint32_t sharedModules{0};    // Files found with the content of another file
+  };
+
+  void setup(const vk::Device& device, const std::vector<std::string>& searchPaths);
+  void destroy();
+
+  // Module of the SPIR-V file `name`, in spv/ or spv/opt/ (see shader_variants.h).
+  // Returns a null handle if the file cannot be found.
+  vk::ShaderModule get(const std::string& name);
+
+  // The next get() of `name` reads the file again (hot reload). The module is destroyed when
+  // no other file uses it.
+  void invalidate(const std::string& name);
+  void invalidateAll();
+  // Replaces the code of `name`, for both variants, without reading the file: used by the hot
+  // reload, which compiles the shaders in memory (see shader_watcher.h)
+  void setCode(const std::string& name, const std::string& code);
+  // Code of the module of `name` for the current variant, empty if it cannot be loaded. Kept by
+  // the hot reload, to go back to it when the new code does not make a valid pipeline.
+  const std::string& getCode(const std::string& name);
+
+  const Stats&    getStats() const { return m_stats; }
+  static uint64_t hashCode(const void* data, size_t size);
+
+private:
+  struct Module
+  {
+    vk::ShaderModule module;
+    uint32_t         references{0};  // Number of files using it
+    std::string      code;  // Compared on a key match, the hash alone could collide
+  };
+
+  uint64_t acquire(const std::string& code, bool& created);
+  void     release(uint64_t key);
+
+  vk::Device                                m_device;
+  std::vector<std::string>                  m_searchPaths;
+  std::unordered_map<std::string, uint64_t> m_files;    // Variant and file name -> key
+  std::unordered_map<uint64_t, Module>      m_modules;  // Key (hash of the code) -> module
+  Stats                                     m_stats;
+};
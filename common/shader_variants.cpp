@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "shader_variants.h"
+
+#include "nvh/fileoperations.hpp"
+
+static SpirvVariant s_variant = SpirvVariant::eOptimized;
+
+void setSpirvVariant(SpirvVariant variant)
+{
+  s_variant = variant;
+}
+
+SpirvVariant getSpirvVariant()
+{
+  return s_variant;
+}
+
+const char* getSpirvVariantName(SpirvVariant variant)
+{
+  return variant == SpirvVariant::eOptimized ? "optimized" : "original";
+}
+
+std::string spvFile(const std::string& name, const std::vector<std::string>& searchPaths)
+{
+  if(s_variant == SpirvVariant::eOptimized)
+  {
+    std::string optimized = "spv/opt/" + name;
+    if(!nvh::findFile(optimized, searchPaths, false).empty())
+      return optimized;
+  }
+  return "spv/" + name;
+}
+
+std::string loadSpirvFile(const std::string& name, const std::vector<std::string>& searchPaths)
+{
+  return nvh::loadFile(spvFile(name, searchPaths), true, searchPaths, true);
+}
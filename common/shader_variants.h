@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Selection of the SPIR-V modules loaded by the samples
+// - eOriginal  : spv/<name>, as compiled by glslangValidator
+// - eOptimized : spv/opt/<name>, optimized by spirv-opt at build time (cmake/spirv_optimize.cmake)
+//
+// The optimized modules are used by default. When a module was not optimized, the original one
+// is loaded instead, so a sample always finds its shaders.
+//
+// Usage:
+//   vk::ShaderModule rgen = nvvk::createShaderModule(
+//       m_device, loadSpirvFile("raytrace.rgen.spv", defaultSearchPaths));
+//
+enum class SpirvVariant
+{
+  eOriginal,
+  eOptimized,
+};
+
+void         setSpirvVariant(SpirvVariant variant);
+SpirvVariant getSpirvVariant();
+const char*  getSpirvVariantName(SpirvVariant variant);
+
+// Relative path of the module `name` for the current variant, to be given to nvh::loadFile
+std::string spvFile(const std::string& name, const std::vector<std::string>& searchPaths);
+// Content of the module `name` for the current variant, empty if not found
+std::string loadSpirvFile(const std::string& name, const std::vector<std::string>& searchPaths);
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "shader_watcher.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "nvh/nvprint.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#define popen _popen
+#define pclose _pclose
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+// Same string for the same file, whether it comes from the directory or from an #include
+std::string normalPath(const fs::path& path)
+{
+  return path.lexically_normal().string();
+}
+
+// The .glsl and .h files included by `source`, recursively. The names are relative to the
+// including file.
+void collectIncludes(const fs::path& source, std::set<std::string>& includes)
+{
+  std::ifstream file(source);
+  std::string   line;
+  while(std::getline(file, line))
+  {
+    size_t directive = line.find_first_not_of(" \t");
+    if(directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+      continue;
+    size_t open  = line.find('"', directive);
+    size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+    if(close == std::string::npos)
+      continue;
+    fs::path include = source.parent_path() / line.substr(open + 1, close - open - 1);
+    if(ShaderWatcher::isInclude(include) && includes.insert(normalPath(include)).second)
+      collectIncludes(include, includes);
+  }
+}
+}  // namespace
+
+bool ShaderWatcher::isStage(const fs::path& path)
+{
+  static const char* stages[] = {".rgen", ".rchit", ".rmiss", ".rahit", ".rint", ".rcall"};
+  std::string        ext      = path.extension().string();
+  for(const char* stage : stages)
+  {
+    if(ext == stage)
+      return true;
+  }
+  return false;
+}
+
+bool ShaderWatcher::isInclude(const fs::path& path)
+{
+  std::string ext = path.extension().string();
+  return ext == ".glsl" || ext == ".h";
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns false if the directory or the compiler does not exist: there is nothing to watch
+//
+bool ShaderWatcher::start(const std::string& shaderDir,
+                          const std::string& compiler,
+                          const std::string& flags,
+                          uint32_t           pollInterval)
+{
+  std::error_code ec;
+  if(!fs::is_directory(shaderDir, ec) || compiler.empty() || !fs::exists(compiler, ec))
+  {
+    LOGW("Shader hot reload disabled: cannot find %s or %s\n", shaderDir.c_str(),
+         compiler.c_str());
+    return false;
+  }
+  stop();
+  m_shaderDir    = shaderDir;
+  m_compiler     = compiler;
+  m_flags        = flags;
+  m_pollInterval = pollInterval;
+  m_tempDir = fs::temp_directory_path(ec) / ("vk_shader_reload_" + std::to_string(getpid()));
+  fs::create_directories(m_tempDir, ec);
+  m_stop   = false;
+  m_thread = std::thread(&ShaderWatcher::worker, this);
+  LOGI("Watching the shaders of %s\n", shaderDir.c_str());
+  return true;
+}
+
+void ShaderWatcher::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wakeUp.notify_all();
+  if(m_thread.joinable())
+    m_thread.join();
+
+  std::error_code ec;
+  if(!m_tempDir.empty())
+    fs::remove_all(m_tempDir, ec);
+  m_tempDir.clear();
+}
+
+std::vector<ShaderWatcher::Compiled> ShaderWatcher::takeCompiled()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<Compiled>       result;
+  result.swap(m_compiled);
+  return result;
+}
+
+std::string ShaderWatcher::getLastError()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_lastError;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Modification times of the stages of the directory, and of the files they include
+//
+ShaderWatcher::FileTimes ShaderWatcher::scan(const Dependencies& dependencies) const
+{
+  FileTimes       times;
+  std::error_code ec;
+  for(const auto& entry : fs::directory_iterator(m_shaderDir, ec))
+  {
+    if(entry.is_regular_file(ec) && isStage(entry.path()))
+      times[normalPath(entry.path())] = entry.last_write_time(ec);
+  }
+  for(const auto& stage : dependencies)
+  {
+    for(const auto& include : stage.second)
+    {
+      auto time = fs::last_write_time(include, ec);
+      if(!ec)
+        times[include] = time;
+    }
+  }
+  return times;
+}
+
+//--------------------------------------------------------------------------------------------------
+// glslangValidator writes the module in a temporary file, which is read back in memory
+//
+bool ShaderWatcher::compile(const fs::path& source, Compiled& compiled, std::string& log)
+{
+  auto        start   = std::chrono::steady_clock::now();
+  fs::path    output  = m_tempDir / (source.filename().string() + ".spv");
+  std::string command = "\"" + m_compiler + "\" " + m_flags + " -o \"" + output.string()
+                        + "\" \"" + source.string() + "\" 2>&1";
+#ifdef _WIN32
+  command = "\"" + command + "\"";  // cmd.exe removes the outer quotes
+#endif
+
+  FILE* pipe = popen(command.c_str(), "r");
+  if(pipe == nullptr)
+  {
+    log = "cannot run " + m_compiler;
+    return false;
+  }
+  char buffer[512];
+  log.clear();
+  while(fgets(buffer, sizeof(buffer), pipe) != nullptr)
+    log += buffer;
+  int status = pclose(pipe);
+  if(status != 0)
+    return false;
+
+  std::ifstream     file(output, std::ios::binary);
+  std::stringstream code;
+  code << file.rdbuf();
+  compiled.name      = output.filename().string();
+  compiled.code      = code.str();
+  compiled.compileMs =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return !compiled.code.empty();
+}
+
+//--------------------------------------------------------------------------------------------------
+// A file is compiled once its modification time did not change for one poll interval, so a
+// file being saved is not compiled half written.
+//
+void ShaderWatcher::worker()
+{
+  Dependencies    dependencies;
+  std::error_code ec;
+  for(const auto& entry : fs::directory_iterator(m_shaderDir, ec))
+  {
+    if(entry.is_regular_file(ec) && isStage(entry.path()))
+      collectIncludes(entry.path(), dependencies[normalPath(entry.path())]);
+  }
+
+  FileTimes             known = scan(dependencies);
+  FileTimes             pending;  // Modified files, waiting to be stable
+  std::set<std::string> failed;   // Stages of the last change, which was not applied
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wakeUp.wait_for(lock, std::chrono::milliseconds(m_pollInterval), [&] { return m_stop; });
+      if(m_stop)
+        return;
+    }
+
+    FileTimes current = scan(dependencies);
+    FileTimes stable;
+    for(const auto& file : current)
+    {
+      auto it = known.find(file.first);
+      if(it != known.end() && it->second == file.second)
+        continue;
+      auto waiting = pending.find(file.first);
+      if(waiting != pending.end() && waiting->second == file.second)
+        stable.insert(file);
+      else
+        pending[file.first] = file.second;
+    }
+    if(stable.empty())
+      continue;
+
+    // Stages to compile: the modified ones and the ones including a modified file, with the
+    // stages of a change which failed
+    std::set<std::string> sources;
+    sources.swap(failed);
+    for(const auto& file : stable)
+    {
+      known[file.first] = file.second;
+      pending.erase(file.first);
+      if(isStage(file.first))
+        sources.insert(file.first);
+      for(const auto& stage : dependencies)
+      {
+        if(stage.second.count(file.first) != 0)
+          sources.insert(stage.first);
+      }
+    }
+
+    // The includes may have changed with the files
+    for(const auto& source : sources)
+    {
+      std::set<std::string>& includes = dependencies[source];
+      includes.clear();
+      collectIncludes(source, includes);
+    }
+
+    std::vector<Compiled> batch;
+    std::string           errors;
+    for(const auto& source : sources)
+    {
+      Compiled    compiled;
+      std::string log;
+      if(!compile(source, compiled, log))
+      {
+        LOGE("Hot reload: %s failed to compile\n%s\n", fs::path(source).filename().string().c_str(),
+             log.c_str());
+        errors += log;
+        continue;
+      }
+      batch.push_back(std::move(compiled));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastError = errors;
+    if(errors.empty())
+      m_compiled.insert(m_compiled.end(), std::make_move_iterator(batch.begin()),
+                        std::make_move_iterator(batch.end()));
+    else
+      failed = sources;
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// Hot reload of the ray tracing shaders
+//
+// - A worker thread polls the modification time of the ray tracing stages of the shader
+//   directory (.rgen, .rchit, .rmiss, .rahit, .rint, .rcall) and of the .glsl and .h files they
+//   include. Other files (rasterization stages, editor swap files, ...) are ignored.
+// - A modified stage is recompiled with glslangValidator, and a modified include recompiles the
+//   stages including it
+// - The SPIR-V code is kept in memory, in a directory of the process: the modules of the build
+//   (spv/) are not overwritten. The render thread collects it with `takeCompiled()` between two
+//   frames, and rebuilds the pipelines using it.
+// - The stages of a change are returned all together or not at all: if one fails to compile,
+//   the error is reported, nothing is returned and the current pipeline is kept. The stages are
+//   compiled again with the next change.
+//
+// Usage:
+//   watcher.start(shaderDir, GLSLANG_VALIDATOR);
+//   ... each frame, before recording
+//   auto compiled = watcher.takeCompiled();
+//   if(!compiled.empty())
+//     rebuild the pipelines, with compiled[i].code for compiled[i].name ("raytrace.rchit.spv")
+//
+class ShaderWatcher
+{
+public:
+  struct Compiled
+  {
+    std::string name;  // Name of the module, as in spv/: raytrace.rchit.spv
+    std::string code;  // SPIR-V
+    double      compileMs{0};
+  };
+
+  ~ShaderWatcher() { stop(); }
+
+  bool start(const std::string& shaderDir,
+             const std::string& compiler,
+             const std::string& flags        = "--target-env vulkan1.2",
+             uint32_t           pollInterval = 200);  // Milliseconds
+  void stop();
+  bool isRunning() const { return m_thread.joinable(); }
+
+  // Modules compiled since the last call
+  std::vector<Compiled> takeCompiled();
+  // Output of the last failed compilation, empty if the last one succeeded
+  std::string getLastError();
+
+  static bool isStage(const std::filesystem::path& path);
+  static bool isInclude(const std::filesystem::path& path);
+
+private:
+  using FileTimes    = std::unordered_map<std::string, std::filesystem::file_time_type>;
+  using Dependencies = std::unordered_map<std::string, std::set<std::string>>;  // Stage -> includes
+
+  void      worker();
+  FileTimes scan(const Dependencies& dependencies) const;
+  bool      compile(const std::filesystem::path& source, Compiled& compiled, std::string& log);
+
+  std::filesystem::path   m_shaderDir;
+  std::filesystem::path   m_tempDir;  // Per process: several samples may run at the same time
+  std::string             m_compiler;
+  std::string             m_flags;
+  uint32_t                m_pollInterval{200};
+  std::mutex              m_mutex;  // Protects the compiled modules, the error and m_stop
+  std::condition_variable m_wakeUp;
+  std::vector<Compiled>   m_compiled;
+  std::string             m_lastError;
+  std::thread             m_thread;
+  bool                    m_stop{false};
+};
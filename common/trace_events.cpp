@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "trace_events.h"
+
+#include <cstdio>
+
+namespace {
+// Escaping the characters which are not allowed in a JSON string
+std::string jsonEscape(const std::string& str)
+{
+  std::string out;
+  out.reserve(str.size());
+  for(char c : str)
+  {
+    switch(c)
+    {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        if(static_cast<unsigned char>(c) >= 0x20)
+          out += c;
+    }
+  }
+  return out;
+}
+}  // namespace
+
+
+TraceRecorder& TraceRecorder::get()
+{
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : m_origin(std::chrono::steady_clock::now())
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+// Each thread gets its buffer on its first event. The buffers are owned by the recorder, so
+// events of threads which have terminated are still written in the dump.
+//
+TraceRecorder::ThreadBuffer& TraceRecorder::threadBuffer()
+{
+  thread_local ThreadBuffer* buffer = nullptr;
+  if(buffer == nullptr)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threads.emplace_back(std::make_unique<ThreadBuffer>());
+    buffer       = m_threads.back().get();
+    buffer->tid  = static_cast<uint32_t>(m_threads.size());
+    buffer->name = buffer->tid == 1 ? "Main" : "Worker " + std::to_string(buffer->tid - 1);
+    buffer->events.reserve(1024);
+  }
+  return *buffer;
+}
+
+void TraceRecorder::setThreadName(const std::string& name)
+{
+  ThreadBuffer&               buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.name = name;
+}
+
+void TraceRecorder::addEvent(const char* name,
+                             std::string detail,
+                             int64_t     startNs,
+                             int64_t     durationNs)
+{
+  ThreadBuffer&               buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events.push_back({name, std::move(detail), startNs, durationNs});
+}
+
+void TraceRecorder::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for(auto& thread : m_threads)
+  {
+    std::lock_guard<std::mutex> threadLock(thread->mutex);
+    thread->events.clear();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Writing all events as 'complete' events ("ph":"X"). Timestamps of the format are in
+// microseconds, the fractional part keeps the nanosecond resolution.
+//
+bool TraceRecorder::dump(const std::string& filename)
+{
+  FILE* file = fopen(filename.c_str(), "w");
+  if(file == nullptr)
+    return false;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  bool first = true;
+  for(const auto& thread : m_threads)
+  {
+    std::lock_guard<std::mutex> threadLock(thread->mutex);
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,", first ? "" : ",\n",
+            thread->tid);
+    fprintf(file, "\"args\":{\"name\":\"%s\"}}", jsonEscape(thread->name).c_str());
+    first = false;
+
+    for(const auto& e : thread->events)
+    {
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,", jsonEscape(e.name).c_str(),
+              thread->tid);
+      fprintf(file, "\"ts\":%.3f,\"dur\":%.3f", e.startNs / 1000.0, e.durationNs / 1000.0);
+      if(!e.detail.empty())
+        fprintf(file, ",\"args\":{\"detail\":\"%s\"}", jsonEscape(e.detail).c_str());
+      fprintf(file, "}");
+    }
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2014-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// CPU trace of the loading and setup phases, written in the Chrome trace format
+// (chrome://tracing, https://ui.perfetto.dev)
+//
+// - Each thread records its events in its own buffer, under its own lock: only contended
+//   while `dump()` or `clear()` reads that buffer
+// - Timestamps are in nanoseconds, relative to the creation of the recorder
+//
+// Usage:
+//   {
+//     TRACE_SCOPE("createBottomLevelAS");
+//     ... stuff ...
+//   }
+//   TraceScope upload("Upload");
+//   ... stuff ...
+//   upload.end();
+//   TraceRecorder::get().dump("load_trace.json");
+//
+class TraceRecorder
+{
+public:
+  struct Event
+  {
+    const char* name{nullptr};  // Must be a string literal
+    std::string detail;         // Optional, shown in the 'args' of the event
+    int64_t     startNs{0};
+    int64_t     durationNs{0};
+  };
+
+  static TraceRecorder& get();
+
+  int64_t now() const
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                                - m_origin)
+        .count();
+  }
+
+  void setEnabled(bool enabled) { m_enabled = enabled; }
+  bool isEnabled() const { return m_enabled; }
+  void setThreadName(const std::string& name);
+
+  void addEvent(const char* name, std::string detail, int64_t startNs, int64_t durationNs);
+  bool dump(const std::string& filename);
+  void clear();
+
+private:
+  struct ThreadBuffer
+  {
+    std::mutex         mutex;  // Protects name and events
+    uint32_t           tid{0};
+    std::string        name;
+    std::vector<Event> events;
+  };
+
+  TraceRecorder();
+  ThreadBuffer& threadBuffer();
+
+  std::chrono::steady_clock::time_point      m_origin;
+  std::atomic<bool>                          m_enabled{true};  // Toggled from the UI
+  std::mutex                                 m_mutex;          // Protects m_threads
+  std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+};
+
+// Records the duration of the enclosing scope
+class TraceScope
+{
+public:
+  explicit TraceScope(const char* name, std::string detail = {})
+      : m_name(name)
+      , m_detail(std::move(detail))
+      , m_start(TraceRecorder::get().now())
+  {
+  }
+  ~TraceScope() { end(); }
+
+  // Ends the event before the end of the scope
+  void end()
+  {
+    TraceRecorder& recorder = TraceRecorder::get();
+    if(m_name != nullptr && recorder.isEnabled())
+      recorder.addEvent(m_name, std::move(m_detail), m_start, recorder.now() - m_start);
+    m_name = nullptr;
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+  const char* m_name;
+  std::string m_detail;
+  int64_t     m_start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(__VA_ARGS__)
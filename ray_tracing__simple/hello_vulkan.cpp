@@ -18,6 +18,8 @@
  */
 
 
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 #include <vulkan/vulkan.hpp>
 
@@ -31,12 +33,15 @@ extern std::vector<std::string> defaultSearchPaths;
 #include "nvh/alignment.hpp"
 #include "nvh/cameramanipulator.hpp"
 #include "nvh/fileoperations.hpp"
+#include "nvh/nvprint.hpp"
 #include "nvvk/commands_vk.hpp"
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/images_vk.hpp"
 #include "nvvk/pipeline_vk.hpp"
 #include "nvvk/renderpasses_vk.hpp"
 #include "nvvk/shaders_vk.hpp"
+#include "shader_variants.h"
+#include "trace_events.h"
 
 
 // Holding the camera matrices
@@ -62,6 +67,7 @@ void HelloVulkan::setup(const vk::Instance&       instance,
   AppBase::setup(instance, device, physicalDevice, queueFamily);
   m_alloc.init(device, physicalDevice);
   m_debug.setup(m_device);
+  m_memStats.setup(device, physicalDevice);
   m_offscreenDepthFormat = nvvk::findDepthFormat(physicalDevice);
 }
 
@@ -196,6 +202,8 @@ void HelloVulkan::updateDescriptorSet()
 //
 void HelloVulkan::createGraphicsPipeline()
 {
+  TRACE_SCOPE("createGraphicsPipeline");
+
   using vkSS = vk::ShaderStageFlagBits;
 
   vk::PushConstantRange pushConstantRanges = {vkSS::eVertex | vkSS::eFragment, 0,
@@ -214,8 +222,8 @@ void HelloVulkan::createGraphicsPipeline()
   std::vector<std::string>                paths = defaultSearchPaths;
   nvvk::GraphicsPipelineGeneratorCombined gpb(m_device, m_pipelineLayout, m_offscreenRenderPass);
   gpb.depthStencilState.depthTestEnable = true;
-  gpb.addShader(nvh::loadFile("spv/vert_shader.vert.spv", true, paths, true), vkSS::eVertex);
-  gpb.addShader(nvh::loadFile("spv/frag_shader.frag.spv", true, paths, true), vkSS::eFragment);
+  gpb.addShader(loadSpirvFile("vert_shader.vert.spv", paths), vkSS::eVertex);
+  gpb.addShader(loadSpirvFile("frag_shader.frag.spv", paths), vkSS::eFragment);
   gpb.addBindingDescription({0, sizeof(VertexObj)});
   gpb.addAttributeDescriptions({
       {0, 0, vk::Format::eR32G32B32Sfloat, static_cast<uint32_t>(offsetof(VertexObj, pos))},
@@ -233,6 +241,8 @@ void HelloVulkan::createGraphicsPipeline()
 //
 void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform)
 {
+  TRACE_SCOPE("loadModel", filename);
+
   using vkBU = vk::BufferUsageFlagBits;
 
   LOGI("Loading File:  %s \n", filename.c_str());
@@ -260,6 +270,7 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
   // Create the buffers on Device and copy vertices, indices and materials
   nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
   vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
+  TraceScope staging("Staging copies");
   model.vertexBuffer =
       m_alloc.createBuffer(cmdBuf, loader.m_vertices,
                            vkBU::eVertexBuffer | vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
@@ -270,9 +281,20 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
                                | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
   model.matColorBuffer = m_alloc.createBuffer(cmdBuf, loader.m_materials, vkBU::eStorageBuffer);
   model.matIndexBuffer = m_alloc.createBuffer(cmdBuf, loader.m_matIndx, vkBU::eStorageBuffer);
+  staging.end();
+
+  int modelId = static_cast<int>(instance.objIndex);
+  m_memStats.trackBuffer(model.vertexBuffer.buffer, MemCategory::eGeometry, modelId);
+  m_memStats.trackBuffer(model.indexBuffer.buffer, MemCategory::eGeometry, modelId);
+  m_memStats.trackBuffer(model.matColorBuffer.buffer, MemCategory::eMaterial, modelId);
+  m_memStats.trackBuffer(model.matIndexBuffer.buffer, MemCategory::eMaterial, modelId);
+
   // Creates all textures found
   createTextureImages(cmdBuf, loader.m_textures);
-  cmdBufGet.submitAndWait(cmdBuf);
+  {
+    TRACE_SCOPE("Submit and wait");
+    cmdBufGet.submitAndWait(cmdBuf);
+  }
   m_alloc.finalizeAndReleaseStaging();
 
   std::string objNb = std::to_string(instance.objIndex);
@@ -297,6 +319,7 @@ void HelloVulkan::createUniformBuffer()
   m_cameraMat = m_alloc.createBuffer(sizeof(CameraMatrices),
                                      vkBU::eUniformBuffer | vkBU::eTransferDst, vkMP::eDeviceLocal);
   m_debug.setObjectName(m_cameraMat.buffer, "cameraMat");
+  m_memStats.trackBuffer(m_cameraMat.buffer, MemCategory::eOther);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -307,6 +330,8 @@ void HelloVulkan::createUniformBuffer()
 //
 void HelloVulkan::createSceneDescriptionBuffer()
 {
+  TRACE_SCOPE("createSceneDescriptionBuffer");
+
   using vkBU = vk::BufferUsageFlagBits;
   nvvk::CommandPool cmdGen(m_device, m_graphicsQueueIndex);
 
@@ -315,6 +340,7 @@ void HelloVulkan::createSceneDescriptionBuffer()
   cmdGen.submitAndWait(cmdBuf);
   m_alloc.finalizeAndReleaseStaging();
   m_debug.setObjectName(m_sceneDesc.buffer, "sceneDesc");
+  m_memStats.trackBuffer(m_sceneDesc.buffer, MemCategory::eOther);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -348,6 +374,7 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer&        cmdBuf,
     // The image format must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     nvvk::cmdBarrierImageLayout(cmdBuf, texture.image, vk::ImageLayout::eUndefined,
                                 vk::ImageLayout::eShaderReadOnlyOptimal);
+    m_memStats.trackImage(texture.image, MemCategory::eTexture);
     m_textures.push_back(texture);
   }
   else
@@ -360,8 +387,10 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer&        cmdBuf,
       o << "media/textures/" << texture;
       std::string txtFile = nvh::findFile(o.str(), defaultSearchPaths, true);
 
-      stbi_uc* stbi_pixels =
+      TraceScope decode("Texture decode", txtFile);
+      stbi_uc*   stbi_pixels =
           stbi_load(txtFile.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+      decode.end();
 
       std::array<stbi_uc, 4> color{255u, 0u, 255u, 255u};
 
@@ -385,6 +414,7 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer&        cmdBuf,
             nvvk::makeImageViewCreateInfo(image.image, imageCreateInfo);
         nvvk::Texture texture = m_alloc.createTexture(image, ivInfo, samplerCreateInfo);
 
+        m_memStats.trackImage(texture.image, MemCategory::eTexture);
         m_textures.push_back(texture);
       }
 
@@ -402,19 +432,26 @@ void HelloVulkan::destroyResources()
   m_device.destroy(m_pipelineLayout);
   m_device.destroy(m_descPool);
   m_device.destroy(m_descSetLayout);
+  m_memStats.untrackBuffer(m_cameraMat.buffer);
   m_alloc.destroy(m_cameraMat);
+  m_memStats.untrackBuffer(m_sceneDesc.buffer);
   m_alloc.destroy(m_sceneDesc);
 
   for(auto& m : m_objModel)
   {
+    m_memStats.untrackBuffer(m.vertexBuffer.buffer);
     m_alloc.destroy(m.vertexBuffer);
+    m_memStats.untrackBuffer(m.indexBuffer.buffer);
     m_alloc.destroy(m.indexBuffer);
+    m_memStats.untrackBuffer(m.matColorBuffer.buffer);
     m_alloc.destroy(m.matColorBuffer);
+    m_memStats.untrackBuffer(m.matIndexBuffer.buffer);
     m_alloc.destroy(m.matIndexBuffer);
   }
 
   for(auto& t : m_textures)
   {
+    m_memStats.untrackImage(t.image);
     m_alloc.destroy(t);
   }
 
@@ -423,19 +460,26 @@ void HelloVulkan::destroyResources()
   m_device.destroy(m_postPipelineLayout);
   m_device.destroy(m_postDescPool);
   m_device.destroy(m_postDescSetLayout);
+  m_memStats.untrackImage(m_offscreenColor.image);
   m_alloc.destroy(m_offscreenColor);
+  m_memStats.untrackImage(m_offscreenDepth.image);
   m_alloc.destroy(m_offscreenDepth);
   m_device.destroy(m_offscreenRenderPass);
   m_device.destroy(m_offscreenFramebuffer);
 
   // #VKRay
+  m_memStats.untrackAccelerationStructures();
   m_rtBuilder.destroy();
   m_device.destroy(m_rtDescPool);
   m_device.destroy(m_rtDescSetLayout);
   m_device.destroy(m_rtPipeline);
   m_device.destroy(m_rtPipelineLayout);
+  m_memStats.untrackBuffer(m_rtSBTBuffer.buffer);
   m_alloc.destroy(m_rtSBTBuffer);
 
+  m_profiler.destroy();
+  m_shaderWatcher.stop();
+  m_shaderCache.destroy();
   m_alloc.deinit();
 }
 
@@ -449,6 +493,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
   vk::DeviceSize offset{0};
 
   m_debug.beginLabel(cmdBuf, "Rasterize");
+  m_profiler.beginSection(cmdBuf, "Rasterize");
 
   // Dynamic Viewport
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
@@ -469,6 +514,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
     cmdBuf.bindIndexBuffer(model.indexBuffer.buffer, 0, vk::IndexType::eUint32);
     cmdBuf.drawIndexed(model.nbIndices, 1, 0, 0, 0);
   }
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -477,6 +523,11 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
 //
 void HelloVulkan::onResize(int /*w*/, int /*h*/)
 {
+  // While the window fits in the offscreen images, only a sub-rectangle of them is used
+  m_resizeStats.events++;
+  if(m_size.width <= m_offscreenCapacity.width && m_size.height <= m_offscreenCapacity.height)
+    return;
+
   createOffscreenRender();
   updatePostDescriptorSet();
   updateRtDescriptorSet();
@@ -491,12 +542,30 @@ void HelloVulkan::onResize(int /*w*/, int /*h*/)
 //
 void HelloVulkan::createOffscreenRender()
 {
+  TRACE_SCOPE("createOffscreenRender");
+
+  // The images are allocated with some headroom, so growing the window by a few pixels at a
+  // time (dragging its border) does not reallocate them at each event
+  if(m_offscreenColor.image)
+  {
+    m_offscreenCapacity.width = std::max(m_offscreenCapacity.width,
+                                         static_cast<uint32_t>(m_size.width * m_offscreenHeadroom));
+    m_offscreenCapacity.height = std::max(
+        m_offscreenCapacity.height, static_cast<uint32_t>(m_size.height * m_offscreenHeadroom));
+  }
+  m_offscreenCapacity.width  = std::max(m_offscreenCapacity.width, m_size.width);
+  m_offscreenCapacity.height = std::max(m_offscreenCapacity.height, m_size.height);
+  m_resizeStats.reallocations++;
+  LOGI("Offscreen images: %u x %u\n", m_offscreenCapacity.width, m_offscreenCapacity.height);
+
+  m_memStats.untrackImage(m_offscreenColor.image);
+  m_memStats.untrackImage(m_offscreenDepth.image);
   m_alloc.destroy(m_offscreenColor);
   m_alloc.destroy(m_offscreenDepth);
 
   // Creating the color image
   {
-    auto colorCreateInfo = nvvk::makeImage2DCreateInfo(m_size, m_offscreenColorFormat,
+    auto colorCreateInfo = nvvk::makeImage2DCreateInfo(m_offscreenCapacity, m_offscreenColorFormat,
                                                        vk::ImageUsageFlagBits::eColorAttachment
                                                            | vk::ImageUsageFlagBits::eSampled
                                                            | vk::ImageUsageFlagBits::eStorage);
@@ -510,7 +579,7 @@ void HelloVulkan::createOffscreenRender()
 
   // Creating the depth buffer
   auto depthCreateInfo =
-      nvvk::makeImage2DCreateInfo(m_size, m_offscreenDepthFormat,
+      nvvk::makeImage2DCreateInfo(m_offscreenCapacity, m_offscreenDepthFormat,
                                   vk::ImageUsageFlagBits::eDepthStencilAttachment);
   {
     nvvk::Image image = m_alloc.createImage(depthCreateInfo);
@@ -523,6 +592,8 @@ void HelloVulkan::createOffscreenRender()
 
     m_offscreenDepth = m_alloc.createTexture(image, depthStencilView);
   }
+  m_memStats.trackImage(m_offscreenColor.image, MemCategory::eRenderTarget);
+  m_memStats.trackImage(m_offscreenDepth.image, MemCategory::eRenderTarget);
 
   // Setting the image layout for both color and depth
   {
@@ -554,8 +625,8 @@ void HelloVulkan::createOffscreenRender()
   info.setRenderPass(m_offscreenRenderPass);
   info.setAttachmentCount(2);
   info.setPAttachments(attachments.data());
-  info.setWidth(m_size.width);
-  info.setHeight(m_size.height);
+  info.setWidth(m_offscreenCapacity.width);
+  info.setHeight(m_offscreenCapacity.height);
   info.setLayers(1);
   m_offscreenFramebuffer = m_device.createFramebuffer(info);
 }
@@ -565,8 +636,11 @@ void HelloVulkan::createOffscreenRender()
 //
 void HelloVulkan::createPostPipeline()
 {
+  TRACE_SCOPE("createPostPipeline");
+
   // Push constants in the fragment shader
-  vk::PushConstantRange pushConstantRanges = {vk::ShaderStageFlagBits::eFragment, 0, sizeof(float)};
+  vk::PushConstantRange pushConstantRanges = {vk::ShaderStageFlagBits::eFragment, 0,
+                                              sizeof(PostPushConstant)};
 
   // Creating the pipeline layout
   vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo;
@@ -579,10 +653,9 @@ void HelloVulkan::createPostPipeline()
   // Pipeline: completely generic, no vertices
   nvvk::GraphicsPipelineGeneratorCombined pipelineGenerator(m_device, m_postPipelineLayout,
                                                             m_renderPass);
-  pipelineGenerator.addShader(nvh::loadFile("spv/passthrough.vert.spv", true, defaultSearchPaths,
-                                            true),
+  pipelineGenerator.addShader(loadSpirvFile("passthrough.vert.spv", defaultSearchPaths),
                               vk::ShaderStageFlagBits::eVertex);
-  pipelineGenerator.addShader(nvh::loadFile("spv/post.frag.spv", true, defaultSearchPaths, true),
+  pipelineGenerator.addShader(loadSpirvFile("post.frag.spv", defaultSearchPaths),
                               vk::ShaderStageFlagBits::eFragment);
   pipelineGenerator.rasterizationState.setCullMode(vk::CullModeFlagBits::eNone);
   m_postPipeline = pipelineGenerator.createPipeline();
@@ -621,18 +694,24 @@ void HelloVulkan::updatePostDescriptorSet()
 void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
 {
   m_debug.beginLabel(cmdBuf, "Post");
+  m_profiler.beginSection(cmdBuf, "Post");
 
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
   cmdBuf.setScissor(0, {{{0, 0}, {m_size.width, m_size.height}}});
 
-  auto aspectRatio = static_cast<float>(m_size.width) / static_cast<float>(m_size.height);
-  cmdBuf.pushConstants<float>(m_postPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0,
-                              aspectRatio);
+  m_postPushConstant.aspectRatio =
+      static_cast<float>(m_size.width) / static_cast<float>(m_size.height);
+  m_postPushConstant.uvScale =
+      nvmath::vec2f(static_cast<float>(m_size.width) / m_offscreenCapacity.width,
+                    static_cast<float>(m_size.height) / m_offscreenCapacity.height);
+  cmdBuf.pushConstants<PostPushConstant>(m_postPipelineLayout, vk::ShaderStageFlagBits::eFragment,
+                                         0, m_postPushConstant);
   cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_postPipeline);
   cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_postPipelineLayout, 0,
                             m_postDescSet, {});
   cmdBuf.draw(3, 1, 0, 0);
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -702,6 +781,8 @@ auto HelloVulkan::objectToVkGeometryKHR(const ObjModel& model)
 //
 void HelloVulkan::createBottomLevelAS()
 {
+  TRACE_SCOPE("createBottomLevelAS");
+
   // BLAS - Storing each primitive in a geometry
   std::vector<nvvk::RaytracingBuilderKHR::BlasInput> allBlas;
   allBlas.reserve(m_objModel.size());
@@ -712,11 +793,14 @@ void HelloVulkan::createBottomLevelAS()
     // We could add more geometry in each BLAS, but we add only one for now
     allBlas.emplace_back(blas);
   }
+  m_memStats.trackBlas(allBlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
   m_rtBuilder.buildBlas(allBlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
 }
 
 void HelloVulkan::createTopLevelAS()
 {
+  TRACE_SCOPE("createTopLevelAS");
+
   std::vector<nvvk::RaytracingBuilderKHR::Instance> tlas;
   tlas.reserve(m_objInstance.size());
   for(uint32_t i = 0; i < static_cast<uint32_t>(m_objInstance.size()); i++)
@@ -729,6 +813,8 @@ void HelloVulkan::createTopLevelAS()
     rayInst.flags            = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
     tlas.emplace_back(rayInst);
   }
+  m_memStats.trackTlas(static_cast<uint32_t>(tlas.size()),
+                       vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
   m_rtBuilder.buildTlas(tlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
 }
 
@@ -785,15 +871,14 @@ void HelloVulkan::updateRtDescriptorSet()
 //
 void HelloVulkan::createRtPipeline()
 {
-  vk::ShaderModule raygenSM = nvvk::createShaderModule(
-      m_device, nvh::loadFile("spv/raytrace.rgen.spv", true, defaultSearchPaths, true));
-  vk::ShaderModule missSM = nvvk::createShaderModule(
-      m_device, nvh::loadFile("spv/raytrace.rmiss.spv", true, defaultSearchPaths, true));
+  TRACE_SCOPE("createRtPipeline");
+
+  vk::ShaderModule raygenSM = m_shaderCache.get("raytrace.rgen.spv");
+  vk::ShaderModule missSM   = m_shaderCache.get("raytrace.rmiss.spv");
 
   // The second miss shader is invoked when a shadow ray misses the geometry. It
   // simply indicates that no occlusion has been found
-  vk::ShaderModule shadowmissSM = nvvk::createShaderModule(
-      m_device, nvh::loadFile("spv/raytraceShadow.rmiss.spv", true, defaultSearchPaths, true));
+  vk::ShaderModule shadowmissSM = m_shaderCache.get("raytraceShadow.rmiss.spv");
 
 
   std::vector<vk::PipelineShaderStageCreateInfo> stages;
@@ -818,8 +903,7 @@ void HelloVulkan::createRtPipeline()
   m_rtShaderGroups.push_back(mg);
 
   // Hit Group - Closest Hit + AnyHit
-  vk::ShaderModule chitSM = nvvk::createShaderModule(
-      m_device, nvh::loadFile("spv/raytrace.rchit.spv", true, defaultSearchPaths, true));
+  vk::ShaderModule chitSM = m_shaderCache.get("raytrace.rchit.spv");
 
   vk::RayTracingShaderGroupCreateInfoKHR hg{vk::RayTracingShaderGroupTypeKHR::eTrianglesHitGroup,
                                             VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR,
@@ -869,10 +953,7 @@ void HelloVulkan::createRtPipeline()
         "Device fails to support ray recursion (m_rtProperties.maxRayRecursionDepth <= 1)");
   }
 
-  m_device.destroy(raygenSM);
-  m_device.destroy(missSM);
-  m_device.destroy(shadowmissSM);
-  m_device.destroy(chitSM);
+  // The modules are kept by m_shaderCache for the next rebuild of the pipeline
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -883,40 +964,177 @@ void HelloVulkan::createRtPipeline()
 //
 void HelloVulkan::createRtShaderBindingTable()
 {
+  TRACE_SCOPE("createRtShaderBindingTable");
+
   auto groupCount =
       static_cast<uint32_t>(m_rtShaderGroups.size());  // 4 shaders: raygen, 2 miss, chit
   uint32_t groupHandleSize = m_rtProperties.shaderGroupHandleSize;  // Size of a program identifier
-  // Compute the actual size needed per SBT entry (round-up to alignment needed).
-  uint32_t groupSizeAligned =
-      nvh::align_up(groupHandleSize, m_rtProperties.shaderGroupBaseAlignment);
-  // Bytes needed for the SBT.
-  uint32_t sbtSize = groupCount * groupSizeAligned;
 
   // Fetch all the shader handles used in the pipeline. This is opaque data,
   // so we store it in a vector of bytes.
-  std::vector<uint8_t> shaderHandleStorage(sbtSize);
-  auto result = m_device.getRayTracingShaderGroupHandlesKHR(m_rtPipeline, 0, groupCount, sbtSize,
-                                                            shaderHandleStorage.data());
+  std::vector<uint8_t> shaderHandleStorage(groupCount * groupHandleSize);
+  auto result = m_device.getRayTracingShaderGroupHandlesKHR(
+      m_rtPipeline, 0, groupCount, shaderHandleStorage.size(), shaderHandleStorage.data());
   assert(result == vk::Result::eSuccess);
 
-  // Allocate a buffer for storing the SBT. Give it a debug name for NSight.
-  m_rtSBTBuffer = m_alloc.createBuffer(
-      sbtSize,
-      vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eShaderDeviceAddress
-          | vk::BufferUsageFlagBits::eShaderBindingTableKHR,
-      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+  // One record per group, in the order of the pipeline. The layout computes the aligned strides
+  // and offsets of the regions, and checks them against the device limits.
+  m_sbtLayout.setup(m_rtProperties);
+  m_sbtLayout.addRecord(SbtLayout::eRaygen, 0);
+  m_sbtLayout.addRecord(SbtLayout::eMiss, 1);
+  m_sbtLayout.addRecord(SbtLayout::eMiss, 2);
+  m_sbtLayout.addRecord(SbtLayout::eHit, 3);
+  std::string error;
+  if(!m_sbtLayout.finalize(&error))
+  {
+    LOGE("SBT: %s\n", error.c_str());
+    exit(1);
+  }
+  std::vector<uint8_t> sbtData(m_sbtLayout.getSize());
+  m_sbtLayout.write(sbtData.data(), shaderHandleStorage.data(), groupCount);
+
+  // The table is read by every ray (raygen, miss, hit): it is uploaded through a staging buffer to
+  // device-local memory. The host-visible version is kept to compare the trace time.
+  vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eShaderDeviceAddress
+                               | vk::BufferUsageFlagBits::eShaderBindingTableKHR;
+  if(m_sbtDeviceLocal)
+  {
+    nvvk::CommandPool genCmdBuf(m_device, m_graphicsQueueIndex);
+    vk::CommandBuffer cmdBuf = genCmdBuf.createCommandBuffer();
+    m_rtSBTBuffer =
+        m_alloc.createBuffer(cmdBuf, sbtData, usage | vk::BufferUsageFlagBits::eTransferDst);
+    genCmdBuf.submitAndWait(cmdBuf);
+  }
+  else
+  {
+    m_rtSBTBuffer = m_alloc.createBuffer(
+        sbtData.size(), usage | vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    void* mapped = m_alloc.map(m_rtSBTBuffer);
+    memcpy(mapped, sbtData.data(), sbtData.size());
+    m_alloc.unmap(m_rtSBTBuffer);
+  }
   m_debug.setObjectName(m_rtSBTBuffer.buffer, std::string("SBT").c_str());
+  m_memStats.trackBuffer(m_rtSBTBuffer.buffer, MemCategory::eSbt);
+  m_alloc.finalizeAndReleaseStaging();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Recreating the pipelines with the SPIR-V modules of the current variant (see shader_variants.h),
+// to compare the original and the optimized modules. The ray tracing modules come from
+// m_shaderCache: rebuilding with the same variant does not read nor create any module.
+//
+void HelloVulkan::reloadShaders()
+{
+  LOGI("Loading the %s SPIR-V modules\n", getSpirvVariantName(getSpirvVariant()));
+  m_device.waitIdle();
+
+  m_device.destroy(m_graphicsPipeline);
+  m_device.destroy(m_pipelineLayout);
+  createGraphicsPipeline();
 
-  // Map the SBT buffer and write in the handles.
-  void* mapped = m_alloc.map(m_rtSBTBuffer);
-  auto* pData  = reinterpret_cast<uint8_t*>(mapped);
-  for(uint32_t g = 0; g < groupCount; g++)
+  m_device.destroy(m_postPipeline);
+  m_device.destroy(m_postPipelineLayout);
+  createPostPipeline();
+
+  rebuildRtPipeline();
+}
+
+//--------------------------------------------------------------------------------------------------
+// The shader group handles change with the pipeline: the SBT is rebuilt as well.
+// The GPU must be idle.
+//
+void HelloVulkan::rebuildRtPipeline()
+{
+  m_device.destroy(m_rtPipeline);
+  m_device.destroy(m_rtPipelineLayout);
+  m_rtShaderGroups.clear();
+  createRtPipeline();
+  m_memStats.untrackBuffer(m_rtSBTBuffer.buffer);
+  m_alloc.destroy(m_rtSBTBuffer);
+  createRtShaderBindingTable();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Hot reload: the modules recompiled by m_shaderWatcher replace the ones of the cache, and only
+// the ray tracing pipeline and its SBT are rebuilt. The acceleration structures, textures and
+// buffers are kept. Called between two frames.
+// If the pipeline cannot be created with the new modules, the previous pipeline and modules
+// are kept: all the modules of the change are applied, or none.
+//
+void HelloVulkan::applyShaderUpdates()
+{
+  std::vector<ShaderWatcher::Compiled> compiled = m_shaderWatcher.takeCompiled();
+  if(compiled.empty())
+    return;
+
+  auto   start     = std::chrono::steady_clock::now();
+  double compileMs = 0;
+
+  // The code in use, to go back to
+  std::vector<std::pair<std::string, std::string>> previous;  // Name, code
+  for(const auto& module : compiled)
   {
-    memcpy(pData, shaderHandleStorage.data() + g * groupHandleSize, groupHandleSize);
-    pData += groupSizeAligned;
+    previous.emplace_back(module.name, m_shaderCache.getCode(module.name));
+    m_shaderCache.setCode(module.name, module.code);
+    compileMs = std::max(compileMs, module.compileMs);
   }
-  m_alloc.unmap(m_rtSBTBuffer);
-  m_alloc.finalizeAndReleaseStaging();
+  m_device.waitIdle();
+
+  vk::Pipeline                                        oldPipeline = m_rtPipeline;
+  vk::PipelineLayout                                  oldLayout   = m_rtPipelineLayout;
+  std::vector<vk::RayTracingShaderGroupCreateInfoKHR> oldGroups;
+  oldGroups.swap(m_rtShaderGroups);
+  try
+  {
+    createRtPipeline();
+  }
+  catch(const std::exception& e)
+  {
+    LOGE("Hot reload: cannot create the ray tracing pipeline (%s), keeping the previous one\n",
+         e.what());
+    if(m_rtPipeline != oldPipeline)
+      m_device.destroy(m_rtPipeline);
+    if(m_rtPipelineLayout != oldLayout)
+      m_device.destroy(m_rtPipelineLayout);
+    m_rtPipeline       = oldPipeline;
+    m_rtPipelineLayout = oldLayout;
+    m_rtShaderGroups.swap(oldGroups);
+    for(const auto& module : previous)
+    {
+      if(!module.second.empty())
+        m_shaderCache.setCode(module.first, module.second);
+      else
+        m_shaderCache.invalidate(module.first);
+    }
+    return;
+  }
+  m_device.destroy(oldPipeline);
+  m_device.destroy(oldLayout);
+  m_memStats.untrackBuffer(m_rtSBTBuffer.buffer);
+  m_alloc.destroy(m_rtSBTBuffer);
+  createRtShaderBindingTable();
+
+  m_lastReload.modules   = static_cast<uint32_t>(compiled.size());
+  m_lastReload.compileMs = compileMs;
+  m_lastReload.rebuildMs =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  LOGI("Hot reload: %u module(s), compiled in %.1f ms, pipeline rebuilt in %.1f ms\n",
+       m_lastReload.modules, m_lastReload.compileMs, m_lastReload.rebuildMs);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Switching the memory of the SBT: the table is rebuilt once the GPU is idle
+//
+void HelloVulkan::setSbtDeviceLocal(bool deviceLocal)
+{
+  if(deviceLocal == m_sbtDeviceLocal)
+    return;
+  m_device.waitIdle();
+  m_memStats.untrackBuffer(m_rtSBTBuffer.buffer);
+  m_alloc.destroy(m_rtSBTBuffer);
+  m_sbtDeviceLocal = deviceLocal;
+  createRtShaderBindingTable();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -925,6 +1143,7 @@ void HelloVulkan::createRtShaderBindingTable()
 void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor)
 {
   m_debug.beginLabel(cmdBuf, "Ray trace");
+  m_profiler.beginSection(cmdBuf, "Ray trace");
   // Initializing push constant values
   m_rtPushConstants.clearColor     = clearColor;
   m_rtPushConstants.lightPosition  = m_pushConstant.lightPosition;
@@ -940,23 +1159,15 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
                                            | vk::ShaderStageFlagBits::eMissKHR,
                                        0, m_rtPushConstants);
 
-  // Size of a program identifier
-  uint32_t groupSize =
-      nvh::align_up(m_rtProperties.shaderGroupHandleSize, m_rtProperties.shaderGroupBaseAlignment);
-  uint32_t          groupStride = groupSize;
-  vk::DeviceAddress sbtAddress  = m_device.getBufferAddress({m_rtSBTBuffer.buffer});
-
-  using Stride = vk::StridedDeviceAddressRegionKHR;
-  std::array<Stride, 4> strideAddresses{
-      Stride{sbtAddress + 0u * groupSize, groupStride, groupSize * 1},  // raygen
-      Stride{sbtAddress + 1u * groupSize, groupStride, groupSize * 2},  // miss
-      Stride{sbtAddress + 3u * groupSize, groupStride, groupSize * 1},  // hit
-      Stride{0u, 0u, 0u}};                                              // callable
+  // Regions of the SBT: raygen, miss, hit, callable
+  vk::DeviceAddress sbtAddress      = m_device.getBufferAddress({m_rtSBTBuffer.buffer});
+  auto              strideAddresses = m_sbtLayout.getRegions(sbtAddress);
 
   cmdBuf.traceRaysKHR(&strideAddresses[0], &strideAddresses[1], &strideAddresses[2],
                       &strideAddresses[3],              //
                       m_size.width, m_size.height, 1);  //
 
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
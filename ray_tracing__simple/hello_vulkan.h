@@ -25,6 +25,12 @@
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/memallocator_dma_vk.hpp"
 
+#include "gpu_profiler.h"
+#include "memory_stats.h"
+#include "sbt_layout.h"
+#include "shader_module_cache.h"
+#include "shader_watcher.h"
+
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
 
@@ -104,6 +110,18 @@ public:
   nvvk::ResourceAllocatorDma m_alloc;  // Allocator for buffer, images, acceleration structures
   nvvk::DebugUtil            m_debug;  // Utility to name objects
 
+  GpuProfiler       m_profiler;       // GPU timestamps of each pass
+  MemoryStats       m_memStats;       // Device memory per category and model
+  ShaderModuleCache m_shaderCache;    // Shader modules, kept across pipeline rebuilds
+  ShaderWatcher     m_shaderWatcher;  // Hot reload of the ray tracing shaders
+
+  struct ReloadTimings
+  {
+    uint32_t modules{0};
+    double   compileMs{0};  // Slowest module, compiled in the background
+    double   rebuildMs{0};  // Pipeline and SBT, blocking the rendering
+  } m_lastReload;
+
   // #Post
   void createOffscreenRender();
   void createPostPipeline();
@@ -111,6 +129,19 @@ public:
   void updatePostDescriptorSet();
   void drawPost(vk::CommandBuffer cmdBuf);
 
+  // The offscreen images are only reallocated when the window becomes larger than them
+  struct ResizeStats
+  {
+    uint32_t events{0};         // Calls to onResize
+    uint32_t reallocations{0};  // Calls to createOffscreenRender
+  } m_resizeStats;
+
+  struct PostPushConstant
+  {
+    nvmath::vec2f uvScale{1.f, 1.f};  // Part of the offscreen image covered by the window
+    float         aspectRatio{1.f};
+  } m_postPushConstant;
+
   nvvk::DescriptorSetBindings m_postDescSetLayoutBind;
   vk::DescriptorPool          m_postDescPool;
   vk::DescriptorSetLayout     m_postDescSetLayout;
@@ -122,6 +153,8 @@ public:
   nvvk::Texture               m_offscreenColor;
   vk::Format                  m_offscreenColorFormat{vk::Format::eR32G32B32A32Sfloat};
   nvvk::Texture               m_offscreenDepth;
+  vk::Extent2D                m_offscreenCapacity;          // Size of the images, >= m_size
+  float                       m_offscreenHeadroom{1.25f};  // Extra size when reallocating
   vk::Format                  m_offscreenDepthFormat{vk::Format::eX8D24UnormPack32};
 
   // #VKRay
@@ -133,6 +166,10 @@ public:
   void updateRtDescriptorSet();
   void createRtPipeline();
   void createRtShaderBindingTable();
+  void setSbtDeviceLocal(bool deviceLocal);
+  void reloadShaders();
+  void rebuildRtPipeline();
+  void applyShaderUpdates();
   void raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor);
 
 
@@ -146,6 +183,9 @@ public:
   vk::PipelineLayout                                  m_rtPipelineLayout;
   vk::Pipeline                                        m_rtPipeline;
   nvvk::Buffer                                        m_rtSBTBuffer;
+  SbtLayout                                           m_sbtLayout;
+  // The SBT is in device-local memory, or host-visible and coherent for comparison
+  bool                                                m_sbtDeviceLocal{true};
 
   struct RtPushConstant
   {
@@ -37,6 +37,8 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 #include "nvvk/appbase_vkpp.hpp"
 #include "nvvk/commands_vk.hpp"
 #include "nvvk/context_vk.hpp"
+#include "shader_variants.h"
+#include "trace_events.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -65,6 +67,53 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat3("Position", &helloVk.m_pushConstant.lightPosition.x, -20.f, 20.f);
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
   }
+  if(ImGui::CollapsingHeader("Shader Binding Table"))
+  {
+    // Compare the "Ray trace" section of the profiler with both memory types
+    bool deviceLocal = helloVk.m_sbtDeviceLocal;
+    if(ImGui::Checkbox("Device-local SBT", &deviceLocal))
+      helloVk.setSbtDeviceLocal(deviceLocal);
+  }
+  if(ImGui::CollapsingHeader("Shaders"))
+  {
+    // A/B of the SPIR-V modules, optimized at build time by spirv-opt
+    int variant = static_cast<int>(getSpirvVariant());
+    ImGui::RadioButton("Original", &variant, static_cast<int>(SpirvVariant::eOriginal));
+    ImGui::SameLine();
+    ImGui::RadioButton("Optimized", &variant, static_cast<int>(SpirvVariant::eOptimized));
+    if(variant != static_cast<int>(getSpirvVariant()))
+    {
+      setSpirvVariant(static_cast<SpirvVariant>(variant));
+      helloVk.reloadShaders();
+    }
+    if(ImGui::Button("Rebuild pipelines"))
+      helloVk.reloadShaders();
+    const auto& stats = helloVk.m_shaderCache.getStats();
+    ImGui::Text("Module cache: %u files read, %u modules, %u hits, %u shared", stats.fileLoads,
+                stats.modulesCreated, stats.hits, stats.sharedModules);
+    if(helloVk.m_shaderWatcher.isRunning())
+    {
+      const auto& reload = helloVk.m_lastReload;
+      ImGui::Text("Hot reload: %u module(s), compile %.1f ms, rebuild %.1f ms", reload.modules,
+                  reload.compileMs, reload.rebuildMs);
+      std::string error = helloVk.m_shaderWatcher.getLastError();
+      if(!error.empty())
+        ImGui::TextColored(ImVec4(1.f, 0.3f, 0.3f, 1.f), "%s", error.c_str());
+    }
+  }
+  if(ImGui::CollapsingHeader("GPU Profiler"))
+  {
+    helloVk.m_profiler.renderUI();
+  }
+  if(ImGui::CollapsingHeader("Memory"))
+  {
+    helloVk.m_memStats.renderUI();
+    const auto& resize = helloVk.m_resizeStats;
+    ImGui::Text("Offscreen %u x %u, window %u x %u", helloVk.m_offscreenCapacity.width,
+                helloVk.m_offscreenCapacity.height, helloVk.getSize().width,
+                helloVk.getSize().height);
+    ImGui::Text("Resize: %u events, %u reallocations", resize.events, resize.reallocations);
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -79,6 +128,7 @@ static int const SAMPLE_HEIGHT = 720;
 int main(int argc, char** argv)
 {
   UNUSED(argc);
+  TraceScope traceStartup("Startup");
 
   // Setup GLFW window
   glfwSetErrorCallback(onErrorCallback);
@@ -138,9 +188,11 @@ int main(int argc, char** argv)
   contextInfo.addDeviceExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
   contextInfo.addDeviceExtension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME);
   contextInfo.addDeviceExtension(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+  contextInfo.addDeviceExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, true);  // Optional
 
 
   // Creating Vulkan base application
+  TraceScope    traceContext("Vulkan context");
   nvvk::Context vkctx{};
   vkctx.initInstance(contextInfo);
   // Find all compatible devices
@@ -148,6 +200,7 @@ int main(int argc, char** argv)
   assert(!compatibleDevices.empty());
   // Use a compatible device
   vkctx.initDevice(compatibleDevices[0], contextInfo);
+  traceContext.end();
 
 
   // Create example
@@ -160,6 +213,10 @@ int main(int argc, char** argv)
   helloVk.setup(vkctx.m_instance, vkctx.m_device, vkctx.m_physicalDevice,
                 vkctx.m_queueGCT.familyIndex);
   helloVk.createSwapchain(surface, SAMPLE_WIDTH, SAMPLE_HEIGHT);
+  helloVk.m_profiler.setup(vkctx.m_device, vkctx.m_physicalDevice, vkctx.m_queueGCT.familyIndex,
+                           static_cast<uint32_t>(helloVk.getCommandBuffers().size()));
+
+  helloVk.m_shaderCache.setup(vkctx.m_device, defaultSearchPaths);
   helloVk.createDepthBuffer();
   helloVk.createRenderPass();
   helloVk.createFrameBuffers();
@@ -196,6 +253,16 @@ int main(int argc, char** argv)
   bool          useRaytracer = true;
 
 
+  // Writing the trace of the startup, to be opened in chrome://tracing or ui.perfetto.dev
+  traceStartup.end();
+  if(TraceRecorder::get().dump("load_trace.json"))
+    LOGI("Startup trace written to load_trace.json\n");
+  TraceRecorder::get().setEnabled(false);
+  helloVk.m_memStats.dump("memory_stats.json");
+
+  // Hot reload: the ray tracing shaders are recompiled when saved
+  helloVk.m_shaderWatcher.start(SHADER_SOURCE_DIR, GLSLANG_VALIDATOR);
+
   helloVk.setupGlfwCallbacks(window);
   ImGui_ImplGlfw_InitForVulkan(window, true);
 
@@ -226,6 +293,9 @@ int main(int argc, char** argv)
       ImGuiH::Panel::End();
     }
 
+    // Rebuilding the ray tracing pipeline with the shaders compiled since the last frame
+    helloVk.applyShaderUpdates();
+
     // Start rendering the scene
     helloVk.prepareFrame();
 
@@ -234,6 +304,7 @@ int main(int argc, char** argv)
     const vk::CommandBuffer& cmdBuf   = helloVk.getCommandBuffers()[curFrame];
 
     cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    helloVk.m_profiler.beginFrame(cmdBuf, curFrame);
 
     // Updating camera buffer
     helloVk.updateUniformBuffer(cmdBuf);
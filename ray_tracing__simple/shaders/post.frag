@@ -25,13 +25,14 @@ layout(set = 0, binding = 0) uniform sampler2D noisyTxt;
 
 layout(push_constant) uniform shaderInformation
 {
+  vec2  uvScale;  // The offscreen image can be larger than the window
   float aspectRatio;
 }
 pushc;
 
 void main()
 {
-  vec2  uv    = outUV;
+  vec2  uv    = outUV * pushc.uvScale;
   float gamma = 1. / 2.2;
   fragColor   = pow(texture(noisyTxt, uv).rgba, vec4(gamma));
 }
@@ -18,6 +18,7 @@
  */
 
 
+#include <algorithm>
 #include <sstream>
 #include <vulkan/vulkan.hpp>
 
@@ -28,6 +29,7 @@ extern std::vector<std::string> defaultSearchPaths;
 #include "stb_image.h"
 
 #include "hello_vulkan.h"
+#include "nvh/alignment.hpp"
 #include "nvh/cameramanipulator.hpp"
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/images_vk.hpp"
@@ -37,6 +39,7 @@ extern std::vector<std::string> defaultSearchPaths;
 #include "nvvk/commands_vk.hpp"
 #include "nvvk/renderpasses_vk.hpp"
 #include "nvvk/shaders_vk.hpp"
+#include "trace_events.h"
 
 
 // Holding the camera matrices
@@ -183,6 +186,8 @@ void HelloVulkan::updateDescriptorSet()
 //
 void HelloVulkan::createGraphicsPipeline()
 {
+  TRACE_SCOPE("createGraphicsPipeline");
+
   using vkSS = vk::ShaderStageFlagBits;
 
   vk::PushConstantRange pushConstantRanges = {vkSS::eVertex | vkSS::eFragment, 0,
@@ -225,6 +230,8 @@ void HelloVulkan::createGraphicsPipeline()
 //
 void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform)
 {
+  TRACE_SCOPE("loadModel", filename);
+
   using vkBU = vk::BufferUsageFlagBits;
 
   LOGI("Loading File:  %s \n", filename.c_str());
@@ -252,6 +259,7 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
   // Create the buffers on Device and copy vertices, indices and materials
   nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
   vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
+  TraceScope staging("Staging copies");
   model.vertexBuffer =
       m_alloc.createBuffer(cmdBuf, loader.m_vertices,
                            vkBU::eVertexBuffer | vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
@@ -262,9 +270,14 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
                                | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
   model.matColorBuffer = m_alloc.createBuffer(cmdBuf, loader.m_materials, vkBU::eStorageBuffer);
   model.matIndexBuffer = m_alloc.createBuffer(cmdBuf, loader.m_matIndx, vkBU::eStorageBuffer);
+  staging.end();
+
   // Creates all textures found
   createTextureImages(cmdBuf, loader.m_textures);
-  cmdBufGet.submitAndWait(cmdBuf);
+  {
+    TRACE_SCOPE("Submit and wait");
+    cmdBufGet.submitAndWait(cmdBuf);
+  }
   m_alloc.finalizeAndReleaseStaging();
 
   std::string objNb = std::to_string(instance.objIndex);
@@ -299,6 +312,8 @@ void HelloVulkan::createUniformBuffer()
 //
 void HelloVulkan::createSceneDescriptionBuffer()
 {
+  TRACE_SCOPE("createSceneDescriptionBuffer");
+
   using vkBU = vk::BufferUsageFlagBits;
   nvvk::CommandPool cmdGen(m_device, m_graphicsQueueIndex);
 
@@ -352,8 +367,10 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer&        cmdBuf,
       o << "media/textures/" << texture;
       std::string txtFile = nvh::findFile(o.str(), defaultSearchPaths, true);
 
-      stbi_uc* stbi_pixels =
+      TraceScope decode("Texture decode", txtFile);
+      stbi_uc*   stbi_pixels =
           stbi_load(txtFile.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+      decode.end();
 
       std::array<stbi_uc, 4> color{255u, 0u, 255u, 255u};
 
@@ -416,20 +433,29 @@ void HelloVulkan::destroyResources()
   m_device.destroy(m_postDescPool);
   m_device.destroy(m_postDescSetLayout);
   m_alloc.destroy(m_offscreenColor);
-  m_alloc.destroy(m_gBuffer);
   m_alloc.destroy(m_aoBuffer);
   m_alloc.destroy(m_offscreenDepth);
   m_device.destroy(m_offscreenRenderPass);
-  m_device.destroy(m_offscreenFramebuffer);
+  for(uint32_t i = 0; i < 2; i++)
+  {
+    m_alloc.destroy(m_gBuffer[i]);
+    m_device.destroy(m_offscreenFramebuffer[i]);
+  }
 
   // Compute
   m_device.destroy(m_compDescPool);
   m_device.destroy(m_compDescSetLayout);
   m_device.destroy(m_compPipeline);
   m_device.destroy(m_compPipelineLayout);
+  m_alloc.destroy(m_blueNoise);
+  destroyAsyncCompute();
 
   // #VKRay
-  m_rtBuilder.destroy();
+  for(auto& blas : m_blas)
+    m_alloc.destroy(blas);
+  m_blas.clear();
+  m_alloc.destroy(m_tlas);
+  m_profiler.destroy();
   m_alloc.deinit();
 }
 
@@ -443,6 +469,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
   vk::DeviceSize offset{0};
 
   m_debug.beginLabel(cmdBuf, "Rasterize");
+  m_profiler.beginSection(cmdBuf, "Rasterize");
 
   // Dynamic Viewport
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
@@ -463,6 +490,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
     cmdBuf.bindIndexBuffer(model.indexBuffer.buffer, 0, vk::IndexType::eUint32);
     cmdBuf.drawIndexed(model.nbIndices, 1, 0, 0, 0);
   }
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -471,10 +499,12 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
 //
 void HelloVulkan::onResize(int /*w*/, int /*h*/)
 {
+  m_aoPending = false;  // The new images belong to the graphics queue
   createOffscreenRender();
   updatePostDescriptorSet();
   updateCompDescriptors();
   resetFrame();
+  resetAsyncCompute();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -486,8 +516,11 @@ void HelloVulkan::onResize(int /*w*/, int /*h*/)
 //
 void HelloVulkan::createOffscreenRender()
 {
+  TRACE_SCOPE("createOffscreenRender");
+
   m_alloc.destroy(m_offscreenColor);
-  m_alloc.destroy(m_gBuffer);
+  m_alloc.destroy(m_gBuffer[0]);
+  m_alloc.destroy(m_gBuffer[1]);
   m_alloc.destroy(m_aoBuffer);
   m_alloc.destroy(m_offscreenDepth);
 
@@ -506,7 +539,8 @@ void HelloVulkan::createOffscreenRender()
     m_debug.setObjectName(m_offscreenColor.image, "offscreen");
   }
 
-  // The G-Buffer (rgba32f) - position(xyz) / normal(w-compressed)
+  // The G-Buffers (rgba32f) - position(xyz) / normal(w-compressed)
+  for(uint32_t i = 0; i < 2; i++)
   {
     auto colorCreateInfo = nvvk::makeImage2DCreateInfo(m_size, vk::Format::eR32G32B32A32Sfloat,
                                                        vk::ImageUsageFlagBits::eColorAttachment
@@ -516,9 +550,9 @@ void HelloVulkan::createOffscreenRender()
 
     nvvk::Image             image  = m_alloc.createImage(colorCreateInfo);
     vk::ImageViewCreateInfo ivInfo = nvvk::makeImageViewCreateInfo(image.image, colorCreateInfo);
-    m_gBuffer                      = m_alloc.createTexture(image, ivInfo, vk::SamplerCreateInfo());
-    m_gBuffer.descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    m_debug.setObjectName(m_gBuffer.image, "G-Buffer");
+    m_gBuffer[i]                   = m_alloc.createTexture(image, ivInfo, vk::SamplerCreateInfo());
+    m_gBuffer[i].descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    m_debug.setObjectName(m_gBuffer[i].image, i == 0 ? "G-Buffer 0" : "G-Buffer 1");
   }
 
   // The ambient occlusion result (r32)
@@ -559,8 +593,9 @@ void HelloVulkan::createOffscreenRender()
     auto              cmdBuf = genCmdBuf.createCommandBuffer();
     nvvk::cmdBarrierImageLayout(cmdBuf, m_offscreenColor.image, vk::ImageLayout::eUndefined,
                                 vk::ImageLayout::eGeneral);
-    nvvk::cmdBarrierImageLayout(cmdBuf, m_gBuffer.image, vk::ImageLayout::eUndefined,
-                                vk::ImageLayout::eGeneral);
+    for(auto& gBuffer : m_gBuffer)
+      nvvk::cmdBarrierImageLayout(cmdBuf, gBuffer.image, vk::ImageLayout::eUndefined,
+                                  vk::ImageLayout::eGeneral);
     nvvk::cmdBarrierImageLayout(cmdBuf, m_aoBuffer.image, vk::ImageLayout::eUndefined,
                                 vk::ImageLayout::eGeneral);
     nvvk::cmdBarrierImageLayout(cmdBuf, m_offscreenDepth.image, vk::ImageLayout::eUndefined,
@@ -580,20 +615,23 @@ void HelloVulkan::createOffscreenRender()
                                vk::ImageLayout::eGeneral);
   }
 
-  // Creating the frame buffer for offscreen
-  std::vector<vk::ImageView> attachments = {m_offscreenColor.descriptor.imageView,
-                                            m_gBuffer.descriptor.imageView,
-                                            m_offscreenDepth.descriptor.imageView};
-
-  m_device.destroy(m_offscreenFramebuffer);
-  vk::FramebufferCreateInfo info;
-  info.setRenderPass(m_offscreenRenderPass);
-  info.setAttachmentCount(static_cast<int>(attachments.size()));
-  info.setPAttachments(attachments.data());
-  info.setWidth(m_size.width);
-  info.setHeight(m_size.height);
-  info.setLayers(1);
-  m_offscreenFramebuffer = m_device.createFramebuffer(info);
+  // Creating the frame buffers for offscreen, one per G-Buffer
+  for(uint32_t i = 0; i < 2; i++)
+  {
+    std::vector<vk::ImageView> attachments = {m_offscreenColor.descriptor.imageView,
+                                              m_gBuffer[i].descriptor.imageView,
+                                              m_offscreenDepth.descriptor.imageView};
+
+    m_device.destroy(m_offscreenFramebuffer[i]);
+    vk::FramebufferCreateInfo info;
+    info.setRenderPass(m_offscreenRenderPass);
+    info.setAttachmentCount(static_cast<int>(attachments.size()));
+    info.setPAttachments(attachments.data());
+    info.setWidth(m_size.width);
+    info.setHeight(m_size.height);
+    info.setLayers(1);
+    m_offscreenFramebuffer[i] = m_device.createFramebuffer(info);
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -601,6 +639,8 @@ void HelloVulkan::createOffscreenRender()
 //
 void HelloVulkan::createPostPipeline()
 {
+  TRACE_SCOPE("createPostPipeline");
+
   // Push constants in the fragment shader
   vk::PushConstantRange pushConstantRanges = {vk::ShaderStageFlagBits::eFragment, 0, sizeof(float)};
 
@@ -660,6 +700,7 @@ void HelloVulkan::updatePostDescriptorSet()
 void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
 {
   m_debug.beginLabel(cmdBuf, "Post");
+  m_profiler.beginSection(cmdBuf, "Post");
 
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
   cmdBuf.setScissor(0, {{{0, 0}, {m_size.width, m_size.height}}});
@@ -672,6 +713,7 @@ void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
                             m_postDescSet, {});
   cmdBuf.draw(3, 1, 0, 0);
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -687,9 +729,45 @@ void HelloVulkan::initRayTracing()
   // Requesting ray tracing properties
   auto properties =
       m_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
-                                      vk::PhysicalDeviceRayTracingPipelinePropertiesKHR>();
+                                      vk::PhysicalDeviceRayTracingPipelinePropertiesKHR,
+                                      vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
   m_rtProperties = properties.get<vk::PhysicalDeviceRayTracingPipelinePropertiesKHR>();
-  m_rtBuilder.setup(m_device, &m_alloc, m_graphicsQueueIndex);
+  m_asProperties = properties.get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Buffer used by both the graphics and the compute queue families. The acceleration structures
+// are built on the graphics queue and traced on the compute queue in async mode: as for the blue
+// noise texture, concurrent sharing avoids transferring their ownership at each mode switch.
+//
+nvvk::Buffer HelloVulkan::createSharedBuffer(vk::DeviceSize          size,
+                                             vk::BufferUsageFlags    usage,
+                                             vk::MemoryPropertyFlags memProps)
+{
+  vk::BufferCreateInfo    info({}, size, usage);
+  std::array<uint32_t, 2> families{m_graphicsQueueIndex, m_compQueueFamily};
+  if(m_compQueue && m_compQueueFamily != m_graphicsQueueIndex)
+  {
+    info.setSharingMode(vk::SharingMode::eConcurrent);
+    info.setQueueFamilyIndexCount(static_cast<uint32_t>(families.size()));
+    info.setPQueueFamilyIndices(families.data());
+  }
+  return m_alloc.createBuffer(info, memProps);
+}
+
+nvvk::AccelKHR HelloVulkan::createAccel(vk::AccelerationStructureTypeKHR type, vk::DeviceSize size)
+{
+  nvvk::AccelKHR accel;
+  accel.buffer = createSharedBuffer(size,
+                                    vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR
+                                        | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                                    vk::MemoryPropertyFlagBits::eDeviceLocal);
+  vk::AccelerationStructureCreateInfoKHR createInfo;
+  createInfo.setType(type);
+  createInfo.setSize(size);
+  createInfo.setBuffer(accel.buffer.buffer);
+  accel.accel = m_device.createAccelerationStructureKHR(createInfo);
+  return accel;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -732,38 +810,140 @@ auto HelloVulkan::objectToVkGeometryKHR(const ObjModel& model)
 }
 
 //--------------------------------------------------------------------------------------------------
-//
+// One BLAS per model, all built in one batch with a single scratch buffer
 //
 void HelloVulkan::createBottomLevelAS()
 {
-  // BLAS - Storing each primitive in a geometry
-  std::vector<nvvk::RaytracingBuilderKHR::BlasInput> allBlas;
+  TRACE_SCOPE("createBottomLevelAS");
+  using vkBU = vk::BufferUsageFlagBits;
+
+  // BLAS - Storing each primitive in a geometry. The build infos point to the geometries of the
+  // inputs: no reallocation after this.
+  std::vector<nvvk::RaytracingBuilderKHR::BlasInput>          allBlas;
+  std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos;
+  std::vector<vk::DeviceSize>                                scratchOffsets;
   allBlas.reserve(m_objModel.size());
-  for(const auto& obj : m_objModel)
+  m_blas.resize(m_objModel.size());
+  vk::DeviceSize scratchSize = 0;
+  vk::DeviceSize alignment   = m_asProperties.minAccelerationStructureScratchOffsetAlignment;
+  for(size_t i = 0; i < m_objModel.size(); i++)
   {
-    auto blas = objectToVkGeometryKHR(obj);
-
     // We could add more geometry in each BLAS, but we add only one for now
-    allBlas.emplace_back(blas);
+    allBlas.emplace_back(objectToVkGeometryKHR(m_objModel[i]));
+    auto& input = allBlas.back();
+
+    vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+    buildInfo.setType(vk::AccelerationStructureTypeKHR::eBottomLevel);
+    buildInfo.setMode(vk::BuildAccelerationStructureModeKHR::eBuild);
+    buildInfo.setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+    buildInfo.setGeometries(input.asGeometry);
+
+    std::vector<uint32_t> maxPrimCount;
+    for(const auto& range : input.asBuildOffsetInfo)
+      maxPrimCount.push_back(range.primitiveCount);
+    auto sizes = m_device.getAccelerationStructureBuildSizesKHR(
+        vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, maxPrimCount);
+
+    m_blas[i] = createAccel(vk::AccelerationStructureTypeKHR::eBottomLevel,
+                            sizes.accelerationStructureSize);
+    buildInfo.setDstAccelerationStructure(m_blas[i].accel);
+    m_debug.setObjectName(m_blas[i].buffer.buffer, "BLAS " + std::to_string(i));
+
+    scratchOffsets.push_back(scratchSize);
+    scratchSize += nvh::align_up(sizes.buildScratchSize, alignment);
+    buildInfos.push_back(buildInfo);
+  }
+
+  // Only used by the build, on the graphics queue
+  nvvk::Buffer scratch = m_alloc.createBuffer(scratchSize + alignment,
+                                              vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress);
+  vk::DeviceAddress scratchAddress = m_device.getBufferAddress({scratch.buffer});
+  std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> ranges;
+  for(size_t i = 0; i < buildInfos.size(); i++)
+  {
+    buildInfos[i].scratchData.setDeviceAddress(nvh::align_up(scratchAddress, alignment)
+                                               + scratchOffsets[i]);
+    ranges.push_back(allBlas[i].asBuildOffsetInfo.data());
   }
-  m_rtBuilder.buildBlas(allBlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+
+  nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
+  cmdBuf.buildAccelerationStructuresKHR(static_cast<uint32_t>(buildInfos.size()),
+                                        buildInfos.data(), ranges.data());
+  cmdBufGet.submitAndWait(cmdBuf);
+  m_alloc.destroy(scratch);
 }
 
+//--------------------------------------------------------------------------------------------------
+// The TLAS, with one instance per object instance
+//
 void HelloVulkan::createTopLevelAS()
 {
-  std::vector<nvvk::RaytracingBuilderKHR::Instance> tlas;
-  tlas.reserve(m_objInstance.size());
+  TRACE_SCOPE("createTopLevelAS");
+  using vkBU = vk::BufferUsageFlagBits;
+
+  std::vector<vk::AccelerationStructureInstanceKHR> instances;
+  instances.reserve(m_objInstance.size());
   for(uint32_t i = 0; i < static_cast<uint32_t>(m_objInstance.size()); i++)
   {
-    nvvk::RaytracingBuilderKHR::Instance rayInst;
-    rayInst.transform        = m_objInstance[i].transform;  // Position of the instance
-    rayInst.instanceCustomId = i;                           // gl_InstanceCustomIndexEXT
-    rayInst.blasId           = m_objInstance[i].objIndex;
-    rayInst.hitGroupId       = 0;  // We will use the same hit group for all objects
-    rayInst.flags            = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-    tlas.emplace_back(rayInst);
+    const ObjInstance& inst = m_objInstance[i];
+
+    vk::AccelerationStructureInstanceKHR rayInst;
+    nvmath::mat4f transp = nvmath::transpose(inst.transform);  // Position of the instance
+    memcpy(&rayInst.transform, &transp, sizeof(rayInst.transform));
+    rayInst.setInstanceCustomIndex(i);  // gl_InstanceCustomIndexEXT
+    rayInst.setMask(0xFF);
+    rayInst.setInstanceShaderBindingTableRecordOffset(0);  // Same hit group for all objects
+    rayInst.setFlags(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable);
+    rayInst.setAccelerationStructureReference(
+        m_device.getAccelerationStructureAddressKHR({m_blas[inst.objIndex].accel}));
+    instances.emplace_back(rayInst);
   }
-  m_rtBuilder.buildTlas(tlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+  auto nbInstances = static_cast<uint32_t>(instances.size());
+  if(instances.empty())
+    instances.emplace_back();  // The TLAS can be empty, not the buffer
+
+  // Written by the host, read by the build: visible at the submission
+  vk::DeviceSize instSize   = instances.size() * sizeof(vk::AccelerationStructureInstanceKHR);
+  nvvk::Buffer   instBuffer = createSharedBuffer(
+      instSize, vkBU::eShaderDeviceAddress | vkBU::eAccelerationStructureBuildInputReadOnlyKHR,
+      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+  memcpy(m_alloc.map(instBuffer), instances.data(), instSize);
+  m_alloc.unmap(instBuffer);
+
+  vk::AccelerationStructureGeometryInstancesDataKHR instancesData;
+  instancesData.setData(m_device.getBufferAddress({instBuffer.buffer}));
+  vk::AccelerationStructureGeometryKHR topASGeometry{vk::GeometryTypeKHR::eInstances};
+  topASGeometry.geometry.setInstances(instancesData);
+
+  vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+  buildInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+  buildInfo.setMode(vk::BuildAccelerationStructureModeKHR::eBuild);
+  buildInfo.setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+  buildInfo.setGeometries(topASGeometry);
+  auto sizes = m_device.getAccelerationStructureBuildSizesKHR(
+      vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, nbInstances);
+
+  m_tlas =
+      createAccel(vk::AccelerationStructureTypeKHR::eTopLevel, sizes.accelerationStructureSize);
+  m_debug.setObjectName(m_tlas.buffer.buffer, "TLAS");
+
+  vk::DeviceSize alignment = m_asProperties.minAccelerationStructureScratchOffsetAlignment;
+  nvvk::Buffer   scratch   = m_alloc.createBuffer(sizes.buildScratchSize + alignment,
+                                              vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress);
+  buildInfo.setDstAccelerationStructure(m_tlas.accel);
+  buildInfo.scratchData.setDeviceAddress(
+      nvh::align_up(m_device.getBufferAddress({scratch.buffer}), alignment));
+
+  nvvk::CommandPool                                 cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer                                 cmdBuf = cmdBufGet.createCommandBuffer();
+  vk::AccelerationStructureBuildRangeInfoKHR        range{nbInstances, 0, 0, 0};
+  const vk::AccelerationStructureBuildRangeInfoKHR* pRange = &range;
+  cmdBuf.buildAccelerationStructuresKHR(1, &buildInfo, &pRange);
+  cmdBufGet.submitAndWait(cmdBuf);
+
+  m_alloc.destroy(scratch);
+  m_alloc.destroy(instBuffer);
 }
 
 
@@ -771,6 +951,36 @@ void HelloVulkan::createTopLevelAS()
 // Compute shader from ANIMATION tutorial
 //////////////////////////////////////////////////////////////////////////
 
+//--------------------------------------------------------------------------------------------------
+// Ranks of the blue-noise tile of SampleSequence::eBlueNoise (sampler.glsl). The texture never
+// changes: with async compute, it is shared by both queue families instead of being transferred.
+//
+void HelloVulkan::createBlueNoiseTexture()
+{
+  TRACE_SCOPE("createBlueNoiseTexture");
+
+  SampleSequence::BlueNoise noise = SampleSequence::generateBlueNoise();
+
+  nvvk::CommandPool   cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer   cmdBuf = cmdBufGet.createCommandBuffer();
+  vk::ImageCreateInfo imageCreateInfo =
+      nvvk::makeImage2DCreateInfo(vk::Extent2D{noise.size, noise.size}, vk::Format::eR32Uint);
+  std::array<uint32_t, 2> families{m_graphicsQueueIndex, m_compQueueFamily};
+  if(m_compQueue && m_compQueueFamily != m_graphicsQueueIndex)
+  {
+    imageCreateInfo.setSharingMode(vk::SharingMode::eConcurrent);
+    imageCreateInfo.setQueueFamilyIndexCount(static_cast<uint32_t>(families.size()));
+    imageCreateInfo.setPQueueFamilyIndices(families.data());
+  }
+  vk::SamplerCreateInfo samplerCreateInfo{
+      {}, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest};
+  m_blueNoise = m_alloc.createTexture(cmdBuf, noise.ranks.size() * sizeof(uint32_t),
+                                      noise.ranks.data(), imageCreateInfo, samplerCreateInfo);
+  cmdBufGet.submitAndWait(cmdBuf);
+  m_alloc.finalizeAndReleaseStaging();
+  m_debug.setObjectName(m_blueNoise.image, "BlueNoise");
+}
+
 //--------------------------------------------------------------------------------------------------
 // Compute shader descriptor
 //
@@ -782,10 +992,13 @@ void HelloVulkan::createCompDescriptors()
       1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute));
   m_compDescSetLayoutBind.addBinding(vk::DescriptorSetLayoutBinding(  // [in] TLAS
       2, vk::DescriptorType::eAccelerationStructureKHR, 1, vk::ShaderStageFlagBits::eCompute));
+  m_compDescSetLayoutBind.addBinding(vk::DescriptorSetLayoutBinding(  // [in] Blue noise
+      3, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute));
 
   m_compDescSetLayout = m_compDescSetLayoutBind.createLayout(m_device);
-  m_compDescPool      = m_compDescSetLayoutBind.createPool(m_device, 1);
-  m_compDescSet       = nvvk::allocateDescriptorSet(m_device, m_compDescPool, m_compDescSetLayout);
+  m_compDescPool      = m_compDescSetLayoutBind.createPool(m_device, 2);
+  for(auto& descSet : m_compDescSet)
+    descSet = nvvk::allocateDescriptorSet(m_device, m_compDescPool, m_compDescSetLayout);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -793,13 +1006,18 @@ void HelloVulkan::createCompDescriptors()
 //
 void HelloVulkan::updateCompDescriptors()
 {
-  std::vector<vk::WriteDescriptorSet> writes;
-  writes.emplace_back(m_compDescSetLayoutBind.makeWrite(m_compDescSet, 0, &m_gBuffer.descriptor));
-  writes.emplace_back(m_compDescSetLayoutBind.makeWrite(m_compDescSet, 1, &m_aoBuffer.descriptor));
-
-  vk::AccelerationStructureKHR                   tlas = m_rtBuilder.getAccelerationStructure();
+  vk::AccelerationStructureKHR                   tlas = m_tlas.accel;
   vk::WriteDescriptorSetAccelerationStructureKHR descASInfo{1, &tlas};
-  writes.emplace_back(m_compDescSetLayoutBind.makeWrite(m_compDescSet, 2, &descASInfo));
+
+  std::vector<vk::WriteDescriptorSet> writes;
+  for(uint32_t i = 0; i < 2; i++)
+  {
+    const vk::DescriptorSet& set = m_compDescSet[i];
+    writes.emplace_back(m_compDescSetLayoutBind.makeWrite(set, 0, &m_gBuffer[i].descriptor));
+    writes.emplace_back(m_compDescSetLayoutBind.makeWrite(set, 1, &m_aoBuffer.descriptor));
+    writes.emplace_back(m_compDescSetLayoutBind.makeWrite(set, 2, &descASInfo));
+    writes.emplace_back(m_compDescSetLayoutBind.makeWrite(set, 3, &m_blueNoise.descriptor));
+  }
 
   m_device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 }
@@ -809,6 +1027,8 @@ void HelloVulkan::updateCompDescriptors()
 //
 void HelloVulkan::createCompPipelines()
 {
+  TRACE_SCOPE("createCompPipelines");
+
   // pushing time
   vk::PushConstantRange push_constants = {vk::ShaderStageFlagBits::eCompute, 0, sizeof(AoControl)};
   vk::PipelineLayoutCreateInfo layout_info{{}, 1, &m_compDescSetLayout, 1, &push_constants};
@@ -836,6 +1056,7 @@ void HelloVulkan::runCompute(vk::CommandBuffer cmdBuf, AoControl& aoControl)
     return;
 
   m_debug.beginLabel(cmdBuf, "Compute");
+  m_profiler.beginSection(cmdBuf, "Compute");
 
   // Adding a barrier to be sure the fragment has finished writing to the G-Buffer
   // before the compute shader is using the buffer
@@ -843,7 +1064,7 @@ void HelloVulkan::runCompute(vk::CommandBuffer cmdBuf, AoControl& aoControl)
   vk::ImageMemoryBarrier    imgMemBarrier;
   imgMemBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
   imgMemBarrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
-  imgMemBarrier.setImage(m_gBuffer.image);
+  imgMemBarrier.setImage(m_gBuffer[m_gBufferIndex].image);
   imgMemBarrier.setOldLayout(vk::ImageLayout::eGeneral);
   imgMemBarrier.setNewLayout(vk::ImageLayout::eGeneral);
   imgMemBarrier.setSubresourceRange(range);
@@ -855,7 +1076,7 @@ void HelloVulkan::runCompute(vk::CommandBuffer cmdBuf, AoControl& aoControl)
   // Preparing for the compute shader
   cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_compPipeline);
   cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_compPipelineLayout, 0,
-                            {m_compDescSet}, {});
+                            {m_compDescSet[m_gBufferIndex]}, {});
 
   // Sending the push constant information
   aoControl.frame = m_frame;
@@ -877,6 +1098,7 @@ void HelloVulkan::runCompute(vk::CommandBuffer cmdBuf, AoControl& aoControl)
                          vk::PipelineStageFlagBits::eFragmentShader,
                          vk::DependencyFlagBits::eDeviceGroup, {}, {}, {imgMemBarrier});
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -908,3 +1130,399 @@ void HelloVulkan::resetFrame()
 {
   m_frame = -1;
 }
+
+//////////////////////////////////////////////////////////////////////////
+// Asynchronous compute: AO on a dedicated queue
+//////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------------------
+// Barrier releasing or acquiring `image` between two queue families. When both families are the
+// same, it is a regular memory barrier.
+//
+static vk::ImageMemoryBarrier makeOwnershipBarrier(vk::Image       image,
+                                                   vk::AccessFlags srcAccess,
+                                                   vk::AccessFlags dstAccess,
+                                                   uint32_t        srcFamily,
+                                                   uint32_t        dstFamily)
+{
+  vk::ImageMemoryBarrier barrier;
+  barrier.setSrcAccessMask(srcAccess);
+  barrier.setDstAccessMask(dstAccess);
+  barrier.setOldLayout(vk::ImageLayout::eGeneral);
+  barrier.setNewLayout(vk::ImageLayout::eGeneral);
+  barrier.setSrcQueueFamilyIndex(srcFamily == dstFamily ? VK_QUEUE_FAMILY_IGNORED : srcFamily);
+  barrier.setDstQueueFamilyIndex(srcFamily == dstFamily ? VK_QUEUE_FAMILY_IGNORED : dstFamily);
+  barrier.setImage(image);
+  barrier.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+  return barrier;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Creating the command buffers, semaphores and timestamp queries of the async compute mode.
+// `computeQueue` must be a different queue than the graphics one, otherwise nothing would run in
+// parallel and the mode stays unavailable.
+//
+void HelloVulkan::setupAsyncCompute(vk::Queue computeQueue,
+                                    uint32_t  computeQueueFamily,
+                                    uint32_t  nbFrames)
+{
+  if(!computeQueue || computeQueue == m_queue)
+  {
+    LOGI("Async compute: no separate compute queue, AO stays on the graphics queue\n");
+    return;
+  }
+
+  m_compQueue       = computeQueue;
+  m_compQueueFamily = computeQueueFamily;
+  LOGI("Async compute: graphics family %u, compute family %u%s\n", m_graphicsQueueIndex,
+       m_compQueueFamily,
+       m_compQueueFamily != m_graphicsQueueIndex ? " (ownership transfers)" : "");
+
+  m_asyncGraphicsPool = m_device.createCommandPool(
+      {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, m_graphicsQueueIndex});
+  m_asyncComputePool = m_device.createCommandPool(
+      {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, m_compQueueFamily});
+
+  m_asyncFrames.resize(nbFrames);
+  auto rasterCmdBufs = m_device.allocateCommandBuffers(
+      {m_asyncGraphicsPool, vk::CommandBufferLevel::ePrimary, nbFrames});
+  auto compCmdBufs = m_device.allocateCommandBuffers(
+      {m_asyncComputePool, vk::CommandBufferLevel::ePrimary, nbFrames});
+  for(uint32_t i = 0; i < nbFrames; i++)
+  {
+    AsyncFrame& frame  = m_asyncFrames[i];
+    frame.rasterCmdBuf = rasterCmdBufs[i];
+    frame.compCmdBuf   = compCmdBufs[i];
+    frame.compFence    = m_device.createFence({vk::FenceCreateFlagBits::eSignaled});
+    frame.gBufferReady = m_device.createSemaphore({});
+    frame.aoFree       = m_device.createSemaphore({});
+    frame.aoReady      = m_device.createSemaphore({});
+  }
+  for(auto& semaphore : m_gBufferFree)
+    semaphore = m_device.createSemaphore({});
+
+  // Timestamps: raster begin/end on the graphics queue, AO begin/end on the compute queue
+  auto     queueFamilies = m_physicalDevice.getQueueFamilyProperties();
+  uint32_t validBits     = std::min(queueFamilies[m_graphicsQueueIndex].timestampValidBits,
+                                    queueFamilies[m_compQueueFamily].timestampValidBits);
+  m_timestampPeriod      = m_physicalDevice.getProperties().limits.timestampPeriod;
+  if(validBits > 0 && m_timestampPeriod > 0.f)
+  {
+    m_timestampMask  = validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1;
+    m_asyncQueryPool = m_device.createQueryPool(
+        {{}, vk::QueryType::eTimestamp, 4 * nbFrames, vk::QueryPipelineStatisticFlags()});
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void HelloVulkan::destroyAsyncCompute()
+{
+  for(auto& frame : m_asyncFrames)
+  {
+    m_device.destroy(frame.compFence);
+    m_device.destroy(frame.gBufferReady);
+    m_device.destroy(frame.aoFree);
+    m_device.destroy(frame.aoReady);
+  }
+  m_asyncFrames.clear();
+  for(auto& semaphore : m_gBufferFree)
+    m_device.destroy(semaphore);
+  m_device.destroy(m_asyncGraphicsPool);
+  m_device.destroy(m_asyncComputePool);
+  m_device.destroy(m_asyncQueryPool);
+  m_compQueue = vk::Queue();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Back to a state where nothing is in flight: after a resize or when switching modes.
+// Semaphores still signaled but never waited are recreated, as binary semaphores cannot be reset.
+// The images used by the compute queue are given back to the graphics queue.
+//
+void HelloVulkan::resetAsyncCompute()
+{
+  if(!isAsyncComputeSupported())
+    return;
+
+  m_device.waitIdle();
+
+  // The last AO was released by the compute queue family for a post that will not acquire it.
+  // The G-Buffers were acquired by the compute queue and never released: their content is not
+  // needed, the transition from 'undefined' gets them back without an ownership transfer.
+  if(m_aoPending)
+  {
+    nvvk::CommandPool                     cmdGen(m_device, m_graphicsQueueIndex);
+    vk::CommandBuffer                     cmdBuf = cmdGen.createCommandBuffer();
+    std::array<vk::ImageMemoryBarrier, 3> acquire{
+        makeOwnershipBarrier(m_aoBuffer.image, {},
+                             vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                             m_compQueueFamily, m_graphicsQueueIndex),
+        makeOwnershipBarrier(m_gBuffer[0].image, {}, {}, m_graphicsQueueIndex,
+                             m_graphicsQueueIndex),
+        makeOwnershipBarrier(m_gBuffer[1].image, {}, {}, m_graphicsQueueIndex,
+                             m_graphicsQueueIndex)};
+    acquire[1].setOldLayout(vk::ImageLayout::eUndefined);
+    acquire[2].setOldLayout(vk::ImageLayout::eUndefined);
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                           vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, acquire);
+    cmdGen.submitAndWait(cmdBuf);
+  }
+
+  for(auto& frame : m_asyncFrames)
+  {
+    m_device.destroy(frame.aoReady);
+    frame.aoReady   = m_device.createSemaphore({});
+    frame.submitted = false;
+  }
+  for(uint32_t i = 0; i < 2; i++)
+  {
+    m_device.destroy(m_gBufferFree[i]);
+    m_gBufferFree[i]        = m_device.createSemaphore({});
+    m_gBufferFreePending[i] = false;
+  }
+  m_aoPending    = false;
+  m_gBufferIndex = 0;
+  m_prevCompute  = {0, 0};
+  m_asyncTimings = AsyncTimings();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Starting the raster of a frame in async mode: waits for the previous use of the frame slot,
+// reads its timestamps back and returns the command buffer in which to rasterize the G-Buffer.
+//
+vk::CommandBuffer HelloVulkan::beginAsyncRaster()
+{
+  m_asyncCur        = static_cast<uint32_t>(m_asyncFrameNumber % m_asyncFrames.size());
+  AsyncFrame& frame = m_asyncFrames[m_asyncCur];
+  m_gBufferIndex    = static_cast<uint32_t>(m_asyncFrameNumber % 2);
+  m_asyncFrameNumber++;
+
+  // The AO fence is the last of the three submissions of that slot
+  while(m_device.waitForFences(frame.compFence, VK_TRUE, 10000) == vk::Result::eTimeout)
+  {
+  }
+  m_device.resetFences(frame.compFence);
+
+  // Timestamps of the frame previously using this slot. Slots are used in order, so this is
+  // also the order of the frames: the AO of the previous frame is compared to this raster.
+  if(m_asyncQueryPool && frame.submitted)
+  {
+    std::array<uint64_t, 4> ts{};
+    vk::Result result = m_device.getQueryPoolResults(m_asyncQueryPool, 4 * m_asyncCur, 4,
+                                                     sizeof(ts), ts.data(), sizeof(uint64_t),
+                                                     vk::QueryResultFlagBits::e64);
+    if(result == vk::Result::eSuccess)
+    {
+      for(auto& t : ts)
+        t &= m_timestampMask;
+      auto toMs = [&](uint64_t ticks) { return double(ticks) * m_timestampPeriod / 1e6; };
+      if(m_prevCompute[1] > m_prevCompute[0])
+      {
+        // Timestamps of different queues share the same time domain on the same device
+        uint64_t start   = std::max(ts[0], m_prevCompute[0]);
+        uint64_t end     = std::min(ts[1], m_prevCompute[1]);
+        double   overlap = end > start ? toMs(end - start) : 0.0;
+        double   raster  = toMs(ts[1] - ts[0]);
+        double   compute = toMs(m_prevCompute[1] - m_prevCompute[0]);
+
+        // Exponential moving average, as the GPU profiler
+        AsyncTimings& t = m_asyncTimings;
+        double        a = t.count == 0 ? 1.0 : 0.05;
+        t.rasterMs += a * (raster - t.rasterMs);
+        t.computeMs += a * (compute - t.computeMs);
+        t.overlapMs += a * (overlap - t.overlapMs);
+        t.count++;
+      }
+      m_prevCompute = {ts[2], ts[3]};
+    }
+  }
+  frame.submitted = true;
+
+  vk::CommandBuffer cmdBuf = frame.rasterCmdBuf;
+  cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  if(m_asyncQueryPool)
+  {
+    cmdBuf.resetQueryPool(m_asyncQueryPool, 4 * m_asyncCur, 4);
+    cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_asyncQueryPool,
+                          4 * m_asyncCur + 0);
+  }
+
+  // The content of the G-Buffer is cleared by the render pass: no need to get it back from the
+  // compute queue, the transition from 'undefined' discards it.
+  vk::ImageMemoryBarrier barrier = makeOwnershipBarrier(
+      m_gBuffer[m_gBufferIndex].image, {}, vk::AccessFlagBits::eColorAttachmentWrite,
+      m_graphicsQueueIndex, m_graphicsQueueIndex);
+  barrier.setOldLayout(vk::ImageLayout::eUndefined);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                         vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, {}, {}, {barrier});
+  return cmdBuf;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Handing the G-Buffer to the compute queue
+//
+void HelloVulkan::submitAsyncRaster(vk::CommandBuffer cmdBuf)
+{
+  AsyncFrame& frame = m_asyncFrames[m_asyncCur];
+
+  // Release to the compute queue family
+  vk::ImageMemoryBarrier barrier = makeOwnershipBarrier(
+      m_gBuffer[m_gBufferIndex].image, vk::AccessFlagBits::eColorAttachmentWrite, {},
+      m_graphicsQueueIndex, m_compQueueFamily);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                         vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, {barrier});
+  if(m_asyncQueryPool)
+    cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_asyncQueryPool,
+                          4 * m_asyncCur + 1);
+  cmdBuf.end();
+
+  // Waiting until the AO of two frames ago is done reading this G-Buffer
+  vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+  vk::SubmitInfo         submitInfo;
+  if(m_gBufferFreePending[m_gBufferIndex])
+  {
+    submitInfo.setWaitSemaphoreCount(1);
+    submitInfo.setPWaitSemaphores(&m_gBufferFree[m_gBufferIndex]);
+    submitInfo.setPWaitDstStageMask(&waitStage);
+    m_gBufferFreePending[m_gBufferIndex] = false;
+  }
+  submitInfo.setCommandBufferCount(1);
+  submitInfo.setPCommandBuffers(&cmdBuf);
+  submitInfo.setSignalSemaphoreCount(1);
+  submitInfo.setPSignalSemaphores(&frame.gBufferReady);
+  m_queue.submit(submitInfo, {});
+}
+
+//--------------------------------------------------------------------------------------------------
+// In the post command buffer, before sampling the AO: acquire it from the compute queue
+//
+void HelloVulkan::acquireAoBuffer(vk::CommandBuffer cmdBuf)
+{
+  if(!m_aoPending)
+    return;  // First frame: the AO buffer never left the graphics queue
+  vk::ImageMemoryBarrier barrier =
+      makeOwnershipBarrier(m_aoBuffer.image, {}, vk::AccessFlagBits::eShaderRead,
+                           m_compQueueFamily, m_graphicsQueueIndex);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
+                         vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, {barrier});
+}
+
+//--------------------------------------------------------------------------------------------------
+// In the post command buffer, after sampling the AO: give it back to the compute queue
+//
+void HelloVulkan::releaseAoBuffer(vk::CommandBuffer cmdBuf)
+{
+  vk::ImageMemoryBarrier barrier = makeOwnershipBarrier(m_aoBuffer.image, {}, {},
+                                                        m_graphicsQueueIndex, m_compQueueFamily);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
+                         vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, {barrier});
+}
+
+//--------------------------------------------------------------------------------------------------
+// Same as AppBase::submitFrame, but the post also waits for the AO of the previous frame and
+// signals when it is done reading the AO buffer.
+//
+void HelloVulkan::submitFrameAsync()
+{
+  size_t      nbFrames   = m_asyncFrames.size();
+  AsyncFrame& frame      = m_asyncFrames[m_asyncCur];
+  AsyncFrame& prevFrame  = m_asyncFrames[(m_asyncCur + nbFrames - 1) % nbFrames];
+  uint32_t    imageIndex = m_swapChain.getActiveImageIndex();
+  m_device.resetFences(m_waitFences[imageIndex]);
+
+  std::vector<vk::Semaphore>          waitSemaphores{m_swapChain.getActiveReadSemaphore()};
+  std::vector<vk::PipelineStageFlags> waitStages{vk::PipelineStageFlagBits::eColorAttachmentOutput};
+  if(m_aoPending)
+  {
+    waitSemaphores.push_back(prevFrame.aoReady);
+    waitStages.push_back(vk::PipelineStageFlagBits::eFragmentShader);
+  }
+  std::array<vk::Semaphore, 2> signalSemaphores{m_swapChain.getActiveWrittenSemaphore(),
+                                                frame.aoFree};
+
+  vk::SubmitInfo submitInfo;
+  submitInfo.setWaitSemaphoreCount(static_cast<uint32_t>(waitSemaphores.size()));
+  submitInfo.setPWaitSemaphores(waitSemaphores.data());
+  submitInfo.setPWaitDstStageMask(waitStages.data());
+  submitInfo.setCommandBufferCount(1);
+  submitInfo.setPCommandBuffers(&m_commandBuffers[imageIndex]);
+  submitInfo.setSignalSemaphoreCount(static_cast<uint32_t>(signalSemaphores.size()));
+  submitInfo.setPSignalSemaphores(signalSemaphores.data());
+  m_queue.submit(submitInfo, m_waitFences[imageIndex]);
+
+  m_swapChain.present(m_queue);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Submitting the AO of the current frame on the compute queue. It starts once the post has read
+// the previous AO, and runs while the graphics queue rasterizes the next frame.
+//
+void HelloVulkan::runComputeAsync(AoControl& aoControl)
+{
+  AsyncFrame&       frame   = m_asyncFrames[m_asyncCur];
+  vk::CommandBuffer cmdBuf  = frame.compCmdBuf;
+  const auto&       gBuffer = m_gBuffer[m_gBufferIndex];
+
+  updateFrame();
+
+  cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  m_debug.beginLabel(cmdBuf, "Async Compute");
+  if(m_asyncQueryPool)
+    cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_asyncQueryPool,
+                          4 * m_asyncCur + 2);
+
+  // Acquiring the G-Buffer and the AO buffer from the graphics queue family
+  std::array<vk::ImageMemoryBarrier, 2> acquire{
+      makeOwnershipBarrier(gBuffer.image, {}, vk::AccessFlagBits::eShaderRead,
+                           m_graphicsQueueIndex, m_compQueueFamily),
+      makeOwnershipBarrier(m_aoBuffer.image, {},
+                           vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                           m_graphicsQueueIndex, m_compQueueFamily)};
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                         vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, acquire);
+
+  // Stop by default after 100'000 samples, but the semaphores and barriers are still needed
+  if(m_frame * aoControl.rtao_samples <= aoControl.max_samples)
+  {
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_compPipeline);
+    cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_compPipelineLayout, 0,
+                              {m_compDescSet[m_gBufferIndex]}, {});
+    aoControl.frame = m_frame;
+    cmdBuf.pushConstants(m_compPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                         sizeof(AoControl), &aoControl);
+    cmdBuf.dispatch((m_size.width + (GROUP_SIZE - 1)) / GROUP_SIZE,
+                    (m_size.height + (GROUP_SIZE - 1)) / GROUP_SIZE, 1);
+  }
+
+  // Releasing the AO buffer to the post of the next frame
+  vk::ImageMemoryBarrier release =
+      makeOwnershipBarrier(m_aoBuffer.image, vk::AccessFlagBits::eShaderWrite, {},
+                           m_compQueueFamily, m_graphicsQueueIndex);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                         vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, {release});
+
+  if(m_asyncQueryPool)
+    cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_asyncQueryPool,
+                          4 * m_asyncCur + 3);
+  m_debug.endLabel(cmdBuf);
+  cmdBuf.end();
+
+  std::array<vk::Semaphore, 2>          waitSemaphores{frame.gBufferReady, frame.aoFree};
+  std::array<vk::PipelineStageFlags, 2> waitStages{vk::PipelineStageFlagBits::eComputeShader,
+                                                   vk::PipelineStageFlagBits::eComputeShader};
+  std::array<vk::Semaphore, 2> signalSemaphores{frame.aoReady, m_gBufferFree[m_gBufferIndex]};
+
+  vk::SubmitInfo submitInfo;
+  submitInfo.setWaitSemaphoreCount(static_cast<uint32_t>(waitSemaphores.size()));
+  submitInfo.setPWaitSemaphores(waitSemaphores.data());
+  submitInfo.setPWaitDstStageMask(waitStages.data());
+  submitInfo.setCommandBufferCount(1);
+  submitInfo.setPCommandBuffers(&cmdBuf);
+  submitInfo.setSignalSemaphoreCount(static_cast<uint32_t>(signalSemaphores.size()));
+  submitInfo.setPSignalSemaphores(signalSemaphores.data());
+  m_compQueue.submit(submitInfo, frame.compFence);
+
+  m_gBufferFreePending[m_gBufferIndex] = true;
+  m_aoPending                          = true;
+}
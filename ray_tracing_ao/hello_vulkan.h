@@ -25,17 +25,23 @@
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/memallocator_dma_vk.hpp"
 
+#include "gpu_profiler.h"
+#include "sample_sequences.h"
+
+#include <array>
+
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
 
 struct AoControl
 {
-  float rtao_radius{2.0f};       // Length of the ray
-  int   rtao_samples{4};         // Nb samples at each iteration
-  float rtao_power{3.0f};        // Darkness is stronger for more hits
-  int   rtao_distance_based{1};  // Attenuate based on distance
-  int   frame{0};                // Current frame
-  int   max_samples{100'000};    // Max samples before it stops
+  float rtao_radius{2.0f};                     // Length of the ray
+  int   rtao_samples{4};                       // Nb samples at each iteration
+  float rtao_power{3.0f};                      // Darkness is stronger for more hits
+  int   rtao_distance_based{1};                // Attenuate based on distance
+  int   frame{0};                              // Current frame
+  int   max_samples{100'000};                  // Max samples before it stops
+  int   sampler_type{SampleSequence::eSobol};  // Sequence of the hemisphere samples
 };
 
 
@@ -115,6 +121,8 @@ public:
   nvvk::ResourceAllocatorDma m_alloc;  // Allocator for buffer, images, acceleration structures
   nvvk::DebugUtil            m_debug;  // Utility to name objects
 
+  GpuProfiler m_profiler;  // GPU timestamps of each pass
+
   // #Post
   void createOffscreenRender();
   void createPostPipeline();
@@ -129,39 +137,108 @@ public:
   vk::Pipeline                m_postPipeline;
   vk::PipelineLayout          m_postPipelineLayout;
   vk::RenderPass              m_offscreenRenderPass;
-  vk::Framebuffer             m_offscreenFramebuffer;
   nvvk::Texture               m_offscreenColor;
-  nvvk::Texture               m_gBuffer;
   nvvk::Texture               m_aoBuffer;
   vk::Format                  m_offscreenColorFormat{vk::Format::eR32G32B32A32Sfloat};
   nvvk::Texture               m_offscreenDepth;
   vk::Format                  m_offscreenDepthFormat{vk::Format::eX8D24UnormPack32};
 
+  // Two G-Buffers: with async compute, the AO of a frame reads one while the next frame is
+  // rasterized in the other. The synchronous path only uses the first one.
+  std::array<nvvk::Texture, 2>   m_gBuffer;
+  std::array<vk::Framebuffer, 2> m_offscreenFramebuffer;
+  uint32_t                       m_gBufferIndex{0};  // G-Buffer rendered in the current frame
+
   // #Tuto_rayquery
   void initRayTracing();
   auto objectToVkGeometryKHR(const ObjModel& model);
   void createBottomLevelAS();
   void createTopLevelAS();
+  nvvk::Buffer   createSharedBuffer(vk::DeviceSize          size,
+                                    vk::BufferUsageFlags    usage,
+                                    vk::MemoryPropertyFlags memProps);
+  nvvk::AccelKHR createAccel(vk::AccelerationStructureTypeKHR type, vk::DeviceSize size);
+
+  vk::PhysicalDeviceRayTracingPipelinePropertiesKHR     m_rtProperties;
+  vk::PhysicalDeviceAccelerationStructurePropertiesKHR m_asProperties;
 
-  vk::PhysicalDeviceRayTracingPipelinePropertiesKHR m_rtProperties;
-  nvvk::RaytracingBuilderKHR                        m_rtBuilder;
+  // Built here rather than with nvvk::RaytracingBuilderKHR: in async mode, ao.comp traces them
+  // on the compute queue family, so their buffers are shared with it (see createSharedBuffer)
+  std::vector<nvvk::AccelKHR> m_blas;  // One per model
+  nvvk::AccelKHR              m_tlas;
 
 
   // #Tuto_animation
+  void createBlueNoiseTexture();
   void createCompDescriptors();
   void updateCompDescriptors();
   void createCompPipelines();
   void runCompute(vk::CommandBuffer cmdBuf, AoControl& aoControl);
 
-  nvvk::DescriptorSetBindings m_compDescSetLayoutBind;
-  vk::DescriptorPool          m_compDescPool;
-  vk::DescriptorSetLayout     m_compDescSetLayout;
-  vk::DescriptorSet           m_compDescSet;
-  vk::Pipeline                m_compPipeline;
-  vk::PipelineLayout          m_compPipelineLayout;
+  nvvk::DescriptorSetBindings      m_compDescSetLayoutBind;
+  vk::DescriptorPool               m_compDescPool;
+  vk::DescriptorSetLayout          m_compDescSetLayout;
+  std::array<vk::DescriptorSet, 2> m_compDescSet;  // One per G-Buffer
+  nvvk::Texture                    m_blueNoise;     // Ranks of SampleSequence::eBlueNoise
+  vk::Pipeline                     m_compPipeline;
+  vk::PipelineLayout               m_compPipelineLayout;
 
   // #Tuto_jitter_cam
   void updateFrame();
   void resetFrame();
   int  m_frame{0};
+
+  // #Async_compute
+  // The AO runs on a dedicated compute queue. A frame is split in three submissions:
+  // - raster (graphics): renders the G-Buffer, signals `gBufferReady`
+  // - post (graphics): waits the AO of the previous frame, signals `aoFree` once it has read it
+  // - AO (compute): waits `gBufferReady` and `aoFree`, signals `aoReady` for the next post
+  // The AO of frame N therefore runs while frame N+1 is rasterized.
+  // Images are exclusive: ownership is released and acquired when crossing queue families.
+  struct AsyncTimings
+  {
+    double   rasterMs{0};   // Raster of a frame
+    double   computeMs{0};  // AO of the previous frame
+    double   overlapMs{0};  // Time both were running
+    uint64_t count{0};
+  };
+
+  void setupAsyncCompute(vk::Queue computeQueue, uint32_t computeQueueFamily, uint32_t nbFrames);
+  void destroyAsyncCompute();
+  void resetAsyncCompute();
+  bool isAsyncComputeSupported() const { return static_cast<bool>(m_compQueue); }
+  vk::CommandBuffer beginAsyncRaster();
+  void              submitAsyncRaster(vk::CommandBuffer cmdBuf);
+  void              acquireAoBuffer(vk::CommandBuffer cmdBuf);
+  void              releaseAoBuffer(vk::CommandBuffer cmdBuf);
+  void              submitFrameAsync();
+  void              runComputeAsync(AoControl& aoControl);
+
+  struct AsyncFrame
+  {
+    vk::CommandBuffer rasterCmdBuf;  // Graphics queue
+    vk::CommandBuffer compCmdBuf;    // Compute queue
+    vk::Fence         compFence;     // Signaled when the three submissions are done
+    vk::Semaphore     gBufferReady;
+    vk::Semaphore     aoFree;
+    vk::Semaphore     aoReady;
+    bool              submitted{false};
+  };
+
+  bool                         m_asyncCompute{false};
+  vk::Queue                    m_compQueue;
+  uint32_t                     m_compQueueFamily{0};
+  vk::CommandPool              m_asyncGraphicsPool;
+  vk::CommandPool              m_asyncComputePool;
+  std::vector<AsyncFrame>      m_asyncFrames;
+  uint32_t                     m_asyncCur{0};
+  uint64_t                     m_asyncFrameNumber{0};
+  std::array<vk::Semaphore, 2> m_gBufferFree;  // AO done reading a G-Buffer
+  std::array<bool, 2>          m_gBufferFreePending{false, false};
+  bool                         m_aoPending{false};  // An AO result waits for the next post
+  vk::QueryPool                m_asyncQueryPool;    // 4 timestamps per frame
+  double                       m_timestampPeriod{1.0};  // Nanoseconds per tick
+  uint64_t                     m_timestampMask{~0ULL};
+  std::array<uint64_t, 2>      m_prevCompute{0, 0};  // AO timestamps of the previous frame
+  AsyncTimings                 m_asyncTimings;
 };
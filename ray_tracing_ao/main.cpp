@@ -39,6 +39,7 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 #include "nvvk/appbase_vkpp.hpp"
 #include "nvvk/commands_vk.hpp"
 #include "nvvk/context_vk.hpp"
+#include "trace_events.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -67,6 +68,10 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat3("Position", &helloVk.m_pushConstant.lightPosition.x, -20.f, 20.f);
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
   }
+  if(ImGui::CollapsingHeader("GPU Profiler"))
+  {
+    helloVk.m_profiler.renderUI();
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -81,6 +86,7 @@ static int const SAMPLE_HEIGHT = 720;
 int main(int argc, char** argv)
 {
   UNUSED(argc);
+  TraceScope traceStartup("Startup");
 
   // Setup GLFW window
   glfwSetErrorCallback(onErrorCallback);
@@ -143,6 +149,7 @@ int main(int argc, char** argv)
 
 
   // Creating Vulkan base application
+  TraceScope    traceContext("Vulkan context");
   nvvk::Context vkctx{};
   vkctx.initInstance(contextInfo);
   // Find all compatible devices
@@ -150,6 +157,7 @@ int main(int argc, char** argv)
   assert(!compatibleDevices.empty());
   // Use a compatible device
   vkctx.initDevice(compatibleDevices[0], contextInfo);
+  traceContext.end();
 
 
   // Create example
@@ -162,6 +170,10 @@ int main(int argc, char** argv)
   helloVk.setup(vkctx.m_instance, vkctx.m_device, vkctx.m_physicalDevice,
                 vkctx.m_queueGCT.familyIndex);
   helloVk.createSwapchain(surface, SAMPLE_WIDTH, SAMPLE_HEIGHT);
+  helloVk.m_profiler.setup(vkctx.m_device, vkctx.m_physicalDevice, vkctx.m_queueGCT.familyIndex,
+                           static_cast<uint32_t>(helloVk.getCommandBuffers().size()));
+  helloVk.setupAsyncCompute(vkctx.m_queueC.queue, vkctx.m_queueC.familyIndex,
+                            static_cast<uint32_t>(helloVk.getCommandBuffers().size()));
   helloVk.createDepthBuffer();
   helloVk.createRenderPass();
   helloVk.createFrameBuffers();
@@ -194,6 +206,7 @@ int main(int argc, char** argv)
   helloVk.updatePostDescriptorSet();
 
 
+  helloVk.createBlueNoiseTexture();
   helloVk.createCompDescriptors();
   helloVk.updateCompDescriptors();
   helloVk.createCompPipelines();
@@ -201,6 +214,12 @@ int main(int argc, char** argv)
 
   nvmath::vec4f clearColor = nvmath::vec4f(0, 0, 0, 0);
 
+  // Writing the trace of the startup, to be opened in chrome://tracing or ui.perfetto.dev
+  traceStartup.end();
+  if(TraceRecorder::get().dump("load_trace.json"))
+    LOGI("Startup trace written to load_trace.json\n");
+  TraceRecorder::get().setEnabled(false);
+
   helloVk.setupGlfwCallbacks(window);
   ImGui_ImplGlfw_InitForVulkan(window, true);
 
@@ -237,8 +256,32 @@ int main(int argc, char** argv)
           changed |= ImGui::SliderFloat("Power", &aoControl.rtao_power, 1, 5);
           changed |= ImGui::InputInt("Max Samples", &aoControl.max_samples);
           changed |= ImGui::Checkbox("Distanced Based", (bool*)&aoControl.rtao_distance_based);
+          static const char* samplers[] = {"White noise", "Sobol (Owen)", "R2", "Blue noise + R2"};
+          changed |= ImGui::Combo("Sampler", &aoControl.sampler_type, samplers,
+                                  IM_ARRAYSIZE(samplers));
           if(changed)
             helloVk.resetFrame();
+
+          // The AO of a frame runs on the compute queue while the next frame is rasterized
+          if(helloVk.isAsyncComputeSupported())
+          {
+            if(ImGui::Checkbox("Async Compute", &helloVk.m_asyncCompute))
+            {
+              helloVk.resetAsyncCompute();
+              helloVk.resetFrame();
+            }
+            if(helloVk.m_asyncCompute && helloVk.m_asyncTimings.count > 0)
+            {
+              const auto& t = helloVk.m_asyncTimings;
+              ImGui::Text("Raster %.3f ms, AO %.3f ms", t.rasterMs, t.computeMs);
+              ImGui::Text("AO overlapped with raster: %.3f ms (%.0f%%)", t.overlapMs,
+                          t.computeMs > 0 ? 100.0 * t.overlapMs / t.computeMs : 0.0);
+            }
+          }
+          else
+          {
+            ImGui::TextDisabled("Async Compute: no separate compute queue");
+          }
         }
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
@@ -253,11 +296,17 @@ int main(int argc, char** argv)
       // Start command buffer of this frame
       auto                     curFrame = helloVk.getCurFrame();
       const vk::CommandBuffer& cmdBuf   = helloVk.getCommandBuffers()[curFrame];
+      bool                     async    = helloVk.m_asyncCompute;
 
-      cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+      // In async mode, the raster is a submission of its own so the compute queue can start as
+      // soon as the G-Buffer is done
+      vk::CommandBuffer rasterCmdBuf = async ? helloVk.beginAsyncRaster() : cmdBuf;
+      if(!async)
+        cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+      helloVk.m_profiler.beginFrame(rasterCmdBuf, curFrame);
 
       // Updating camera buffer
-      helloVk.updateUniformBuffer(cmdBuf);
+      helloVk.updateUniformBuffer(rasterCmdBuf);
 
       // Clearing screen
       std::array<vk::ClearValue, 3> clearValues;
@@ -273,15 +322,26 @@ int main(int argc, char** argv)
         offscreenRenderPassBeginInfo.setClearValueCount(3);
         offscreenRenderPassBeginInfo.setPClearValues(clearValues.data());
         offscreenRenderPassBeginInfo.setRenderPass(helloVk.m_offscreenRenderPass);
-        offscreenRenderPassBeginInfo.setFramebuffer(helloVk.m_offscreenFramebuffer);
+        offscreenRenderPassBeginInfo.setFramebuffer(
+            helloVk.m_offscreenFramebuffer[helloVk.m_gBufferIndex]);
         offscreenRenderPassBeginInfo.setRenderArea({{}, helloVk.getSize()});
 
         // Rendering Scene
         {
-          cmdBuf.beginRenderPass(offscreenRenderPassBeginInfo, vk::SubpassContents::eInline);
-          helloVk.rasterize(cmdBuf);
-          cmdBuf.endRenderPass();
-          helloVk.runCompute(cmdBuf, aoControl);
+          rasterCmdBuf.beginRenderPass(offscreenRenderPassBeginInfo,
+                                       vk::SubpassContents::eInline);
+          helloVk.rasterize(rasterCmdBuf);
+          rasterCmdBuf.endRenderPass();
+          if(async)
+          {
+            helloVk.submitAsyncRaster(rasterCmdBuf);
+            cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            helloVk.acquireAoBuffer(cmdBuf);
+          }
+          else
+          {
+            helloVk.runCompute(cmdBuf, aoControl);
+          }
         }
       }
 
@@ -305,8 +365,19 @@ int main(int argc, char** argv)
       }
 
       // Submit for display
-      cmdBuf.end();
-      helloVk.submitFrame();
+      if(async)
+      {
+        // The AO of this frame is displayed by the next one
+        helloVk.releaseAoBuffer(cmdBuf);
+        cmdBuf.end();
+        helloVk.submitFrameAsync();
+        helloVk.runComputeAsync(aoControl);
+      }
+      else
+      {
+        cmdBuf.end();
+        helloVk.submitFrame();
+      }
     }
     catch(const std::system_error& e)
     {
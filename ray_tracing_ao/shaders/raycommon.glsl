@@ -129,6 +129,16 @@ void ComputeDefaultBasis(const vec3 normal, out vec3 x, out vec3 y)
 // Random
 //-------------------------------------------------------------------------------------------------
 
+// State of the sample sequences (sampler.glsl)
+struct Sampler
+{
+  uint  type;
+  uvec2 pixel;
+  uint  index;      // Sample of the pixel
+  uint  dimension;  // Pairs of dimensions consumed
+  uint  seed;       // Pixel hash, or state of the white noise
+};
+
 
 // Generate a random unsigned int from two unsigned int values, using 16 pairs
 // of rounds of the Tiny Encryption Algorithm. See Zafar, Olano, and Curtis,
@@ -18,7 +18,10 @@
  */
 
 
+#include <array>
+#include <map>
 #include <sstream>
+#include <unordered_map>
 #include <vulkan/vulkan.hpp>
 
 extern std::vector<std::string> defaultSearchPaths;
@@ -39,6 +42,8 @@ extern std::vector<std::string> defaultSearchPaths;
 #include "nvvk/pipeline_vk.hpp"
 #include "nvvk/renderpasses_vk.hpp"
 #include "nvvk/shaders_vk.hpp"
+#include "mapped_file.h"
+#include "trace_events.h"
 
 #include "nvh/alignment.hpp"
 #include "shaders/binding.glsl"
@@ -67,6 +72,7 @@ void HelloVulkan::setup(const vk::Instance&       instance,
   AppBase::setup(instance, device, physicalDevice, queueFamily);
   m_alloc.init(device, physicalDevice);
   m_debug.setup(m_device);
+  m_memStats.setup(device, physicalDevice);
   m_offscreenDepthFormat = nvvk::findDepthFormat(physicalDevice);
 }
 
@@ -126,20 +132,37 @@ void HelloVulkan::createDescriptorSetLayout()
 
   auto& bind = m_descSetLayoutBind;
   // Camera matrices (binding = 0)
-  bind.addBinding(vkDS(B_CAMERA, vkDT::eUniformBuffer, 1, vkSS::eVertex | vkSS::eRaygenKHR));
+  // The compute path tracer (pathtrace.comp) uses the same bindings as the hit shaders
   bind.addBinding(
-      vkDS(B_VERTICES, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR | vkSS::eAnyHitKHR));
+      vkDS(B_CAMERA, vkDT::eUniformBuffer, 1, vkSS::eVertex | vkSS::eRaygenKHR | vkSS::eCompute));
+  bind.addBinding(vkDS(B_VERTICES, vkDT::eStorageBuffer, 1,
+                       vkSS::eClosestHitKHR | vkSS::eAnyHitKHR | vkSS::eCompute));
+  bind.addBinding(vkDS(B_INDICES, vkDT::eStorageBuffer, 1,
+                       vkSS::eClosestHitKHR | vkSS::eAnyHitKHR | vkSS::eCompute));
   bind.addBinding(
-      vkDS(B_INDICES, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR | vkSS::eAnyHitKHR));
-  bind.addBinding(vkDS(B_NORMALS, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR));
-  bind.addBinding(vkDS(B_TEXCOORDS, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR));
+      vkDS(B_NORMALS, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR | vkSS::eCompute));
+  bind.addBinding(
+      vkDS(B_TEXCOORDS, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR | vkSS::eCompute));
   bind.addBinding(vkDS(B_MATERIALS, vkDT::eStorageBuffer, 1,
-                       vkSS::eFragment | vkSS::eClosestHitKHR | vkSS::eAnyHitKHR));
+                       vkSS::eFragment | vkSS::eClosestHitKHR | vkSS::eAnyHitKHR | vkSS::eCompute));
   bind.addBinding(vkDS(B_MATRICES, vkDT::eStorageBuffer, 1,
                        vkSS::eVertex | vkSS::eClosestHitKHR | vkSS::eAnyHitKHR));
   auto nbTextures = static_cast<uint32_t>(m_textures.size());
   bind.addBinding(vkDS(B_TEXTURES, vkDT::eCombinedImageSampler, nbTextures,
-                       vkSS::eFragment | vkSS::eClosestHitKHR | vkSS::eAnyHitKHR));
+                       vkSS::eFragment | vkSS::eClosestHitKHR | vkSS::eAnyHitKHR | vkSS::eCompute));
+  // Light sampling (next event estimation)
+  bind.addBinding(
+      vkDS(B_EMITTERS, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR | vkSS::eCompute));
+  bind.addBinding(
+      vkDS(B_EMITTER_ALIAS, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR | vkSS::eCompute));
+  // Sample sequences
+  bind.addBinding(vkDS(B_BLUE_NOISE, vkDT::eCombinedImageSampler, 1,
+                       vkSS::eRaygenKHR | vkSS::eClosestHitKHR | vkSS::eCompute));
+  // Radiance cache
+  bind.addBinding(vkDS(B_RADIANCE_CACHE, vkDT::eStorageBuffer, 1,
+                       vkSS::eRaygenKHR | vkSS::eClosestHitKHR | vkSS::eCompute));
+  bind.addBinding(vkDS(B_CACHE_COUNTERS, vkDT::eStorageBuffer, 1,
+                       vkSS::eRaygenKHR | vkSS::eClosestHitKHR | vkSS::eCompute));
 
 
   m_descSetLayout = m_descSetLayoutBind.createLayout(m_device);
@@ -162,6 +185,10 @@ void HelloVulkan::updateDescriptorSet()
   vk::DescriptorBufferInfo uvDesc{m_uvBuffer.buffer, 0, VK_WHOLE_SIZE};
   vk::DescriptorBufferInfo materialDesc{m_materialBuffer.buffer, 0, VK_WHOLE_SIZE};
   vk::DescriptorBufferInfo matrixDesc{m_matrixBuffer.buffer, 0, VK_WHOLE_SIZE};
+  vk::DescriptorBufferInfo emitterDesc{m_emitterBuffer.buffer, 0, VK_WHOLE_SIZE};
+  vk::DescriptorBufferInfo aliasDesc{m_emitterAliasBuffer.buffer, 0, VK_WHOLE_SIZE};
+  vk::DescriptorBufferInfo cacheDesc{m_cacheBuffer.buffer, 0, VK_WHOLE_SIZE};
+  vk::DescriptorBufferInfo counterDesc{m_cacheCounterBuffer.buffer, 0, VK_WHOLE_SIZE};
 
   writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_CAMERA, &dbiUnif));
   writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_VERTICES, &vertexDesc));
@@ -170,6 +197,12 @@ void HelloVulkan::updateDescriptorSet()
   writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_TEXCOORDS, &uvDesc));
   writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_MATERIALS, &materialDesc));
   writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_MATRICES, &matrixDesc));
+  writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_EMITTERS, &emitterDesc));
+  writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_EMITTER_ALIAS, &aliasDesc));
+  writes.emplace_back(
+      m_descSetLayoutBind.makeWrite(m_descSet, B_BLUE_NOISE, &m_blueNoise.descriptor));
+  writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_RADIANCE_CACHE, &cacheDesc));
+  writes.emplace_back(m_descSetLayoutBind.makeWrite(m_descSet, B_CACHE_COUNTERS, &counterDesc));
 
   // All texture samplers
   std::vector<vk::DescriptorImageInfo> diit;
@@ -186,6 +219,8 @@ void HelloVulkan::updateDescriptorSet()
 //
 void HelloVulkan::createGraphicsPipeline()
 {
+  TRACE_SCOPE("createGraphicsPipeline");
+
   using vkSS = vk::ShaderStageFlagBits;
 
   vk::PushConstantRange pushConstantRanges = {vkSS::eVertex | vkSS::eFragment, 0,
@@ -218,40 +253,229 @@ void HelloVulkan::createGraphicsPipeline()
 }
 
 //--------------------------------------------------------------------------------------------------
-// Loading the OBJ file and setting up all buffers
+// Images are decoded by tinygltf while parsing the file, the default loader is wrapped to
+// get the decoding time of each image in the load trace.
+//
+static bool tracedLoadImageData(tinygltf::Image*     image,
+                                const int            imageIdx,
+                                std::string*         err,
+                                std::string*         warn,
+                                int                  reqWidth,
+                                int                  reqHeight,
+                                const unsigned char* bytes,
+                                int                  size,
+                                void*                userData)
+{
+  TRACE_SCOPE("Texture decode", image->uri.empty() ? image->name : image->uri);
+  return tinygltf::LoadImageData(image, imageIdx, err, warn, reqWidth, reqHeight, bytes, size,
+                                 userData);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Finding the BIN chunk of a .glb file (header, JSON chunk, optional BIN chunk)
+//
+static const uint8_t* findGlbBinChunk(const MappedFile& file, size_t& binSize)
+{
+  auto readU32 = [&](size_t offset) {
+    uint32_t value = 0;
+    memcpy(&value, file.data() + offset, sizeof(uint32_t));
+    return value;
+  };
+
+  binSize = 0;
+  if(file.size() < 20 || readU32(0) != 0x46546C67)  // 'glTF'
+    return nullptr;
+  size_t binHeader = 20 + static_cast<size_t>(readU32(12));  // After the JSON chunk
+  if(binHeader + 8 > file.size() || readU32(binHeader + 4) != 0x004E4942)  // 'BIN'
+    return nullptr;
+  binSize = std::min<size_t>(readU32(binHeader), file.size() - binHeader - 8);
+  return file.data() + binHeader + 8;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Returns where the data of the accessor is in the BIN chunk, if it can be copied as is: the
+// expected type, not sparse, tightly packed and stored in the GLB buffer. nullptr otherwise.
+//
+static const uint8_t* directAccessorData(const tinygltf::Model& tmodel,
+                                         int                    accessorIndex,
+                                         int                    type,
+                                         int                    componentType,
+                                         size_t                 elementSize,
+                                         const uint8_t*         bin,
+                                         size_t                 binSize)
+{
+  if(accessorIndex < 0)
+    return nullptr;
+  const tinygltf::Accessor& accessor = tmodel.accessors[accessorIndex];
+  if(accessor.type != type || accessor.componentType != componentType
+     || accessor.sparse.isSparse || accessor.bufferView < 0)
+    return nullptr;
+
+  // Only the first buffer, without uri, is the BIN chunk of the .glb
+  const tinygltf::BufferView& view = tmodel.bufferViews[accessor.bufferView];
+  if(view.buffer != 0 || !tmodel.buffers[0].uri.empty())
+    return nullptr;
+  if(view.byteStride != 0 && view.byteStride != elementSize)
+    return nullptr;
+
+  size_t offset = view.byteOffset + accessor.byteOffset;
+  if(offset + accessor.count * elementSize > binSize)
+    return nullptr;
+  return bin + offset;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Creating the vertex and index buffers of a .glb, writing directly in the staging memory.
+// Positions (float3) and indices (uint32) already in the device layout are copied from the
+// mapped BIN chunk, the other primitives (other types, interleaved, generated indices, ...) are
+// copied from the arrays of the imported scene.
+//
+void HelloVulkan::createGeometryBuffers(const vk::CommandBuffer& cmdBuf,
+                                        const tinygltf::Model&   tmodel,
+                                        const uint8_t*           bin,
+                                        size_t                   binSize)
+{
+  using vkBU = vk::BufferUsageFlagBits;
+  TRACE_SCOPE("Direct geometry staging");
+
+  // Finding the glTF primitive of each primitive mesh, in the order used by the import
+  std::vector<const tinygltf::Primitive*> sources(m_gltfScene.m_primMeshes.size(), nullptr);
+  for(auto& meshPrims : m_gltfScene.m_meshToPrimMeshes)
+  {
+    const tinygltf::Mesh& mesh = tmodel.meshes[meshPrims.first];
+    size_t                next = 0;
+    for(const auto& primitive : mesh.primitives)
+    {
+      if(primitive.mode != TINYGLTF_MODE_TRIANGLES)
+        continue;  // Not imported
+      if(next < meshPrims.second.size() && sources[meshPrims.second[next]] == nullptr)
+        sources[meshPrims.second[next]] = &primitive;
+      next++;
+    }
+  }
+
+  vk::DeviceSize posSize = m_gltfScene.m_positions.size() * sizeof(nvmath::vec3f);
+  vk::DeviceSize idxSize = m_gltfScene.m_indices.size() * sizeof(uint32_t);
+  vk::BufferUsageFlags rtUsage = vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
+                                 | vkBU::eAccelerationStructureBuildInputReadOnlyKHR
+                                 | vkBU::eTransferDst;
+  m_vertexBuffer = m_alloc.createBuffer(posSize, rtUsage | vkBU::eVertexBuffer);
+  m_indexBuffer  = m_alloc.createBuffer(idxSize, rtUsage | vkBU::eIndexBuffer);
+
+  auto* positions = m_alloc.getStaging()->cmdToBufferT<nvmath::vec3f>(
+      cmdBuf, m_vertexBuffer.buffer, 0, posSize);
+  auto* indices =
+      m_alloc.getStaging()->cmdToBufferT<uint32_t>(cmdBuf, m_indexBuffer.buffer, 0, idxSize);
+
+  uint32_t directPrims = 0;
+  for(size_t p = 0; p < m_gltfScene.m_primMeshes.size(); p++)
+  {
+    const nvh::GltfPrimMesh&   prim   = m_gltfScene.m_primMeshes[p];
+    const tinygltf::Primitive* source = sources[p];
+
+    const uint8_t* srcPos = nullptr;
+    const uint8_t* srcIdx = nullptr;
+    if(source != nullptr)
+    {
+      auto posIt = source->attributes.find("POSITION");
+      if(posIt != source->attributes.end()
+         && tmodel.accessors[posIt->second].count == prim.vertexCount)
+        srcPos = directAccessorData(tmodel, posIt->second, TINYGLTF_TYPE_VEC3,
+                                    TINYGLTF_COMPONENT_TYPE_FLOAT, sizeof(nvmath::vec3f), bin,
+                                    binSize);
+      if(source->indices >= 0 && tmodel.accessors[source->indices].count == prim.indexCount)
+        srcIdx = directAccessorData(tmodel, source->indices, TINYGLTF_TYPE_SCALAR,
+                                    TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, sizeof(uint32_t), bin,
+                                    binSize);
+    }
+
+    if(srcPos != nullptr && srcIdx != nullptr)
+      directPrims++;
+    if(srcPos == nullptr)
+      srcPos = reinterpret_cast<const uint8_t*>(&m_gltfScene.m_positions[prim.vertexOffset]);
+    if(srcIdx == nullptr)
+      srcIdx = reinterpret_cast<const uint8_t*>(&m_gltfScene.m_indices[prim.firstIndex]);
+
+    memcpy(positions + prim.vertexOffset, srcPos, prim.vertexCount * sizeof(nvmath::vec3f));
+    memcpy(indices + prim.firstIndex, srcIdx, prim.indexCount * sizeof(uint32_t));
+  }
+  LOGI("Geometry copied from the mapped file for %u of %u primitives", directPrims,
+       static_cast<uint32_t>(m_gltfScene.m_primMeshes.size()));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Loading the glTF (.gltf or .glb) file and setting up all buffers
 //
 void HelloVulkan::loadScene(const std::string& filename)
 {
+  TRACE_SCOPE("loadScene", filename);
+
   using vkBU = vk::BufferUsageFlagBits;
   tinygltf::Model    tmodel;
   tinygltf::TinyGLTF tcontext;
   std::string        warn, error;
 
+  // Binary glTF is mapped in memory; the mapping is kept until the geometry is staged
+  bool isGlb = filename.size() > 4
+               && (filename.compare(filename.size() - 4, 4, ".glb") == 0
+                   || filename.compare(filename.size() - 4, 4, ".GLB") == 0);
+  MappedFile     glbFile;
+  const uint8_t* binChunk = nullptr;
+  size_t         binSize  = 0;
+
   LOGI("Loading file: %s", filename.c_str());
-  if(!tcontext.LoadASCIIFromFile(&tmodel, &error, &warn, filename))
+  tcontext.SetImageLoader(tracedLoadImageData, nullptr);
+  TraceScope parse("glTF parse");
+  bool loaded = false;
+  if(isGlb)
+  {
+    std::string baseDir = filename.substr(0, filename.find_last_of("/\\") + 1);
+    if(glbFile.open(filename))
+    {
+      loaded   = tcontext.LoadBinaryFromMemory(&tmodel, &error, &warn, glbFile.data(),
+                                             static_cast<unsigned int>(glbFile.size()), baseDir);
+      binChunk = findGlbBinChunk(glbFile, binSize);
+    }
+  }
+  else
+  {
+    loaded = tcontext.LoadASCIIFromFile(&tmodel, &error, &warn, filename);
+  }
+  if(!loaded)
   {
     assert(!"Error while loading scene");
   }
+  parse.end();
   LOGW(warn.c_str());
   LOGE(error.c_str());
 
 
+  TraceScope importScene("glTF import");
   m_gltfScene.importMaterials(tmodel);
   m_gltfScene.importDrawableNodes(tmodel,
                                   nvh::GltfAttributes::Normal | nvh::GltfAttributes::Texcoord_0);
+  importScene.end();
 
   // Create the buffers on Device and copy vertices, indices and materials
   nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
   vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
 
-  m_vertexBuffer =
-      m_alloc.createBuffer(cmdBuf, m_gltfScene.m_positions,
-                           vkBU::eVertexBuffer | vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
-                               | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
-  m_indexBuffer =
-      m_alloc.createBuffer(cmdBuf, m_gltfScene.m_indices,
-                           vkBU::eIndexBuffer | vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
-                               | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
+  TraceScope staging("Staging copies");
+  if(binChunk != nullptr)
+  {
+    createGeometryBuffers(cmdBuf, tmodel, binChunk, binSize);
+  }
+  else
+  {
+    m_vertexBuffer =
+        m_alloc.createBuffer(cmdBuf, m_gltfScene.m_positions,
+                             vkBU::eVertexBuffer | vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
+                                 | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
+    m_indexBuffer =
+        m_alloc.createBuffer(cmdBuf, m_gltfScene.m_indices,
+                             vkBU::eIndexBuffer | vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
+                                 | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
+  }
   m_normalBuffer = m_alloc.createBuffer(cmdBuf, m_gltfScene.m_normals,
                                         vkBU::eVertexBuffer | vkBU::eStorageBuffer);
   m_uvBuffer     = m_alloc.createBuffer(cmdBuf, m_gltfScene.m_texcoords0,
@@ -274,27 +498,130 @@ void HelloVulkan::loadScene(const std::string& filename)
   }
   m_matrixBuffer = m_alloc.createBuffer(cmdBuf, nodeMatrices, vkBU::eStorageBuffer);
 
-  // The following is used to find the primitive mesh information in the CHIT
+  // Ray tracing meshes: one BLAS per glTF mesh, with one geometry per primitive, in the order
+  // of the glTF meshes
+  std::map<int, std::vector<uint32_t>> meshes(m_gltfScene.m_meshToPrimMeshes.begin(),
+                                              m_gltfScene.m_meshToPrimMeshes.end());
+  uint32_t firstGeometry = 0;
+  m_rtMeshes.clear();
+  for(auto& mesh : meshes)
+  {
+    m_rtMeshes.push_back({firstGeometry, mesh.second});
+    firstGeometry += static_cast<uint32_t>(mesh.second.size());
+  }
+
+  // The following is used to find the primitive mesh information in the CHIT, with
+  // gl_InstanceCustomIndexEXT (first geometry of the mesh) + gl_GeometryIndexEXT
   std::vector<RtPrimitiveLookup> primLookup;
-  for(auto& primMesh : m_gltfScene.m_primMeshes)
+  for(auto& rtMesh : m_rtMeshes)
   {
-    primLookup.push_back({primMesh.firstIndex, primMesh.vertexOffset, primMesh.materialIndex});
+    for(auto primId : rtMesh.primMeshes)
+    {
+      auto& primMesh = m_gltfScene.m_primMeshes[primId];
+      primLookup.push_back({primMesh.firstIndex, primMesh.vertexOffset, primMesh.materialIndex});
+    }
   }
   m_rtPrimLookup =
       m_alloc.createBuffer(cmdBuf, primLookup, vk::BufferUsageFlagBits::eStorageBuffer);
 
+  createEmitterBuffers(cmdBuf);
+  createRadianceCache(cmdBuf);
+
+  staging.end();
 
   // Creates all textures found
   createTextureImages(cmdBuf, tmodel);
-  cmdBufGet.submitAndWait(cmdBuf);
+  createBlueNoiseTexture(cmdBuf);
+  {
+    TRACE_SCOPE("Submit and wait");
+    cmdBufGet.submitAndWait(cmdBuf);
+  }
   m_alloc.finalizeAndReleaseStaging();
 
   m_debug.setObjectName(m_vertexBuffer.buffer, "Vertex");
   m_debug.setObjectName(m_indexBuffer.buffer, "Index");
   m_debug.setObjectName(m_normalBuffer.buffer, "Normal");
   m_debug.setObjectName(m_uvBuffer.buffer, "TexCoord");
+
+  // All primitives share the same buffers, only the BLAS are accounted per primitive mesh
+  m_memStats.trackBuffer(m_vertexBuffer.buffer, MemCategory::eGeometry);
+  m_memStats.trackBuffer(m_indexBuffer.buffer, MemCategory::eGeometry);
+  m_memStats.trackBuffer(m_normalBuffer.buffer, MemCategory::eGeometry);
+  m_memStats.trackBuffer(m_uvBuffer.buffer, MemCategory::eGeometry);
+  m_memStats.trackBuffer(m_rtPrimLookup.buffer, MemCategory::eGeometry);
+  m_memStats.trackBuffer(m_materialBuffer.buffer, MemCategory::eMaterial);
+  m_memStats.trackBuffer(m_matrixBuffer.buffer, MemCategory::eOther);
+  m_memStats.trackBuffer(m_emitterBuffer.buffer, MemCategory::eOther);
+  m_memStats.trackBuffer(m_emitterAliasBuffer.buffer, MemCategory::eOther);
+  m_memStats.trackBuffer(m_cacheBuffer.buffer, MemCategory::eOther);
+  m_memStats.trackBuffer(m_cacheCounterBuffer.buffer, MemCategory::eOther);
+  m_memStats.trackBuffer(m_cacheReadback.buffer, MemCategory::eOther);
+  for(const auto& texture : m_textures)
+    m_memStats.trackImage(texture.image, MemCategory::eTexture);
+  m_memStats.trackImage(m_blueNoise.image, MemCategory::eTexture);
   m_debug.setObjectName(m_materialBuffer.buffer, "Material");
   m_debug.setObjectName(m_matrixBuffer.buffer, "Matrix");
+  m_debug.setObjectName(m_emitterBuffer.buffer, "Emitters");
+  m_debug.setObjectName(m_emitterAliasBuffer.buffer, "EmitterAlias");
+  m_debug.setObjectName(m_cacheBuffer.buffer, "RadianceCache");
+  m_debug.setObjectName(m_cacheCounterBuffer.buffer, "RadianceCacheCounters");
+}
+
+//--------------------------------------------------------------------------------------------------
+// Next event estimation: every triangle with an emissive material becomes an emitter, transformed
+// in world space by its node. The emitters are sampled proportionally to their power, the
+// luminance of the emission times the area, with an alias table built on all cores.
+// The shaders always need the buffers: without emitter, they hold one unused element.
+//
+void HelloVulkan::createEmitterBuffers(const vk::CommandBuffer& cmdBuf)
+{
+  TRACE_SCOPE("createEmitterBuffers");
+
+  std::vector<Emitter> emitters;
+  std::vector<float>   powers;
+  for(const auto& node : m_gltfScene.m_nodes)
+  {
+    const auto& primMesh = m_gltfScene.m_primMeshes[node.primMesh];
+    // Same material as in the closest hit shader
+    const auto&         material = m_gltfScene.m_materials[std::max(0, primMesh.materialIndex)];
+    const nvmath::vec3f emission = material.emissiveFactor;
+    const float luminance = nvmath::dot(emission, nvmath::vec3f(0.2126f, 0.7152f, 0.0722f));
+    if(luminance <= 0.f)
+      continue;
+
+    for(uint32_t i = 0; i + 2 < primMesh.indexCount; i += 3)
+    {
+      nvmath::vec3f v[3];
+      for(uint32_t k = 0; k < 3; k++)
+      {
+        uint32_t index = primMesh.vertexOffset + m_gltfScene.m_indices[primMesh.firstIndex + i + k];
+        v[k] = nvmath::vec3f(node.worldMatrix * nvmath::vec4f(m_gltfScene.m_positions[index], 1.f));
+      }
+      float area = 0.5f * nvmath::length(nvmath::cross(v[1] - v[0], v[2] - v[0]));
+      if(area <= 0.f)
+        continue;  // Cannot be hit either
+
+      emitters.push_back({nvmath::vec4f(v[0], area), nvmath::vec4f(v[1], 0.f),
+                          nvmath::vec4f(v[2], 0.f), nvmath::vec4f(emission, 0.f)});
+      powers.push_back(luminance * area);
+    }
+  }
+
+  m_emitterTable.build(powers);
+  m_rtPushConstants.nbEmitters = static_cast<int>(m_emitterTable.size());
+  m_rtPushConstants.totalPower = static_cast<float>(m_emitterTable.getTotalWeight());
+  LOGI("%d emissive triangles, total power %g\n", m_rtPushConstants.nbEmitters,
+       m_emitterTable.getTotalWeight());
+
+  std::vector<AliasTable::Entry> entries = m_emitterTable.getEntries();
+  if(m_emitterTable.empty())
+  {
+    emitters = {Emitter{}};
+    entries  = {AliasTable::Entry{}};
+  }
+  m_emitterBuffer = m_alloc.createBuffer(cmdBuf, emitters, vk::BufferUsageFlagBits::eStorageBuffer);
+  m_emitterAliasBuffer =
+      m_alloc.createBuffer(cmdBuf, entries, vk::BufferUsageFlagBits::eStorageBuffer);
 }
 
 
@@ -310,6 +637,7 @@ void HelloVulkan::createUniformBuffer()
   m_cameraMat = m_alloc.createBuffer(sizeof(CameraMatrices),
                                      vkBU::eUniformBuffer | vkBU::eTransferDst, vkMP::eDeviceLocal);
   m_debug.setObjectName(m_cameraMat.buffer, "cameraMat");
+  m_memStats.trackBuffer(m_cameraMat.buffer, MemCategory::eOther);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -365,6 +693,24 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer& cmdBuf, tinygltf:
   }
 }
 
+//--------------------------------------------------------------------------------------------------
+// Tile of blue-noise ranks for the eBlueNoise sample sequence, generated at load. The shaders
+// read it with texelFetch: integer texels, no filtering.
+//
+void HelloVulkan::createBlueNoiseTexture(const vk::CommandBuffer& cmdBuf)
+{
+  TRACE_SCOPE("createBlueNoiseTexture");
+
+  SampleSequence::BlueNoise noise = SampleSequence::generateBlueNoise();
+  vk::ImageCreateInfo       imageCreateInfo =
+      nvvk::makeImage2DCreateInfo(vk::Extent2D{noise.size, noise.size}, vk::Format::eR32Uint);
+  vk::SamplerCreateInfo samplerCreateInfo{
+      {}, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest};
+  m_blueNoise = m_alloc.createTexture(cmdBuf, noise.ranks.size() * sizeof(uint32_t),
+                                      noise.ranks.data(), imageCreateInfo, samplerCreateInfo);
+  m_debug.setObjectName(m_blueNoise.image, "BlueNoise");
+}
+
 //--------------------------------------------------------------------------------------------------
 // Destroying all allocations
 //
@@ -374,39 +720,69 @@ void HelloVulkan::destroyResources()
   m_device.destroy(m_pipelineLayout);
   m_device.destroy(m_descPool);
   m_device.destroy(m_descSetLayout);
+  m_memStats.untrackBuffer(m_cameraMat.buffer);
   m_alloc.destroy(m_cameraMat);
 
+  m_memStats.untrackBuffer(m_vertexBuffer.buffer);
   m_alloc.destroy(m_vertexBuffer);
+  m_memStats.untrackBuffer(m_normalBuffer.buffer);
   m_alloc.destroy(m_normalBuffer);
+  m_memStats.untrackBuffer(m_uvBuffer.buffer);
   m_alloc.destroy(m_uvBuffer);
+  m_memStats.untrackBuffer(m_indexBuffer.buffer);
   m_alloc.destroy(m_indexBuffer);
+  m_memStats.untrackBuffer(m_materialBuffer.buffer);
   m_alloc.destroy(m_materialBuffer);
+  m_memStats.untrackBuffer(m_matrixBuffer.buffer);
   m_alloc.destroy(m_matrixBuffer);
+  m_memStats.untrackBuffer(m_rtPrimLookup.buffer);
   m_alloc.destroy(m_rtPrimLookup);
+  m_memStats.untrackBuffer(m_emitterBuffer.buffer);
+  m_alloc.destroy(m_emitterBuffer);
+  m_memStats.untrackBuffer(m_emitterAliasBuffer.buffer);
+  m_alloc.destroy(m_emitterAliasBuffer);
+  m_memStats.untrackBuffer(m_cacheBuffer.buffer);
+  m_alloc.destroy(m_cacheBuffer);
+  m_memStats.untrackBuffer(m_cacheCounterBuffer.buffer);
+  m_alloc.destroy(m_cacheCounterBuffer);
+  m_memStats.untrackBuffer(m_cacheReadback.buffer);
+  m_alloc.destroy(m_cacheReadback);
 
   for(auto& t : m_textures)
   {
+    m_memStats.untrackImage(t.image);
     m_alloc.destroy(t);
   }
+  m_memStats.untrackImage(m_blueNoise.image);
+  m_alloc.destroy(m_blueNoise);
 
   //#Post
   m_device.destroy(m_postPipeline);
   m_device.destroy(m_postPipelineLayout);
   m_device.destroy(m_postDescPool);
   m_device.destroy(m_postDescSetLayout);
+  m_memStats.untrackImage(m_offscreenColor.image);
   m_alloc.destroy(m_offscreenColor);
+  m_memStats.untrackImage(m_offscreenDepth.image);
   m_alloc.destroy(m_offscreenDepth);
   m_device.destroy(m_offscreenRenderPass);
   m_device.destroy(m_offscreenFramebuffer);
 
   // #VKRay
+  m_memStats.untrackAccelerationStructures();
   m_rtBuilder.destroy();
   m_sbtWrapper.destroy();
   m_device.destroy(m_rtDescPool);
   m_device.destroy(m_rtDescSetLayout);
   m_device.destroy(m_rtPipeline);
   m_device.destroy(m_rtPipelineLayout);
+  for(auto& pipeline : m_compPipelines)
+    m_device.destroy(pipeline);
+  m_device.destroy(m_compPipelineLayout);
+  m_device.destroy(m_cachePipeline);
+  m_device.destroy(m_cachePipelineLayout);
 
+  m_profiler.destroy();
   m_alloc.deinit();
 }
 
@@ -420,6 +796,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
   std::vector<vk::DeviceSize> offsets = {0, 0, 0};
 
   m_debug.beginLabel(cmdBuf, "Rasterize");
+  m_profiler.beginSection(cmdBuf, "Rasterize");
 
   // Dynamic Viewport
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
@@ -447,6 +824,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
     cmdBuf.drawIndexed(primitive.indexCount, 1, primitive.firstIndex, primitive.vertexOffset, 0);
   }
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -470,6 +848,10 @@ void HelloVulkan::onResize(int /*w*/, int /*h*/)
 //
 void HelloVulkan::createOffscreenRender()
 {
+  TRACE_SCOPE("createOffscreenRender");
+
+  m_memStats.untrackImage(m_offscreenColor.image);
+  m_memStats.untrackImage(m_offscreenDepth.image);
   m_alloc.destroy(m_offscreenColor);
   m_alloc.destroy(m_offscreenDepth);
 
@@ -478,7 +860,8 @@ void HelloVulkan::createOffscreenRender()
     auto colorCreateInfo = nvvk::makeImage2DCreateInfo(m_size, m_offscreenColorFormat,
                                                        vk::ImageUsageFlagBits::eColorAttachment
                                                            | vk::ImageUsageFlagBits::eSampled
-                                                           | vk::ImageUsageFlagBits::eStorage);
+                                                           | vk::ImageUsageFlagBits::eStorage
+                                                           | vk::ImageUsageFlagBits::eTransferSrc);
 
 
     nvvk::Image             image  = m_alloc.createImage(colorCreateInfo);
@@ -502,6 +885,8 @@ void HelloVulkan::createOffscreenRender()
 
     m_offscreenDepth = m_alloc.createTexture(image, depthStencilView);
   }
+  m_memStats.trackImage(m_offscreenColor.image, MemCategory::eRenderTarget);
+  m_memStats.trackImage(m_offscreenDepth.image, MemCategory::eRenderTarget);
 
   // Setting the image layout for both color and depth
   {
@@ -544,6 +929,8 @@ void HelloVulkan::createOffscreenRender()
 //
 void HelloVulkan::createPostPipeline()
 {
+  TRACE_SCOPE("createPostPipeline");
+
   // Push constants in the fragment shader
   vk::PushConstantRange pushConstantRanges = {vk::ShaderStageFlagBits::eFragment, 0, sizeof(float)};
 
@@ -600,6 +987,7 @@ void HelloVulkan::updatePostDescriptorSet()
 void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
 {
   m_debug.beginLabel(cmdBuf, "Post");
+  m_profiler.beginSection(cmdBuf, "Post");
 
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
   cmdBuf.setScissor(0, {{{0, 0}, {m_size.width, m_size.height}}});
@@ -612,6 +1000,7 @@ void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
                             m_postDescSet, {});
   cmdBuf.draw(3, 1, 0, 0);
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -670,35 +1059,91 @@ auto HelloVulkan::primitiveToGeometry(const nvh::GltfPrimMesh& prim)
 }
 
 //--------------------------------------------------------------------------------------------------
-//
+// One BLAS per glTF mesh, each primitive of the mesh is a geometry of the BLAS
 //
 void HelloVulkan::createBottomLevelAS()
 {
-  // BLAS - Storing each primitive in a geometry
+  TRACE_SCOPE("createBottomLevelAS");
+
   std::vector<nvvk::RaytracingBuilderKHR::BlasInput> allBlas;
-  allBlas.reserve(m_gltfScene.m_primMeshes.size());
-  for(auto& primMesh : m_gltfScene.m_primMeshes)
+  allBlas.reserve(m_rtMeshes.size());
+  for(auto& rtMesh : m_rtMeshes)
   {
-    auto geo = primitiveToGeometry(primMesh);
-    allBlas.push_back({geo});
+    nvvk::RaytracingBuilderKHR::BlasInput blas;
+    for(auto primId : rtMesh.primMeshes)
+    {
+      auto geo = primitiveToGeometry(m_gltfScene.m_primMeshes[primId]);
+      blas.asGeometry.insert(blas.asGeometry.end(), geo.asGeometry.begin(), geo.asGeometry.end());
+      blas.asBuildOffsetInfo.insert(blas.asBuildOffsetInfo.end(), geo.asBuildOffsetInfo.begin(),
+                                    geo.asBuildOffsetInfo.end());
+    }
+    allBlas.emplace_back(blas);
   }
+  m_memStats.trackBlas(allBlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
   m_rtBuilder.buildBlas(allBlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
 }
 
+//--------------------------------------------------------------------------------------------------
+// One instance per glTF node. The scene has one node per primitive: the nodes of a glTF node
+// are consecutive, share the same matrix and list the primitives of the mesh in order.
+//
 void HelloVulkan::createTopLevelAS()
 {
+  TRACE_SCOPE("createTopLevelAS");
+
+  // Meshes which can start at a node, indexed by their first primitive
+  std::unordered_map<uint32_t, std::vector<uint32_t>> meshesByFirstPrim;
+  for(uint32_t m = 0; m < static_cast<uint32_t>(m_rtMeshes.size()); m++)
+    meshesByFirstPrim[m_rtMeshes[m].primMeshes[0]].push_back(m);
+
+  auto& nodes       = m_gltfScene.m_nodes;
+  auto  matchesMesh = [&](size_t first, const RtMesh& rtMesh) {
+    if(first + rtMesh.primMeshes.size() > nodes.size())
+      return false;
+    for(size_t p = 0; p < rtMesh.primMeshes.size(); p++)
+    {
+      const auto& node = nodes[first + p];
+      if(node.primMesh != rtMesh.primMeshes[p]
+         || memcmp(&node.worldMatrix, &nodes[first].worldMatrix, sizeof(nvmath::mat4f)) != 0)
+        return false;
+    }
+    return true;
+  };
+
   std::vector<nvvk::RaytracingBuilderKHR::Instance> tlas;
-  tlas.reserve(m_gltfScene.m_nodes.size());
-  for(auto& node : m_gltfScene.m_nodes)
+  tlas.reserve(m_rtMeshes.size());
+  for(size_t n = 0; n < nodes.size();)
   {
+    uint32_t meshId = ~0u;
+    for(auto m : meshesByFirstPrim[nodes[n].primMesh])
+    {
+      if(matchesMesh(n, m_rtMeshes[m]))
+      {
+        meshId = m;
+        break;
+      }
+    }
+    if(meshId == ~0u)
+    {
+      LOGE("Node %d does not match a mesh, skipped", static_cast<int>(n));
+      n++;
+      continue;
+    }
+
     nvvk::RaytracingBuilderKHR::Instance rayInst;
-    rayInst.transform        = node.worldMatrix;
-    rayInst.instanceCustomId = node.primMesh;  // gl_InstanceCustomIndexEXT: to find which primitive
-    rayInst.blasId           = node.primMesh;
+    rayInst.transform = nodes[n].worldMatrix;
+    // gl_InstanceCustomIndexEXT + gl_GeometryIndexEXT: to find which primitive
+    rayInst.instanceCustomId = m_rtMeshes[meshId].firstGeometry;
+    rayInst.blasId           = meshId;
     rayInst.flags            = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
     rayInst.hitGroupId       = 0;  // We will use the same hit group for all objects
     tlas.emplace_back(rayInst);
+    n += m_rtMeshes[meshId].primMeshes.size();
   }
+  LOGI("TLAS: %d instances for %d nodes", static_cast<int>(tlas.size()),
+       static_cast<int>(nodes.size()));
+  m_memStats.trackTlas(static_cast<uint32_t>(tlas.size()),
+                       vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
   m_rtBuilder.buildTlas(tlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
 }
 
@@ -711,12 +1156,14 @@ void HelloVulkan::createRtDescriptorSet()
   using vkSS   = vk::ShaderStageFlagBits;
   using vkDSLB = vk::DescriptorSetLayoutBinding;
 
-  m_rtDescSetLayoutBind.addBinding(vkDSLB(0, vkDT::eAccelerationStructureKHR, 1,
-                                          vkSS::eRaygenKHR | vkSS::eClosestHitKHR));  // TLAS
   m_rtDescSetLayoutBind.addBinding(
-      vkDSLB(1, vkDT::eStorageImage, 1, vkSS::eRaygenKHR));  // Output image
-  m_rtDescSetLayoutBind.addBinding(vkDSLB(
-      2, vkDT::eStorageBuffer, 1, vkSS::eClosestHitKHR | vkSS::eAnyHitKHR));  // Primitive info
+      vkDSLB(0, vkDT::eAccelerationStructureKHR, 1,
+             vkSS::eRaygenKHR | vkSS::eClosestHitKHR | vkSS::eCompute));  // TLAS
+  m_rtDescSetLayoutBind.addBinding(
+      vkDSLB(1, vkDT::eStorageImage, 1, vkSS::eRaygenKHR | vkSS::eCompute));  // Output image
+  m_rtDescSetLayoutBind.addBinding(
+      vkDSLB(2, vkDT::eStorageBuffer, 1,
+             vkSS::eClosestHitKHR | vkSS::eAnyHitKHR | vkSS::eCompute));  // Primitive info
 
   m_rtDescPool      = m_rtDescSetLayoutBind.createPool(m_device);
   m_rtDescSetLayout = m_rtDescSetLayoutBind.createLayout(m_device);
@@ -756,9 +1203,13 @@ void HelloVulkan::updateRtDescriptorSet()
 
 //--------------------------------------------------------------------------------------------------
 // Pipeline for the ray tracer: all shaders, raygen, chit, miss
+// - The raygen shader is specialized for each number of samples per launch (1, 2, 4, ...): the
+//   raygen groups come first, and the one of a launch is selected with getRegions()
 //
 void HelloVulkan::createRtPipeline()
 {
+  TRACE_SCOPE("createRtPipeline");
+
   vk::ShaderModule raygenSM = nvvk::createShaderModule(
       m_device, nvh::loadFile("spv/pathtrace.rgen.spv", true, defaultSearchPaths, true));
   vk::ShaderModule missSM = nvvk::createShaderModule(
@@ -772,13 +1223,24 @@ void HelloVulkan::createRtPipeline()
 
   std::vector<vk::PipelineShaderStageCreateInfo> stages;
 
-  // Raygen
-  vk::RayTracingShaderGroupCreateInfoKHR rg{vk::RayTracingShaderGroupTypeKHR::eGeneral,
-                                            VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR,
-                                            VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR};
-  rg.setGeneralShader(static_cast<uint32_t>(stages.size()));
-  stages.push_back({{}, vk::ShaderStageFlagBits::eRaygenKHR, raygenSM, "main"});
-  m_rtShaderGroups.push_back(rg);
+  // Raygen, one per samples per launch: constant_id 0 is SAMPLES_PER_LAUNCH
+  uint32_t nbVariants = SampleBudget::getVariant(s_maxSamplesPerLaunch) + 1;
+  std::vector<int32_t>                samples(nbVariants);
+  std::vector<vk::SpecializationInfo> specializations(nbVariants);
+  vk::SpecializationMapEntry          entry{0, 0, sizeof(int32_t)};
+  for(uint32_t i = 0; i < nbVariants; i++)
+  {
+    samples[i]         = 1 << i;
+    specializations[i] = vk::SpecializationInfo{1, &entry, sizeof(int32_t), &samples[i]};
+
+    vk::RayTracingShaderGroupCreateInfoKHR rg{vk::RayTracingShaderGroupTypeKHR::eGeneral,
+                                              VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR,
+                                              VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR};
+    rg.setGeneralShader(static_cast<uint32_t>(stages.size()));
+    stages.push_back(
+        {{}, vk::ShaderStageFlagBits::eRaygenKHR, raygenSM, "main", &specializations[i]});
+    m_rtShaderGroups.push_back(rg);
+  }
   // Miss
   vk::RayTracingShaderGroupCreateInfoKHR mg{vk::RayTracingShaderGroupTypeKHR::eGeneral,
                                             VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR,
@@ -853,13 +1315,32 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
 {
   updateFrame();
 
-  m_debug.beginLabel(cmdBuf, "Ray trace");
   // Initializing push constant values
   m_rtPushConstants.clearColor     = clearColor;
   m_rtPushConstants.lightPosition  = m_pushConstant.lightPosition;
   m_rtPushConstants.lightIntensity = m_pushConstant.lightIntensity;
   m_rtPushConstants.lightType      = m_pushConstant.lightType;
 
+  // One invocation per cell of `phases` pixels, tracing `samples` paths
+  updateSamplesPerLaunch();
+  uint32_t     samples   = getSamplesPerLaunch();
+  vk::Extent2D traceSize = getTraceSize();
+  if(m_rtPushConstants.frame == 0)
+    m_samplesPerPixel = 0;
+  m_samplesPerPixel += static_cast<double>(samples) / m_rtPushConstants.phases;
+
+  if(m_rtPushConstants.radianceCache != 0)
+    updateRadianceCache(cmdBuf);
+
+  if(m_useRayQuery)
+  {
+    raytraceCompute(cmdBuf, traceSize);
+    return;
+  }
+
+  m_debug.beginLabel(cmdBuf, "Ray trace");
+  m_profiler.beginSection(cmdBuf, "Ray trace");
+
   cmdBuf.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, m_rtPipeline);
   cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eRayTracingKHR, m_rtPipelineLayout, 0,
                             {m_rtDescSet, m_descSet}, {});
@@ -870,11 +1351,139 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
                                        0, m_rtPushConstants);
 
 
-  auto regions = m_sbtWrapper.getRegions();
+  // The raygen group of the samples per launch of this frame
+  auto regions = m_sbtWrapper.getRegions(SampleBudget::getVariant(samples));
   cmdBuf.traceRaysKHR(regions[0], regions[1], regions[2], regions[3],  //
-                      m_size.width, m_size.height, 1);
+                      traceSize.width, traceSize.height, 1);
 
 
+  m_profiler.endSection(cmdBuf);
+  m_debug.endLabel(cmdBuf);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Choosing the samples per launch of the frame about to be recorded.
+// Must be called after m_profiler.beginFrame(), which brought back the timings of a frame
+// recorded a few frames ago: its samples per launch are found in `m_frameSamples`. The path
+// tracing pass is the part of the frame proportional to the samples, the other passes are fixed.
+// The accumulation does not restart: the shaders count the samples of each pixel.
+//
+void HelloVulkan::updateSamplesPerLaunch()
+{
+  if(m_frameSamples.empty())
+    m_frameSamples.resize(16, 1);  // More than the number of frames in flight
+
+  const auto& sections    = m_profiler.getLastFrame();
+  uint64_t    frameNumber = m_profiler.getLastFrameNumber();
+  if(m_autoSamples && !sections.empty() && frameNumber != m_measuredFrame)
+  {
+    m_measuredFrame = frameNumber;
+
+    double sampledMs = 0.0;
+    double fixedMs   = 0.0;
+    bool   traced    = false;
+    for(const auto& section : sections)
+    {
+      if(section.depth != 0)
+        continue;
+      if(section.name == "Ray trace" || section.name == "Ray query")
+      {
+        sampledMs += section.gpuMs;
+        traced = true;
+      }
+      else
+        fixedMs += section.gpuMs;
+    }
+
+    // Nothing to learn from the frames rendered with the rasterizer
+    if(traced)
+      m_sampleBudget.addFrame(m_frameSamples[frameNumber % m_frameSamples.size()], sampledMs,
+                              fixedMs);
+  }
+
+  m_frameSamples[m_profiler.getFrameNumber() % m_frameSamples.size()] = getSamplesPerLaunch();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// #RayQuery
+//////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------------------
+// The path tracer as a compute shader with inline ray queries: no SBT and no recursion, the
+// closest hit and miss shading are done in the loop of pathtrace.comp. It uses the same
+// descriptor sets and push constants as the ray tracing pipeline, so both can be switched at any
+// frame. The size of the workgroups (tiles of cells) is a specialization constant: this function
+// is called again when it changes. SAMPLES_PER_LAUNCH is the third one, with one pipeline per
+// power of two, as for the raygen shaders.
+//
+void HelloVulkan::createCompPipeline()
+{
+  TRACE_SCOPE("createCompPipeline");
+
+  if(!m_compPipelineLayout)
+  {
+    vk::PushConstantRange pushConstant{vk::ShaderStageFlagBits::eCompute, 0,
+                                       sizeof(RtPushConstant)};
+    std::vector<vk::DescriptorSetLayout> setLayouts = {m_rtDescSetLayout, m_descSetLayout};
+
+    vk::PipelineLayoutCreateInfo layoutInfo;
+    layoutInfo.setSetLayoutCount(static_cast<uint32_t>(setLayouts.size()));
+    layoutInfo.setPSetLayouts(setLayouts.data());
+    layoutInfo.setPushConstantRangeCount(1);
+    layoutInfo.setPPushConstantRanges(&pushConstant);
+    m_compPipelineLayout = m_device.createPipelineLayout(layoutInfo);
+  }
+  for(auto& pipeline : m_compPipelines)
+    m_device.destroy(pipeline);
+  m_compPipelines.clear();
+
+  // local_size_x_id = 0, local_size_y_id = 1, SAMPLES_PER_LAUNCH = 2
+  std::array<uint32_t, 3> constants{m_compTileSize.width, m_compTileSize.height, 1};
+  std::array<vk::SpecializationMapEntry, 3> entries;
+  entries[0] = vk::SpecializationMapEntry{0, 0, sizeof(uint32_t)};
+  entries[1] = vk::SpecializationMapEntry{1, sizeof(uint32_t), sizeof(uint32_t)};
+  entries[2] = vk::SpecializationMapEntry{2, 2 * sizeof(uint32_t), sizeof(uint32_t)};
+  vk::SpecializationInfo specialization{static_cast<uint32_t>(entries.size()), entries.data(),
+                                        sizeof(constants), constants.data()};
+
+  vk::ComputePipelineCreateInfo createInfo{{}, {}, m_compPipelineLayout};
+  createInfo.stage = nvvk::createShaderStageInfo(
+      m_device, nvh::loadFile("spv/pathtrace.comp.spv", true, defaultSearchPaths, true),
+      VK_SHADER_STAGE_COMPUTE_BIT);
+  createInfo.stage.setPSpecializationInfo(&specialization);
+  for(uint32_t samples = 1; samples <= s_maxSamplesPerLaunch; samples *= 2)
+  {
+    constants[2] = samples;
+    m_compPipelines.push_back(m_device.createComputePipeline({}, createInfo).value);
+    m_debug.setObjectName(m_compPipelines.back(), "pathtrace.comp x" + std::to_string(samples));
+  }
+  m_device.destroy(createInfo.stage.module);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Path tracing with pathtrace.comp, one invocation per cell
+//
+void HelloVulkan::raytraceCompute(const vk::CommandBuffer& cmdBuf, const vk::Extent2D& traceSize)
+{
+  m_debug.beginLabel(cmdBuf, "Ray query");
+  m_profiler.beginSection(cmdBuf, "Ray query");
+
+  uint32_t variant = SampleBudget::getVariant(getSamplesPerLaunch());
+  cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_compPipelines[variant]);
+  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_compPipelineLayout, 0,
+                            {m_rtDescSet, m_descSet}, {});
+  cmdBuf.pushConstants<RtPushConstant>(m_compPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                                       m_rtPushConstants);
+  cmdBuf.dispatch((traceSize.width + m_compTileSize.width - 1) / m_compTileSize.width,
+                  (traceSize.height + m_compTileSize.height - 1) / m_compTileSize.height, 1);
+
+  // The post-process reads the image written by the compute shader
+  vk::MemoryBarrier barrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead};
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                         vk::PipelineStageFlagBits::eFragmentShader,
+                         vk::DependencyFlagBits::eDeviceGroup, {barrier}, {}, {});
+
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -903,3 +1512,297 @@ void HelloVulkan::resetFrame()
 {
   m_rtPushConstants.frame = -1;
 }
+
+//--------------------------------------------------------------------------------------------------
+// Sparse tracing: 1 traces all pixels at each frame, 2 half of them in a checkerboard, 4 one pixel
+// of each 2x2 block. The accumulation restarts, as the pixels are not sampled the same way.
+//
+void HelloVulkan::setTracePhases(int phases)
+{
+  if(phases == m_rtPushConstants.phases)
+    return;
+  m_rtPushConstants.phases = phases;
+  resetFrame();
+}
+
+vk::Extent2D HelloVulkan::getTraceSize() const
+{
+  switch(m_rtPushConstants.phases)
+  {
+    case 2:
+      return {(m_size.width + 1) / 2, m_size.height};
+    case 4:
+      return {(m_size.width + 1) / 2, (m_size.height + 1) / 2};
+    default:
+      return m_size;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// #RadianceCache
+//////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------------------
+// The hash grid of the radiance cache, empty, and its counters. The cells are about 1/50 of the
+// radius of the scene by default.
+//
+void HelloVulkan::createRadianceCache(const vk::CommandBuffer& cmdBuf)
+{
+  using vkBU = vk::BufferUsageFlagBits;
+  using vkMP = vk::MemoryPropertyFlagBits;
+
+  m_cacheBuffer = m_alloc.createBuffer(s_cacheCells * sizeof(RadianceCacheCell),
+                                       vkBU::eStorageBuffer | vkBU::eTransferDst,
+                                       vkMP::eDeviceLocal);
+  m_cacheCounterBuffer =
+      m_alloc.createBuffer(sizeof(RadianceCacheCounters),
+                           vkBU::eStorageBuffer | vkBU::eTransferSrc | vkBU::eTransferDst,
+                           vkMP::eDeviceLocal);
+  cmdBuf.fillBuffer(m_cacheBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+  cmdBuf.fillBuffer(m_cacheCounterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+  // One copy of the counters per frame in flight, see updateRadianceCache()
+  vk::DeviceSize readbackSize = getCommandBuffers().size() * sizeof(RadianceCacheCounters);
+  m_cacheReadback = m_alloc.createBuffer(readbackSize, vkBU::eTransferDst,
+                                         vkMP::eHostVisible | vkMP::eHostCoherent);
+  memset(m_alloc.map(m_cacheReadback), 0, readbackSize);
+  m_alloc.unmap(m_cacheReadback);
+
+  m_rtPushConstants.cacheCellSize = std::max(m_gltfScene.m_dimensions.radius / 50.f, 1e-4f);
+  LOGI("Radiance cache: %u cells, %.1f MB, cell size %g\n", s_cacheCells,
+       s_cacheCells * sizeof(RadianceCacheCell) / (1024.0 * 1024.0),
+       m_rtPushConstants.cacheCellSize);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Pipeline of radiance_cache.comp, with the descriptor sets of the path tracers. The push
+// constants are the length of the history and the age of eviction.
+//
+void HelloVulkan::createCachePipeline()
+{
+  TRACE_SCOPE("createCachePipeline");
+
+  vk::PushConstantRange pushConstant{vk::ShaderStageFlagBits::eCompute, 0, 2 * sizeof(uint32_t)};
+  std::vector<vk::DescriptorSetLayout> setLayouts = {m_rtDescSetLayout, m_descSetLayout};
+
+  vk::PipelineLayoutCreateInfo layoutInfo;
+  layoutInfo.setSetLayoutCount(static_cast<uint32_t>(setLayouts.size()));
+  layoutInfo.setPSetLayouts(setLayouts.data());
+  layoutInfo.setPushConstantRangeCount(1);
+  layoutInfo.setPPushConstantRanges(&pushConstant);
+  m_cachePipelineLayout = m_device.createPipelineLayout(layoutInfo);
+
+  vk::ComputePipelineCreateInfo createInfo{{}, {}, m_cachePipelineLayout};
+  createInfo.stage = nvvk::createShaderStageInfo(
+      m_device, nvh::loadFile("spv/radiance_cache.comp.spv", true, defaultSearchPaths, true),
+      VK_SHADER_STAGE_COMPUTE_BIT);
+  m_cachePipeline = m_device.createComputePipeline({}, createInfo).value;
+  m_debug.setObjectName(m_cachePipeline, "radiance_cache.comp");
+  m_device.destroy(createInfo.stage.module);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Before the paths of a frame: the samples added by the previous frame are blended in the cells
+// (radiance_cache.comp, 256 cells per workgroup), then the counters of the previous frame are
+// copied for the host and reset. The copy is in the slot of the current frame in flight: the
+// command buffer which wrote it last has completed, its counters are read first.
+//
+void HelloVulkan::updateRadianceCache(const vk::CommandBuffer& cmdBuf)
+{
+  using vkAF = vk::AccessFlagBits;
+  using vkPS = vk::PipelineStageFlagBits;
+
+  const vk::DeviceSize counterSize = sizeof(RadianceCacheCounters);
+  const vk::DeviceSize offset      = getCurFrame() * counterSize;
+  const auto*          mapped      = reinterpret_cast<const uint8_t*>(m_alloc.map(m_cacheReadback));
+  memcpy(&m_cacheCounters, mapped + offset, sizeof(RadianceCacheCounters));
+  m_alloc.unmap(m_cacheReadback);
+
+  m_debug.beginLabel(cmdBuf, "Radiance cache");
+  m_profiler.beginSection(cmdBuf, "Radiance cache");
+
+  // Cells and counters written by the paths of the previous frame
+  vk::MemoryBarrier traced{vkAF::eShaderWrite,
+                           vkAF::eShaderRead | vkAF::eShaderWrite | vkAF::eTransferWrite};
+  cmdBuf.pipelineBarrier(vkPS::eRayTracingShaderKHR | vkPS::eComputeShader,
+                         vkPS::eComputeShader | vkPS::eTransfer, {}, {traced}, {}, {});
+  if(m_cacheClear)
+  {
+    cmdBuf.fillBuffer(m_cacheBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+    vk::MemoryBarrier cleared{vkAF::eTransferWrite, vkAF::eShaderRead | vkAF::eShaderWrite};
+    cmdBuf.pipelineBarrier(vkPS::eTransfer, vkPS::eComputeShader, {}, {cleared}, {}, {});
+    m_cacheClear = false;
+  }
+
+  std::array<uint32_t, 2> constants{static_cast<uint32_t>(m_cacheMaxSamples),
+                                    static_cast<uint32_t>(m_cacheMaxAge)};
+  cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_cachePipeline);
+  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_cachePipelineLayout, 0,
+                            {m_rtDescSet, m_descSet}, {});
+  cmdBuf.pushConstants<std::array<uint32_t, 2>>(m_cachePipelineLayout,
+                                                vk::ShaderStageFlagBits::eCompute, 0, constants);
+  cmdBuf.dispatch(s_cacheCells / 256, 1, 1);
+
+  vk::MemoryBarrier resolved{vkAF::eShaderWrite, vkAF::eTransferRead | vkAF::eTransferWrite};
+  cmdBuf.pipelineBarrier(vkPS::eComputeShader, vkPS::eTransfer, {}, {resolved}, {}, {});
+  cmdBuf.copyBuffer(m_cacheCounterBuffer.buffer, m_cacheReadback.buffer,
+                    vk::BufferCopy(0, offset, counterSize));
+  cmdBuf.fillBuffer(m_cacheCounterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+  // The paths of this frame use the blended cells, the host reads the copy
+  vk::MemoryBarrier ready{vkAF::eShaderWrite | vkAF::eTransferWrite,
+                          vkAF::eShaderRead | vkAF::eShaderWrite | vkAF::eHostRead};
+  cmdBuf.pipelineBarrier(vkPS::eComputeShader | vkPS::eTransfer,
+                         vkPS::eRayTracingShaderKHR | vkPS::eComputeShader | vkPS::eHost, {},
+                         {ready}, {}, {});
+
+  m_profiler.endSection(cmdBuf);
+  m_debug.endLabel(cmdBuf);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Paths ended by the cache, over the lookups, in the last counters read back
+//
+double HelloVulkan::getCacheHitRate() const
+{
+  const auto& counters = m_cacheCounters;
+  return counters.queries > 0 ? static_cast<double>(counters.hits) / counters.queries : 0.0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Estimate of the bounce rays not traced thanks to the cache: a path ended by the cache would
+// have traced as many rays after the lookup as the paths continuing after a lookup which missed.
+//
+double HelloVulkan::getCacheSavedRays() const
+{
+  const auto& counters = m_cacheCounters;
+  uint32_t    misses   = counters.queries - counters.hits;
+  if(misses == 0)
+    return 0.0;
+  return static_cast<double>(counters.hits) * counters.tailRays / misses;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// #Quality
+//////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------------------
+// Copying the offscreen color image (RGBA32F) to the host. This waits for the GPU: it is only
+// used for the measures, every few frames.
+//
+bool HelloVulkan::readOffscreenImage(std::vector<float>& pixels)
+{
+  vk::DeviceSize nbPixels = static_cast<vk::DeviceSize>(m_size.width) * m_size.height;
+  vk::DeviceSize size     = nbPixels * 4 * sizeof(float);
+  nvvk::Buffer   staging  = m_alloc.createBuffer(size, vk::BufferUsageFlagBits::eTransferDst,
+                                               vk::MemoryPropertyFlagBits::eHostVisible
+                                                   | vk::MemoryPropertyFlagBits::eHostCoherent);
+  if(!staging.buffer)
+    return false;
+
+  {
+    nvvk::CommandPool genCmdBuf(m_device, m_graphicsQueueIndex);
+    auto              cmdBuf = genCmdBuf.createCommandBuffer();
+
+    // Waiting for the frames submitted before, which write the image
+    vk::MemoryBarrier before{vk::AccessFlagBits::eShaderWrite
+                                 | vk::AccessFlagBits::eColorAttachmentWrite,
+                             vk::AccessFlagBits::eTransferRead};
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                           vk::PipelineStageFlagBits::eTransfer, {}, {before}, {}, {});
+
+    vk::BufferImageCopy region;
+    region.setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1});
+    region.setImageExtent({m_size.width, m_size.height, 1});
+    cmdBuf.copyImageToBuffer(m_offscreenColor.image, vk::ImageLayout::eGeneral, staging.buffer,
+                             {region});
+
+    vk::MemoryBarrier after{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead};
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                           {}, {after}, {}, {});
+    genCmdBuf.submitAndWait(cmdBuf);
+  }
+
+  const float* mapped = reinterpret_cast<const float*>(m_alloc.map(staging));
+  pixels.assign(mapped, mapped + size / sizeof(float));
+  m_alloc.unmap(staging);
+  m_alloc.destroy(staging);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The current accumulated image becomes the reference of the measures
+//
+void HelloVulkan::captureReference()
+{
+  if(!readOffscreenImage(m_reference))
+    return;
+  m_referenceSize    = m_size;
+  m_referenceFrames  = m_rtPushConstants.frame + 1;
+  m_referenceSamples = m_samplesPerPixel;
+  m_quality.clear();
+  LOGI("Reference captured: %d frames, %.1f samples per pixel\n", m_referenceFrames,
+       m_referenceSamples);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Called after the submission of a ray traced frame: every `m_qualityInterval` frames, the
+// accumulated image is compared to the reference. The reference must have been captured with the
+// same camera and size, otherwise the measures are meaningless.
+// The GPU time of the path tracing is summed over the frames, so that settings of different
+// costs (light sampling, sparse tracing) can be compared at equal time rather than equal frames.
+// The timings of the current frame are not available yet: the last measured one is used instead.
+//
+void HelloVulkan::measureQuality()
+{
+  int frames = m_rtPushConstants.frame + 1;
+  if(frames == 1)
+  {
+    m_quality.clear();
+    m_traceMs = 0;
+  }
+  const char* pass = m_useRayQuery ? "Ray query" : "Ray trace";
+  for(const auto& section : m_profiler.getLastFrame())
+  {
+    if(section.name == pass)
+      m_traceMs += section.gpuMs;
+  }
+  if(m_reference.empty() || m_referenceSize != m_size || frames % m_qualityInterval != 0)
+    return;
+
+  std::vector<float> pixels;
+  if(!readOffscreenImage(pixels))
+    return;
+
+  QualitySample sample;
+  sample.frame           = frames;
+  sample.samplesPerPixel = m_samplesPerPixel;
+  sample.gpuMs           = m_traceMs;
+  sample.error           = compareImages(pixels.data(), m_reference.data(), pixels.size() / 4);
+  m_quality.push_back(sample);
+}
+
+//--------------------------------------------------------------------------------------------------
+// frame,phases,nee,sampler,samples_per_pixel,gpu_ms,rmse,psnr,rel_mse
+//
+bool HelloVulkan::saveQuality(const std::string& filename) const
+{
+  FILE* file = fopen(filename.c_str(), "w");
+  if(file == nullptr)
+  {
+    LOGE("Cannot write %s\n", filename.c_str());
+    return false;
+  }
+  const char* sampler =
+      SampleSequence::getTypeName(SampleSequence::Type(m_rtPushConstants.samplerType));
+  fprintf(file, "frame,phases,nee,sampler,samples_per_pixel,gpu_ms,rmse,psnr,rel_mse\n");
+  for(const auto& sample : m_quality)
+  {
+    fprintf(file, "%d,%d,%d,%s,%.3f,%.3f,%.6f,%.3f,%.6e\n", sample.frame,
+            m_rtPushConstants.phases, m_rtPushConstants.nee, sampler, sample.samplesPerPixel,
+            sample.gpuMs, sample.error.rmse, sample.error.psnr, sample.error.relMse);
+  }
+  fclose(file);
+  LOGI("Quality measures written to %s\n", filename.c_str());
+  return true;
+}
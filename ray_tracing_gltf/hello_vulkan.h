@@ -26,6 +26,13 @@
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/memallocator_dma_vk.hpp"
 
+#include "alias_table.h"
+#include "gpu_profiler.h"
+#include "image_metrics.h"
+#include "memory_stats.h"
+#include "sample_budget.h"
+#include "sample_sequences.h"
+
 // #VKRay
 #include "nvh/gltfscene.hpp"
 #include "nvvk/raytraceKHR_vk.hpp"
@@ -48,6 +55,10 @@ public:
   void createDescriptorSetLayout();
   void createGraphicsPipeline();
   void loadScene(const std::string& filename);
+  void createGeometryBuffers(const vk::CommandBuffer& cmdBuf,
+                             const tinygltf::Model&   tmodel,
+                             const uint8_t*           bin,
+                             size_t                   binSize);
   void updateDescriptorSet();
   void createUniformBuffer();
   void createTextureImages(const vk::CommandBuffer& cmdBuf, tinygltf::Model& gltfModel);
@@ -57,7 +68,7 @@ public:
   void rasterize(const vk::CommandBuffer& cmdBuff);
 
   // Structure used for retrieving the primitive information in the closest hit
-  // The gl_InstanceCustomIndexNV
+  // The gl_InstanceCustomIndexEXT + gl_GeometryIndexEXT
   struct RtPrimitiveLookup
   {
     uint32_t indexOffset;
@@ -66,7 +77,15 @@ public:
   };
 
 
-  nvh::GltfScene m_gltfScene;
+  // Mesh of the ray tracer: one BLAS per glTF mesh, one geometry per primitive
+  struct RtMesh
+  {
+    uint32_t              firstGeometry;  // Index of the first primitive in m_rtPrimLookup
+    std::vector<uint32_t> primMeshes;     // Primitive meshes, in geometry order
+  };
+
+  nvh::GltfScene      m_gltfScene;
+  std::vector<RtMesh> m_rtMeshes;
   nvvk::Buffer   m_vertexBuffer;
   nvvk::Buffer   m_normalBuffer;
   nvvk::Buffer   m_uvBuffer;
@@ -75,6 +94,21 @@ public:
   nvvk::Buffer   m_matrixBuffer;
   nvvk::Buffer   m_rtPrimLookup;
 
+  // #NEE: emissive triangles of the scene, in world space, sampled proportionally to their power
+  // with an alias table (see shaders/lights.glsl)
+  struct Emitter
+  {
+    nvmath::vec4f v0;  // w: area
+    nvmath::vec4f v1;
+    nvmath::vec4f v2;
+    nvmath::vec4f emission;
+  };
+  void createEmitterBuffers(const vk::CommandBuffer& cmdBuf);
+
+  AliasTable   m_emitterTable;
+  nvvk::Buffer m_emitterBuffer;
+  nvvk::Buffer m_emitterAliasBuffer;
+
   // Information pushed at each draw call
   struct ObjPushConstant
   {
@@ -96,10 +130,16 @@ public:
 
   nvvk::Buffer               m_cameraMat;  // Device-Host of the camera matrices
   std::vector<nvvk::Texture> m_textures;   // vector of all textures of the scene
+  nvvk::Texture              m_blueNoise;  // Ranks of SampleSequence::eBlueNoise (sampler.glsl)
+
+  void createBlueNoiseTexture(const vk::CommandBuffer& cmdBuf);
 
   nvvk::ResourceAllocatorDma m_alloc;  // Allocator for buffer, images, acceleration structures
   nvvk::DebugUtil            m_debug;  // Utility to name objects
 
+  GpuProfiler m_profiler;  // GPU timestamps of each pass
+  MemoryStats m_memStats;  // Device memory per category and model
+
   // #Post
   void createOffscreenRender();
   void createPostPipeline();
@@ -131,6 +171,8 @@ public:
   void raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor);
   void updateFrame();
   void resetFrame();
+  void setTracePhases(int phases);
+  vk::Extent2D getTraceSize() const;
 
   vk::PhysicalDeviceRayTracingPipelinePropertiesKHR   m_rtProperties;
   nvvk::RaytracingBuilderKHR                          m_rtBuilder;
@@ -150,5 +192,108 @@ public:
     float         lightIntensity;
     int           lightType;
     int           frame{0};
+    int           phases{1};  // Pixels of a cell, one is traced per frame (see pathtrace.rgen)
+    int           nee{1};     // Light sampling of the emitters, with MIS
+    int           nbEmitters{0};
+    float         totalPower{0.f};  // Sum of luminance(emission) x area of the emitters
+    int           samplerType{SampleSequence::eSobol};  // Sample sequences of the paths
+    int           radianceCache{0};                     // See #RadianceCache
+    float         cacheCellSize{0.05f};                 // World space
+    int           cacheMinSamples{16};                  // Of a cell, to end the paths
   } m_rtPushConstants;
+
+  double m_samplesPerPixel{0};  // Average number of paths per pixel since the last reset
+
+  // #SamplesPerLaunch: each launch traces SAMPLES_PER_LAUNCH paths per pixel, a specialization
+  // constant of pathtrace.rgen and pathtrace.comp. There is one raygen shader group and one
+  // compute pipeline per power of two, and `m_sampleBudget` picks one at each frame to fill the
+  // target GPU time (see updateSamplesPerLaunch()).
+  static constexpr uint32_t s_maxSamplesPerLaunch = 64;
+
+  void     updateSamplesPerLaunch();
+  uint32_t getSamplesPerLaunch() const { return m_sampleBudget.getSamples(); }
+
+  SampleBudget          m_sampleBudget;
+  bool                  m_autoSamples{true};
+  std::vector<uint32_t> m_frameSamples;          // Samples per launch of the last frames
+  uint64_t              m_measuredFrame{~0ULL};  // Last frame given to `m_sampleBudget`
+
+  // #RayQuery: the same path tracer in a compute shader with inline ray queries (pathtrace.comp),
+  // as an alternative to the ray tracing pipeline
+  void createCompPipeline();
+  void raytraceCompute(const vk::CommandBuffer& cmdBuf, const vk::Extent2D& traceSize);
+
+  bool                      m_useRayQuery{false};
+  vk::Extent2D              m_compTileSize{8, 8};  // Workgroup size, in cells
+  vk::PipelineLayout        m_compPipelineLayout;
+  std::vector<vk::Pipeline> m_compPipelines;  // One per samples per launch
+
+  // #RadianceCache: world-space hash grid of the radiance reflected by the surfaces
+  // (shaders/radiance_cache.glsl). The first vertices of the paths add samples to their cell, and
+  // from the second bounce the paths end on the cells with enough samples. Before the paths of a
+  // frame, radiance_cache.comp blends the samples of the previous frame in the cells and evicts
+  // the cells without samples for `m_cacheMaxAge` frames.
+  struct RadianceCacheCell  // CacheCell of radiance_cache.glsl, std430
+  {
+    nvmath::vec4f radiance;  // w: samples
+    uint32_t      accum[4];  // Samples of the frame, in fixed point
+    uint32_t      checksum;  // 0: free
+    uint32_t      age;
+    uint32_t      pad[2];
+  };
+
+  // Counters of a frame, in the order of the CACHE_ defines of radiance_cache.glsl
+  struct RadianceCacheCounters
+  {
+    uint32_t queries;   // Lookups, from the second bounce
+    uint32_t hits;      // Paths ended by the cache
+    uint32_t rays;      // Bounce rays traced
+    uint32_t tailRays;  // Bounce rays traced after the lookups that missed
+    uint32_t inserts;
+    uint32_t drops;  // Samples without a free slot
+    uint32_t cells;  // Cells in use
+    uint32_t evictions;
+  };
+
+  static constexpr uint32_t s_cacheCells = 1 << 20;  // Power of two
+
+  void   createRadianceCache(const vk::CommandBuffer& cmdBuf);
+  void   createCachePipeline();
+  void   updateRadianceCache(const vk::CommandBuffer& cmdBuf);
+  void   clearRadianceCache() { m_cacheClear = true; }
+  double getCacheHitRate() const;
+  double getCacheSavedRays() const;
+
+  nvvk::Buffer          m_cacheBuffer;
+  nvvk::Buffer          m_cacheCounterBuffer;
+  nvvk::Buffer          m_cacheReadback;  // Counters, one copy per frame in flight
+  RadianceCacheCounters m_cacheCounters{};
+  vk::PipelineLayout    m_cachePipelineLayout;
+  vk::Pipeline          m_cachePipeline;
+  bool                  m_cacheClear{false};
+  int                   m_cacheMaxSamples{256};  // History of the blending, in samples
+  int                   m_cacheMaxAge{64};       // Frames without sample before eviction
+
+  // #Quality: error of the accumulated image against a reference, usually a converged image
+  // traced at full rate, to compare the convergence of the sparse patterns
+  struct QualitySample
+  {
+    int        frame{0};  // Frames since the last reset
+    double     samplesPerPixel{0};
+    double     gpuMs{0};  // Path tracing time since the last reset, for equal-time comparisons
+    ImageError error;
+  };
+
+  bool readOffscreenImage(std::vector<float>& pixels);
+  void captureReference();
+  void measureQuality();
+  bool saveQuality(const std::string& filename) const;
+
+  std::vector<float>         m_reference;  // RGBA32F
+  vk::Extent2D               m_referenceSize;
+  int                        m_referenceFrames{0};
+  double                     m_referenceSamples{0};
+  std::vector<QualitySample> m_quality;              // Measures since the last reset
+  int                        m_qualityInterval{16};  // Frames between two measures
+  double                     m_traceMs{0};           // GPU time of the frames since the reset
 };
@@ -22,7 +22,9 @@
 // pipeline If you are new to ImGui, see examples/README.txt and documentation
 // at the top of imgui.cpp.
 
+#include <algorithm>
 #include <array>
+#include <cfloat>
 #include <vulkan/vulkan.hpp>
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
@@ -37,6 +39,7 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 #include "nvvk/appbase_vkpp.hpp"
 #include "nvvk/commands_vk.hpp"
 #include "nvvk/context_vk.hpp"
+#include "trace_events.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -65,6 +68,178 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat3("Position", &helloVk.m_pushConstant.lightPosition.x, -20.f, 20.f);
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
   }
+  if(ImGui::CollapsingHeader("Path Tracer"))
+  {
+    int useRayQuery = helloVk.m_useRayQuery ? 1 : 0;
+    ImGui::RadioButton("RT pipeline", &useRayQuery, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("Ray query (compute)", &useRayQuery, 1);
+    helloVk.m_useRayQuery = useRayQuery == 1;
+
+    // Next event estimation: the accumulation restarts, the noise is not the same
+    bool nee = helloVk.m_rtPushConstants.nee != 0;
+    if(ImGui::Checkbox("Light sampling (NEE + MIS)", &nee))
+    {
+      helloVk.m_rtPushConstants.nee = nee ? 1 : 0;
+      helloVk.resetFrame();
+    }
+    ImGui::SameLine();
+    ImGui::Text("%d emissive triangles", helloVk.m_rtPushConstants.nbEmitters);
+
+    // Sample sequences of the paths (sampler.glsl)
+    static const char* samplers[] = {"White noise", "Sobol (Owen)", "R2", "Blue noise + R2"};
+    if(ImGui::Combo("Sampler", &helloVk.m_rtPushConstants.samplerType, samplers,
+                    IM_ARRAYSIZE(samplers)))
+      helloVk.resetFrame();
+
+    // Tile size of the compute shader, in cells
+    static const vk::Extent2D tiles[] = {{8, 4}, {8, 8}, {16, 8}, {16, 16}, {32, 2}};
+    static const char*        names[] = {"8x4", "8x8", "16x8", "16x16", "32x2"};
+    int tile = 0;
+    while(tile < IM_ARRAYSIZE(tiles) - 1 && tiles[tile] != helloVk.m_compTileSize)
+      tile++;
+    if(ImGui::Combo("Tile", &tile, names, IM_ARRAYSIZE(names)))
+    {
+      helloVk.getDevice().waitIdle();
+      helloVk.m_compTileSize = tiles[tile];
+      helloVk.createCompPipeline();
+  helloVk.createCachePipeline();
+    }
+
+    // Throughput of both path tracers: each traced pixel is `samples` paths of up to 10 bounces.
+    // The times are the moving averages of the profiler, with the current sparse pattern and
+    // samples per launch.
+    vk::Extent2D traceSize = helloVk.getTraceSize();
+    double       paths     = static_cast<double>(traceSize.width) * traceSize.height
+                     * helloVk.getSamplesPerLaunch();
+    for(const auto& stats : helloVk.m_profiler.getStats())
+    {
+      if(stats.name == "Ray trace" || stats.name == "Ray query")
+        ImGui::Text("%-10s %7.3f ms  %8.1f Mpaths/s", stats.name.c_str(), stats.avgMs,
+                    stats.avgMs > 0 ? paths / (stats.avgMs * 1000.0) : 0.0);
+    }
+  }
+  if(ImGui::CollapsingHeader("Samples per Launch"))
+  {
+    SampleBudget&          budget   = helloVk.m_sampleBudget;
+    SampleBudget::Settings settings = budget.getSettings();
+
+    // Fewer, larger launches: a higher target is for offline renders
+    ImGui::Checkbox("Auto", &helloVk.m_autoSamples);
+    if(ImGui::SliderFloat("Target (ms)", &settings.targetMs, 1.f, 200.f))
+      budget.setSettings(settings);
+    if(!helloVk.m_autoSamples)
+    {
+      // Powers of two, one shader variant each
+      const uint32_t maxSamples = HelloVulkan::s_maxSamplesPerLaunch;
+      int            variant    = static_cast<int>(SampleBudget::getVariant(budget.getSamples()));
+      int            maxVariant = static_cast<int>(SampleBudget::getVariant(maxSamples));
+      std::string    label      = std::to_string(1 << variant);
+      if(ImGui::SliderInt("Samples", &variant, 0, maxVariant, label.c_str()))
+        budget.reset(1u << variant);
+    }
+
+    const auto& stats = budget.getStats();
+    ImGui::Text("%u paths per pixel per launch", budget.getSamples());
+    ImGui::Text("GPU frame: %.2f ms, one sample: %.3f ms", stats.lastFrameMs, stats.sampleMs);
+    ImGui::Text("Ideal samples: %.1f, changes: %llu", stats.idealSamples,
+                static_cast<unsigned long long>(stats.changes));
+  }
+  if(ImGui::CollapsingHeader("Radiance Cache"))
+  {
+    // The cache changes the estimate: the accumulation restarts
+    auto& pc    = helloVk.m_rtPushConstants;
+    bool  cache = pc.radianceCache != 0;
+    if(ImGui::Checkbox("Enable", &cache))
+    {
+      pc.radianceCache = cache ? 1 : 0;
+      helloVk.resetFrame();
+    }
+    ImGui::SameLine();
+    if(ImGui::Button("Clear"))
+    {
+      helloVk.clearRadianceCache();
+      helloVk.resetFrame();
+    }
+    // Other cells: the cache restarts empty
+    if(ImGui::InputFloat("Cell size", &pc.cacheCellSize, 0.f, 0.f, "%.4f"))
+    {
+      pc.cacheCellSize = std::max(pc.cacheCellSize, 1e-4f);
+      helloVk.clearRadianceCache();
+      helloVk.resetFrame();
+    }
+    if(ImGui::SliderInt("Min samples", &pc.cacheMinSamples, 1, 256))
+      helloVk.resetFrame();
+    ImGui::SliderInt("History", &helloVk.m_cacheMaxSamples, 1, 4096, "%d samples");
+    ImGui::SliderInt("Max age", &helloVk.m_cacheMaxAge, 1, 1024, "%d frames");
+
+    // Counters of a frame, a few frames ago
+    const auto& counters = helloVk.m_cacheCounters;
+    double      saved    = helloVk.getCacheSavedRays();
+    double      baseline = counters.rays + saved;  // Rays without the cache
+    ImGui::Text("Cells: %u of %u, %u evicted", counters.cells, HelloVulkan::s_cacheCells,
+                counters.evictions);
+    ImGui::Text("Lookups: %u, hit rate %.1f %%", counters.queries,
+                helloVk.getCacheHitRate() * 100.0);
+    ImGui::Text("Samples: %u, %u dropped", counters.inserts, counters.drops);
+    ImGui::Text("Bounce rays: %.2f M traced, ~%.2f M saved (%.1f %%)", counters.rays / 1e6,
+                saved / 1e6, baseline > 0 ? saved * 100.0 / baseline : 0.0);
+  }
+  if(ImGui::CollapsingHeader("Sparse Tracing"))
+  {
+    int phases = helloVk.m_rtPushConstants.phases;
+    ImGui::RadioButton("Full", &phases, 1);
+    ImGui::SameLine();
+    ImGui::RadioButton("Checkerboard", &phases, 2);
+    ImGui::SameLine();
+    ImGui::RadioButton("Interleaved 2x2", &phases, 4);
+    helloVk.setTracePhases(phases);
+
+    vk::Extent2D traceSize = helloVk.getTraceSize();
+    ImGui::Text("Rays per frame: %u x %u, %.1f samples per pixel", traceSize.width,
+                traceSize.height, helloVk.m_samplesPerPixel);
+
+    if(ImGui::Button("Capture reference"))
+      helloVk.captureReference();
+    if(!helloVk.m_reference.empty())
+    {
+      ImGui::SameLine();
+      ImGui::Text("%d frames, %.1f spp", helloVk.m_referenceFrames, helloVk.m_referenceSamples);
+    }
+    ImGui::SliderInt("Measure every", &helloVk.m_qualityInterval, 1, 64, "%d frames");
+
+    const auto& quality = helloVk.m_quality;
+    if(!quality.empty())
+    {
+      const auto& last = quality.back();
+      ImGui::Text("Frame %d: RMSE %.4f, PSNR %.2f dB, relMSE %.2e", last.frame, last.error.rmse,
+                  last.error.psnr, last.error.relMse);
+      ImGui::Text("GPU time since reset: %.1f ms", last.gpuMs);
+
+      std::vector<float> psnr;
+      for(const auto& sample : quality)
+        psnr.push_back(static_cast<float>(sample.error.psnr));
+      ImGui::PlotLines("PSNR", psnr.data(), static_cast<int>(psnr.size()), 0, nullptr, FLT_MAX,
+                       FLT_MAX, ImVec2(0, 60));
+      if(ImGui::Button("Save measures"))
+      {
+        const char* sampling = helloVk.m_rtPushConstants.nee ? "nee" : "bsdf";
+        const char* sampler  = SampleSequence::getTypeName(
+            SampleSequence::Type(helloVk.m_rtPushConstants.samplerType));
+        const char* cache = helloVk.m_rtPushConstants.radianceCache ? "_cache" : "";
+        helloVk.saveQuality("quality_" + std::to_string(helloVk.m_rtPushConstants.phases) + "_"
+                            + sampling + "_" + sampler + cache + ".csv");
+      }
+    }
+  }
+  if(ImGui::CollapsingHeader("GPU Profiler"))
+  {
+    helloVk.m_profiler.renderUI();
+  }
+  if(ImGui::CollapsingHeader("Memory"))
+  {
+    helloVk.m_memStats.renderUI();
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -78,7 +253,7 @@ static int const SAMPLE_HEIGHT = 720;
 //
 int main(int argc, char** argv)
 {
-  UNUSED(argc);
+  TraceScope traceStartup("Startup");
 
   // Setup GLFW window
   glfwSetErrorCallback(onErrorCallback);
@@ -132,6 +307,7 @@ int main(int argc, char** argv)
   contextInfo.addDeviceExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
   contextInfo.addDeviceExtension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME);
   contextInfo.addDeviceExtension(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+  contextInfo.addDeviceExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, true);  // Optional
   vk::PhysicalDeviceShaderClockFeaturesKHR clockFeature;
   contextInfo.addDeviceExtension(VK_KHR_SHADER_CLOCK_EXTENSION_NAME, false, &clockFeature);
   vk::PhysicalDeviceAccelerationStructureFeaturesKHR accelFeature;
@@ -140,9 +316,13 @@ int main(int argc, char** argv)
   vk::PhysicalDeviceRayTracingPipelineFeaturesKHR rtPipelineFeature;
   contextInfo.addDeviceExtension(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME, false,
                                  &rtPipelineFeature);
+  // #RayQuery: compute version of the path tracer
+  vk::PhysicalDeviceRayQueryFeaturesKHR rayQueryFeatures;
+  contextInfo.addDeviceExtension(VK_KHR_RAY_QUERY_EXTENSION_NAME, false, &rayQueryFeatures);
 
 
   // Creating Vulkan base application
+  TraceScope    traceContext("Vulkan context");
   nvvk::Context vkctx{};
   vkctx.initInstance(contextInfo);
   // Find all compatible devices
@@ -150,6 +330,7 @@ int main(int argc, char** argv)
   assert(!compatibleDevices.empty());
   // Use a compatible device
   vkctx.initDevice(compatibleDevices[0], contextInfo);
+  traceContext.end();
 
 
   // Create example
@@ -162,6 +343,8 @@ int main(int argc, char** argv)
   helloVk.setup(vkctx.m_instance, vkctx.m_device, vkctx.m_physicalDevice,
                 vkctx.m_queueGCT.familyIndex);
   helloVk.createSwapchain(surface, SAMPLE_WIDTH, SAMPLE_HEIGHT);
+  helloVk.m_profiler.setup(vkctx.m_device, vkctx.m_physicalDevice, vkctx.m_queueGCT.familyIndex,
+                           static_cast<uint32_t>(helloVk.getCommandBuffers().size()));
   helloVk.createDepthBuffer();
   helloVk.createRenderPass();
   helloVk.createFrameBuffers();
@@ -169,8 +352,9 @@ int main(int argc, char** argv)
   // Setup Imgui
   helloVk.initGUI(0);  // Using sub-pass 0
 
-  // Creation of the example
-  helloVk.loadScene(nvh::findFile("media/scenes/cornellBox.gltf", defaultSearchPaths, true));
+  // Creation of the example, the scene (.gltf or .glb) can be given on the command line
+  std::string sceneFile = argc > 1 ? std::string(argv[1]) : "media/scenes/cornellBox.gltf";
+  helloVk.loadScene(nvh::findFile(sceneFile, defaultSearchPaths, true));
 
 
   helloVk.createOffscreenRender();
@@ -185,6 +369,7 @@ int main(int argc, char** argv)
   helloVk.createTopLevelAS();
   helloVk.createRtDescriptorSet();
   helloVk.createRtPipeline();
+  helloVk.createCompPipeline();
 
   helloVk.createPostDescriptor();
   helloVk.createPostPipeline();
@@ -195,6 +380,13 @@ int main(int argc, char** argv)
   bool          useRaytracer = true;
 
 
+  // Writing the trace of the startup, to be opened in chrome://tracing or ui.perfetto.dev
+  traceStartup.end();
+  if(TraceRecorder::get().dump("load_trace.json"))
+    LOGI("Startup trace written to load_trace.json\n");
+  TraceRecorder::get().setEnabled(false);
+  helloVk.m_memStats.dump("memory_stats.json");
+
   helloVk.setupGlfwCallbacks(window);
   ImGui_ImplGlfw_InitForVulkan(window, true);
 
@@ -231,6 +423,7 @@ int main(int argc, char** argv)
     const vk::CommandBuffer& cmdBuf   = helloVk.getCommandBuffers()[curFrame];
 
     cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    helloVk.m_profiler.beginFrame(cmdBuf, curFrame);
 
     // Updating camera buffer
     helloVk.updateUniformBuffer(cmdBuf);
@@ -284,6 +477,9 @@ int main(int argc, char** argv)
     // Submit for display
     cmdBuf.end();
     helloVk.submitFrame();
+
+    if(useRaytracer)
+      helloVk.measureQuality();
   }
 
   // Cleanup
@@ -26,3 +26,8 @@
 #define B_MATERIALS 5
 #define B_MATRICES 6
 #define B_TEXTURES 7
+#define B_EMITTERS 8
+#define B_EMITTER_ALIAS 9
+#define B_BLUE_NOISE 10
+#define B_RADIANCE_CACHE 11
+#define B_CACHE_COUNTERS 12
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2019-2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2019-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Next event estimation: sampling of the emissive triangles of the scene, see
+// HelloVulkan::createEmitterBuffers. The triangles are picked proportionally to their power
+// (luminance of the emission x area) with an alias table, then a point is picked uniformly on the
+// triangle. With these choices, the probability (per area) of a point of any emitter is
+// luminance(emission) / totalPower: it is known for the emitters hit by the BSDF rays, without
+// looking them up.
+//
+// Requires binding.glsl, sampling.glsl and sampler.glsl
+
+// clang-format off
+struct Emitter
+{
+  vec4 v0;        // World space, w: area
+  vec4 v1;
+  vec4 v2;
+  vec4 emission;  // Emissive factor of the material
+};
+
+// AliasTable::Entry (common/alias_table.h)
+struct AliasEntry
+{
+  float prob;   // Probability to keep this entry, else `alias`
+  uint  alias;
+  float pdf;    // Probability of the emitter of this entry
+  float weight;
+};
+
+layout(set = 1, binding = B_EMITTERS) readonly buffer _Emitters {Emitter emitters[];};
+layout(set = 1, binding = B_EMITTER_ALIAS) readonly buffer _EmitterAlias {AliasEntry emitterAlias[];};
+// clang-format on
+
+struct LightSample
+{
+  vec3  direction;  // From the shaded point, normalized
+  float distance;
+  vec3  radiance;
+  float pdf;  // Solid angle
+};
+
+float luminance(vec3 color)
+{
+  return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Multiple importance sampling weight of the strategy of pdf `a`, against the one of pdf `b`
+float powerHeuristic(float a, float b)
+{
+  float a2 = a * a;
+  return a2 / (a2 + b * b);
+}
+
+// Solid angle probability that the light sampling picks the point at `dist` of an emitter of
+// `emission`, `cosLight` being the cosine between the direction and the emitter normal
+float emitterPdf(vec3 emission, float totalPower, float dist, float cosLight)
+{
+  if(cosLight <= 0.0)
+    return 0.0;
+  return luminance(emission) / totalPower * dist * dist / cosLight;
+}
+
+// Picks a point on an emitter, seen from `position`. The emitters are two-sided, as the emission
+// of the materials. Returns false if the point cannot light `position`.
+bool sampleEmitters(int nbEmitters, inout Sampler sampler, vec3 position, out LightSample ls)
+{
+  // Alias table: one number picks an entry, the other its emitter or the alias. The fraction of
+  // x * nbEmitters would lose its precision with many emitters.
+  vec2       x     = sample2D(sampler);
+  uint       entry = min(uint(x.x * nbEmitters), uint(nbEmitters - 1));
+  AliasEntry e     = emitterAlias[entry];
+  uint       index = x.y < e.prob ? entry : e.alias;
+  float      pdf   = emitterAlias[index].pdf;
+  Emitter    light = emitters[index];
+
+  // Uniform point on the triangle
+  vec2  u     = sample2D(sampler);
+  float su    = sqrt(u.x);
+  float b1    = u.y * su;
+  vec3  point = light.v0.xyz * (1.0 - su) + light.v1.xyz * b1 + light.v2.xyz * (su - b1);
+
+  vec3  toLight   = point - position;
+  float distance2 = dot(toLight, toLight);
+  if(distance2 <= 0.0)
+    return false;
+  ls.distance  = sqrt(distance2);
+  ls.direction = toLight / ls.distance;
+
+  vec3  normal   = normalize(cross(light.v1.xyz - light.v0.xyz, light.v2.xyz - light.v0.xyz));
+  float cosLight = abs(dot(normal, ls.direction));
+  if(cosLight <= 0.0 || light.v0.w <= 0.0)
+    return false;
+
+  ls.radiance = light.emission.xyz;
+  ls.pdf      = pdf / light.v0.w * distance2 / cosLight;
+  return true;
+}
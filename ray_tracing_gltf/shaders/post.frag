@@ -29,9 +29,33 @@ layout(push_constant) uniform shaderInformation
 }
 pushc;
 
+// Pixels not traced yet since the last reset of the accumulation have an alpha of 0 (sparse
+// tracing, see pathtrace.rgen): they are reconstructed from the traced pixels around them.
+vec4 reconstruct(ivec2 pixel)
+{
+  ivec2 size   = textureSize(noisyTxt, 0);
+  vec3  sum    = vec3(0);
+  float weight = 0;
+  for(int y = -1; y <= 1; y++)
+  {
+    for(int x = -1; x <= 1; x++)
+    {
+      ivec2 p = clamp(pixel + ivec2(x, y), ivec2(0), size - 1);
+      vec4  c = texelFetch(noisyTxt, p, 0);
+      float w = (c.a > 0.0 ? 1.0 : 0.0) * (x == 0 || y == 0 ? 2.0 : 1.0);  // Closer ones first
+      sum += c.rgb * w;
+      weight += w;
+    }
+  }
+  return vec4(weight > 0.0 ? sum / weight : vec3(0), 1.0);
+}
+
 void main()
 {
   vec2  uv    = outUV;
   float gamma = 1. / 2.2;
-  fragColor   = pow(texture(noisyTxt, uv).rgba, vec4(gamma));
+  vec4  color = texture(noisyTxt, uv);
+  if(color.a == 0.0)
+    color = reconstruct(ivec2(uv * vec2(textureSize(noisyTxt, 0))));
+  fragColor = vec4(pow(color.rgb, vec3(gamma)), 1.0);  // Alpha holds the sample count
 }
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// World-space radiance cache: a hash grid of the radiance reflected by the surfaces, see
+// HelloVulkan::createRadianceCache. A cell is a cube of `cellSize` in world space, for one of the
+// 6 main directions of the normal. The first vertices of each path add the radiance found after
+// them to their cell; from the second bounce, a path reaching a cell with enough samples stops
+// there and takes the cached radiance instead of tracing the rest.
+//
+// - The key of a cell is hashed twice: one hash gives its first slot, the other is the checksum
+//   stored in the slot to recognize the cell (0: free slot). Collisions are resolved by linear
+//   probing over CACHE_PROBES slots.
+// - The paths accumulate the radiance of the frame in fixed point, with integer atomics.
+//   radiance_cache.comp blends it in the cached radiance at the next frame, and evicts the cells
+//   without samples for a while. A lookup never stops at a free slot: an evicted cell may be in
+//   the middle of the probes of another one.
+//
+// Requires binding.glsl
+
+#define CACHE_PROBES 8
+#define CACHE_VERTICES 4          // First vertices of a path updating the cache
+#define CACHE_FIXED_SCALE 256.0   // Fixed point of the accumulation
+#define CACHE_MAX_RADIANCE 256.0  // Clamped: at least 65536 samples per cell and frame fit
+
+// Counters of the frame, see HelloVulkan::RadianceCacheCounters
+#define CACHE_QUERIES 0
+#define CACHE_HITS 1
+#define CACHE_RAYS 2       // Bounce rays traced
+#define CACHE_TAIL_RAYS 3  // Bounce rays traced after the lookups that missed
+#define CACHE_INSERTS 4
+#define CACHE_DROPS 5  // Vertices without a free slot
+#define CACHE_CELLS 6  // Cells in use, counted by radiance_cache.comp
+#define CACHE_EVICTIONS 7
+
+// std430: 48 bytes, HelloVulkan::RadianceCacheCell
+struct CacheCell
+{
+  vec4 radiance;  // Blended over the frames, w: samples
+  uint accum[4];  // Radiance of the frame being traced, in fixed point. 3: samples
+  uint checksum;  // 0: free
+  uint age;       // Frames without sample
+};
+
+// clang-format off
+layout(set = 1, binding = B_RADIANCE_CACHE) buffer _RadianceCache {CacheCell cacheCells[];};
+layout(set = 1, binding = B_CACHE_COUNTERS) buffer _CacheCounters {uint cacheCounters[];};
+// clang-format on
+
+// Statistics of the paths of an invocation, added to the counters once
+struct CacheStats
+{
+  uint queries;
+  uint hits;
+  uint rays;
+  uint tailRays;
+  uint inserts;
+  uint drops;
+};
+
+// Vertices of a path updating the cache, when the path is complete
+struct CachePath
+{
+  vec3 position[CACHE_VERTICES];
+  vec3 normal[CACHE_VERTICES];
+  vec3 before[CACHE_VERTICES];  // Radiance of the path up to the reflection at the vertex
+  vec3 weight[CACHE_VERTICES];  // Throughput of the path up to the vertex
+  int  nbVertices;
+};
+
+uint pcgHash(uint v)
+{
+  uint state = v * 747796405u + 2891336453u;
+  uint word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+uint xxHash32(uint v)
+{
+  uint h = v + 374761393u;
+  h      = 668265263u * ((h << 17) | (h >> 15));
+  h      = 2246822519u * (h ^ (h >> 15));
+  h      = 3266489917u * (h ^ (h >> 13));
+  return h ^ (h >> 16);
+}
+
+// x: hash of the first slot, y: checksum, never 0
+uvec2 cacheKey(vec3 position, vec3 normal, float cellSize)
+{
+  uvec3 p    = uvec3(ivec3(floor(position / cellSize)));
+  vec3  n    = abs(normal);
+  uint  axis = n.x > n.y ? (n.x > n.z ? 0u : 2u) : (n.y > n.z ? 1u : 2u);
+  uint  dir  = axis * 2u + (normal[axis] < 0.0 ? 1u : 0u);
+
+  uint slot     = pcgHash(dir + pcgHash(p.z + pcgHash(p.y + pcgHash(p.x))));
+  uint checksum = xxHash32(dir + xxHash32(p.z + xxHash32(p.y + xxHash32(p.x))));
+  return uvec2(slot, max(checksum, 1u));
+}
+
+// Reflected radiance of the cell of the point, if it has at least `minSamples`
+bool cacheLookup(vec3 position, vec3 normal, float cellSize, int minSamples, out vec3 radiance)
+{
+  const uvec2 key  = cacheKey(position, normal, cellSize);
+  const uint  mask = uint(cacheCells.length()) - 1;  // Power of two
+  for(uint i = 0; i < CACHE_PROBES; i++)
+  {
+    uint slot = (key.x + i) & mask;
+    if(cacheCells[slot].checksum == key.y)
+    {
+      vec4 cached = cacheCells[slot].radiance;
+      radiance    = cached.xyz;
+      return cached.w >= float(minSamples);
+    }
+  }
+  radiance = vec3(0);
+  return false;
+}
+
+void cacheAccumulate(uint slot, uvec3 value)
+{
+  atomicAdd(cacheCells[slot].accum[0], value.x);
+  atomicAdd(cacheCells[slot].accum[1], value.y);
+  atomicAdd(cacheCells[slot].accum[2], value.z);
+  atomicAdd(cacheCells[slot].accum[3], 1u);
+}
+
+// Adds a sample of the reflected radiance to the cell of the point, false if the probes are full.
+// The cell is searched in all the probes before claiming a free slot: after an eviction, a free
+// slot can come before the cell, which would be duplicated.
+bool cacheInsert(vec3 position, vec3 normal, float cellSize, vec3 radiance)
+{
+  const uvec2 key   = cacheKey(position, normal, cellSize);
+  const uint  mask  = uint(cacheCells.length()) - 1;
+  const uvec3 value = uvec3(min(radiance, vec3(CACHE_MAX_RADIANCE)) * CACHE_FIXED_SCALE + 0.5);
+  for(uint i = 0; i < CACHE_PROBES; i++)
+  {
+    uint slot = (key.x + i) & mask;
+    if(cacheCells[slot].checksum == key.y)
+    {
+      cacheAccumulate(slot, value);
+      return true;
+    }
+  }
+  // New cell. Concurrent inserts of the same cell probe in the same order: they claim the same
+  // first free slot, or find it claimed by the other.
+  for(uint i = 0; i < CACHE_PROBES; i++)
+  {
+    uint slot = (key.x + i) & mask;
+    uint prev = atomicCompSwap(cacheCells[slot].checksum, 0u, key.y);
+    if(prev == 0u || prev == key.y)
+    {
+      cacheAccumulate(slot, value);
+      return true;
+    }
+  }
+  return false;
+}
+
+void cacheAddVertex(inout CachePath path, vec3 position, vec3 normal, vec3 before, vec3 weight)
+{
+  if(path.nbVertices >= CACHE_VERTICES)
+    return;
+  path.position[path.nbVertices] = position;
+  path.normal[path.nbVertices]   = normal;
+  path.before[path.nbVertices]   = before;
+  path.weight[path.nbVertices]   = weight;
+  path.nbVertices++;
+}
+
+// With the radiance of the complete path: the radiance reflected at a vertex is the part of the
+// path after it, divided by the throughput up to it. It includes the radiance of the cells which
+// ended the path, so the cache converges to the radiance of infinite bounces.
+void cacheUpdatePath(in CachePath path, vec3 pathRadiance, float cellSize, inout CacheStats stats)
+{
+  for(int i = 0; i < path.nbVertices; i++)
+  {
+    // A channel without throughput tells nothing about the radiance of the vertex
+    vec3 weight = path.weight[i];
+    if(any(lessThanEqual(weight, vec3(0))))
+      continue;
+    vec3 reflected = max(pathRadiance - path.before[i], vec3(0)) / weight;
+    if(cacheInsert(path.position[i], path.normal[i], cellSize, reflected))
+      stats.inserts++;
+    else
+      stats.drops++;
+  }
+}
+
+void cacheAddStats(in CacheStats stats)
+{
+  atomicAdd(cacheCounters[CACHE_QUERIES], stats.queries);
+  atomicAdd(cacheCounters[CACHE_HITS], stats.hits);
+  atomicAdd(cacheCounters[CACHE_RAYS], stats.rays);
+  atomicAdd(cacheCounters[CACHE_TAIL_RAYS], stats.tailRays);
+  atomicAdd(cacheCounters[CACHE_INSERTS], stats.inserts);
+  atomicAdd(cacheCounters[CACHE_DROPS], stats.drops);
+}
@@ -17,12 +17,26 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+// State of the sample sequences (sampler.glsl)
+struct Sampler
+{
+  uint  type;
+  uvec2 pixel;
+  uint  index;      // Sample of the pixel
+  uint  dimension;  // Pairs of dimensions consumed
+  uint  seed;       // Pixel hash, or state of the white noise
+};
+
 struct hitPayload
 {
   vec3 hitValue;
-  uint seed;
+  Sampler sampler;
   uint depth;
   vec3 rayOrigin;
   vec3 rayDirection;
   vec3 weight;
+  float bsdfPdf;   // Of rayDirection, for MIS with the light sampling. 0: camera ray
+  vec3 hitNormal;  // Of the surface at rayOrigin, for the radiance cache
+  vec3 emission;   // Part of hitValue emitted by the surface
+  bool cached;     // hitValue comes from the radiance cache, the path ends
 };
@@ -57,13 +57,13 @@ float rnd(inout uint prev)
 // Sampling
 //-------------------------------------------------------------------------------------------------
 
-// Randomly sampling around +Z
-vec3 samplingHemisphere(inout uint seed, in vec3 x, in vec3 y, in vec3 z)
+// Randomly sampling around +Z, cosine distributed, from two uniform numbers (sampler.glsl)
+vec3 samplingHemisphere(in vec2 u, in vec3 x, in vec3 y, in vec3 z)
 {
 #define M_PI 3.141592
 
-  float r1 = rnd(seed);
-  float r2 = rnd(seed);
+  float r1 = u.x;
+  float r2 = u.y;
   float sq = sqrt(1.0 - r2);
 
   vec3 direction = vec3(cos(2 * M_PI * r1) * sq, sin(2 * M_PI * r1) * sq, sqrt(r2));
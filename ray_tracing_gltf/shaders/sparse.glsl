@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2019-2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2019-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Sparse tracing: each invocation owns a cell of `phases` pixels, and traces one of them per
+// frame, in turn. The cells are 2x1 for the checkerboard (the traced pixel alternates between
+// rows), and 2x2 for the interleaved pattern (the pixels are visited in a diagonal order).
+// phases: 1 for all pixels, 2 for the checkerboard, 4 for one pixel of each 2x2 block
+ivec2 cellSize(int phases)
+{
+  return phases == 4 ? ivec2(2, 2) : (phases == 2 ? ivec2(2, 1) : ivec2(1, 1));
+}
+
+ivec2 pixelOfPhase(int phases, ivec2 cell, int phase)
+{
+  const ivec2 order[4] = ivec2[](ivec2(0, 0), ivec2(1, 1), ivec2(1, 0), ivec2(0, 1));
+
+  ivec2 offset = ivec2(0);
+  if(phases == 2)
+    offset.x = (cell.y + phase) & 1;
+  else if(phases == 4)
+    offset = order[phase];
+  return cell * cellSize(phases) + offset;
+}
@@ -18,6 +18,8 @@
  */
 
 
+#include <algorithm>
+#include <random>
 #include <sstream>
 #include <vulkan/vulkan.hpp>
 
@@ -47,6 +49,7 @@ struct CameraMatrices
   nvmath::mat4f viewInverse;
   // #VKRay
   nvmath::mat4f projInverse;
+  nvmath::mat4f prevViewProj;  // Temporal reuse of the lantern reservoirs
 };
 
 
@@ -78,7 +81,9 @@ void HelloVulkan::updateUniformBuffer(const vk::CommandBuffer& cmdBuf)
   // hostUBO.proj[1][1] *= -1;  // Inverting Y for Vulkan (not needed with perspectiveVK).
   hostUBO.viewInverse = nvmath::invert(hostUBO.view);
   // #VKRay
-  hostUBO.projInverse = nvmath::invert(hostUBO.proj);
+  hostUBO.projInverse  = nvmath::invert(hostUBO.proj);
+  hostUBO.prevViewProj = m_prevViewProj;
+  m_prevViewProj       = hostUBO.proj * hostUBO.view;
 
   // UBO on the device, and what stages access it.
   vk::Buffer deviceUBO = m_cameraMat.buffer;
@@ -124,7 +129,7 @@ void HelloVulkan::createDescriptorSetLayout()
 
   // Camera matrices (binding = 0)
   m_descSetLayoutBind.addBinding(
-      vkDS(0, vkDT::eUniformBuffer, 1, vkSS::eVertex | vkSS::eRaygenKHR));
+      vkDS(0, vkDT::eUniformBuffer, 1, vkSS::eVertex | vkSS::eRaygenKHR | vkSS::eClosestHitKHR));
   // Materials (binding = 1)
   m_descSetLayoutBind.addBinding(
       vkDS(1, vkDT::eStorageBuffer, nbObj, vkSS::eVertex | vkSS::eFragment | vkSS::eClosestHitKHR));
@@ -294,6 +299,27 @@ void HelloVulkan::addLantern(nvmath::vec3f pos, nvmath::vec3f color, float brigh
   m_lanterns.push_back({pos, color, brightness, radius});
 }
 
+//--------------------------------------------------------------------------------------------------
+// Scatter `count` lanterns of random colors around the building, to measure how the lighting
+// scales with the number of lanterns. The brightness is divided by the count, so the scene
+// receives about the same light as with the 10 default lanterns.
+//
+void HelloVulkan::addRandomLanterns(uint32_t count, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  // Not std::uniform_real_distribution: same lanterns with all the standard libraries
+  auto uniform = [&rng](float a, float b) { return a + (b - a) * float(rng() >> 8) / 16777216.f; };
+
+  const float brightness = 5.f / static_cast<float>(count);
+  for(uint32_t i = 0; i < count; i++)
+  {
+    nvmath::vec3f pos(uniform(-4.f, 10.f), uniform(0.1f, 4.5f), uniform(-5.f, 6.f));
+    nvmath::vec3f color(uniform(0.f, 1.f), uniform(0.f, 1.f), uniform(0.f, 1.f));
+    color /= std::max(color.x, std::max(color.y, color.z));
+    addLantern(pos, color, brightness * uniform(0.5f, 1.5f), uniform(3.f, 7.f));
+  }
+}
+
 //--------------------------------------------------------------------------------------------------
 // Creating the uniform buffer holding the camera matrices
 // - Buffer is host visible
@@ -452,7 +478,9 @@ void HelloVulkan::destroyResources()
   m_alloc.destroy(m_lanternIndirectBuffer);
   m_alloc.destroy(m_lanternVertexBuffer);
   m_alloc.destroy(m_lanternIndexBuffer);
+  m_alloc.destroy(m_lanternReservoirs);
 
+  m_profiler.destroy();
   m_alloc.deinit();
 }
 
@@ -496,6 +524,7 @@ void HelloVulkan::onResize(int /*w*/, int /*h*/)
 {
   createOffscreenRender();
   updatePostDescriptorSet();
+  createLanternReservoirs();
   updateRtDescriptorSet();
 }
 
@@ -516,7 +545,8 @@ void HelloVulkan::createOffscreenRender()
     auto colorCreateInfo = nvvk::makeImage2DCreateInfo(m_size, m_offscreenColorFormat,
                                                        vk::ImageUsageFlagBits::eColorAttachment
                                                            | vk::ImageUsageFlagBits::eSampled
-                                                           | vk::ImageUsageFlagBits::eStorage);
+                                                           | vk::ImageUsageFlagBits::eStorage
+                                                           | vk::ImageUsageFlagBits::eTransferSrc);
 
 
     nvvk::Image             image  = m_alloc.createImage(colorCreateInfo);
@@ -924,7 +954,8 @@ void HelloVulkan::createTopLevelAS()
 }
 
 //--------------------------------------------------------------------------------------------------
-// This descriptor set holds the Acceleration structure, output image, and lanterns array buffer.
+// This descriptor set holds the Acceleration structure, output image, lanterns array buffer,
+// and the reservoirs of the resampled lanterns.
 //
 void HelloVulkan::createRtDescriptorSet()
 {
@@ -944,6 +975,11 @@ void HelloVulkan::createRtDescriptorSet()
       vkDSLB(2, vkDT::eStorageBuffer, 1, vkSS::eRaygenKHR | vkSS::eClosestHitKHR));
   assert(m_lanternCount > 0);
 
+  // Lantern reservoirs (binding = 3)
+  m_rtDescSetLayoutBind.addBinding(  //
+      vkDSLB(3, vkDT::eStorageBuffer, 1, vkSS::eRaygenKHR | vkSS::eClosestHitKHR));
+  assert(m_lanternReservoirs.buffer);
+
   m_rtDescPool      = m_rtDescSetLayoutBind.createPool(m_device);
   m_rtDescSetLayout = m_rtDescSetLayoutBind.createLayout(m_device);
   m_rtDescSet       = m_device.allocateDescriptorSets({m_rtDescPool, 1, &m_rtDescSetLayout})[0];
@@ -956,17 +992,19 @@ void HelloVulkan::createRtDescriptorSet()
       {}, m_offscreenColor.descriptor.imageView, vk::ImageLayout::eGeneral};
   vk::DescriptorBufferInfo lanternBufferInfo{m_lanternIndirectBuffer.buffer, 0,
                                              m_lanternCount * sizeof(LanternIndirectEntry)};
+  vk::DescriptorBufferInfo reservoirBufferInfo{m_lanternReservoirs.buffer, 0, VK_WHOLE_SIZE};
 
   std::vector<vk::WriteDescriptorSet> writes;
   writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 0, &descASInfo));
   writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 1, &imageInfo));
   writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 2, &lanternBufferInfo));
+  writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 3, &reservoirBufferInfo));
   m_device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 }
 
 
 //--------------------------------------------------------------------------------------------------
-// Writes the output image to the descriptor set
+// Writes the output image and the lantern reservoirs to the descriptor set
 // - Required when changing resolution
 //
 void HelloVulkan::updateRtDescriptorSet()
@@ -976,8 +1014,13 @@ void HelloVulkan::updateRtDescriptorSet()
   // (1) Output buffer
   vk::DescriptorImageInfo imageInfo{
       {}, m_offscreenColor.descriptor.imageView, vk::ImageLayout::eGeneral};
-  vk::WriteDescriptorSet wds{m_rtDescSet, 1, 0, 1, vkDT::eStorageImage, &imageInfo};
-  m_device.updateDescriptorSets(wds, nullptr);
+  // (3) Lantern reservoirs, one per pixel
+  vk::DescriptorBufferInfo reservoirBufferInfo{m_lanternReservoirs.buffer, 0, VK_WHOLE_SIZE};
+
+  std::vector<vk::WriteDescriptorSet> writes;
+  writes.emplace_back(m_rtDescSet, 1, 0, 1, vkDT::eStorageImage, &imageInfo);
+  writes.emplace_back(m_rtDescSet, 3, 0, 1, vkDT::eStorageBuffer, nullptr, &reservoirBufferInfo);
+  m_device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 }
 
 
@@ -1283,22 +1326,43 @@ void HelloVulkan::createLanternIndirectBuffer()
   assert(m_lanternCount == m_lanterns.size());
 
   // m_alloc behind the scenes uses cmdBuf to transfer data to the buffer.
+  // A staging buffer is used: vkCmdUpdateBuffer is limited to 64 KB, about 1200 lanterns.
   nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
   vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
 
+  std::vector<LanternIndirectEntry> entries(m_lanternCount);
+  for(size_t i = 0; i < m_lanternCount; ++i)
+    entries[i].lantern = m_lanterns[i];
+
   using Usage = vk::BufferUsageFlagBits;
   m_lanternIndirectBuffer =
-      m_alloc.createBuffer(sizeof(LanternIndirectEntry) * m_lanternCount,
+      m_alloc.createBuffer(cmdBuf, entries,
                            Usage::eIndirectBuffer | Usage::eTransferDst
-                               | Usage::eShaderDeviceAddress | Usage::eStorageBuffer,
-                           vk::MemoryPropertyFlagBits::eDeviceLocal);
+                               | Usage::eShaderDeviceAddress | Usage::eStorageBuffer);
 
-  std::vector<LanternIndirectEntry> entries(m_lanternCount);
-  for(size_t i = 0; i < m_lanternCount; ++i)
-    entries[i].lantern = m_lanterns[i];
-  cmdBuf.updateBuffer(m_lanternIndirectBuffer.buffer, 0, entries.size() * sizeof entries[0],
-                      entries.data());
+  cmdBufGet.submitAndWait(cmdBuf);
+  m_alloc.finalizeAndReleaseStaging();
+}
 
+// Allocate the reservoirs of the resampled lanterns: two per pixel of the output image, see
+// lanternReservoir.glsl. They are cleared, so the temporal reuse starts without history.
+// Called again when the window is resized.
+void HelloVulkan::createLanternReservoirs()
+{
+  static_assert(sizeof(LanternReservoir) == 48, "Must match the std430 layout of the shaders");
+  m_alloc.destroy(m_lanternReservoirs);
+
+  vk::DeviceSize size =
+      2 * static_cast<vk::DeviceSize>(m_size.width) * m_size.height * sizeof(LanternReservoir);
+  m_lanternReservoirs = m_alloc.createBuffer(size,
+                                             vk::BufferUsageFlagBits::eStorageBuffer
+                                                 | vk::BufferUsageFlagBits::eTransferDst,
+                                             vk::MemoryPropertyFlagBits::eDeviceLocal);
+  m_debug.setObjectName(m_lanternReservoirs.buffer, "lanternReservoirs");
+
+  nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
+  cmdBuf.fillBuffer(m_lanternReservoirs.buffer, 0, VK_WHOLE_SIZE, 0);
   cmdBufGet.submitAndWait(cmdBuf);
 }
 
@@ -1315,56 +1379,88 @@ void HelloVulkan::createLanternIndirectBuffer()
 // effect. This is stored in m_lanternIndirectBuffer. Then an indirect trace rays command
 // is run for every lantern within its scissor rectangle. The lanterns' light
 // contribution is additively blended into the output image.
+//
+// With resampled lanterns (m_rtPushConstants.restirLanterns), the first pass also fills the
+// lantern reservoirs, and the lantern passes are replaced by a single full-screen pass which
+// traces one shadow ray per pixel, whatever the number of lanterns. See lanternReservoir.glsl.
 void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor)
 {
+  const bool restirLanterns = m_rtPushConstants.restirLanterns != 0;
+
   // Before tracing rays, we need to dispatch the compute shaders that
   // fill in the ray trace indirect parameters for each lantern pass.
+  if(!restirLanterns)
+  {
+    m_profiler.beginSection(cmdBuf, "Lantern indirect");
+
+    // First, barrier before, ensure writes aren't visible to previous frame.
+    vk::BufferMemoryBarrier bufferBarrier;
+    bufferBarrier.setSrcAccessMask(vk::AccessFlagBits::eIndirectCommandRead);
+    bufferBarrier.setDstAccessMask(vk::AccessFlagBits::eShaderWrite);
+    bufferBarrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+    bufferBarrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+    bufferBarrier.setBuffer(m_lanternIndirectBuffer.buffer);
+    bufferBarrier.offset = 0;
+    bufferBarrier.size   = m_lanternCount * sizeof(LanternIndirectEntry);
+    cmdBuf.pipelineBarrier(                         //
+        vk::PipelineStageFlagBits::eDrawIndirect,   //
+        vk::PipelineStageFlagBits::eComputeShader,  //
+        vk::DependencyFlags(0),                     //
+        {}, {bufferBarrier}, {});
+
+    // Bind compute shader, update push constant and descriptors, dispatch compute.
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_lanternIndirectCompPipeline);
+    nvmath::mat4 view                           = getViewMatrix();
+    m_lanternIndirectPushConstants.viewRowX     = view.row(0);
+    m_lanternIndirectPushConstants.viewRowY     = view.row(1);
+    m_lanternIndirectPushConstants.viewRowZ     = view.row(2);
+    m_lanternIndirectPushConstants.proj         = getProjMatrix();
+    m_lanternIndirectPushConstants.nearZ        = nearZ;
+    m_lanternIndirectPushConstants.screenX      = m_size.width;
+    m_lanternIndirectPushConstants.screenY      = m_size.height;
+    m_lanternIndirectPushConstants.lanternCount = int32_t(m_lanternCount);
+    cmdBuf.pushConstants<LanternIndirectPushConstants>(m_lanternIndirectCompPipelineLayout,
+                                                       vk::ShaderStageFlagBits::eCompute, 0,
+                                                       m_lanternIndirectPushConstants);
+    cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_lanternIndirectCompPipelineLayout,
+                              0, {m_lanternIndirectDescSet}, {});
+    cmdBuf.dispatch(1, 1, 1);
+
+    // Ensure compute results are visible when doing indirect ray trace.
+    bufferBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
+    bufferBarrier.setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead);
+    cmdBuf.pipelineBarrier(                         //
+        vk::PipelineStageFlagBits::eComputeShader,  //
+        vk::PipelineStageFlagBits::eDrawIndirect,   //
+        vk::DependencyFlags(0),                     //
+        {}, {bufferBarrier}, {});
+
+    m_profiler.endSection(cmdBuf);
+  }
 
-  // First, barrier before, ensure writes aren't visible to previous frame.
-  vk::BufferMemoryBarrier bufferBarrier;
-  bufferBarrier.setSrcAccessMask(vk::AccessFlagBits::eIndirectCommandRead);
-  bufferBarrier.setDstAccessMask(vk::AccessFlagBits::eShaderWrite);
-  bufferBarrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
-  bufferBarrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
-  bufferBarrier.setBuffer(m_lanternIndirectBuffer.buffer);
-  bufferBarrier.offset = 0;
-  bufferBarrier.size   = m_lanternCount * sizeof m_lanterns[0];
-  cmdBuf.pipelineBarrier(                         //
-      vk::PipelineStageFlagBits::eDrawIndirect,   //
-      vk::PipelineStageFlagBits::eComputeShader,  //
-      vk::DependencyFlags(0),                     //
-      {}, {bufferBarrier}, {});
-
-  // Bind compute shader, update push constant and descriptors, dispatch compute.
-  cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_lanternIndirectCompPipeline);
-  nvmath::mat4 view                           = getViewMatrix();
-  m_lanternIndirectPushConstants.viewRowX     = view.row(0);
-  m_lanternIndirectPushConstants.viewRowY     = view.row(1);
-  m_lanternIndirectPushConstants.viewRowZ     = view.row(2);
-  m_lanternIndirectPushConstants.proj         = getProjMatrix();
-  m_lanternIndirectPushConstants.nearZ        = nearZ;
-  m_lanternIndirectPushConstants.screenX      = m_size.width;
-  m_lanternIndirectPushConstants.screenY      = m_size.height;
-  m_lanternIndirectPushConstants.lanternCount = int32_t(m_lanternCount);
-  cmdBuf.pushConstants<LanternIndirectPushConstants>(m_lanternIndirectCompPipelineLayout,
-                                                     vk::ShaderStageFlagBits::eCompute, 0,
-                                                     m_lanternIndirectPushConstants);
-  cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_lanternIndirectCompPipelineLayout, 0,
-                            {m_lanternIndirectDescSet}, {});
-  cmdBuf.dispatch(1, 1, 1);
-
-  // Ensure compute results are visible when doing indirect ray trace.
-  bufferBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
-  bufferBarrier.setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead);
-  cmdBuf.pipelineBarrier(                         //
-      vk::PipelineStageFlagBits::eComputeShader,  //
-      vk::PipelineStageFlagBits::eDrawIndirect,   //
-      vk::DependencyFlags(0),                     //
-      {}, {bufferBarrier}, {});
+  // The reservoirs of a pass are read by the next one, including the final reservoirs of the
+  // previous frame read by the first pass.
+  vk::BufferMemoryBarrier reservoirBarrier;
+  reservoirBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
+  reservoirBarrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead
+                                    | vk::AccessFlagBits::eShaderWrite);
+  reservoirBarrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+  reservoirBarrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+  reservoirBarrier.setBuffer(m_lanternReservoirs.buffer);
+  reservoirBarrier.offset = 0;
+  reservoirBarrier.size   = VK_WHOLE_SIZE;
+  if(restirLanterns)
+  {
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eRayTracingShaderKHR,  //
+                           vk::PipelineStageFlagBits::eRayTracingShaderKHR,  //
+                           vk::DependencyFlags(0),                           //
+                           {}, {reservoirBarrier}, {});
+  }
 
 
   // Now move on to the actual ray tracing.
   m_debug.beginLabel(cmdBuf, "Ray trace");
+  m_profiler.beginSection(cmdBuf, "Ray trace");
 
   // Initialize push constant values
   m_rtPushConstants.clearColor        = clearColor;
@@ -1375,6 +1471,7 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
   m_rtPushConstants.screenX           = m_size.width;
   m_rtPushConstants.screenY           = m_size.height;
   m_rtPushConstants.lanternDebug      = m_lanternDebug;
+  m_rtPushConstants.lanternCount      = int32_t(m_lanternCount);
 
   cmdBuf.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, m_rtPipeline);
   cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eRayTracingKHR, m_rtPipelineLayout, 0,
@@ -1402,42 +1499,150 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
   cmdBuf.traceRaysKHR(&strideAddresses[0], &strideAddresses[1],  //
                       &strideAddresses[2], &strideAddresses[3],  //
                       m_size.width, m_size.height, 1);
-
-  // Lantern passes, ensure previous pass completed, then add light contribution from each lantern.
-  for(int i = 0; i < static_cast<int>(m_lanternCount); ++i)
+  m_profiler.endSection(cmdBuf);
+
+  // Barrier to ensure previous pass finished.
+  vk::Image                 offscreenImage{m_offscreenColor.image};
+  vk::ImageSubresourceRange colorRange(vk::ImageAspectFlagBits::eColor, 0,
+                                       VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
+  vk::ImageMemoryBarrier    imageBarrier;
+  imageBarrier.setOldLayout(vk::ImageLayout::eGeneral);
+  imageBarrier.setNewLayout(vk::ImageLayout::eGeneral);
+  imageBarrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+  imageBarrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+  imageBarrier.setImage(offscreenImage);
+  imageBarrier.setSubresourceRange(colorRange);
+  imageBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
+  imageBarrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+  // Resampled lanterns: one full-screen pass adding the light of the lantern selected by each
+  // pixel.
+  if(restirLanterns)
   {
-    // Barrier to ensure previous pass finished.
-    vk::Image                 offscreenImage{m_offscreenColor.image};
-    vk::ImageSubresourceRange colorRange(vk::ImageAspectFlagBits::eColor, 0,
-                                         VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
-    vk::ImageMemoryBarrier    imageBarrier;
-    imageBarrier.setOldLayout(vk::ImageLayout::eGeneral);
-    imageBarrier.setNewLayout(vk::ImageLayout::eGeneral);
-    imageBarrier.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
-    imageBarrier.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
-    imageBarrier.setImage(offscreenImage);
-    imageBarrier.setSubresourceRange(colorRange);
-    imageBarrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite);
-    imageBarrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    m_profiler.beginSection(cmdBuf, "Lantern reservoirs");
     cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eRayTracingShaderKHR,  //
                            vk::PipelineStageFlagBits::eRayTracingShaderKHR,  //
                            vk::DependencyFlags(0),                           //
-                           {}, {}, {imageBarrier});
+                           {}, {reservoirBarrier}, {imageBarrier});
 
-    // Set lantern pass number.
-    m_rtPushConstants.lanternPassNumber = i;
+    m_rtPushConstants.lanternPassNumber = -2;
     cmdBuf.pushConstants<RtPushConstant>(m_rtPipelineLayout,
                                          vk::ShaderStageFlagBits::eRaygenKHR
                                              | vk::ShaderStageFlagBits::eClosestHitKHR
                                              | vk::ShaderStageFlagBits::eMissKHR,
                                          0, m_rtPushConstants);
-
-    // Execute lantern pass.
-    cmdBuf.traceRaysIndirectKHR(&strideAddresses[0], &strideAddresses[1],  //
-                                &strideAddresses[2], &strideAddresses[3],  //
-                                m_device.getBufferAddress({m_lanternIndirectBuffer.buffer})
-                                    + i * sizeof(LanternIndirectEntry));
+    cmdBuf.traceRaysKHR(&strideAddresses[0], &strideAddresses[1],  //
+                        &strideAddresses[2], &strideAddresses[3],  //
+                        m_size.width, m_size.height, 1);
+    m_profiler.endSection(cmdBuf);
+  }
+  else
+  {
+    // Lantern passes, ensure previous pass completed, then add light contribution from each
+    // lantern.
+    m_profiler.beginSection(cmdBuf, "Lantern passes");
+    for(int i = 0; i < static_cast<int>(m_lanternCount); ++i)
+    {
+      cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eRayTracingShaderKHR,  //
+                             vk::PipelineStageFlagBits::eRayTracingShaderKHR,  //
+                             vk::DependencyFlags(0),                           //
+                             {}, {}, {imageBarrier});
+
+      // Set lantern pass number.
+      m_rtPushConstants.lanternPassNumber = i;
+      cmdBuf.pushConstants<RtPushConstant>(m_rtPipelineLayout,
+                                           vk::ShaderStageFlagBits::eRaygenKHR
+                                               | vk::ShaderStageFlagBits::eClosestHitKHR
+                                               | vk::ShaderStageFlagBits::eMissKHR,
+                                           0, m_rtPushConstants);
+
+      // Execute lantern pass.
+      cmdBuf.traceRaysIndirectKHR(&strideAddresses[0], &strideAddresses[1],  //
+                                  &strideAddresses[2], &strideAddresses[3],  //
+                                  m_device.getBufferAddress({m_lanternIndirectBuffer.buffer})
+                                      + i * sizeof(LanternIndirectEntry));
+    }
+    m_profiler.endSection(cmdBuf);
   }
 
+  m_rtPushConstants.frame++;
   m_debug.endLabel(cmdBuf);
 }
+
+//////////////////////////////////////////////////////////////////////////
+// #Quality
+//////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------------------
+// Copying the offscreen color image (RGBA32F) to the host. This waits for the GPU: it is only
+// used for the measures.
+//
+bool HelloVulkan::readOffscreenImage(std::vector<float>& pixels)
+{
+  vk::DeviceSize nbPixels = static_cast<vk::DeviceSize>(m_size.width) * m_size.height;
+  vk::DeviceSize size     = nbPixels * 4 * sizeof(float);
+  nvvk::Buffer   staging  = m_alloc.createBuffer(size, vk::BufferUsageFlagBits::eTransferDst,
+                                               vk::MemoryPropertyFlagBits::eHostVisible
+                                                   | vk::MemoryPropertyFlagBits::eHostCoherent);
+  if(!staging.buffer)
+    return false;
+
+  {
+    nvvk::CommandPool genCmdBuf(m_device, m_graphicsQueueIndex);
+    auto              cmdBuf = genCmdBuf.createCommandBuffer();
+
+    // Waiting for the frames submitted before, which write the image
+    vk::MemoryBarrier before{vk::AccessFlagBits::eShaderWrite
+                                 | vk::AccessFlagBits::eColorAttachmentWrite,
+                             vk::AccessFlagBits::eTransferRead};
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                           vk::PipelineStageFlagBits::eTransfer, {}, {before}, {}, {});
+
+    vk::BufferImageCopy region;
+    region.setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1});
+    region.setImageExtent({m_size.width, m_size.height, 1});
+    cmdBuf.copyImageToBuffer(m_offscreenColor.image, vk::ImageLayout::eGeneral, staging.buffer,
+                             {region});
+
+    vk::MemoryBarrier after{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead};
+    cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                           {}, {after}, {}, {});
+    genCmdBuf.submitAndWait(cmdBuf);
+  }
+
+  const float* mapped = reinterpret_cast<const float*>(m_alloc.map(staging));
+  pixels.assign(mapped, mapped + size / sizeof(float));
+  m_alloc.unmap(staging);
+  m_alloc.destroy(staging);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The current image becomes the reference, usually with one scissor pass per lantern, which
+// sums the exact light of every lantern.
+//
+void HelloVulkan::captureReference()
+{
+  if(!readOffscreenImage(m_reference))
+    return;
+  m_referenceSize     = m_size;
+  m_hasReferenceError = false;
+  LOGI("Reference captured: %s, %u lanterns\n",
+       m_rtPushConstants.restirLanterns ? "resampled lanterns" : "lantern passes",
+       static_cast<uint32_t>(m_lanternCount));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Error of the current image against the reference, which must have been captured with the same
+// camera and size. The resampled lanterns are not accumulated: this is the error of one frame.
+//
+void HelloVulkan::compareToReference()
+{
+  std::vector<float> pixels;
+  if(m_reference.empty() || m_referenceSize != m_size || !readOffscreenImage(pixels))
+    return;
+  m_referenceError    = compareImages(pixels.data(), m_reference.data(), pixels.size() / 4);
+  m_hasReferenceError = true;
+  LOGI("Error against the reference: RMSE %.4f, PSNR %.2f dB, relMSE %.3e\n",
+       m_referenceError.rmse, m_referenceError.psnr, m_referenceError.relMse);
+}
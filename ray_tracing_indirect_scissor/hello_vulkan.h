@@ -26,6 +26,9 @@
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/memallocator_dma_vk.hpp"
 
+#include "gpu_profiler.h"
+#include "image_metrics.h"
+
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
 
@@ -47,6 +50,7 @@ public:
   void createGraphicsPipeline();
   void loadModel(const std::string& filename, nvmath::mat4f transform = nvmath::mat4f(1));
   void addLantern(nvmath::vec3f pos, nvmath::vec3f color, float brightness, float radius);
+  void addRandomLanterns(uint32_t count, uint32_t seed);
   void updateDescriptorSet();
   void createUniformBuffer();
   void createSceneDescriptionBuffer();
@@ -141,8 +145,11 @@ public:
   nvvk::Buffer               m_sceneDesc;  // Device buffer of the OBJ instances
   std::vector<nvvk::Texture> m_textures;   // vector of all textures of the scene
 
-  nvvk::ResourceAllocatorDma m_alloc;  // Allocator for buffer, images, acceleration structures
-  nvvk::DebugUtil            m_debug;  // Utility to name objects
+  nvvk::ResourceAllocatorDma m_alloc;     // Allocator for buffer, images, acceleration structures
+  nvvk::DebugUtil            m_debug;     // Utility to name objects
+  GpuProfiler                m_profiler;  // GPU timestamps of each pass
+
+  nvmath::mat4f m_prevViewProj{1};  // Camera of the previous frame, for the temporal reuse
 
   // #Post
   void createOffscreenRender();
@@ -182,6 +189,7 @@ public:
   void createLanternIndirectCompPipeline();
   void createRtShaderBindingTable();
   void createLanternIndirectBuffer();
+  void createLanternReservoirs();
 
   void raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor);
 
@@ -239,6 +247,16 @@ public:
 
     // See m_lanternDebug.
     int32_t lanternDebug;
+
+    // Resampled lanterns, see lanternReservoir.glsl. Replaces the lantern passes with one
+    // full-screen pass (lanternPassNumber = -2), tracing one shadow ray per pixel.
+    int32_t  restirLanterns{0};
+    int32_t  lanternCount{0};
+    int32_t  lanternCandidates{16};  // Lanterns picked per pixel and frame
+    int32_t  lanternNeighbors{4};    // Reservoirs combined by the spatial reuse
+    float    lanternRadius{16.f};    // Of the spatial reuse, in pixels
+    int32_t  lanternMaxHistory{20};  // Of the temporal reuse, in frames of candidates
+    uint32_t frame{0};
   } m_rtPushConstants;
 
   // Copied to RtPushConstant::lanternDebug. If true,
@@ -246,6 +264,33 @@ public:
   // so that I can see the screen rectangle coverage.
   bool m_lanternDebug = false;
 
+  // Reservoir of a pixel, see lanternReservoir.glsl.
+  struct LanternReservoir
+  {
+    nvmath::vec3f position;
+    int32_t       lantern;
+    nvmath::vec3f normal;
+    float         W;
+    uint32_t      M;
+    float         weightSum;
+    float         padding[2];  // std430 alignment of the vec3
+  };
+
+  // Two reservoirs per pixel: output of the temporal reuse, and final one. Resized with the
+  // output image.
+  nvvk::Buffer m_lanternReservoirs;
+
+  // #Quality: error of the output image against a reference, usually the exact sum of the
+  // lantern passes, to compare with the resampled lanterns.
+  bool readOffscreenImage(std::vector<float>& pixels);
+  void captureReference();
+  void compareToReference();
+
+  std::vector<float> m_reference;  // RGBA32F
+  vk::Extent2D       m_referenceSize;
+  ImageError         m_referenceError;
+  bool               m_hasReferenceError{false};
+
 
   // Push constant for compute shader filling lantern indirect buffer.
   // Barely fits in 128-byte push constant limit guaranteed by spec.
@@ -22,7 +22,9 @@
 // pipeline If you are new to ImGui, see examples/README.txt and documentation
 // at the top of imgui.cpp.
 
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <vulkan/vulkan.hpp>
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
@@ -66,6 +68,40 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
     ImGui::Checkbox("Lantern Debug", &helloVk.m_lanternDebug);
   }
+  if(ImGui::CollapsingHeader("Lanterns"))
+  {
+    auto& pc = helloVk.m_rtPushConstants;
+    ImGui::Text("%u lanterns", static_cast<uint32_t>(helloVk.m_lanternCount));
+    ImGui::RadioButton("Pass per lantern", &pc.restirLanterns, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("Resampled", &pc.restirLanterns, 1);
+    if(pc.restirLanterns)
+    {
+      ImGui::SliderInt("Candidates", &pc.lanternCandidates, 1, 64);
+      ImGui::SliderInt("Neighbors", &pc.lanternNeighbors, 0, 16);
+      ImGui::SliderFloat("Radius", &pc.lanternRadius, 1.f, 64.f, "%.0f pixels");
+      ImGui::SliderInt("Max history", &pc.lanternMaxHistory, 0, 64, "%d frames");
+    }
+
+    // Quality of the resampled lanterns: reference captured with the lantern passes
+    if(ImGui::Button("Capture reference"))
+      helloVk.captureReference();
+    if(!helloVk.m_reference.empty())
+    {
+      ImGui::SameLine();
+      if(ImGui::Button("Compare"))
+        helloVk.compareToReference();
+    }
+    if(helloVk.m_hasReferenceError)
+    {
+      const auto& error = helloVk.m_referenceError;
+      ImGui::Text("RMSE %.4f, PSNR %.2f dB, relMSE %.2e", error.rmse, error.psnr, error.relMse);
+    }
+  }
+  if(ImGui::CollapsingHeader("GPU Profiler"))
+  {
+    helloVk.m_profiler.renderUI();
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -79,7 +115,14 @@ static int const SAMPLE_HEIGHT = 720;
 //
 int main(int argc, char** argv)
 {
-  UNUSED(argc);
+  // --lanterns <count>: random lanterns instead of the 10 default ones, to compare the lantern
+  // passes and the resampled lanterns as the number of lanterns grows
+  uint32_t lanternCount = 0;
+  for(int i = 1; i + 1 < argc; i++)
+  {
+    if(strcmp(argv[i], "--lanterns") == 0)
+      lanternCount = static_cast<uint32_t>(std::max(atoi(argv[++i]), 0));
+  }
 
   // Setup GLFW window
   glfwSetErrorCallback(onErrorCallback);
@@ -161,6 +204,8 @@ int main(int argc, char** argv)
   helloVk.setup(vkctx.m_instance, vkctx.m_device, vkctx.m_physicalDevice,
                 vkctx.m_queueGCT.familyIndex);
   helloVk.createSwapchain(surface, SAMPLE_WIDTH, SAMPLE_HEIGHT);
+  helloVk.m_profiler.setup(vkctx.m_device, vkctx.m_physicalDevice, vkctx.m_queueGCT.familyIndex,
+                           static_cast<uint32_t>(helloVk.getCommandBuffers().size()));
   helloVk.createDepthBuffer();
   helloVk.createRenderPass();
   helloVk.createFrameBuffers();
@@ -171,16 +216,23 @@ int main(int argc, char** argv)
   // Creation of the example
   helloVk.loadModel(nvh::findFile("media/scenes/Medieval_building.obj", defaultSearchPaths, true));
   helloVk.loadModel(nvh::findFile("media/scenes/plane.obj", defaultSearchPaths, true));
-  helloVk.addLantern({8.000f, 1.100f, 3.600f}, {1.0f, 0.0f, 0.0f}, 0.4f, 4.0f);
-  helloVk.addLantern({8.000f, 0.600f, 3.900f}, {0.0f, 1.0f, 0.0f}, 0.4f, 4.0f);
-  helloVk.addLantern({8.000f, 1.100f, 4.400f}, {0.0f, 0.0f, 1.0f}, 0.4f, 4.0f);
-  helloVk.addLantern({1.730f, 1.812f, -1.604f}, {0.0f, 0.4f, 0.4f}, 0.4f, 4.0f);
-  helloVk.addLantern({1.730f, 1.862f, 1.916f}, {0.0f, 0.2f, 0.4f}, 0.3f, 3.0f);
-  helloVk.addLantern({-2.000f, 1.900f, -0.700f}, {0.8f, 0.8f, 0.6f}, 0.4f, 3.9f);
-  helloVk.addLantern({0.100f, 0.080f, -2.392f}, {1.0f, 0.0f, 1.0f}, 0.5f, 5.0f);
-  helloVk.addLantern({1.948f, 0.080f, 0.598f}, {1.0f, 1.0f, 1.0f}, 0.6f, 6.0f);
-  helloVk.addLantern({-2.300f, 0.080f, 2.100f}, {0.0f, 0.7f, 0.0f}, 0.6f, 6.0f);
-  helloVk.addLantern({-1.400f, 4.300f, 0.150f}, {1.0f, 1.0f, 0.0f}, 0.7f, 7.0f);
+  if(lanternCount > 0)
+  {
+    helloVk.addRandomLanterns(lanternCount, 42);
+  }
+  else
+  {
+    helloVk.addLantern({8.000f, 1.100f, 3.600f}, {1.0f, 0.0f, 0.0f}, 0.4f, 4.0f);
+    helloVk.addLantern({8.000f, 0.600f, 3.900f}, {0.0f, 1.0f, 0.0f}, 0.4f, 4.0f);
+    helloVk.addLantern({8.000f, 1.100f, 4.400f}, {0.0f, 0.0f, 1.0f}, 0.4f, 4.0f);
+    helloVk.addLantern({1.730f, 1.812f, -1.604f}, {0.0f, 0.4f, 0.4f}, 0.4f, 4.0f);
+    helloVk.addLantern({1.730f, 1.862f, 1.916f}, {0.0f, 0.2f, 0.4f}, 0.3f, 3.0f);
+    helloVk.addLantern({-2.000f, 1.900f, -0.700f}, {0.8f, 0.8f, 0.6f}, 0.4f, 3.9f);
+    helloVk.addLantern({0.100f, 0.080f, -2.392f}, {1.0f, 0.0f, 1.0f}, 0.5f, 5.0f);
+    helloVk.addLantern({1.948f, 0.080f, 0.598f}, {1.0f, 1.0f, 1.0f}, 0.6f, 6.0f);
+    helloVk.addLantern({-2.300f, 0.080f, 2.100f}, {0.0f, 0.7f, 0.0f}, 0.6f, 6.0f);
+    helloVk.addLantern({-1.400f, 4.300f, 0.150f}, {1.0f, 1.0f, 0.0f}, 0.7f, 7.0f);
+  }
 
   helloVk.createOffscreenRender();
   helloVk.createDescriptorSetLayout();
@@ -194,6 +246,7 @@ int main(int argc, char** argv)
   helloVk.createBottomLevelAS();
   helloVk.createTopLevelAS();
   helloVk.createLanternIndirectBuffer();
+  helloVk.createLanternReservoirs();
   helloVk.createRtDescriptorSet();
   helloVk.createRtPipeline();
   helloVk.createLanternIndirectDescriptorSet();
@@ -246,6 +299,7 @@ int main(int argc, char** argv)
     const vk::CommandBuffer& cmdBuf   = helloVk.getCommandBuffers()[curFrame];
 
     cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    helloVk.m_profiler.beginFrame(cmdBuf, curFrame);
 
     // Updating camera buffer
     helloVk.updateUniformBuffer(cmdBuf);
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Resampled lanterns (pushC.restirLanterns), instead of one scissor pass per lantern. Each
+// pixel keeps a reservoir: one lantern selected among all the candidates it has seen, with
+// weighted reservoir sampling. See "Spatiotemporal reservoir resampling for real-time ray
+// tracing with dynamic direct lighting", Bitterli et al. 2020.
+//
+// - Pass -1 (global pass): the closest hit shader streams `lanternCandidates` lanterns picked
+//   uniformly, then the final reservoir of the previous frame where the surface was, and
+//   writes the result in the temporal half of the buffer.
+// - Pass -2 (LANTERN_PASS_RESERVOIRS): the closest hit shader combines its temporal reservoir
+//   with the ones of `lanternNeighbors` random neighbours, writes the result in the final half
+//   and traces the only shadow ray, towards the selected lantern.
+//
+// The target function is the unshadowed light reflected from a lantern, so the cost of the
+// passes depends on the number of candidates and neighbours, not on the number of lanterns.
+// The neighbours are combined with the biased 1/M weights: they only need to be on a similar
+// surface, no extra shadow ray is traced.
+//
+// Requires raycommon.glsl and random.glsl
+
+#define LANTERN_PASS_RESERVOIRS -2
+
+#define RESERVOIR_TEMPORAL 0  // Written by pass -1, read by pass -2
+#define RESERVOIR_FINAL 1     // Written by pass -2, read by pass -1 of the next frame
+
+// std430: 48 bytes, HelloVulkan::LanternReservoir
+struct LanternReservoir
+{
+  vec3  position;  // Surface of the pixel, to validate the reuse
+  int   lantern;   // Selected lantern, -1: none
+  vec3  normal;
+  float W;          // Contribution weight of the lantern: weightSum / (M * targetPdf(lantern))
+  uint  M;          // Candidates seen, 0: empty reservoir
+  float weightSum;  // Sum of the resampling weights
+};
+
+LanternReservoir emptyReservoir(vec3 position, vec3 normal)
+{
+  return LanternReservoir(position, -1, normal, 0.0, 0u, 0.0);
+}
+
+// Index of the reservoir of a pixel, in the temporal or the final half of the buffer
+uint reservoirIndex(ivec2 pixel, int stage)
+{
+  return uint((stage * pushC.screenY + pixel.y) * pushC.screenX + pixel.x);
+}
+
+// Weighted reservoir sampling: the lantern replaces the selection with a probability
+// weight / weightSum. `M` is the number of candidates it stands for.
+void updateReservoir(inout LanternReservoir r, int lantern, float weight, uint M, inout uint seed)
+{
+  r.weightSum += weight;
+  r.M += M;
+  if(weight > 0.0 && rnd(seed) * r.weightSum < weight)
+    r.lantern = lantern;
+}
+
+// `targetPdf` is the one of the selected lantern
+void finalizeReservoir(inout LanternReservoir r, float targetPdf)
+{
+  r.W = (r.M > 0u && targetPdf > 0.0) ? r.weightSum / (float(r.M) * targetPdf) : 0.0;
+}
+
+// A reservoir is reused only by a surface close to its own: same orientation, and close to the
+// plane of the surface relative to the distance from the camera
+bool similarSurface(in LanternReservoir r, vec3 position, vec3 normal, float viewDistance)
+{
+  return r.M > 0u && dot(r.normal, normal) > 0.9
+         && abs(dot(r.position - position, normal)) < 0.05 * viewDistance;
+}
@@ -32,8 +32,16 @@ layout(push_constant) uniform Constants
   float lightIntensity;
   int   lightType;         // 0: point, 1: infinite
   int   lanternPassNumber; // -1 if this is the full-screen pass. Otherwise, used to lookup trace indirect parameters.
+                           // -2 for the resampled lanterns pass, see lanternReservoir.glsl.
   int   screenX;
   int   screenY;
   int   lanternDebug;
+  int   restirLanterns;    // 0: one pass per lantern, 1: resampled lanterns
+  int   lanternCount;
+  int   lanternCandidates; // Lanterns picked per pixel and frame
+  int   lanternNeighbors;  // Spatial reuse
+  float lanternRadius;     // Of the spatial reuse, in pixels
+  int   lanternMaxHistory; // Of the temporal reuse, in frames
+  uint  frame;
 }
 pushC;
\ No newline at end of file
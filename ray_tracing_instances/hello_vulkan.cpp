@@ -18,6 +18,7 @@
  */
 
 
+#include <chrono>
 #include <sstream>
 #include <vulkan/vulkan.hpp>
 
@@ -39,6 +40,7 @@ extern std::vector<std::string> defaultSearchPaths;
 #include "nvvk/pipeline_vk.hpp"
 #include "nvvk/renderpasses_vk.hpp"
 #include "nvvk/shaders_vk.hpp"
+#include "trace_events.h"
 
 
 // Holding the camera matrices
@@ -63,6 +65,7 @@ void HelloVulkan::setup(const vk::Instance&       instance,
   AppBase::setup(instance, device, physicalDevice, queueFamily);
   m_alloc.init(instance, device, physicalDevice);
   m_debug.setup(m_device);
+  m_memStats.setup(device, physicalDevice);
   m_offscreenDepthFormat = nvvk::findDepthFormat(physicalDevice);
 }
 
@@ -144,8 +147,16 @@ void HelloVulkan::createDescriptorSetLayout()
   m_descSetLayoutBind.addBinding(  //
       vkDS(6, vkDT::eStorageBuffer, nbObj, vkSS::eClosestHitKHR));
 
+  // The slots of the streamed models are written while the frames in flight use the set: they
+  // are not accessed by those frames, no instance of the model is drawn or traced yet
+  // (descriptorBindingPartiallyBound and descriptorBindingUpdateUnusedWhilePending, Vulkan 1.2)
+  VkDescriptorBindingFlags modelFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+                                        | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+  for(uint32_t binding : {1u, 4u, 5u, 6u})
+    m_descSetLayoutBind.setBindingFlags(binding, modelFlags);
 
-  m_descSetLayout = m_descSetLayoutBind.createLayout(m_device);
+  m_descSetLayout =
+      m_descSetLayoutBind.createLayout(m_device, 0, nvvk::DescriptorSupport::CORE_1_2);
   m_descPool      = m_descSetLayoutBind.createPool(m_device, 1);
   m_descSet       = nvvk::allocateDescriptorSet(m_device, m_descPool, m_descSetLayout);
 }
@@ -170,6 +181,16 @@ void HelloVulkan::updateDescriptorSet()
   std::vector<vk::DescriptorBufferInfo> dbiIdx;
   for(auto& obj : m_objModel)
   {
+    if(!obj.ready)
+    {
+      // Not loaded yet, never accessed: no instance of the model is drawn or traced
+      vk::DescriptorBufferInfo placeholder{m_placeholder.buffer, 0, VK_WHOLE_SIZE};
+      dbiMat.emplace_back(placeholder);
+      dbiMatIdx.emplace_back(placeholder);
+      dbiVert.emplace_back(placeholder);
+      dbiIdx.emplace_back(placeholder);
+      continue;
+    }
     dbiMat.emplace_back(obj.matColorBuffer.buffer, 0, VK_WHOLE_SIZE);
     dbiMatIdx.emplace_back(obj.matIndexBuffer.buffer, 0, VK_WHOLE_SIZE);
     dbiVert.emplace_back(obj.vertexBuffer.buffer, 0, VK_WHOLE_SIZE);
@@ -197,6 +218,8 @@ void HelloVulkan::updateDescriptorSet()
 //
 void HelloVulkan::createGraphicsPipeline()
 {
+  TRACE_SCOPE("createGraphicsPipeline");
+
   using vkSS = vk::ShaderStageFlagBits;
 
   vk::PushConstantRange pushConstantRanges = {vkSS::eVertex | vkSS::eFragment, 0,
@@ -234,11 +257,46 @@ void HelloVulkan::createGraphicsPipeline()
 //
 void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform)
 {
-  using vkBU = vk::BufferUsageFlagBits;
+  TRACE_SCOPE("loadModel", filename);
 
   LOGI("Loading File:  %s \n", filename.c_str());
   ObjLoader loader;
   loader.loadModel(filename);
+  loadModel(std::move(loader), transform);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Setting up the buffers of an OBJ already in memory (loaded, or generated)
+//
+void HelloVulkan::loadModel(ObjLoader loader, nvmath::mat4f transform)
+{
+  uint32_t objIndex = static_cast<uint32_t>(m_objModel.size());
+  m_objModel.emplace_back();
+  addInstance(objIndex, transform);
+  m_objInstance.back().txtOffset = static_cast<uint32_t>(m_textures.size());
+
+  // Create the buffers on Device and copy vertices, indices and materials
+  nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
+  uploadModel(cmdBuf, loader, objIndex);
+
+  // Creates all textures found
+  createTextureImages(cmdBuf, loader.m_textures);
+  {
+    TRACE_SCOPE("Submit and wait");
+    cmdBufGet.submitAndWait(cmdBuf);
+  }
+  m_alloc.finalizeAndReleaseStaging();
+  m_objModel[objIndex].ready = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Recording the upload of the buffers of the model `objIndex`, the slot must exist. The model
+// is ready once the command buffer completed.
+//
+void HelloVulkan::uploadModel(const vk::CommandBuffer& cmdBuf, ObjLoader& loader, uint32_t objIndex)
+{
+  using vkBU = vk::BufferUsageFlagBits;
 
   // Converting from Srgb to linear
   for(auto& m : loader.m_materials)
@@ -248,19 +306,11 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
     m.specular = nvmath::pow(m.specular, 2.2f);
   }
 
-  ObjInstance instance;
-  instance.objIndex    = static_cast<uint32_t>(m_objModel.size());
-  instance.transform   = transform;
-  instance.transformIT = nvmath::transpose(nvmath::invert(transform));
-  instance.txtOffset   = static_cast<uint32_t>(m_textures.size());
-
   ObjModel model;
   model.nbIndices  = static_cast<uint32_t>(loader.m_indices.size());
   model.nbVertices = static_cast<uint32_t>(loader.m_vertices.size());
 
-  // Create the buffers on Device and copy vertices, indices and materials
-  nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
-  vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
+  TraceScope staging("Staging copies");
   model.vertexBuffer =
       m_alloc.createBuffer(cmdBuf, loader.m_vertices,
                            vkBU::eVertexBuffer | vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
@@ -271,19 +321,21 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
                                | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
   model.matColorBuffer = m_alloc.createBuffer(cmdBuf, loader.m_materials, vkBU::eStorageBuffer);
   model.matIndexBuffer = m_alloc.createBuffer(cmdBuf, loader.m_matIndx, vkBU::eStorageBuffer);
-  // Creates all textures found
-  createTextureImages(cmdBuf, loader.m_textures);
-  cmdBufGet.submitAndWait(cmdBuf);
-  m_alloc.finalizeAndReleaseStaging();
+  staging.end();
+
+  int modelId = static_cast<int>(objIndex);
+  m_memStats.trackBuffer(model.vertexBuffer.buffer, MemCategory::eGeometry, modelId);
+  m_memStats.trackBuffer(model.indexBuffer.buffer, MemCategory::eGeometry, modelId);
+  m_memStats.trackBuffer(model.matColorBuffer.buffer, MemCategory::eMaterial, modelId);
+  m_memStats.trackBuffer(model.matIndexBuffer.buffer, MemCategory::eMaterial, modelId);
 
-  std::string objNb = std::to_string(instance.objIndex);
+  std::string objNb = std::to_string(objIndex);
   m_debug.setObjectName(model.vertexBuffer.buffer, (std::string("vertex_" + objNb).c_str()));
   m_debug.setObjectName(model.indexBuffer.buffer, (std::string("index_" + objNb).c_str()));
   m_debug.setObjectName(model.matColorBuffer.buffer, (std::string("mat_" + objNb).c_str()));
   m_debug.setObjectName(model.matIndexBuffer.buffer, (std::string("matIdx_" + objNb).c_str()));
 
-  m_objModel.emplace_back(model);
-  m_objInstance.emplace_back(instance);
+  m_objModel[objIndex] = model;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -298,6 +350,7 @@ void HelloVulkan::createUniformBuffer()
   m_cameraMat = m_alloc.createBuffer(sizeof(CameraMatrices),
                                      vkBU::eUniformBuffer | vkBU::eTransferDst, vkMP::eDeviceLocal);
   m_debug.setObjectName(m_cameraMat.buffer, "cameraMat");
+  m_memStats.trackBuffer(m_cameraMat.buffer, MemCategory::eOther);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -308,6 +361,8 @@ void HelloVulkan::createUniformBuffer()
 //
 void HelloVulkan::createSceneDescriptionBuffer()
 {
+  TRACE_SCOPE("createSceneDescriptionBuffer");
+
   using vkBU = vk::BufferUsageFlagBits;
   nvvk::CommandPool cmdGen(m_device, m_graphicsQueueIndex);
 
@@ -316,6 +371,7 @@ void HelloVulkan::createSceneDescriptionBuffer()
   cmdGen.submitAndWait(cmdBuf);
   m_alloc.finalizeAndReleaseStaging();
   m_debug.setObjectName(m_sceneDesc.buffer, "sceneDesc");
+  m_memStats.trackBuffer(m_sceneDesc.buffer, MemCategory::eOther);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -349,6 +405,7 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer&        cmdBuf,
     // The image format must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     nvvk::cmdBarrierImageLayout(cmdBuf, texture.image, vk::ImageLayout::eUndefined,
                                 vk::ImageLayout::eShaderReadOnlyOptimal);
+    m_memStats.trackImage(texture.image, MemCategory::eTexture);
     m_textures.push_back(texture);
   }
   else
@@ -361,8 +418,10 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer&        cmdBuf,
       o << "media/textures/" << texture;
       std::string txtFile = nvh::findFile(o.str(), defaultSearchPaths, true);
 
-      stbi_uc* stbi_pixels =
+      TraceScope decode("Texture decode", txtFile);
+      stbi_uc*   stbi_pixels =
           stbi_load(txtFile.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+      decode.end();
 
       std::array<stbi_uc, 4> color{255u, 0u, 255u, 255u};
 
@@ -386,6 +445,7 @@ void HelloVulkan::createTextureImages(const vk::CommandBuffer&        cmdBuf,
             nvvk::makeImageViewCreateInfo(image.image, imageCreateInfo);
         nvvk::Texture texture = m_alloc.createTexture(image, ivInfo, samplerCreateInfo);
 
+        m_memStats.trackImage(texture.image, MemCategory::eTexture);
         m_textures.push_back(texture);
       }
 
@@ -403,19 +463,30 @@ void HelloVulkan::destroyResources()
   m_device.destroy(m_pipelineLayout);
   m_device.destroy(m_descPool);
   m_device.destroy(m_descSetLayout);
+  m_memStats.untrackBuffer(m_cameraMat.buffer);
   m_alloc.destroy(m_cameraMat);
+  m_memStats.untrackBuffer(m_sceneDesc.buffer);
   m_alloc.destroy(m_sceneDesc);
+  if(m_placeholder.buffer)
+    m_alloc.destroy(m_placeholder);
 
   for(auto& m : m_objModel)
   {
+    if(!m.vertexBuffer.buffer)
+      continue;  // Not loaded
+    m_memStats.untrackBuffer(m.vertexBuffer.buffer);
     m_alloc.destroy(m.vertexBuffer);
+    m_memStats.untrackBuffer(m.indexBuffer.buffer);
     m_alloc.destroy(m.indexBuffer);
+    m_memStats.untrackBuffer(m.matColorBuffer.buffer);
     m_alloc.destroy(m.matColorBuffer);
+    m_memStats.untrackBuffer(m.matIndexBuffer.buffer);
     m_alloc.destroy(m.matIndexBuffer);
   }
 
   for(auto& t : m_textures)
   {
+    m_memStats.untrackImage(t.image);
     m_alloc.destroy(t);
   }
 
@@ -424,19 +495,51 @@ void HelloVulkan::destroyResources()
   m_device.destroy(m_postPipelineLayout);
   m_device.destroy(m_postDescPool);
   m_device.destroy(m_postDescSetLayout);
+  m_memStats.untrackImage(m_offscreenColor.image);
   m_alloc.destroy(m_offscreenColor);
+  m_memStats.untrackImage(m_offscreenDepth.image);
   m_alloc.destroy(m_offscreenDepth);
   m_device.destroy(m_offscreenRenderPass);
   m_device.destroy(m_offscreenFramebuffer);
 
   // #VKRay
-  m_rtBuilder.destroy();
+  for(auto& blas : m_blas)
+  {
+    if(!blas.accel)
+      continue;
+    m_memStats.untrackBuffer(blas.buffer.buffer);
+    m_alloc.destroy(blas);
+  }
+  if(m_placeholderBlas.accel)
+  {
+    m_memStats.untrackBuffer(m_placeholderBlas.buffer.buffer);
+    m_alloc.destroy(m_placeholderBlas);
+  }
+  if(m_tlas.accel)
+  {
+    m_memStats.untrackBuffer(m_tlas.buffer.buffer);
+    m_alloc.destroy(m_tlas);
+    m_memStats.untrackBuffer(m_instBuffer.buffer);
+    m_alloc.destroy(m_instBuffer);
+    m_memStats.untrackBuffer(m_tlasScratch.buffer);
+    m_alloc.destroy(m_tlasScratch);
+  }
   m_sbtWrapper.destroy();
   m_device.destroy(m_rtDescPool);
   m_device.destroy(m_rtDescSetLayout);
   m_device.destroy(m_rtPipeline);
   m_device.destroy(m_rtPipelineLayout);
 
+  // #Streaming
+  if(m_streamScratch.buffer)
+  {
+    m_memStats.untrackBuffer(m_streamScratch.buffer);
+    m_alloc.destroy(m_streamScratch);
+  }
+  m_device.destroy(m_streamFence);
+  m_device.destroy(m_streamCmdPool);
+
+  m_profiler.destroy();
   m_alloc.deinit();
 }
 
@@ -450,6 +553,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
   vk::DeviceSize offset{0};
 
   m_debug.beginLabel(cmdBuf, "Rasterize");
+  m_profiler.beginSection(cmdBuf, "Rasterize");
 
   // Dynamic Viewport
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
@@ -460,8 +564,10 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
   cmdBuf.bindDescriptorSets(vkPBP::eGraphics, m_pipelineLayout, 0, {m_descSet}, {});
   for(int i = 0; i < m_objInstance.size(); ++i)
   {
-    auto& inst                = m_objInstance[i];
-    auto& model               = m_objModel[inst.objIndex];
+    auto& inst  = m_objInstance[i];
+    auto& model = m_objModel[inst.objIndex];
+    if(!model.ready)
+      continue;  // Still streaming
     m_pushConstant.instanceId = i;  // Telling which instance is drawn
     cmdBuf.pushConstants<ObjPushConstant>(m_pipelineLayout, vkSS::eVertex | vkSS::eFragment, 0,
                                           m_pushConstant);
@@ -470,6 +576,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
     cmdBuf.bindIndexBuffer(model.indexBuffer.buffer, 0, vk::IndexType::eUint32);
     cmdBuf.drawIndexed(model.nbIndices, 1, 0, 0, 0);
   }
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -492,6 +599,10 @@ void HelloVulkan::onResize(int /*w*/, int /*h*/)
 //
 void HelloVulkan::createOffscreenRender()
 {
+  TRACE_SCOPE("createOffscreenRender");
+
+  m_memStats.untrackImage(m_offscreenColor.image);
+  m_memStats.untrackImage(m_offscreenDepth.image);
   m_alloc.destroy(m_offscreenColor);
   m_alloc.destroy(m_offscreenDepth);
 
@@ -524,6 +635,8 @@ void HelloVulkan::createOffscreenRender()
 
     m_offscreenDepth = m_alloc.createTexture(image, depthStencilView);
   }
+  m_memStats.trackImage(m_offscreenColor.image, MemCategory::eRenderTarget);
+  m_memStats.trackImage(m_offscreenDepth.image, MemCategory::eRenderTarget);
 
   // Setting the image layout for both color and depth
   {
@@ -566,6 +679,8 @@ void HelloVulkan::createOffscreenRender()
 //
 void HelloVulkan::createPostPipeline()
 {
+  TRACE_SCOPE("createPostPipeline");
+
   // Push constants in the fragment shader
   vk::PushConstantRange pushConstantRanges = {vk::ShaderStageFlagBits::eFragment, 0, sizeof(float)};
 
@@ -622,6 +737,7 @@ void HelloVulkan::updatePostDescriptorSet()
 void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
 {
   m_debug.beginLabel(cmdBuf, "Post");
+  m_profiler.beginSection(cmdBuf, "Post");
 
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
   cmdBuf.setScissor(0, {{{0, 0}, {m_size.width, m_size.height}}});
@@ -634,6 +750,7 @@ void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
                             m_postDescSet, {});
   cmdBuf.draw(3, 1, 0, 0);
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -649,9 +766,11 @@ void HelloVulkan::initRayTracing()
   // Requesting ray tracing properties
   auto properties =
       m_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
-                                      vk::PhysicalDeviceRayTracingPipelinePropertiesKHR>();
+                                      vk::PhysicalDeviceRayTracingPipelinePropertiesKHR,
+                                      vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
   m_rtProperties = properties.get<vk::PhysicalDeviceRayTracingPipelinePropertiesKHR>();
-  m_rtBuilder.setup(m_device, &m_alloc, m_graphicsQueueIndex);
+  m_asProperties = properties.get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+  m_blas.resize(m_objModel.size());
   m_sbtWrapper.setup(m_device, m_graphicsQueueIndex, &m_alloc, m_rtProperties);
 }
 
@@ -689,36 +808,282 @@ auto HelloVulkan::objectToVkGeometryKHR(const ObjModel& model)
   return input;
 }
 
+//--------------------------------------------------------------------------------------------------
+// Recording the build of the BLAS of `models` into `blas`, all in one batch. The acceleration
+// structures are managed here instead of nvvk::RaytracingBuilderKHR, which builds all the BLAS
+// at once and cannot add more. Returns the scratch buffer, to destroy once `cmdBuf` completed.
+//
+nvvk::Buffer HelloVulkan::buildBlas(const vk::CommandBuffer&             cmdBuf,
+                                    const std::vector<const ObjModel*>& models,
+                                    const std::vector<nvvk::AccelKHR*>& blas)
+{
+  using vkBU = vk::BufferUsageFlagBits;
+
+  // The build infos point to the geometries of the inputs: no reallocation after this
+  std::vector<nvvk::RaytracingBuilderKHR::BlasInput>          inputs;
+  std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos;
+  std::vector<vk::DeviceSize>                                scratchOffsets;
+  inputs.reserve(models.size());
+  vk::DeviceSize scratchSize = 0;
+  vk::DeviceSize alignment   = m_asProperties.minAccelerationStructureScratchOffsetAlignment;
+  for(size_t i = 0; i < models.size(); i++)
+  {
+    inputs.emplace_back(objectToVkGeometryKHR(*models[i]));
+    auto& input = inputs.back();
+
+    vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+    buildInfo.setType(vk::AccelerationStructureTypeKHR::eBottomLevel);
+    buildInfo.setMode(vk::BuildAccelerationStructureModeKHR::eBuild);
+    buildInfo.setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+    buildInfo.setGeometries(input.asGeometry);
+
+    std::vector<uint32_t> maxPrimCount;
+    for(const auto& range : input.asBuildOffsetInfo)
+      maxPrimCount.push_back(range.primitiveCount);
+    auto sizes = m_device.getAccelerationStructureBuildSizesKHR(
+        vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, maxPrimCount);
+
+    vk::AccelerationStructureCreateInfoKHR createInfo;
+    createInfo.setType(vk::AccelerationStructureTypeKHR::eBottomLevel);
+    createInfo.setSize(sizes.accelerationStructureSize);
+    *blas[i] = m_alloc.createAcceleration(createInfo);
+    buildInfo.setDstAccelerationStructure(blas[i]->accel);
+
+    scratchOffsets.push_back(scratchSize);
+    scratchSize += nvh::align_up(sizes.buildScratchSize, alignment);
+    buildInfos.push_back(buildInfo);
+  }
+
+  // One scratch buffer for the batch, each build uses its own part
+  nvvk::Buffer scratch = m_alloc.createBuffer(scratchSize + alignment,
+                                              vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress);
+  m_memStats.trackBuffer(scratch.buffer, MemCategory::eScratch);
+  vk::DeviceAddress scratchAddress = m_device.getBufferAddress({scratch.buffer});
+  std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> ranges;
+  for(size_t i = 0; i < buildInfos.size(); i++)
+  {
+    buildInfos[i].scratchData.setDeviceAddress(nvh::align_up(scratchAddress, alignment)
+                                               + scratchOffsets[i]);
+    ranges.push_back(inputs[i].asBuildOffsetInfo.data());
+  }
+
+  cmdBuf.buildAccelerationStructuresKHR(static_cast<uint32_t>(buildInfos.size()),
+                                        buildInfos.data(), ranges.data());
+
+  // The BLAS are read by the TLAS builds and the ray tracing of the next submissions
+  vk::MemoryBarrier barrier(vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+                            vk::AccessFlagBits::eAccelerationStructureReadKHR);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+                         vk::PipelineStageFlagBits::eAllCommands, {}, {barrier}, {}, {});
+  return scratch;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Building, at startup, the placeholder BLAS used by the instances of the models not loaded yet,
+// and the BLAS of the models which are already ready
+//
 void HelloVulkan::createBottomLevelAS()
 {
-  // BLAS - Storing each primitive in a geometry
-  std::vector<nvvk::RaytracingBuilderKHR::BlasInput> allBlas;
-  allBlas.reserve(m_objModel.size());
-  for(const auto& obj : m_objModel)
+  TRACE_SCOPE("createBottomLevelAS");
+
+  // A single degenerate triangle made of the zeros of the placeholder buffer
+  ObjModel placeholder;
+  placeholder.nbIndices    = 3;
+  placeholder.nbVertices   = 3;
+  placeholder.vertexBuffer = m_placeholder;
+  placeholder.indexBuffer  = m_placeholder;
+
+  std::vector<const ObjModel*> models{&placeholder};
+  std::vector<nvvk::AccelKHR*> blas{&m_placeholderBlas};
+  for(uint32_t i = 0; i < static_cast<uint32_t>(m_objModel.size()); i++)
   {
-    auto blas = objectToVkGeometryKHR(obj);
+    if(m_objModel[i].ready && !m_blas[i].accel)
+    {
+      models.push_back(&m_objModel[i]);
+      blas.push_back(&m_blas[i]);
+    }
+  }
+
+  nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer cmdBuf  = cmdBufGet.createCommandBuffer();
+  nvvk::Buffer      scratch = buildBlas(cmdBuf, models, blas);
+  cmdBufGet.submitAndWait(cmdBuf);
 
-    // We could add more geometry in each BLAS, but we add only one for now
-    allBlas.emplace_back(blas);
+  m_memStats.untrackBuffer(scratch.buffer);
+  m_alloc.destroy(scratch);
+  m_memStats.trackBuffer(m_placeholderBlas.buffer.buffer, MemCategory::eBlas);
+  for(uint32_t i = 0; i < static_cast<uint32_t>(m_objModel.size()); i++)
+  {
+    if(m_blas[i].accel)
+      m_memStats.trackBuffer(m_blas[i].buffer.buffer, MemCategory::eBlas, static_cast<int>(i));
   }
-  m_rtBuilder.buildBlas(allBlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
 }
 
-void HelloVulkan::createTopLevelAS()
+//--------------------------------------------------------------------------------------------------
+// One TLAS instance per object instance, always: the instances of the models which are not ready
+// reference the placeholder BLAS and are masked out. Updates require the same instance count.
+//
+std::vector<vk::AccelerationStructureInstanceKHR> HelloVulkan::tlasInstances()
 {
-  std::vector<nvvk::RaytracingBuilderKHR::Instance> tlas;
-  tlas.reserve(m_objInstance.size());
+  vk::DeviceAddress placeholderAddress =
+      m_device.getAccelerationStructureAddressKHR({m_placeholderBlas.accel});
+
+  std::vector<vk::AccelerationStructureInstanceKHR> instances;
+  instances.reserve(m_objInstance.size());
   for(uint32_t i = 0; i < static_cast<uint32_t>(m_objInstance.size()); i++)
   {
-    nvvk::RaytracingBuilderKHR::Instance rayInst;
-    rayInst.transform        = m_objInstance[i].transform;  // Position of the instance
-    rayInst.instanceCustomId = i;                           // gl_InstanceCustomIndexEXT
-    rayInst.blasId           = m_objInstance[i].objIndex;
-    rayInst.hitGroupId       = 0;  // We will use the same hit group for all objects
-    rayInst.flags            = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-    tlas.emplace_back(rayInst);
+    const ObjInstance& inst  = m_objInstance[i];
+    bool               ready = m_objModel[inst.objIndex].ready;
+
+    vk::AccelerationStructureInstanceKHR rayInst;
+    nvmath::mat4f transp = nvmath::transpose(inst.transform);  // Position of the instance
+    memcpy(&rayInst.transform, &transp, sizeof(rayInst.transform));
+    rayInst.setInstanceCustomIndex(i);  // gl_InstanceCustomIndexEXT
+    rayInst.setMask(ready ? 0xFF : 0x00);
+    rayInst.setInstanceShaderBindingTableRecordOffset(0);  // Same hit group for all objects
+    rayInst.setFlags(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable);
+    rayInst.setAccelerationStructureReference(
+        ready ? m_device.getAccelerationStructureAddressKHR({m_blas[inst.objIndex].accel}) :
+                placeholderAddress);
+    instances.emplace_back(rayInst);
   }
-  m_rtBuilder.buildTlas(tlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+  return instances;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Building the TLAS with all the instances, once. It allows updates: when streamed models are
+// added, updateTopLevelAS refits it in the frame instead of rebuilding a new one.
+//
+void HelloVulkan::createTopLevelAS()
+{
+  TRACE_SCOPE("createTopLevelAS");
+  using vkBU = vk::BufferUsageFlagBits;
+
+  std::vector<vk::AccelerationStructureInstanceKHR> instances = tlasInstances();
+  auto nbInstances = static_cast<uint32_t>(instances.size());
+  if(instances.empty())
+    instances.emplace_back();  // The TLAS can be empty, not the buffer
+
+  nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
+  m_instBuffer             = m_alloc.createBuffer(cmdBuf, instances,
+                                      vkBU::eShaderDeviceAddress | vkBU::eTransferDst
+                                          | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
+  m_debug.setObjectName(m_instBuffer.buffer, "TLASInstances");
+
+  // Making sure the copy of the instances is done before building the TLAS
+  vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite,
+                            vk::AccessFlagBits::eAccelerationStructureWriteKHR);
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                         vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR, {}, {barrier},
+                         {}, {});
+
+  vk::AccelerationStructureGeometryInstancesDataKHR instancesData;
+  instancesData.setData(m_device.getBufferAddress({m_instBuffer.buffer}));
+  vk::AccelerationStructureGeometryKHR topASGeometry{vk::GeometryTypeKHR::eInstances};
+  topASGeometry.geometry.setInstances(instancesData);
+
+  vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+  buildInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+  buildInfo.setMode(vk::BuildAccelerationStructureModeKHR::eBuild);
+  buildInfo.setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace
+                     | vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate);
+  buildInfo.setGeometries(topASGeometry);
+  auto sizes = m_device.getAccelerationStructureBuildSizesKHR(
+      vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, nbInstances);
+
+  vk::AccelerationStructureCreateInfoKHR createInfo;
+  createInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+  createInfo.setSize(sizes.accelerationStructureSize);
+  m_tlas = m_alloc.createAcceleration(createInfo);
+
+  // Kept for the updates, and the final rebuild
+  vk::DeviceSize alignment   = m_asProperties.minAccelerationStructureScratchOffsetAlignment;
+  vk::DeviceSize scratchSize = std::max(sizes.buildScratchSize, sizes.updateScratchSize);
+  m_tlasScratch = m_alloc.createBuffer(scratchSize + alignment,
+                                       vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress);
+  buildInfo.setDstAccelerationStructure(m_tlas.accel);
+  buildInfo.scratchData.setDeviceAddress(
+      nvh::align_up(m_device.getBufferAddress({m_tlasScratch.buffer}), alignment));
+
+  vk::AccelerationStructureBuildRangeInfoKHR        range{nbInstances, 0, 0, 0};
+  const vk::AccelerationStructureBuildRangeInfoKHR* pRange = &range;
+  cmdBuf.buildAccelerationStructuresKHR(1, &buildInfo, &pRange);
+  cmdBufGet.submitAndWait(cmdBuf);
+  m_alloc.finalizeAndReleaseStaging();
+
+  m_memStats.trackBuffer(m_tlas.buffer.buffer, MemCategory::eTlas);
+  m_memStats.trackBuffer(m_instBuffer.buffer, MemCategory::eTlas);
+  m_memStats.trackBuffer(m_tlasScratch.buffer, MemCategory::eScratch);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Recorded in the frame, before the ray tracing: when models were added, the instances are
+// rewritten and the TLAS is updated in place, its handle does not change. Once all the models
+// are streamed, it is rebuilt one last time: refits keep the hierarchy of the placeholders.
+//
+void HelloVulkan::updateTopLevelAS(const vk::CommandBuffer& cmdBuf)
+{
+  if(!m_tlasDirty)
+    return;
+  m_tlasDirty = false;
+
+  using vkAF = vk::AccessFlagBits;
+  using vkPS = vk::PipelineStageFlagBits;
+
+  std::vector<vk::AccelerationStructureInstanceKHR> instances = tlasInstances();
+  auto nbInstances = static_cast<uint32_t>(instances.size());
+  if(instances.empty())
+    return;
+
+  // The previous frames may still be using the instances, the scratch buffer and the TLAS
+  vk::MemoryBarrier before(vkAF::eAccelerationStructureReadKHR
+                               | vkAF::eAccelerationStructureWriteKHR | vkAF::eShaderRead,
+                           vkAF::eTransferWrite | vkAF::eAccelerationStructureReadKHR
+                               | vkAF::eAccelerationStructureWriteKHR);
+  cmdBuf.pipelineBarrier(vkPS::eAccelerationStructureBuildKHR | vkPS::eRayTracingShaderKHR,
+                         vkPS::eTransfer | vkPS::eAccelerationStructureBuildKHR, {}, {before}, {},
+                         {});
+
+  // vkCmdUpdateBuffer is limited to 64 KB
+  const vk::DeviceSize chunk = 65536;
+  vk::DeviceSize       size  = instances.size() * sizeof(vk::AccelerationStructureInstanceKHR);
+  const auto*          data  = reinterpret_cast<const uint8_t*>(instances.data());
+  for(vk::DeviceSize offset = 0; offset < size; offset += chunk)
+    cmdBuf.updateBuffer(m_instBuffer.buffer, offset, std::min(chunk, size - offset), data + offset);
+
+  vk::MemoryBarrier copied(vkAF::eTransferWrite, vkAF::eShaderRead);
+  cmdBuf.pipelineBarrier(vkPS::eTransfer, vkPS::eAccelerationStructureBuildKHR, {}, {copied}, {},
+                         {});
+
+  vk::AccelerationStructureGeometryInstancesDataKHR instancesData;
+  instancesData.setData(m_device.getBufferAddress({m_instBuffer.buffer}));
+  vk::AccelerationStructureGeometryKHR topASGeometry{vk::GeometryTypeKHR::eInstances};
+  topASGeometry.geometry.setInstances(instancesData);
+
+  bool rebuild = m_streamer.isComplete() && m_streamPending.empty();
+
+  vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+  buildInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+  buildInfo.setMode(rebuild ? vk::BuildAccelerationStructureModeKHR::eBuild :
+                              vk::BuildAccelerationStructureModeKHR::eUpdate);
+  buildInfo.setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace
+                     | vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate);
+  buildInfo.setGeometries(topASGeometry);
+  buildInfo.setSrcAccelerationStructure(rebuild ? vk::AccelerationStructureKHR() : m_tlas.accel);
+  buildInfo.setDstAccelerationStructure(m_tlas.accel);
+  vk::DeviceSize alignment = m_asProperties.minAccelerationStructureScratchOffsetAlignment;
+  buildInfo.scratchData.setDeviceAddress(
+      nvh::align_up(m_device.getBufferAddress({m_tlasScratch.buffer}), alignment));
+
+  vk::AccelerationStructureBuildRangeInfoKHR        range{nbInstances, 0, 0, 0};
+  const vk::AccelerationStructureBuildRangeInfoKHR* pRange = &range;
+  cmdBuf.buildAccelerationStructuresKHR(1, &buildInfo, &pRange);
+
+  vk::MemoryBarrier built(vkAF::eAccelerationStructureWriteKHR,
+                          vkAF::eAccelerationStructureReadKHR);
+  cmdBuf.pipelineBarrier(vkPS::eAccelerationStructureBuildKHR, vkPS::eRayTracingShaderKHR, {},
+                         {built}, {}, {});
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -739,7 +1104,7 @@ void HelloVulkan::createRtDescriptorSet()
   m_rtDescSetLayout = m_rtDescSetLayoutBind.createLayout(m_device);
   m_rtDescSet       = m_device.allocateDescriptorSets({m_rtDescPool, 1, &m_rtDescSetLayout})[0];
 
-  vk::AccelerationStructureKHR                   tlas = m_rtBuilder.getAccelerationStructure();
+  vk::AccelerationStructureKHR                   tlas = m_tlas.accel;
   vk::WriteDescriptorSetAccelerationStructureKHR descASInfo;
   descASInfo.setAccelerationStructureCount(1);
   descASInfo.setPAccelerationStructures(&tlas);
@@ -761,11 +1126,20 @@ void HelloVulkan::updateRtDescriptorSet()
 {
   using vkDT = vk::DescriptorType;
 
+  // (0) TLAS, updated in place when streamed models are added
+  vk::AccelerationStructureKHR                   tlas = m_tlas.accel;
+  vk::WriteDescriptorSetAccelerationStructureKHR descASInfo;
+  descASInfo.setAccelerationStructureCount(1);
+  descASInfo.setPAccelerationStructures(&tlas);
+
   // (1) Output buffer
   vk::DescriptorImageInfo imageInfo{
       {}, m_offscreenColor.descriptor.imageView, vk::ImageLayout::eGeneral};
-  vk::WriteDescriptorSet wds{m_rtDescSet, 1, 0, 1, vkDT::eStorageImage, &imageInfo};
-  m_device.updateDescriptorSets(wds, nullptr);
+
+  std::vector<vk::WriteDescriptorSet> writes;
+  writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 0, &descASInfo));
+  writes.emplace_back(m_rtDescSet, 1, 0, 1, vkDT::eStorageImage, &imageInfo);
+  m_device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 }
 
 
@@ -774,6 +1148,8 @@ void HelloVulkan::updateRtDescriptorSet()
 //
 void HelloVulkan::createRtPipeline()
 {
+  TRACE_SCOPE("createRtPipeline");
+
   vk::ShaderModule raygenSM = nvvk::createShaderModule(
       m_device, nvh::loadFile("spv/raytrace.rgen.spv", true, defaultSearchPaths, true));
   vk::ShaderModule missSM = nvvk::createShaderModule(
@@ -864,6 +1240,7 @@ void HelloVulkan::createRtPipeline()
 void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor)
 {
   m_debug.beginLabel(cmdBuf, "Ray trace");
+  m_profiler.beginSection(cmdBuf, "Ray trace");
   // Initializing push constant values
   m_rtPushConstants.clearColor     = clearColor;
   m_rtPushConstants.lightPosition  = m_pushConstant.lightPosition;
@@ -885,5 +1262,216 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
                       1);
 
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
+
+//--------------------------------------------------------------------------------------------------
+// #Streaming
+// Reserving the slots of all the models, creating the dummy texture (streamed models are not
+// textured), the buffer bound in place of the models which are not loaded yet, and the command
+// pool and fence of the stream batches
+//
+void HelloVulkan::initStreaming(uint32_t nbModels)
+{
+  using vkBU = vk::BufferUsageFlagBits;
+  m_objModel.resize(nbModels);
+  m_modelRadius.resize(nbModels, 1.f);
+
+  // Zeros, bound in place of the buffers of the models and forming the placeholder triangle
+  nvvk::CommandPool     cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer     cmdBuf = cmdBufGet.createCommandBuffer();
+  std::vector<uint32_t> zeros(3 * sizeof(VertexObj) / sizeof(uint32_t), 0);
+  m_placeholder = m_alloc.createBuffer(cmdBuf, zeros,
+                                       vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress
+                                           | vkBU::eAccelerationStructureBuildInputReadOnlyKHR);
+  createTextureImages(cmdBuf, {});
+  cmdBufGet.submitAndWait(cmdBuf);
+  m_alloc.finalizeAndReleaseStaging();
+  m_debug.setObjectName(m_placeholder.buffer, "placeholder");
+
+  // The uploads and BLAS builds of the streamed models
+  m_streamCmdPool = m_device.createCommandPool(
+      {vk::CommandPoolCreateFlagBits::eTransient, m_graphicsQueueIndex});
+  m_streamCmdBuf =
+      m_device.allocateCommandBuffers({m_streamCmdPool, vk::CommandBufferLevel::ePrimary, 1})[0];
+  m_streamFence = m_device.createFence({});
+}
+
+//--------------------------------------------------------------------------------------------------
+// Instance of a model, which may not be loaded yet
+//
+void HelloVulkan::addInstance(uint32_t objIndex, const nvmath::mat4f& transform)
+{
+  ObjInstance instance;
+  instance.objIndex    = objIndex;
+  instance.transform   = transform;
+  instance.transformIT = nvmath::transpose(nvmath::invert(transform));
+  instance.txtOffset   = 0;
+  m_objInstance.emplace_back(instance);
+}
+
+//--------------------------------------------------------------------------------------------------
+// `load` is called on a worker thread; `boundRadius` is the radius of the bounding sphere of the
+// model around its origin
+//
+void HelloVulkan::requestModel(uint32_t objIndex, float boundRadius, MeshStreamer::LoadFunc load)
+{
+  m_modelRadius[objIndex] = boundRadius;
+  m_streamer.request(objIndex, 0.f, std::move(load));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Priority of a model: the largest apparent size of its instances, the bounding radius over the
+// distance to the camera
+//
+void HelloVulkan::updateStreamingPriorities()
+{
+  if(m_streamer.isComplete())
+    return;
+
+  nvmath::vec3f eye, center, up;
+  CameraManip.getLookat(eye, center, up);
+
+  std::vector<float> priority(m_objModel.size(), 0.f);
+  for(const auto& inst : m_objInstance)
+  {
+    nvmath::vec4f pos      = inst.transform * nvmath::vec4f(0.f, 0.f, 0.f, 1.f);
+    nvmath::vec4f axis     = inst.transform * nvmath::vec4f(1.f, 0.f, 0.f, 0.f);
+    float         scale    = nvmath::length(nvmath::vec3f(axis.x, axis.y, axis.z));
+    float         distance = nvmath::length(nvmath::vec3f(pos.x, pos.y, pos.z) - eye);
+    float         size     = m_modelRadius[inst.objIndex] * scale / std::max(distance, 1e-3f);
+    priority[inst.objIndex] = std::max(priority[inst.objIndex], size);
+  }
+  m_streamer.setPriorities([&](uint32_t id) { return priority[id]; });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Called between frames, never waits on the device. When the batch in flight is complete, its
+// models are added to the scene; then at most `maxModels` loaded models are uploaded and their
+// BLAS built in a new batch. Returns the number of models added.
+//
+uint32_t HelloVulkan::integrateStreamedModels(uint32_t maxModels)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  uint32_t added = 0;
+  if(!m_streamPending.empty())
+  {
+    if(m_device.getFenceStatus(m_streamFence) != vk::Result::eSuccess)
+      return 0;  // Still building
+    added = finishStreamBatch();
+  }
+
+  std::vector<MeshStreamer::Loaded> loaded = m_streamer.takeLoaded(maxModels);
+  if(!loaded.empty())
+  {
+    TRACE_SCOPE("Stream batch");
+    m_device.resetCommandPool(m_streamCmdPool);
+    m_streamCmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    std::vector<const ObjModel*> models;
+    std::vector<nvvk::AccelKHR*> blas;
+    for(auto& model : loaded)
+    {
+      if(!model.mesh.m_textures.empty())
+        LOGW("Textures of streamed models are ignored (model %u)\n", model.id);
+      uploadModel(m_streamCmdBuf, model.mesh, model.id);
+      m_streamStats.loadMs += model.loadMs;
+      m_streamPending.push_back(model.id);
+      models.push_back(&m_objModel[model.id]);
+      blas.push_back(&m_blas[model.id]);
+    }
+
+    // Copies of the vertices and indices before the builds
+    vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+    m_streamCmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                   vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR, {},
+                                   {barrier}, {}, {});
+    m_streamScratch = buildBlas(m_streamCmdBuf, models, blas);
+    m_streamCmdBuf.end();
+
+    m_device.resetFences(m_streamFence);
+    vk::SubmitInfo submitInfo;
+    submitInfo.setCommandBuffers(m_streamCmdBuf);
+    m_queue.submit(submitInfo, m_streamFence);
+    m_alloc.finalizeStaging(m_streamFence);  // Released when the batch completed
+  }
+
+  if(added == 0 && loaded.empty())
+    return 0;
+
+  double elapsed =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  m_streamStats.integrateMs += elapsed;
+  m_streamStats.maxIntegrateMs = std::max(m_streamStats.maxIntegrateMs, elapsed);
+  return added;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The batch in flight completed: its models become visible, in the descriptors and in the TLAS
+// updated by the next frame
+//
+uint32_t HelloVulkan::finishStreamBatch()
+{
+  m_alloc.releaseStaging();
+  m_memStats.untrackBuffer(m_streamScratch.buffer);
+  m_alloc.destroy(m_streamScratch);
+
+  for(uint32_t objIndex : m_streamPending)
+  {
+    m_objModel[objIndex].ready = true;
+    m_memStats.trackBuffer(m_blas[objIndex].buffer.buffer, MemCategory::eBlas,
+                           static_cast<int>(objIndex));
+  }
+  writeModelDescriptors(m_streamPending);
+  auto added = static_cast<uint32_t>(m_streamPending.size());
+  m_streamPending.clear();
+  m_tlasDirty = true;
+  m_streamStats.nbBatches++;
+
+  if(m_streamer.isComplete())
+  {
+    m_streamStats.completeMs = TraceRecorder::get().now() / 1e6;
+    LOGI("Streaming: first frame %.1f ms, complete %.1f ms (%u models, %u batches)\n",
+         m_streamStats.firstFrameMs, m_streamStats.completeMs, m_streamer.requestedCount(),
+         m_streamStats.nbBatches);
+  }
+  return added;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Writing only the slots of `objIndices` in the model bindings: the other slots may be used by
+// the frames in flight
+//
+void HelloVulkan::writeModelDescriptors(const std::vector<uint32_t>& objIndices)
+{
+  using vkDT = vk::DescriptorType;
+
+  // Stable addresses of the infos, referenced by the writes
+  std::vector<vk::DescriptorBufferInfo> infos;
+  infos.reserve(objIndices.size() * 4);
+  std::vector<vk::WriteDescriptorSet> writes;
+  for(uint32_t objIndex : objIndices)
+  {
+    const ObjModel& obj = m_objModel[objIndex];
+    infos.emplace_back(obj.matColorBuffer.buffer, 0, VK_WHOLE_SIZE);
+    writes.emplace_back(m_descSet, 1, objIndex, 1, vkDT::eStorageBuffer, nullptr, &infos.back());
+    infos.emplace_back(obj.matIndexBuffer.buffer, 0, VK_WHOLE_SIZE);
+    writes.emplace_back(m_descSet, 4, objIndex, 1, vkDT::eStorageBuffer, nullptr, &infos.back());
+    infos.emplace_back(obj.vertexBuffer.buffer, 0, VK_WHOLE_SIZE);
+    writes.emplace_back(m_descSet, 5, objIndex, 1, vkDT::eStorageBuffer, nullptr, &infos.back());
+    infos.emplace_back(obj.indexBuffer.buffer, 0, VK_WHOLE_SIZE);
+    writes.emplace_back(m_descSet, 6, objIndex, 1, vkDT::eStorageBuffer, nullptr, &infos.back());
+  }
+  m_device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Time to first frame, from the start of the application
+//
+void HelloVulkan::onFrameSubmitted()
+{
+  if(m_streamStats.nbFrames++ == 0)
+    m_streamStats.firstFrameMs = TraceRecorder::get().now() / 1e6;
+}
@@ -41,6 +41,10 @@ using Allocator = nvvk::ResourceAllocatorDedicated;
 #include "nvvk/debug_util_vk.hpp"
 #include "nvvk/descriptorsets_vk.hpp"
 
+#include "gpu_profiler.h"
+#include "memory_stats.h"
+#include "mesh_streamer.h"
+
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
 #include "nvvk/sbtwrapper_vk.hpp"
@@ -62,6 +66,8 @@ public:
   void createDescriptorSetLayout();
   void createGraphicsPipeline();
   void loadModel(const std::string& filename, nvmath::mat4f transform = nvmath::mat4f(1));
+  void loadModel(ObjLoader loader, nvmath::mat4f transform = nvmath::mat4f(1));
+  void uploadModel(const vk::CommandBuffer& cmdBuf, ObjLoader& loader, uint32_t objIndex);
   void updateDescriptorSet();
   void createUniformBuffer();
   void createSceneDescriptionBuffer();
@@ -81,6 +87,7 @@ public:
     nvvk::Buffer indexBuffer;     // Device buffer of the indices forming triangles
     nvvk::Buffer matColorBuffer;  // Device buffer of array of 'Wavefront material'
     nvvk::Buffer matIndexBuffer;  // Device buffer of array of 'Wavefront material'
+    bool         ready{false};    // False while the model is being streamed
   };
 
   // Instance of the OBJ
@@ -114,15 +121,19 @@ public:
   vk::DescriptorSetLayout     m_descSetLayout;
   vk::DescriptorSet           m_descSet;
 
-  nvvk::Buffer               m_cameraMat;  // Device-Host of the camera matrices
-  nvvk::Buffer               m_sceneDesc;  // Device buffer of the OBJ instances
-  std::vector<nvvk::Texture> m_textures;   // vector of all textures of the scene
+  nvvk::Buffer               m_cameraMat;    // Device-Host of the camera matrices
+  nvvk::Buffer               m_sceneDesc;    // Device buffer of the OBJ instances
+  std::vector<nvvk::Texture> m_textures;     // vector of all textures of the scene
+  nvvk::Buffer               m_placeholder;  // Bound in place of the models not loaded yet
 
   // Allocator for buffer, images, acceleration structures
   Allocator m_alloc;
 
   nvvk::DebugUtil m_debug;  // Utility to name objects
 
+  GpuProfiler m_profiler;  // GPU timestamps of each pass
+  MemoryStats m_memStats;  // Device memory per category and model
+
   // #Post
   void createOffscreenRender();
   void createPostPipeline();
@@ -146,16 +157,27 @@ public:
   // #VKRay
   void initRayTracing();
   auto objectToVkGeometryKHR(const ObjModel& model);
-  void createBottomLevelAS();
-  void createTopLevelAS();
+  void createBottomLevelAS();  // Placeholder and the models which are ready, at startup
+  void createTopLevelAS();     // All the instances, built once and then updated
+  void updateTopLevelAS(const vk::CommandBuffer& cmdBuf);
+  nvvk::Buffer buildBlas(const vk::CommandBuffer&             cmdBuf,
+                         const std::vector<const ObjModel*>& models,
+                         const std::vector<nvvk::AccelKHR*>& blas);
+  std::vector<vk::AccelerationStructureInstanceKHR> tlasInstances();
   void createRtDescriptorSet();
   void updateRtDescriptorSet();
   void createRtPipeline();
   void raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor);
 
 
-  vk::PhysicalDeviceRayTracingPipelinePropertiesKHR   m_rtProperties;
-  nvvk::RaytracingBuilderKHR                          m_rtBuilder;
+  vk::PhysicalDeviceRayTracingPipelinePropertiesKHR    m_rtProperties;
+  vk::PhysicalDeviceAccelerationStructurePropertiesKHR m_asProperties;
+  std::vector<nvvk::AccelKHR>                          m_blas;  // One per model, null until loaded
+  nvvk::AccelKHR                                       m_tlas;
+  nvvk::Buffer                                         m_instBuffer;   // Instances of the TLAS
+  nvvk::Buffer                                         m_tlasScratch;  // Build and updates
+  nvvk::AccelKHR                                       m_placeholderBlas;  // Models not loaded
+  bool                                                 m_tlasDirty{false};
   nvvk::DescriptorSetBindings                         m_rtDescSetLayoutBind;
   vk::DescriptorPool                                  m_rtDescPool;
   vk::DescriptorSetLayout                             m_rtDescSetLayout;
@@ -172,4 +194,39 @@ public:
     float         lightIntensity;
     int           lightType;
   } m_rtPushConstants;
+
+  // #Streaming
+  // Models are loaded on background threads, the closest and largest first, while the scene
+  // is already rendered. Between frames, the loaded models are uploaded and their BLAS built
+  // on a separate command buffer, with a fence. Once it is signaled, the descriptors of the
+  // models are written and the TLAS is updated in the next frame: no wait on the device.
+  void     initStreaming(uint32_t nbModels);
+  void     addInstance(uint32_t objIndex, const nvmath::mat4f& transform);
+  void     requestModel(uint32_t objIndex, float boundRadius, MeshStreamer::LoadFunc load);
+  void     updateStreamingPriorities();
+  uint32_t integrateStreamedModels(uint32_t maxModels);
+  uint32_t finishStreamBatch();
+  void     writeModelDescriptors(const std::vector<uint32_t>& objIndices);
+  void     onFrameSubmitted();
+
+  struct StreamingStats
+  {
+    double   firstFrameMs{0};    // From the start of the application to the first frame
+    double   completeMs{0};      // From the start of the application to the last model
+    double   loadMs{0};          // Sum of the load times on the worker threads
+    double   integrateMs{0};     // Sum of the integration times on the render thread
+    double   maxIntegrateMs{0};  // Longest integration, a frame hitch
+    uint32_t nbBatches{0};
+    uint32_t nbFrames{0};
+  };
+
+  MeshStreamer          m_streamer;
+  StreamingStats        m_streamStats;
+  vk::CommandPool       m_streamCmdPool;
+  vk::CommandBuffer     m_streamCmdBuf;
+  vk::Fence             m_streamFence;
+  std::vector<uint32_t> m_streamPending;    // Models of the batch in flight
+  nvvk::Buffer          m_streamScratch;    // BLAS scratch of the batch in flight
+  std::vector<float>    m_modelRadius;      // Bounding sphere radius of each model, for priority
+  uint32_t              m_streamBatch{64};  // Max models integrated per frame
 };
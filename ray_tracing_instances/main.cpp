@@ -23,7 +23,7 @@
 // at the top of imgui.cpp.
 
 #include <array>
-#include <random>
+#include <thread>
 #include <vulkan/vulkan.hpp>
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
@@ -38,6 +38,8 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 #include "nvvk/appbase_vkpp.hpp"
 #include "nvvk/commands_vk.hpp"
 #include "nvvk/context_vk.hpp"
+#include "scene_generator.h"
+#include "trace_events.h"
 
 
 // Utility to time the execution of something resetting the timer
@@ -94,6 +96,31 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat3("Position", &helloVk.m_pushConstant.lightPosition.x, -20.f, 20.f);
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
   }
+  if(ImGui::CollapsingHeader("GPU Profiler"))
+  {
+    helloVk.m_profiler.renderUI();
+  }
+  if(ImGui::CollapsingHeader("Memory"))
+  {
+    helloVk.m_memStats.renderUI();
+  }
+  if(ImGui::CollapsingHeader("Streaming"))
+  {
+    const auto& stats = helloVk.m_streamStats;
+    ImGui::Text("Models: %u / %u", helloVk.m_streamer.takenCount(),
+                helloVk.m_streamer.requestedCount());
+    ImGui::Text("First frame: %.1f ms", stats.firstFrameMs);
+    if(helloVk.m_streamer.isComplete())
+      ImGui::Text("Complete: %.1f ms", stats.completeMs);
+    else
+      ImGui::Text("Complete: loading...");
+    ImGui::Text("Load (workers): %.1f ms", stats.loadMs);
+    ImGui::Text("Integration: %.1f ms in %u batches, longest %.1f ms", stats.integrateMs,
+                stats.nbBatches, stats.maxIntegrateMs);
+    int batch = static_cast<int>(helloVk.m_streamBatch);
+    if(ImGui::SliderInt("Models per frame", &batch, 1, 512))
+      helloVk.m_streamBatch = static_cast<uint32_t>(batch);
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -108,6 +135,7 @@ static int const SAMPLE_HEIGHT = 720;
 int main(int argc, char** argv)
 {
   UNUSED(argc);
+  TraceScope traceStartup("Startup");
 
   // Setup GLFW window
   glfwSetErrorCallback(onErrorCallback);
@@ -163,6 +191,7 @@ int main(int argc, char** argv)
   contextInfo.addDeviceExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
   contextInfo.addDeviceExtension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME);
   contextInfo.addDeviceExtension(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+  contextInfo.addDeviceExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, true);  // Optional
   vk::PhysicalDeviceAccelerationStructureFeaturesKHR accelFeature;
   contextInfo.addDeviceExtension(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, false,
                                  &accelFeature);
@@ -171,6 +200,7 @@ int main(int argc, char** argv)
                                  &rtPipelineFeature);
 
   // Creating Vulkan base application
+  TraceScope    traceContext("Vulkan context");
   nvvk::Context vkctx{};
   vkctx.initInstance(contextInfo);
   // Find all compatible devices
@@ -178,6 +208,7 @@ int main(int argc, char** argv)
   assert(!compatibleDevices.empty());
   // Use a compatible device
   vkctx.initDevice(compatibleDevices[0], contextInfo);
+  traceContext.end();
 
   // Create example
   HelloVulkan helloVk;
@@ -189,6 +220,8 @@ int main(int argc, char** argv)
   helloVk.setup(vkctx.m_instance, vkctx.m_device, vkctx.m_physicalDevice,
                 vkctx.m_queueGCT.familyIndex);
   helloVk.createSwapchain(surface, SAMPLE_WIDTH, SAMPLE_HEIGHT);
+  helloVk.m_profiler.setup(vkctx.m_device, vkctx.m_physicalDevice, vkctx.m_queueGCT.familyIndex,
+                           static_cast<uint32_t>(helloVk.getCommandBuffers().size()));
   helloVk.createDepthBuffer();
   helloVk.createRenderPass();
   helloVk.createFrameBuffers();
@@ -198,26 +231,38 @@ int main(int argc, char** argv)
 
   MilliTimer timer;
 
-  // Creation of the example
-  std::random_device              rd;  //Will be used to obtain a seed for the random number engine
-  std::mt19937                    gen(rd());  //Standard mersenne_twister_engine seeded with rd()
-  std::normal_distribution<float> dis(1.0f, 1.0f);
-  std::normal_distribution<float> disn(0.05f, 0.05f);
-  for(int n = 0; n < 2000; ++n)
+  // Creation of the example: the same 2000 objects at each run. Only the placement is known
+  // before the first frame, the meshes and the plane are streamed.
+  SceneGenerator::Settings genSettings;
+  genSettings.seed             = 1;
+  genSettings.nbInstances      = 2000;
+  genSettings.nbMeshes         = 2000;  // One BLAS per object
+  genSettings.trianglesPerMesh = 12;
+  genSettings.materialsPerMesh = 2;
+  genSettings.minScale         = 0.02f;
+  genSettings.maxScale         = 0.15f;
+  genSettings.center           = nvmath::vec3f(1.f, 3.f, 1.f);
+  genSettings.generateMeshes   = false;
+  SceneGenerator::Scene scene  = SceneGenerator::generate(genSettings);
+
+  uint32_t planeIndex = genSettings.nbMeshes;
+  helloVk.initStreaming(genSettings.nbMeshes + 1);
+  for(const auto& genInst : scene.instances)
+    helloVk.addInstance(genInst.meshIndex, genInst.transform);
+  helloVk.addInstance(planeIndex, nvmath::mat4f(1));
+
+  for(uint32_t m = 0; m < genSettings.nbMeshes; m++)
   {
-    helloVk.loadModel(nvh::findFile("media/scenes/cube_multi.obj", defaultSearchPaths, true));
-    HelloVulkan::ObjInstance& inst = helloVk.m_objInstance.back();
-
-    float         scale = fabsf(disn(gen));
-    nvmath::mat4f mat =
-        nvmath::translation_mat4(nvmath::vec3f{dis(gen), 2.0f + dis(gen), dis(gen)});
-    mat              = mat * nvmath::rotation_mat4_x(dis(gen));
-    mat              = mat * nvmath::scale_mat4(nvmath::vec3f(scale));
-    inst.transform   = mat;
-    inst.transformIT = nvmath::transpose(nvmath::invert((inst.transform)));
+    helloVk.requestModel(m, 1.f, [genSettings, m] {
+      return SceneGenerator::generateMesh(genSettings, m);
+    });
   }
-
-  helloVk.loadModel(nvh::findFile("media/scenes/plane.obj", defaultSearchPaths, true));
+  std::string planeFile = nvh::findFile("media/scenes/plane.obj", defaultSearchPaths, true);
+  helloVk.requestModel(planeIndex, 30.f, [planeFile] {
+    ObjLoader loader;
+    loader.loadModel(planeFile);
+    return loader;
+  });
 
   double time_elapse = timer.elapse();
   LOGI(" --> (%f)", time_elapse);
@@ -245,6 +290,18 @@ int main(int argc, char** argv)
   bool          useRaytracer = true;
 
 
+  // Writing the trace of the startup, to be opened in chrome://tracing or ui.perfetto.dev
+  traceStartup.end();
+  if(TraceRecorder::get().dump("load_trace.json"))
+    LOGI("Startup trace written to load_trace.json\n");
+  TraceRecorder::get().setEnabled(false);
+  helloVk.m_memStats.dump("memory_stats.json");
+
+  // Loading the models in the background, after the trace is written: the loaders record
+  // trace events
+  helloVk.updateStreamingPriorities();
+  helloVk.m_streamer.start(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
   helloVk.setupGlfwCallbacks(window);
   ImGui_ImplGlfw_InitForVulkan(window, true);
 
@@ -255,6 +312,10 @@ int main(int argc, char** argv)
     if(helloVk.isMinimized())
       continue;
 
+    // Adding the models loaded since the last frame
+    helloVk.updateStreamingPriorities();
+    helloVk.integrateStreamedModels(helloVk.m_streamBatch);
+
     // Start the Dear ImGui frame
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -281,9 +342,11 @@ int main(int argc, char** argv)
     const vk::CommandBuffer& cmdBuf   = helloVk.getCommandBuffers()[curFrame];
 
     cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    helloVk.m_profiler.beginFrame(cmdBuf, curFrame);
 
-    // Updating camera buffer
+    // Updating camera buffer, and the TLAS if streamed models were added
     helloVk.updateUniformBuffer(cmdBuf);
+    helloVk.updateTopLevelAS(cmdBuf);
 
     // Clearing screen
     std::array<vk::ClearValue, 2> clearValues;
@@ -334,9 +397,11 @@ int main(int argc, char** argv)
     // Submit for display
     cmdBuf.end();
     helloVk.submitFrame();
+    helloVk.onFrameSubmitted();
   }
 
   // Cleanup
+  helloVk.m_streamer.stop();
   helloVk.getDevice().waitIdle();
   helloVk.destroyResources();
   helloVk.destroy();
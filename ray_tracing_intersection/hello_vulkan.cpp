@@ -18,6 +18,7 @@
  */
 
 
+#include <cmath>
 #include <sstream>
 #include <vulkan/vulkan.hpp>
 
@@ -37,8 +38,7 @@ extern std::vector<std::string> defaultSearchPaths;
 #include "nvvk/pipeline_vk.hpp"
 #include "nvvk/renderpasses_vk.hpp"
 #include "nvvk/shaders_vk.hpp"
-
-#include <random>
+#include "scene_generator.h"
 
 // Holding the camera matrices
 struct CameraMatrices
@@ -450,6 +450,7 @@ void HelloVulkan::destroyResources()
   m_alloc.destroy(m_spheresMatColorBuffer);
   m_alloc.destroy(m_spheresMatIndexBuffer);
 
+  m_profiler.destroy();
   m_alloc.deinit();
 }
 
@@ -463,6 +464,8 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
   vk::DeviceSize offset{0};
 
   m_debug.beginLabel(cmdBuf, "Rasterize");
+  m_profiler.beginSection(cmdBuf, "Rasterize");
+  m_postPushConstant.uvScale = nvmath::vec2f(1.f, 1.f);  // Always rendered at full resolution
 
   // Dynamic Viewport
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
@@ -483,6 +486,7 @@ void HelloVulkan::rasterize(const vk::CommandBuffer& cmdBuf)
     cmdBuf.bindIndexBuffer(model.indexBuffer.buffer, 0, vk::IndexType::eUint32);
     cmdBuf.drawIndexed(model.nbIndices, 1, 0, 0, 0);
   }
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -580,7 +584,8 @@ void HelloVulkan::createOffscreenRender()
 void HelloVulkan::createPostPipeline()
 {
   // Push constants in the fragment shader
-  vk::PushConstantRange pushConstantRanges = {vk::ShaderStageFlagBits::eFragment, 0, sizeof(float)};
+  vk::PushConstantRange pushConstantRanges = {vk::ShaderStageFlagBits::eFragment, 0,
+                                              sizeof(PostPushConstant)};
 
   // Creating the pipeline layout
   vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo;
@@ -635,18 +640,21 @@ void HelloVulkan::updatePostDescriptorSet()
 void HelloVulkan::drawPost(vk::CommandBuffer cmdBuf)
 {
   m_debug.beginLabel(cmdBuf, "Post");
+  m_profiler.beginSection(cmdBuf, "Post");
 
   cmdBuf.setViewport(0, {vk::Viewport(0, 0, (float)m_size.width, (float)m_size.height, 0, 1)});
   cmdBuf.setScissor(0, {{{0, 0}, {m_size.width, m_size.height}}});
 
-  auto aspectRatio = static_cast<float>(m_size.width) / static_cast<float>(m_size.height);
-  cmdBuf.pushConstants<float>(m_postPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0,
-                              aspectRatio);
+  m_postPushConstant.aspectRatio =
+      static_cast<float>(m_size.width) / static_cast<float>(m_size.height);
+  cmdBuf.pushConstants<PostPushConstant>(m_postPipelineLayout, vk::ShaderStageFlagBits::eFragment,
+                                         0, m_postPushConstant);
   cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_postPipeline);
   cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_postPipelineLayout, 0,
                             m_postDescSet, {});
   cmdBuf.draw(3, 1, 0, 0);
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
 
@@ -735,22 +743,27 @@ nvvk::RaytracingBuilderKHR::BlasInput HelloVulkan::sphereToVkGeometryKHR()
 
 //--------------------------------------------------------------------------------------------------
 // Creating all spheres
+// - Always the same spheres for a given seed
 //
-void HelloVulkan::createSpheres(uint32_t nbSpheres)
+void HelloVulkan::createSpheres(uint32_t nbSpheres, uint32_t seed)
 {
-  std::random_device                    rd{};
-  std::mt19937                          gen{rd()};
-  std::normal_distribution<float>       xzd{0.f, 5.f};
-  std::normal_distribution<float>       yd{6.f, 3.f};
-  std::uniform_real_distribution<float> radd{.05f, .2f};
+  SceneGenerator::Settings genSettings;
+  genSettings.seed      = seed;
+  genSettings.nbSpheres = nbSpheres;
+  genSettings.minRadius = .05f;
+  genSettings.maxRadius = .2f;
+  genSettings.center    = nvmath::vec3f(0.f, 6.f, 0.f);
+  genSettings.spread    = nvmath::vec3f(5.f, 3.f, 5.f);
+
+  SceneGenerator::Scene scene = SceneGenerator::generate(genSettings);
 
   // All spheres
   m_spheres.resize(nbSpheres);
   for(uint32_t i = 0; i < nbSpheres; i++)
   {
     Sphere s;
-    s.center     = nvmath::vec3f(xzd(gen), yd(gen), xzd(gen));
-    s.radius     = radd(gen);
+    s.center     = scene.spheres[i].center;
+    s.radius     = scene.spheres[i].radius;
     m_spheres[i] = std::move(s);
   }
 
@@ -1052,6 +1065,7 @@ void HelloVulkan::createRtShaderBindingTable()
 void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor)
 {
   m_debug.beginLabel(cmdBuf, "Ray trace");
+  m_profiler.beginSection(cmdBuf, "Ray trace");
   // Initializing push constant values
   m_rtPushConstants.clearColor     = clearColor;
   m_rtPushConstants.lightPosition  = m_pushConstant.lightPosition;
@@ -1080,9 +1094,60 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
       Stride{sbtAddress + 3u * groupSize, groupStride, groupSize * 1},  // hit
       Stride{0u, 0u, 0u}};                                              // callable
 
+  // Tracing at the resolution chosen in updateRenderSize(), the post-process upscales the result
   cmdBuf.traceRaysKHR(&strideAddresses[0], &strideAddresses[1], &strideAddresses[2],
-                      &strideAddresses[3],              //
-                      m_size.width, m_size.height, 1);  //
+                      &strideAddresses[3],                          //
+                      m_renderSize.width, m_renderSize.height, 1);  //
+  m_postPushConstant.uvScale =
+      nvmath::vec2f(static_cast<float>(m_renderSize.width) / m_size.width,
+                    static_cast<float>(m_renderSize.height) / m_size.height);
 
+  m_profiler.endSection(cmdBuf);
   m_debug.endLabel(cmdBuf);
 }
+
+//--------------------------------------------------------------------------------------------------
+// Choosing the ray tracing resolution of the frame about to be recorded.
+// Must be called after m_profiler.beginFrame(), which brought back the timings of a frame
+// recorded a few frames ago: the scale of that frame is found in `m_frameScales`. The ray trace
+// pass is the part of the frame scaling with the resolution, the other passes are fixed.
+//
+void HelloVulkan::updateRenderSize()
+{
+  if(m_frameScales.empty())
+    m_frameScales.resize(16, 1.f);  // More than the number of frames in flight
+
+  const auto& sections    = m_profiler.getLastFrame();
+  uint64_t    frameNumber = m_profiler.getLastFrameNumber();
+  if(m_dynamicResolution && !sections.empty() && frameNumber != m_measuredFrame)
+  {
+    m_measuredFrame = frameNumber;
+
+    double scaledMs = 0.0;
+    double fixedMs  = 0.0;
+    bool   traced   = false;
+    for(const auto& section : sections)
+    {
+      if(section.depth != 0)
+        continue;
+      if(section.name == "Ray trace")
+      {
+        scaledMs += section.gpuMs;
+        traced = true;
+      }
+      else
+        fixedMs += section.gpuMs;
+    }
+
+    // Nothing to learn from the frames rendered with the rasterizer
+    if(traced)
+      m_resolution.addFrame(m_frameScales[frameNumber % m_frameScales.size()], scaledMs, fixedMs);
+  }
+
+  m_resolution.getRenderSize(m_size.width, m_size.height, m_renderSize.width, m_renderSize.height);
+
+  // The scale actually used, after rounding to whole pixels
+  float pixelRatio = static_cast<float>(m_renderSize.width) * m_renderSize.height
+                     / (static_cast<float>(m_size.width) * m_size.height);
+  m_frameScales[m_profiler.getFrameNumber() % m_frameScales.size()] = std::sqrt(pixelRatio);
+}
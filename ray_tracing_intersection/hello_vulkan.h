@@ -28,6 +28,9 @@
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
 
+#include "gpu_profiler.h"
+#include "resolution_controller.h"
+
 //--------------------------------------------------------------------------------------------------
 // Simple rasterizer of OBJ objects
 // - Each OBJ loaded are stored in an `ObjModel` and referenced by a `ObjInstance`
@@ -101,8 +104,9 @@ public:
   nvvk::Buffer               m_sceneDesc;  // Device buffer of the OBJ instances
   std::vector<nvvk::Texture> m_textures;   // vector of all textures of the scene
 
-  nvvk::ResourceAllocatorDma m_alloc;  // Allocator for buffer, images, acceleration structures
-  nvvk::DebugUtil            m_debug;  // Utility to name objects
+  nvvk::ResourceAllocatorDma m_alloc;     // Allocator for buffer, images, acceleration structures
+  nvvk::DebugUtil            m_debug;     // Utility to name objects
+  GpuProfiler                m_profiler;  // GPU timestamps of each pass
 
   // #Post
   void createOffscreenRender();
@@ -111,6 +115,14 @@ public:
   void updatePostDescriptorSet();
   void drawPost(vk::CommandBuffer cmdBuf);
 
+  // Information pushed to the post-process
+  struct PostPushConstant
+  {
+    nvmath::vec2f uvScale{1.f, 1.f};  // Part of the offscreen image holding the rendered frame
+    float         aspectRatio{1.f};
+    float         sharpness{0.5f};  // Edge-aware sharpening of the upscaled image, 0 to 1
+  } m_postPushConstant;
+
   nvvk::DescriptorSetBindings m_postDescSetLayoutBind;
   vk::DescriptorPool          m_postDescPool;
   vk::DescriptorSetLayout     m_postDescSetLayout;
@@ -135,6 +147,15 @@ public:
   void createRtShaderBindingTable();
   void raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor);
 
+  // Dynamic resolution: the rays are traced in the top-left `m_renderSize` part of the offscreen
+  // image, and the post-process upscales it to the window
+  void updateRenderSize();
+
+  ResolutionController m_resolution;
+  bool                 m_dynamicResolution{true};
+  vk::Extent2D         m_renderSize;
+  std::vector<float>   m_frameScales;            // Scale of the last frames, by frame number
+  uint64_t             m_measuredFrame{~0ULL};  // Last frame given to `m_resolution`
 
   vk::PhysicalDeviceRayTracingPipelinePropertiesKHR   m_rtProperties;
   nvvk::RaytracingBuilderKHR                          m_rtBuilder;
@@ -175,5 +196,5 @@ public:
   nvvk::Buffer        m_spheresAabbBuffer;      // Buffer of all Aabb
   nvvk::Buffer        m_spheresMatColorBuffer;  // Multiple materials
   nvvk::Buffer        m_spheresMatIndexBuffer;  // Define which sphere uses which material
-  void                createSpheres(uint32_t nbSpheres);
+  void                createSpheres(uint32_t nbSpheres, uint32_t seed = 0);
 };
@@ -65,6 +65,36 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat3("Position", &helloVk.m_pushConstant.lightPosition.x, -20.f, 20.f);
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
   }
+  if(ImGui::CollapsingHeader("Dynamic Resolution", ImGuiTreeNodeFlags_DefaultOpen))
+  {
+    ResolutionController&          resolution = helloVk.m_resolution;
+    ResolutionController::Settings settings   = resolution.getSettings();
+
+    ImGui::Checkbox("Dynamic", &helloVk.m_dynamicResolution);
+    bool changed = ImGui::SliderFloat("Target (ms)", &settings.targetMs, 1.f, 50.f);
+    changed |= ImGui::SliderFloat("Min scale", &settings.minScale, 0.1f, 1.f);
+    if(changed)
+      resolution.setSettings(settings);
+    if(!helloVk.m_dynamicResolution)
+    {
+      float scale = resolution.getScale();
+      if(ImGui::SliderFloat("Scale", &scale, settings.minScale, settings.maxScale))
+        resolution.reset(scale);
+    }
+    ImGui::SliderFloat("Sharpness", &helloVk.m_postPushConstant.sharpness, 0.f, 1.f);
+
+    const auto& stats = resolution.getStats();
+    ImGui::Text("Ray tracing: %u x %u (%.0f%%)", helloVk.m_renderSize.width,
+                helloVk.m_renderSize.height, resolution.getScale() * 100.f);
+    ImGui::Text("GPU frame: %.2f ms, full resolution: %.2f ms", stats.lastFrameMs,
+                stats.fixedMs + stats.fullResMs);
+    ImGui::Text("Ideal scale: %.3f, changes: %llu", stats.idealScale,
+                static_cast<unsigned long long>(stats.changes));
+  }
+  if(ImGui::CollapsingHeader("GPU Profiler"))
+  {
+    helloVk.m_profiler.renderUI();
+  }
   ImGui::Text("Nb Spheres and Cubes: %llu", helloVk.m_spheres.size());
 }
 
@@ -162,6 +192,8 @@ int main(int argc, char** argv)
   helloVk.setup(vkctx.m_instance, vkctx.m_device, vkctx.m_physicalDevice,
                 vkctx.m_queueGCT.familyIndex);
   helloVk.createSwapchain(surface, SAMPLE_WIDTH, SAMPLE_HEIGHT);
+  helloVk.m_profiler.setup(vkctx.m_device, vkctx.m_physicalDevice, vkctx.m_queueGCT.familyIndex,
+                           static_cast<uint32_t>(helloVk.getCommandBuffers().size()));
   helloVk.createDepthBuffer();
   helloVk.createRenderPass();
   helloVk.createFrameBuffers();
@@ -234,6 +266,10 @@ int main(int argc, char** argv)
     const vk::CommandBuffer& cmdBuf   = helloVk.getCommandBuffers()[curFrame];
 
     cmdBuf.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    helloVk.m_profiler.beginFrame(cmdBuf, curFrame);
+
+    // Resolution of the ray tracing, from the timings of the previous frames
+    helloVk.updateRenderSize();
 
     // Updating camera buffer
     helloVk.updateUniformBuffer(cmdBuf);
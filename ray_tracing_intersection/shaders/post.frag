@@ -25,13 +25,51 @@ layout(set = 0, binding = 0) uniform sampler2D noisyTxt;
 
 layout(push_constant) uniform shaderInformation
 {
+  vec2  uvScale;  // Part of the image holding the frame, less than 1 with dynamic resolution
   float aspectRatio;
+  float sharpness;
 }
 pushc;
 
+vec3 toDisplay(vec3 color)
+{
+  return clamp(pow(color, vec3(1. / 2.2)), 0.0, 1.0);
+}
+
+// Reading the rendered part of the image; the coordinates are clamped to the centers of its border
+// texels, so that bilinear filtering never reads what is outside of it.
+vec3 fetch(vec2 uv, vec2 minUV, vec2 maxUV)
+{
+  return toDisplay(texture(noisyTxt, clamp(uv, minUV, maxUV)).rgb);
+}
+
 void main()
 {
-  vec2  uv    = outUV;
-  float gamma = 1. / 2.2;
-  fragColor   = pow(texture(noisyTxt, uv).rgba, vec4(gamma));
+  vec2 texel = 1.0 / vec2(textureSize(noisyTxt, 0));
+  vec2 minUV = 0.5 * texel;
+  vec2 maxUV = pushc.uvScale - 0.5 * texel;
+  vec2 uv    = outUV * pushc.uvScale;
+
+  // Bilinear upscale
+  vec3 color = fetch(uv, minUV, maxUV);
+
+  // Edge-aware sharpening of the upscaled image, in the manner of contrast adaptive sharpening:
+  // the neighbors, one rendered texel away, are subtracted from the center with a weight that
+  // decreases with the local contrast. Flat areas get the blur of the upscale removed, while
+  // strong edges are left alone and do not ring.
+  if(pushc.sharpness > 0.0 && pushc.uvScale.x < 1.0)
+  {
+    vec3 n = fetch(uv + vec2(0, -texel.y), minUV, maxUV);
+    vec3 s = fetch(uv + vec2(0, texel.y), minUV, maxUV);
+    vec3 w = fetch(uv + vec2(-texel.x, 0), minUV, maxUV);
+    vec3 e = fetch(uv + vec2(texel.x, 0), minUV, maxUV);
+
+    vec3 minColor = min(color, min(min(n, s), min(w, e)));
+    vec3 maxColor = max(color, max(max(n, s), max(w, e)));
+    vec3 amount   = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, 1e-4), 0.0, 1.0));
+    vec3 weight   = -amount / mix(8.0, 5.0, pushc.sharpness);
+    color         = clamp((color + (n + s + w + e) * weight) / (1.0 + 4.0 * weight), 0.0, 1.0);
+  }
+
+  fragColor = vec4(color, 1.0);
 }
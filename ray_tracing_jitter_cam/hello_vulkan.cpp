@@ -432,6 +432,7 @@ void HelloVulkan::destroyResources()
   m_rtBuilder.destroy();
   m_device.destroy(m_rtDescPool);
   m_device.destroy(m_rtDescSetLayout);
+  m_alloc.destroy(m_blueNoise);
   m_device.destroy(m_rtPipeline);
   m_device.destroy(m_rtPipelineLayout);
   m_alloc.destroy(m_rtSBTBuffer);
@@ -721,7 +722,27 @@ void HelloVulkan::createTopLevelAS()
 }
 
 //--------------------------------------------------------------------------------------------------
-// This descriptor set holds the Acceleration structure and the output image
+// Ranks of the blue-noise tile used by the SampleSequence::eBlueNoise jitter (sampler.glsl)
+//
+void HelloVulkan::createBlueNoiseTexture()
+{
+  SampleSequence::BlueNoise noise = SampleSequence::generateBlueNoise();
+
+  nvvk::CommandPool   cmdBufGet(m_device, m_graphicsQueueIndex);
+  vk::CommandBuffer   cmdBuf = cmdBufGet.createCommandBuffer();
+  vk::ImageCreateInfo imageCreateInfo =
+      nvvk::makeImage2DCreateInfo(vk::Extent2D{noise.size, noise.size}, vk::Format::eR32Uint);
+  vk::SamplerCreateInfo samplerCreateInfo{
+      {}, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest};
+  m_blueNoise = m_alloc.createTexture(cmdBuf, noise.ranks.size() * sizeof(uint32_t),
+                                      noise.ranks.data(), imageCreateInfo, samplerCreateInfo);
+  cmdBufGet.submitAndWait(cmdBuf);
+  m_alloc.finalizeAndReleaseStaging();
+  m_debug.setObjectName(m_blueNoise.image, "BlueNoise");
+}
+
+//--------------------------------------------------------------------------------------------------
+// This descriptor set holds the Acceleration structure, the output image and the blue noise
 //
 void HelloVulkan::createRtDescriptorSet()
 {
@@ -733,6 +754,8 @@ void HelloVulkan::createRtDescriptorSet()
                                           vkSS::eRaygenKHR | vkSS::eClosestHitKHR));  // TLAS
   m_rtDescSetLayoutBind.addBinding(
       vkDSLB(1, vkDT::eStorageImage, 1, vkSS::eRaygenKHR));  // Output image
+  m_rtDescSetLayoutBind.addBinding(
+      vkDSLB(2, vkDT::eCombinedImageSampler, 1, vkSS::eRaygenKHR));  // Blue noise
 
   m_rtDescPool      = m_rtDescSetLayoutBind.createPool(m_device);
   m_rtDescSetLayout = m_rtDescSetLayoutBind.createLayout(m_device);
@@ -748,6 +771,7 @@ void HelloVulkan::createRtDescriptorSet()
   std::vector<vk::WriteDescriptorSet> writes;
   writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 0, &descASInfo));
   writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 1, &imageInfo));
+  writes.emplace_back(m_rtDescSetLayoutBind.makeWrite(m_rtDescSet, 2, &m_blueNoise.descriptor));
   m_device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 }
 
@@ -770,6 +794,9 @@ void HelloVulkan::updateRtDescriptorSet()
 
 //--------------------------------------------------------------------------------------------------
 // Pipeline for the ray tracer: all shaders, raygen, chit, miss
+// - NBSAMPLES is a specialization constant of the raygen shader: there is one raygen group per
+//   power of two, all before the miss and hit groups. raytrace() selects the one of
+//   `m_samplesPerLaunch` with the raygen region of the SBT.
 //
 void HelloVulkan::createRtPipeline()
 {
@@ -786,13 +813,24 @@ void HelloVulkan::createRtPipeline()
 
   std::vector<vk::PipelineShaderStageCreateInfo> stages;
 
-  // Raygen
-  vk::RayTracingShaderGroupCreateInfoKHR rg{vk::RayTracingShaderGroupTypeKHR::eGeneral,
-                                            VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR,
-                                            VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR};
-  rg.setGeneralShader(static_cast<uint32_t>(stages.size()));
-  stages.push_back({{}, vk::ShaderStageFlagBits::eRaygenKHR, raygenSM, "main"});
-  m_rtShaderGroups.push_back(rg);
+  // Raygen, one per samples per launch: constant_id 0 is NBSAMPLES
+  uint32_t nbVariants = SampleBudget::getVariant(s_maxSamplesPerLaunch) + 1;
+  std::vector<int32_t>                samples(nbVariants);
+  std::vector<vk::SpecializationInfo> specializations(nbVariants);
+  vk::SpecializationMapEntry          entry{0, 0, sizeof(int32_t)};
+  for(uint32_t i = 0; i < nbVariants; i++)
+  {
+    samples[i]         = 1 << i;
+    specializations[i] = vk::SpecializationInfo{1, &entry, sizeof(int32_t), &samples[i]};
+
+    vk::RayTracingShaderGroupCreateInfoKHR rg{vk::RayTracingShaderGroupTypeKHR::eGeneral,
+                                              VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR,
+                                              VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR};
+    rg.setGeneralShader(static_cast<uint32_t>(stages.size()));
+    stages.push_back(
+        {{}, vk::ShaderStageFlagBits::eRaygenKHR, raygenSM, "main", &specializations[i]});
+    m_rtShaderGroups.push_back(rg);
+  }
   // Miss
   vk::RayTracingShaderGroupCreateInfoKHR mg{vk::RayTracingShaderGroupTypeKHR::eGeneral,
                                             VK_SHADER_UNUSED_KHR, VK_SHADER_UNUSED_KHR,
@@ -904,7 +942,7 @@ void HelloVulkan::createRtShaderBindingTable()
 void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor)
 {
   updateFrame();
-  if(m_rtPushConstants.frame >= m_maxFrames)
+  if(m_rtPushConstants.samples >= m_maxSamples)
     return;
 
   m_debug.beginLabel(cmdBuf, "Ray trace");
@@ -929,16 +967,21 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
   uint32_t          groupStride = groupSize;
   vk::DeviceAddress sbtAddress  = m_device.getBufferAddress({m_rtSBTBuffer.buffer});
 
+  // The raygen groups come first, one per power of two (see createRtPipeline)
+  uint32_t variant    = SampleBudget::getVariant(m_samplesPerLaunch);
+  uint32_t nbVariants = SampleBudget::getVariant(s_maxSamplesPerLaunch) + 1;
+
   using Stride = vk::StridedDeviceAddressRegionKHR;
   std::array<Stride, 4> strideAddresses{
-      Stride{sbtAddress + 0u * groupSize, groupStride, groupSize * 1},  // raygen
-      Stride{sbtAddress + 1u * groupSize, groupStride, groupSize * 2},  // miss
-      Stride{sbtAddress + 3u * groupSize, groupStride, groupSize * 1},  // hit
-      Stride{0u, 0u, 0u}};                                              // callable
+      Stride{sbtAddress + variant * groupSize, groupStride, groupSize * 1},           // raygen
+      Stride{sbtAddress + nbVariants * groupSize, groupStride, groupSize * 2},        // miss
+      Stride{sbtAddress + (nbVariants + 2) * groupSize, groupStride, groupSize * 1},  // hit
+      Stride{0u, 0u, 0u}};                                                            // callable
 
   cmdBuf.traceRaysKHR(&strideAddresses[0], &strideAddresses[1], &strideAddresses[2],
                       &strideAddresses[3],              //
                       m_size.width, m_size.height, 1);  //
+  m_rtPushConstants.samples += m_samplesPerLaunch;
 
   m_debug.endLabel(cmdBuf);
 }
@@ -967,5 +1010,6 @@ void HelloVulkan::updateFrame()
 
 void HelloVulkan::resetFrame()
 {
-  m_rtPushConstants.frame = -1;
+  m_rtPushConstants.frame   = -1;
+  m_rtPushConstants.samples = 0;
 }
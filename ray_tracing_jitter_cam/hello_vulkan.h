@@ -28,6 +28,9 @@
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
 
+#include "sample_budget.h"
+#include "sample_sequences.h"
+
 //--------------------------------------------------------------------------------------------------
 // Simple rasterizer of OBJ objects
 // - Each OBJ loaded are stored in an `ObjModel` and referenced by a `ObjInstance`
@@ -129,6 +132,7 @@ public:
   auto objectToVkGeometryKHR(const ObjModel& model);
   void createBottomLevelAS();
   void createTopLevelAS();
+  void createBlueNoiseTexture();
   void createRtDescriptorSet();
   void updateRtDescriptorSet();
   void createRtPipeline();
@@ -147,7 +151,12 @@ public:
   vk::PipelineLayout                                  m_rtPipelineLayout;
   vk::Pipeline                                        m_rtPipeline;
   nvvk::Buffer                                        m_rtSBTBuffer;
-  int                                                 m_maxFrames{10};
+  int                                                 m_maxSamples{100};
+  uint32_t                                            m_samplesPerLaunch{8};  // NBSAMPLES
+
+  // Powers of two up to this value, one raygen shader group each
+  static constexpr uint32_t s_maxSamplesPerLaunch = 64;
+  nvvk::Texture                                       m_blueNoise;  // Ranks of eBlueNoise
 
   struct RtPushConstant
   {
@@ -156,5 +165,7 @@ public:
     float         lightIntensity;
     int           lightType;
     int           frame{0};
+    int           samplerType{SampleSequence::eSobol};  // Sequence of the subpixel jitter
+    int           samples{0};  // Samples accumulated in the image before this launch
   } m_rtPushConstants;
 };
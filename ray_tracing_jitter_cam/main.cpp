@@ -70,7 +70,22 @@ void renderUI(HelloVulkan& helloVk)
   }
 
 
-  changed |= ImGui::SliderInt("Max Frames", &helloVk.m_maxFrames, 1, 100);
+  // Sequence of the subpixel jitter (sampler.glsl)
+  static const char* samplers[] = {"White noise", "Sobol (Owen)", "R2", "Blue noise + R2"};
+  changed |= ImGui::Combo("Sampler", &helloVk.m_rtPushConstants.samplerType, samplers,
+                          IM_ARRAYSIZE(samplers));
+
+  // Samples per launch: powers of two, one raygen shader group each. More samples per launch
+  // trace the same image in fewer frames, with less launch overhead.
+  const uint32_t samples    = helloVk.m_samplesPerLaunch;
+  const uint32_t maxSamples = HelloVulkan::s_maxSamplesPerLaunch;
+  int            variant    = static_cast<int>(SampleBudget::getVariant(samples));
+  int            maxVariant = static_cast<int>(SampleBudget::getVariant(maxSamples));
+  std::string    label      = std::to_string(1 << variant);
+  if(ImGui::SliderInt("Samples per Launch", &variant, 0, maxVariant, label.c_str()))
+    helloVk.m_samplesPerLaunch = 1u << variant;
+
+  changed |= ImGui::SliderInt("Max Samples", &helloVk.m_maxSamples, 1, 1000);
   if(changed)
     helloVk.resetFrame();
 }
@@ -192,6 +207,7 @@ int main(int argc, char** argv)
   helloVk.initRayTracing();
   helloVk.createBottomLevelAS();
   helloVk.createTopLevelAS();
+  helloVk.createBlueNoiseTexture();
   helloVk.createRtDescriptorSet();
   helloVk.createRtPipeline();
   helloVk.createRtShaderBindingTable();
@@ -17,6 +17,16 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+// State of the sample sequences (sampler.glsl)
+struct Sampler
+{
+  uint  type;
+  uvec2 pixel;
+  uint  index;      // Sample of the pixel
+  uint  dimension;  // Pairs of dimensions consumed
+  uint  seed;       // Pixel hash, or state of the white noise
+};
+
 struct hitPayload
 {
   vec3 hitValue;
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2019-2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2019-2021 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Sample sequences of common/sample_sequences.h, which is the reference: for the same pixel,
+// sample index and pair of dimensions, both give the same values.
+//
+// - SAMPLER_WHITE: tea() and rnd(), white noise
+// - SAMPLER_SOBOL: Owen-scrambled and shuffled Sobol, per pair of dimensions (Burley 2020)
+// - SAMPLER_R2: R2 rank-1 lattice with a random rotation per pixel and pair of dimensions
+// - SAMPLER_BLUE_NOISE: R2 rotated by a tiled blue-noise texture, the error is pushed to high
+//   frequencies
+//
+// The dimensions are consumed by pairs, sample1D() uses a whole pair: a path must always
+// request its samples in the same order.
+//
+// Requires struct Sampler (raycommon.glsl), tea() and rnd(), and the blue-noise ranks:
+//   layout(...) uniform usampler2D blueNoiseTexture;  // R32_UINT, BLUE_NOISE_SIZE^2
+
+#define SAMPLER_WHITE 0
+#define SAMPLER_SOBOL 1
+#define SAMPLER_R2 2
+#define SAMPLER_BLUE_NOISE 3
+
+#define BLUE_NOISE_SIZE 64
+#define BLUE_NOISE_RANK_SHIFT 20  // 32 - log2(BLUE_NOISE_SIZE^2)
+
+// Generators of R2, in 0.32 fixed point
+#define R2_X 3242174889u
+#define R2_Y 2447445413u
+
+uint hashU32(uint x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+uint hashCombine(uint seed, uint v)
+{
+  return seed ^ (hashU32(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+// Owen scrambling (Laine-Karras permutation with the constants of Burley)
+uint nestedUniformScramble(uint x, uint seed)
+{
+  x = bitfieldReverse(x);
+  x ^= x * 0x3d20adeau;
+  x += seed;
+  x *= (seed >> 16) | 1u;
+  x ^= x * 0x05526c56u;
+  x ^= x * 0x53a22864u;
+  return bitfieldReverse(x);
+}
+
+// Second dimension of Sobol, the first one is bitfieldReverse(index)
+uint sobol1(uint index)
+{
+  uint result    = 0;
+  uint direction = 1u << 31;
+  for(; index != 0; index >>= 1)
+  {
+    if((index & 1) != 0)
+      result ^= direction;
+    direction ^= direction >> 1;
+  }
+  return result;
+}
+
+float fixedToFloat(uint x)
+{
+  return float(x >> 8) / float(1 << 24);
+}
+
+Sampler samplerInit(uint type, uvec2 pixel, uint index)
+{
+  Sampler s;
+  s.type      = type;
+  s.pixel     = pixel;
+  s.index     = index;
+  s.dimension = 0;
+  if(type == SAMPLER_WHITE)
+    s.seed = tea((pixel.y << 16) ^ pixel.x, index);
+  else
+    s.seed = hashCombine(hashU32(pixel.x), pixel.y);
+  return s;
+}
+
+vec2 sample2D(inout Sampler s)
+{
+  const uint dimension = s.dimension++;
+
+  if(s.type == SAMPLER_SOBOL)
+  {
+    uint seed     = hashCombine(s.seed, dimension);
+    uint shuffled = nestedUniformScramble(s.index, seed);
+    uint x        = nestedUniformScramble(bitfieldReverse(shuffled), hashCombine(seed, 0));
+    uint y        = nestedUniformScramble(sobol1(shuffled), hashCombine(seed, 1));
+    return vec2(fixedToFloat(x), fixedToFloat(y));
+  }
+  if(s.type == SAMPLER_R2)
+  {
+    uint seed  = hashCombine(s.seed, dimension);
+    uint index = nestedUniformScramble(s.index, hashCombine(seed, 2));
+    uint x     = index * R2_X + hashCombine(seed, 0);
+    uint y     = index * R2_Y + hashCombine(seed, 1);
+    return vec2(fixedToFloat(x), fixedToFloat(y));
+  }
+  if(s.type == SAMPLER_BLUE_NOISE)
+  {
+    uint  shift0 = hashU32(2 * dimension + 0);
+    uint  shift1 = hashU32(2 * dimension + 1);
+    uvec2 texel0 = (s.pixel + uvec2(shift0 & 0xFFFF, shift0 >> 16)) % BLUE_NOISE_SIZE;
+    uvec2 texel1 = (s.pixel + uvec2(shift1 & 0xFFFF, shift1 >> 16)) % BLUE_NOISE_SIZE;
+    uint  r0     = texelFetch(blueNoiseTexture, ivec2(texel0), 0).r;
+    uint  r1     = texelFetch(blueNoiseTexture, ivec2(texel1), 0).r;
+    uint  index  = nestedUniformScramble(s.index, hashU32(dimension));
+    uint  x      = index * R2_X + (r0 << BLUE_NOISE_RANK_SHIFT);
+    uint  y      = index * R2_Y + (r1 << BLUE_NOISE_RANK_SHIFT);
+    return vec2(fixedToFloat(x), fixedToFloat(y));
+  }
+
+  float x = rnd(s.seed);
+  float y = rnd(s.seed);
+  return vec2(x, y);
+}
+
+float sample1D(inout Sampler s)
+{
+  return sample2D(s).x;
+}
@@ -35,6 +35,7 @@ extern std::vector<std::string> defaultSearchPaths;
 
 #include "nvh/alignment.hpp"
 #include "nvh/fileoperations.hpp"
+#include "nvh/nvprint.hpp"
 #include "nvvk/commands_vk.hpp"
 #include "nvvk/renderpasses_vk.hpp"
 #include "nvvk/shaders_vk.hpp"
@@ -428,13 +429,14 @@ void HelloVulkan::destroyResources()
   m_device.destroy(m_offscreenFramebuffer);
 
   // #VKRay
-  m_sbtWrapper.destroy();
   m_rtBuilder.destroy();
   m_device.destroy(m_rtDescPool);
   m_device.destroy(m_rtDescSetLayout);
   m_device.destroy(m_rtPipeline);
   m_device.destroy(m_rtPipelineLayout);
   m_alloc.destroy(m_rtSBTBuffer);
+  m_alloc.unmap(m_rtSBTHitBuffer);
+  m_alloc.destroy(m_rtSBTHitBuffer);
 
   m_alloc.deinit();
 }
@@ -651,8 +653,6 @@ void HelloVulkan::initRayTracing()
                                       vk::PhysicalDeviceRayTracingPipelinePropertiesKHR>();
   m_rtProperties = properties.get<vk::PhysicalDeviceRayTracingPipelinePropertiesKHR>();
   m_rtBuilder.setup(m_device, &m_alloc, m_graphicsQueueIndex);
-
-  m_sbtWrapper.setup(m_device, m_graphicsQueueIndex, &m_alloc, m_rtProperties);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -854,14 +854,6 @@ void HelloVulkan::createRtPipeline()
 
   m_rtPipeline = m_device.createRayTracingPipelineKHR({}, {}, rayPipelineInfo).value;
 
-
-  // Manually defining group indices
-  m_sbtWrapper.addIndices(rayPipelineInfo);
-  m_sbtWrapper.addIndex(SBTWrapper::eHit, 4);  // hit = 2
-  m_sbtWrapper.addData(SBTWrapper::eHit, 1, m_hitShaderRecord[0]);
-  m_sbtWrapper.addData(SBTWrapper::eHit, 2, m_hitShaderRecord[1]);
-  m_sbtWrapper.create(m_rtPipeline);
-
   m_device.destroy(raygenSM);
   m_device.destroy(missSM);
   m_device.destroy(shadowmissSM);
@@ -879,67 +871,40 @@ void HelloVulkan::createRtShaderBindingTable()
 {
   auto groupCount =
       static_cast<uint32_t>(m_rtShaderGroups.size());  // shaders: raygen, 2 miss, 2 chit
-  uint32_t groupHandleSize  = m_rtProperties.shaderGroupHandleSize;  // Size of a program identifier
-  uint32_t groupSizeAligned = m_rtProperties.shaderGroupBaseAlignment;
+  uint32_t groupHandleSize = m_rtProperties.shaderGroupHandleSize;  // Size of a program identifier
 
   // Fetch all the shader handles used in the pipeline, so that they can be written in the SBT
-  uint32_t sbtSize = groupCount * groupSizeAligned;
-
-  std::vector<uint8_t> shaderHandleStorage(sbtSize);
-  auto result = m_device.getRayTracingShaderGroupHandlesKHR(m_rtPipeline, 0, groupCount, sbtSize,
-                                                            shaderHandleStorage.data());
+  std::vector<uint8_t> shaderHandleStorage(groupCount * groupHandleSize);
+  auto result = m_device.getRayTracingShaderGroupHandlesKHR(
+      m_rtPipeline, 0, groupCount, shaderHandleStorage.size(), shaderHandleStorage.data());
   assert(result == vk::Result::eSuccess);
 
-  // Retrieve the handle pointers
-  std::vector<uint8_t*> handles(groupCount);
-  for(uint32_t i = 0; i < groupCount; i++)
-  {
-    handles[i] = &shaderHandleStorage[i * groupHandleSize];
-  }
-
-  // Sizes
-  uint32_t rayGenSize = groupSizeAligned;
-  uint32_t missSize   = groupSizeAligned;
-  uint32_t hitSize =
-      nvh::align_up(groupHandleSize + static_cast<int>(sizeof(HitRecordBuffer)), groupSizeAligned);
-  uint32_t newSbtSize = rayGenSize + 2 * missSize + 3 * hitSize;
-
-  std::vector<uint8_t> sbtBuffer(newSbtSize);
+  // Records: the stride of the hit region is computed from the largest record (handle + color)
+  m_sbtLayout.setup(m_rtProperties);
+  m_sbtLayout.addRecord(SbtLayout::eRaygen, 0);
+  m_sbtLayout.addRecord(SbtLayout::eMiss, 1);
+  m_sbtLayout.addRecord(SbtLayout::eMiss, 2);
+  m_sbtLayout.addRecord(SbtLayout::eHit, 3);                        // Hit 0, no data
+  m_sbtLayout.addRecord(SbtLayout::eHit, 4, m_hitShaderRecord[0]);  // Hit 1
+  m_sbtLayout.addRecord(SbtLayout::eHit, 4, m_hitShaderRecord[1]);  // Hit 2
+
+  std::string error;
+  if(!m_sbtLayout.finalize(&error))
   {
-    uint8_t* pBuffer = sbtBuffer.data();
-
-    memcpy(pBuffer, handles[0], groupHandleSize);  // Raygen
-    pBuffer += rayGenSize;
-    memcpy(pBuffer, handles[1], groupHandleSize);  // Miss 0
-    pBuffer += missSize;
-    memcpy(pBuffer, handles[2], groupHandleSize);  // Miss 1
-    pBuffer += missSize;
-
-    uint8_t* pHitBuffer = pBuffer;
-    memcpy(pHitBuffer, handles[3], groupHandleSize);  // Hit 0
-    // No data
-    pBuffer += hitSize;
-
-    pHitBuffer = pBuffer;
-    memcpy(pHitBuffer, handles[4], groupHandleSize);  // Hit 1
-    pHitBuffer += groupHandleSize;
-    memcpy(pHitBuffer, &m_hitShaderRecord[0], sizeof(HitRecordBuffer));  // Hit 1 data
-    pBuffer += hitSize;
-
-    pHitBuffer = pBuffer;
-    memcpy(pHitBuffer, handles[4], groupHandleSize);  // Hit 2
-    pHitBuffer += groupHandleSize;
-    memcpy(pHitBuffer, &m_hitShaderRecord[1], sizeof(HitRecordBuffer));  // Hit 2 data
-    // pBuffer += hitSize;
+    LOGE("SBT: %s\n", error.c_str());
+    exit(1);
   }
+  m_sbtHost.resize(m_sbtLayout.getSize());
+  m_sbtLayout.write(m_sbtHost.data(), shaderHandleStorage.data(), groupCount);
 
   // Write the handles in the SBT
   nvvk::CommandPool genCmdBuf(m_device, m_graphicsQueueIndex);
   vk::CommandBuffer cmdBuf = genCmdBuf.createCommandBuffer();
 
-  m_rtSBTBuffer = m_alloc.createBuffer(cmdBuf, sbtBuffer,
+  m_rtSBTBuffer = m_alloc.createBuffer(cmdBuf, m_sbtHost,
                                        vk::BufferUsageFlagBits::eShaderDeviceAddressKHR
-                                           | vk::BufferUsageFlagBits::eShaderBindingTableKHR);
+                                           | vk::BufferUsageFlagBits::eShaderBindingTableKHR
+                                           | vk::BufferUsageFlagBits::eTransferDst);
 
   m_debug.setObjectName(m_rtSBTBuffer.buffer, "SBT");
 
@@ -947,6 +912,84 @@ void HelloVulkan::createRtShaderBindingTable()
   genCmdBuf.submitAndWait(cmdBuf);
 
   m_alloc.finalizeAndReleaseStaging();
+
+  // Host-visible hit regions, one per frame in flight, each starting on the base alignment
+  auto nbFrames    = static_cast<vk::DeviceSize>(getCommandBuffers().size());
+  auto alignment   = static_cast<vk::DeviceSize>(m_rtProperties.shaderGroupBaseAlignment);
+  m_sbtHitSlotSize = nvh::align_up(m_sbtLayout.getRegions(0)[SbtLayout::eHit].size, alignment);
+  m_rtSBTHitBuffer = m_alloc.createBuffer(
+      nbFrames * m_sbtHitSlotSize,
+      vk::BufferUsageFlagBits::eShaderDeviceAddress
+          | vk::BufferUsageFlagBits::eShaderBindingTableKHR,
+      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+  m_debug.setObjectName(m_rtSBTHitBuffer.buffer, "SBT hit records");
+  m_sbtHitMapped = reinterpret_cast<uint8_t*>(m_alloc.map(m_rtSBTHitBuffer));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Changing the color of a hit record only modifies its data in the host copy of the SBT.
+// The modified bytes are uploaded in the next frame by updateRtShaderBindingTable().
+//
+void HelloVulkan::setHitShaderRecord(uint32_t index)
+{
+  m_sbtLayout.setRecordData(SbtLayout::eHit, index + 1, m_hitShaderRecord[index]);
+}
+
+void HelloVulkan::updateRtShaderBindingTable(const vk::CommandBuffer& cmdBuf)
+{
+  if(m_hostVisibleHitRecords)
+  {
+    // No transfer: the hit region of this frame is written directly. The GPU is done with it,
+    // since the fence of the frame was waited on.
+    m_sbtLayout.writeDirty(m_sbtHost.data());
+    m_sbtLayout.clearDirty();
+    const auto& hitRegion = m_sbtLayout.getRegions(0)[SbtLayout::eHit];
+    memcpy(m_sbtHitMapped + getCurFrame() * m_sbtHitSlotSize,
+           m_sbtHost.data() + m_sbtLayout.getOffset(SbtLayout::eHit), hitRegion.size);
+    return;
+  }
+
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size   = 0;
+  if(!m_sbtLayout.getDirtyRange(offset, size))
+    return;
+  m_sbtLayout.writeDirty(m_sbtHost.data());
+  m_sbtLayout.clearDirty();
+
+  // The previous frames may still be tracing with the table
+  vk::BufferMemoryBarrier beforeBarrier{vk::AccessFlagBits::eShaderRead,
+                                        vk::AccessFlagBits::eTransferWrite,
+                                        VK_QUEUE_FAMILY_IGNORED,
+                                        VK_QUEUE_FAMILY_IGNORED,
+                                        m_rtSBTBuffer.buffer,
+                                        offset,
+                                        size};
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+                         vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlagBits::eDeviceGroup,
+                         {}, {beforeBarrier}, {});
+  cmdBuf.updateBuffer(m_rtSBTBuffer.buffer, offset, size, m_sbtHost.data() + offset);
+
+  vk::BufferMemoryBarrier afterBarrier{vk::AccessFlagBits::eTransferWrite,
+                                       vk::AccessFlagBits::eShaderRead,
+                                       VK_QUEUE_FAMILY_IGNORED,
+                                       VK_QUEUE_FAMILY_IGNORED,
+                                       m_rtSBTBuffer.buffer,
+                                       offset,
+                                       size};
+  cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                         vk::PipelineStageFlagBits::eRayTracingShaderKHR,
+                         vk::DependencyFlagBits::eDeviceGroup, {}, {afterBarrier}, {});
+}
+
+//--------------------------------------------------------------------------------------------------
+// Moving the hit records between the device-local SBT and the per-frame host-visible copies.
+// All records are marked as modified, so the new location gets the current colors.
+//
+void HelloVulkan::setHostVisibleHitRecords(bool enable)
+{
+  m_hostVisibleHitRecords = enable;
+  for(uint32_t i = 0; i < static_cast<uint32_t>(m_hitShaderRecord.size()); i++)
+    setHitShaderRecord(i);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -971,37 +1014,13 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
                                        0, m_rtPushConstants);
 
 
-  //// Size of a program identifier
-  //uint32_t groupSize =
-  //    nvh::align_up(m_rtProperties.shaderGroupHandleSize, m_rtProperties.shaderGroupBaseAlignment);
-  //uint32_t       groupStride = groupSize;
-  //vk::DeviceSize hitGroupSize =
-  //    nvh::align_up(m_rtProperties.shaderGroupHandleSize + sizeof(HitRecordBuffer),
-  //                  m_rtProperties.shaderGroupBaseAlignment);
-  //vk::DeviceAddress sbtAddress = m_device.getBufferAddress({m_rtSBTBuffer.buffer});
-
-  //using Stride = vk::StridedDeviceAddressRegionKHR;
-  //std::array<Stride, 4> strideAddresses{
-  //    Stride{sbtAddress + 0u * groupSize, groupStride, groupSize * 1},      // raygen
-  //    Stride{sbtAddress + 1u * groupSize, groupStride, groupSize * 2},      // miss
-  //    Stride{sbtAddress + 3u * groupSize, hitGroupSize, hitGroupSize * 3},  // hit
-  //    Stride{0u, 0u, 0u}};                                                  // callable
-
-  //strideAddresses[0] = m_sbtWrapper.getRaygenRegion();
-  //strideAddresses[1] = m_sbtWrapper.getMissRegion();
-  //strideAddresses[2] = m_sbtWrapper.getHitRegion();
-
-  //cmdBuf.traceRaysKHR(&strideAddresses[0], &strideAddresses[1], &strideAddresses[2],
-  //                    &strideAddresses[3],              //
-  //                    m_size.width, m_size.height, 1);  //
-
-  //std::array<vk::StridedDeviceAddressRegionKHR, 4> regions;
-  //regions[0] = m_sbtWrapper.getRegion(SBTWrapper::eRaygen);
-  //regions[1] = m_sbtWrapper.getRegion(SBTWrapper::eMiss);
-  //regions[2] = m_sbtWrapper.getRegion(SBTWrapper::eHit);
-  //regions[3] = m_sbtWrapper.getRegion(SBTWrapper::eCallable);
-
-  auto regions = m_sbtWrapper.getRegions();
+  vk::DeviceAddress sbtAddress = m_device.getBufferAddress({m_rtSBTBuffer.buffer});
+  auto              regions    = m_sbtLayout.getRegions(sbtAddress);
+  if(m_hostVisibleHitRecords)
+  {
+    vk::DeviceAddress hitAddress = m_device.getBufferAddress({m_rtSBTHitBuffer.buffer});
+    regions[SbtLayout::eHit].setDeviceAddress(hitAddress + getCurFrame() * m_sbtHitSlotSize);
+  }
   cmdBuf.traceRaysKHR(regions[0], regions[1], regions[2], regions[3],  //
                       m_size.width, m_size.height, 1);                 //
 
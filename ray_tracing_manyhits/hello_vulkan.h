@@ -27,8 +27,7 @@
 
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
-#include "nvvk/sbtwrapper_vk.hpp"
-using nvvk::SBTWrapper;
+#include "sbt_layout.h"
 
 //--------------------------------------------------------------------------------------------------
 // Simple rasterizer of OBJ objects
@@ -136,6 +135,9 @@ public:
   void updateRtDescriptorSet();
   void createRtPipeline();
   void createRtShaderBindingTable();
+  void setHitShaderRecord(uint32_t index);
+  void updateRtShaderBindingTable(const vk::CommandBuffer& cmdBuf);
+  void setHostVisibleHitRecords(bool enable);
   void raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor);
 
 
@@ -164,5 +166,13 @@ public:
   };
   std::vector<HitRecordBuffer> m_hitShaderRecord;
 
-  nvvk::SBTWrapper m_sbtWrapper;
+  SbtLayout            m_sbtLayout;  // Regions and records of m_rtSBTBuffer
+  std::vector<uint8_t> m_sbtHost;    // Copy of m_rtSBTBuffer, for partial updates
+
+  // Optional copy of the hit region in host-visible memory, for records changing every frame.
+  // There is one copy per frame in flight, the rest of the SBT stays in device-local memory.
+  bool           m_hostVisibleHitRecords{false};
+  nvvk::Buffer   m_rtSBTHitBuffer;
+  uint8_t*       m_sbtHitMapped{nullptr};
+  vk::DeviceSize m_sbtHitSlotSize{0};
 };
@@ -62,6 +62,19 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat3("Position", &helloVk.m_pushConstant.lightPosition.x, -20.f, 20.f);
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
   }
+  if(ImGui::CollapsingHeader("Hit shader records"))
+  {
+    // Only the data of the modified record is uploaded to the SBT
+    bool hostVisible = helloVk.m_hostVisibleHitRecords;
+    if(ImGui::Checkbox("Host-visible hit records", &hostVisible))
+      helloVk.setHostVisibleHitRecords(hostVisible);
+    for(uint32_t i = 0; i < static_cast<uint32_t>(helloVk.m_hitShaderRecord.size()); i++)
+    {
+      std::string label = "Wuson " + std::to_string(i);
+      if(ImGui::ColorEdit3(label.c_str(), &helloVk.m_hitShaderRecord[i].color.x))
+        helloVk.setHitShaderRecord(i);
+    }
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -247,6 +260,8 @@ int main(int argc, char** argv)
 
     // Updating camera buffer
     helloVk.updateUniformBuffer(cmdBuf);
+    // Updating the modified hit records
+    helloVk.updateRtShaderBindingTable(cmdBuf);
 
     // Clearing screen
     std::array<vk::ClearValue, 2> clearValues;
@@ -18,6 +18,7 @@
  */
 
 
+#include <algorithm>
 #include <numeric>
 #include <sstream>
 #include <vulkan/vulkan.hpp>
@@ -258,6 +259,42 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
   model.nbIndices  = static_cast<uint32_t>(loader.m_indices.size());
   model.nbVertices = static_cast<uint32_t>(loader.m_vertices.size());
 
+  // Sorting the triangles by material: the triangles of a material form a geometry of the BLAS,
+  // using the closest-hit shader specialized for that material
+  {
+    auto                  nbTriangles = static_cast<uint32_t>(loader.m_matIndx.size());
+    std::vector<uint32_t> order(nbTriangles);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return loader.m_matIndx[a] < loader.m_matIndx[b];
+    });
+
+    std::vector<uint32_t> indices(loader.m_indices.size());
+    std::vector<int32_t>  matIndx(nbTriangles);
+    for(uint32_t t = 0; t < nbTriangles; t++)
+    {
+      matIndx[t] = loader.m_matIndx[order[t]];
+      for(uint32_t k = 0; k < 3; k++)
+        indices[3 * t + k] = loader.m_indices[3 * order[t] + k];
+    }
+    loader.m_indices.swap(indices);
+    loader.m_matIndx.swap(matIndx);
+
+    for(uint32_t t = 0; t < nbTriangles; t++)
+    {
+      int32_t matId = loader.m_matIndx[t];
+      if(model.geometries.empty() || model.geometries.back().materialId != matId)
+      {
+        MaterialGeometry geom;
+        geom.firstPrimitive = t;
+        geom.materialId     = matId;
+        geom.matClass       = MaterialClass::classify(loader.m_materials[matId]);
+        model.geometries.push_back(geom);
+      }
+      model.geometries.back().nbPrimitives++;
+    }
+  }
+
   // Create the buffers on Device and copy vertices, indices and materials
   nvvk::CommandPool cmdBufGet(m_device, m_graphicsQueueIndex);
   vk::CommandBuffer cmdBuf = cmdBufGet.createCommandBuffer();
@@ -286,6 +323,18 @@ void HelloVulkan::loadModel(const std::string& filename, nvmath::mat4f transform
   m_objInstance.emplace_back(instance);
 }
 
+//--------------------------------------------------------------------------------------------------
+// The illumination models above 2 (reflection, refraction, ...) are shaded as 2 by this sample
+//
+HelloVulkan::MaterialClass HelloVulkan::MaterialClass::classify(const MaterialObj& mat)
+{
+  MaterialClass matClass;
+  matClass.illum    = std::min(std::max(mat.illum, 0), 2);
+  matClass.textured = mat.textureID >= 0 ? 1 : 0;
+  matClass.emissive = std::max(mat.emission.x, std::max(mat.emission.y, mat.emission.z)) > 0.f;
+  return matClass;
+}
+
 //--------------------------------------------------------------------------------------------------
 // Creating the uniform buffer holding the camera matrices
 // - Buffer is host visible
@@ -664,8 +713,6 @@ auto HelloVulkan::objectToVkGeometryKHR(const ObjModel& model)
   vk::DeviceAddress vertexAddress = m_device.getBufferAddress({model.vertexBuffer.buffer});
   vk::DeviceAddress indexAddress  = m_device.getBufferAddress({model.indexBuffer.buffer});
 
-  uint32_t maxPrimitiveCount = model.nbIndices / 3;
-
   // Describe buffer as array of VertexObj.
   vk::AccelerationStructureGeometryTrianglesDataKHR triangles;
   triangles.setVertexFormat(vk::Format::eR32G32B32Sfloat);  // vec3 vertex position data.
@@ -684,17 +731,20 @@ auto HelloVulkan::objectToVkGeometryKHR(const ObjModel& model)
   asGeom.setFlags(vk::GeometryFlagBitsKHR::eOpaque);
   asGeom.geometry.setTriangles(triangles);
 
-  // The entire array will be used to build the BLAS.
-  vk::AccelerationStructureBuildRangeInfoKHR offset;
-  offset.setFirstVertex(0);
-  offset.setPrimitiveCount(maxPrimitiveCount);
-  offset.setPrimitiveOffset(0);
-  offset.setTransformOffset(0);
-
-  // Our blas is made from only one geometry, but could be made of many geometries
+  // One geometry per material, using a range of the index buffer. The geometry index selects the
+  // SBT record, hence the closest-hit shader specialized for the material.
   nvvk::RaytracingBuilderKHR::BlasInput input;
-  input.asGeometry.emplace_back(asGeom);
-  input.asBuildOffsetInfo.emplace_back(offset);
+  for(const auto& geom : model.geometries)
+  {
+    vk::AccelerationStructureBuildRangeInfoKHR offset;
+    offset.setFirstVertex(0);
+    offset.setPrimitiveCount(geom.nbPrimitives);
+    offset.setPrimitiveOffset(geom.firstPrimitive * 3 * sizeof(uint32_t));
+    offset.setTransformOffset(0);
+
+    input.asGeometry.emplace_back(asGeom);
+    input.asBuildOffsetInfo.emplace_back(offset);
+  }
 
   return input;
 }
@@ -721,15 +771,17 @@ void HelloVulkan::createTopLevelAS()
 {
   std::vector<nvvk::RaytracingBuilderKHR::Instance> tlas;
   tlas.reserve(m_objInstance.size());
+  uint32_t hitRecord = 0;  // First SBT hit record of the instance
   for(uint32_t i = 0; i < static_cast<uint32_t>(m_objInstance.size()); i++)
   {
     nvvk::RaytracingBuilderKHR::Instance rayInst;
     rayInst.transform        = m_objInstance[i].transform;  // Position of the instance
     rayInst.instanceCustomId = i;                           // gl_InstanceCustomIndexEXT
     rayInst.blasId           = m_objInstance[i].objIndex;
-    rayInst.hitGroupId       = 0;  // We will use the same hit group for all objects
+    rayInst.hitGroupId       = hitRecord;  // Followed by the records of its other geometries
     rayInst.flags            = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
     tlas.emplace_back(rayInst);
+    hitRecord += static_cast<uint32_t>(m_objModel[m_objInstance[i].objIndex].geometries.size());
   }
   m_rtBuilder.buildTlas(tlas, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
 }
@@ -836,15 +888,32 @@ void HelloVulkan::createRtPipeline()
       m_device, nvh::loadFile("spv/raytrace.rchit.spv", true, defaultSearchPaths, true));
 
 
-  // Specialization
-  std::vector<Specialization> specializations(8);
-  for(int i = 0; i < 8; i++)
+  // Specialization: one per material class used in the scene, and a generic one with all
+  // constants at -1, reading the material at run time. The hit groups come after the raygen and
+  // the two miss groups.
+  std::vector<MaterialClass> classes;
+  m_classHitGroup.clear();
+  for(const auto& instance : m_objInstance)
   {
-    int a = ((i >> 2) % 2) == 1;
-    int b = ((i >> 1) % 2) == 1;
-    int c = ((i >> 0) % 2) == 1;
-    specializations[i].add({{0, a}, {1, b}, {2, c}});
+    for(const auto& geom : m_objModel[instance.objIndex].geometries)
+    {
+      if(m_classHitGroup.count(geom.matClass.key()) == 0)
+      {
+        m_classHitGroup[geom.matClass.key()] = 3 + static_cast<uint32_t>(classes.size());
+        classes.push_back(geom.matClass);
+      }
+    }
+  }
+  m_genericHitGroup = 3 + static_cast<uint32_t>(classes.size());
+
+  std::vector<Specialization> specializations(classes.size() + 1);
+  for(size_t i = 0; i < classes.size(); i++)
+  {
+    const MaterialClass& c = classes[i];
+    specializations[i].add({{0, c.illum}, {1, c.textured}, {2, c.emissive}});
   }
+  specializations.back().add({{0, -1}, {1, -1}, {2, -1}});
+  LOGI("%d material classes\n", static_cast<int>(classes.size()));
 
   std::vector<vk::PipelineShaderStageCreateInfo> stages;
 
@@ -916,7 +985,7 @@ void HelloVulkan::createRtPipeline()
 
   m_rtPipeline = m_device.createRayTracingPipelineKHR({}, {}, rayPipelineInfo).value;
 
-  m_sbtWrapper.create(m_rtPipeline, rayPipelineInfo);
+  createRtShaderBindingTable();
 
   // Spec only guarantees 1 level of "recursion". Check for that sad possibility here.
   if(m_rtProperties.maxRayRecursionDepth <= 1)
@@ -931,6 +1000,42 @@ void HelloVulkan::createRtPipeline()
   m_device.destroy(chitSM);
 }
 
+//--------------------------------------------------------------------------------------------------
+// The SBT: raygen, the two miss, then one hit record per geometry of each instance, in the order
+// of the TLAS instances (`hitGroupId` is the first record of an instance). A record points to the
+// hit group specialized for the class of its material, or to the generic one, and holds the
+// material and first triangle of the geometry.
+//
+void HelloVulkan::createRtShaderBindingTable()
+{
+  // Starting from an empty table, as it is rebuilt when toggling the specialization
+  m_sbtWrapper.destroy();
+  m_sbtWrapper = nvvk::SBTWrapper();
+  m_sbtWrapper.setup(m_device, m_graphicsQueueIndex, &m_alloc, m_rtProperties);
+
+  m_sbtWrapper.addIndex(nvvk::SBTWrapper::eRaygen, 0);
+  m_sbtWrapper.addIndex(nvvk::SBTWrapper::eMiss, 1);
+  m_sbtWrapper.addIndex(nvvk::SBTWrapper::eMiss, 2);
+
+  m_hitRecords.clear();
+  std::vector<uint32_t> hitGroups;
+  for(const auto& instance : m_objInstance)
+  {
+    for(const auto& geom : m_objModel[instance.objIndex].geometries)
+    {
+      m_hitRecords.push_back({static_cast<int>(geom.firstPrimitive), geom.materialId});
+      hitGroups.push_back(m_specializeMaterials ? m_classHitGroup[geom.matClass.key()] :
+                                                  m_genericHitGroup);
+    }
+  }
+  for(uint32_t i = 0; i < static_cast<uint32_t>(hitGroups.size()); i++)
+  {
+    m_sbtWrapper.addIndex(nvvk::SBTWrapper::eHit, hitGroups[i]);
+    m_sbtWrapper.addData(nvvk::SBTWrapper::eHit, i, m_hitRecords[i]);
+  }
+  m_sbtWrapper.create(m_rtPipeline);
+}
+
 //--------------------------------------------------------------------------------------------------
 // Ray Tracing the scene
 //
@@ -942,7 +1047,6 @@ void HelloVulkan::raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f&
   m_rtPushConstants.lightPosition  = m_pushConstant.lightPosition;
   m_rtPushConstants.lightIntensity = m_pushConstant.lightIntensity;
   m_rtPushConstants.lightType      = m_pushConstant.lightType;
-  m_rtPushConstants.specialization = m_pushConstant.specialization;
 
   cmdBuf.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, m_rtPipeline);
   cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eRayTracingKHR, m_rtPipelineLayout, 0,
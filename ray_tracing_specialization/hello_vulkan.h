@@ -18,6 +18,7 @@
  */
 
 #pragma once
+#include <unordered_map>
 #include <vulkan/vulkan.hpp>
 
 
@@ -25,6 +26,7 @@
 #include "nvvk/debug_util_vk.hpp"
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/memallocator_dma_vk.hpp"
+#include "obj_loader.h"
 
 // #VKRay
 #include "nvvk/raytraceKHR_vk.hpp"
@@ -57,15 +59,37 @@ public:
   void destroyResources();
   void rasterize(const vk::CommandBuffer& cmdBuff);
 
+  // Class of a material, selecting the specialized closest-hit shader: the specialization
+  // constants of raytrace.rchit (illumination model, textured, emissive) are set from it.
+  struct MaterialClass
+  {
+    int illum{2};  // 0: color, 1: + ambient, 2 and above: + specular
+    int textured{0};
+    int emissive{0};
+
+    static MaterialClass classify(const MaterialObj& mat);
+    uint32_t             key() const { return (illum << 2) | (textured << 1) | emissive; }
+  };
+
+  // Triangles of a model using the same material, one BLAS geometry each
+  struct MaterialGeometry
+  {
+    uint32_t      firstPrimitive{0};
+    uint32_t      nbPrimitives{0};
+    int32_t       materialId{0};
+    MaterialClass matClass;
+  };
+
   // The OBJ model
   struct ObjModel
   {
-    uint32_t     nbIndices{0};
-    uint32_t     nbVertices{0};
-    nvvk::Buffer vertexBuffer;    // Device buffer of all 'Vertex'
-    nvvk::Buffer indexBuffer;     // Device buffer of the indices forming triangles
-    nvvk::Buffer matColorBuffer;  // Device buffer of array of 'Wavefront material'
-    nvvk::Buffer matIndexBuffer;  // Device buffer of array of 'Wavefront material'
+    uint32_t                      nbIndices{0};
+    uint32_t                      nbVertices{0};
+    nvvk::Buffer                  vertexBuffer;    // Device buffer of all 'Vertex'
+    nvvk::Buffer                  indexBuffer;     // Device buffer of the indices forming triangles
+    nvvk::Buffer                  matColorBuffer;  // Device buffer of array of 'Wavefront material'
+    nvvk::Buffer                  matIndexBuffer;  // Device buffer of array of 'Wavefront material'
+    std::vector<MaterialGeometry> geometries;      // Triangles are sorted by material
   };
 
   // Instance of the OBJ
@@ -83,8 +107,7 @@ public:
     nvmath::vec3f lightPosition{10.f, 15.f, 8.f};
     int           instanceId{0};  // To retrieve the transformation matrix
     float         lightIntensity{100.f};
-    int           lightType{0};       // 0: point, 1: infinite
-    int           specialization{7};  // all in use
+    int           lightType{0};  // 0: point, 1: infinite
   };
   ObjPushConstant m_pushConstant;
 
@@ -135,6 +158,7 @@ public:
   void createRtDescriptorSet();
   void updateRtDescriptorSet();
   void createRtPipeline();
+  void createRtShaderBindingTable();
   void raytrace(const vk::CommandBuffer& cmdBuf, const nvmath::vec4f& clearColor);
 
 
@@ -149,12 +173,24 @@ public:
   vk::Pipeline                                        m_rtPipeline;
   nvvk::SBTWrapper                                    m_sbtWrapper;
 
+  // Specialized hit groups: one per material class found in the scene, plus a generic one
+  // reading the material at run time. Each geometry of each instance has its own SBT record,
+  // pointing to the hit group of its class.
+  struct HitRecord
+  {
+    int firstPrimitive{0};  // gl_PrimitiveID is relative to the geometry
+    int materialId{0};
+  };
+  std::unordered_map<uint32_t, uint32_t> m_classHitGroup;  // MaterialClass::key -> group index
+  uint32_t                               m_genericHitGroup{0};
+  std::vector<HitRecord>                 m_hitRecords;
+  bool                                   m_specializeMaterials{true};
+
   struct RtPushConstant
   {
     nvmath::vec4f clearColor;
     nvmath::vec3f lightPosition;
     float         lightIntensity{100.0f};
     int           lightType{0};
-    int           specialization{7};
   } m_rtPushConstants;
 };
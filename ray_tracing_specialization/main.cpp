@@ -66,16 +66,15 @@ void renderUI(HelloVulkan& helloVk)
     ImGui::SliderFloat("Intensity", &helloVk.m_pushConstant.lightIntensity, 0.f, 150.f);
   }
 
-  // Specialization
-  ImGui::SliderInt("Specialization", &helloVk.m_pushConstant.specialization, 0, 7);
-  int s = helloVk.m_pushConstant.specialization;
-  int a = ((s >> 2) % 2) == 1;
-  int b = ((s >> 1) % 2) == 1;
-  int c = ((s >> 0) % 2) == 1;
-  ImGui::Checkbox("Use Diffuse", (bool*)&a);
-  ImGui::Checkbox("Use Specular", (bool*)&b);
-  ImGui::Checkbox("Trace shadow", (bool*)&c);
-  helloVk.m_pushConstant.specialization = (a << 2) + (b << 1) + c;
+  // Specialization: hit groups specialized per material class, or the generic one everywhere
+  if(ImGui::Checkbox("Specialize per material", &helloVk.m_specializeMaterials))
+  {
+    helloVk.getDevice().waitIdle();
+    helloVk.createRtShaderBindingTable();
+  }
+  ImGui::Text("%d material classes, %d hit records",
+              static_cast<int>(helloVk.m_classHitGroup.size()),
+              static_cast<int>(helloVk.m_hitRecords.size()));
 }
 
 //////////////////////////////////////////////////////////////////////////